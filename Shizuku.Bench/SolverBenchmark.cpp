@@ -0,0 +1,372 @@
+#include "Solver/CpuLbm.h"
+#include "Solver/PackedLattice.h"
+#include "Shizuku.Core/Utilities/Profiler.h"
+#include "Shizuku.Core/Utilities/Stopwatch.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Shizuku::Core;
+using namespace Shizuku::Flow;
+
+namespace
+{
+    enum Layout{EMPTY,BLOCK,ARRAY};
+
+    //! Bytes an LLC miss moves from memory
+    const int CacheLineBytes = 64;
+
+    const char* LayoutName(const Layout p_layout)
+    {
+        switch (p_layout)
+        {
+        case Layout::EMPTY:
+            return "empty";
+        case Layout::BLOCK:
+            return "block";
+        default:
+            return "array";
+        }
+    }
+
+    struct Variant
+    {
+        const char* Name;
+        Shizuku::Flow::Precision Precision;
+        DistributionStorage Storage;
+        StreamingMode Streaming;
+        bool Simd;
+        //! Temporal blocking steps, 1 for off
+        int StepsPerTile;
+    };
+
+    //! fp32 ping-pong with the solver defaults is the baseline the other sweeps use
+    const Variant variants[] = {
+        { "fp32", Precision::FP32, DistributionStorage::FULL, StreamingMode::PING_PONG, true, 4 },
+        { "fp32-unblocked", Precision::FP32, DistributionStorage::FULL, StreamingMode::PING_PONG, true, 1 },
+        { "fp32-scalar", Precision::FP32, DistributionStorage::FULL, StreamingMode::PING_PONG, false, 4 },
+        { "fp32-in-place", Precision::FP32, DistributionStorage::FULL, StreamingMode::IN_PLACE, true, 1 },
+        { "fp16", Precision::FP32, DistributionStorage::FLOAT16, StreamingMode::PING_PONG, true, 4 },
+        { "bf16", Precision::FP32, DistributionStorage::BFLOAT16, StreamingMode::PING_PONG, true, 4 },
+        { "fp64", Precision::FP64, DistributionStorage::FULL, StreamingMode::PING_PONG, false, 4 },
+    };
+
+    struct Case
+    {
+        const char* Group;
+        int XDim;
+        int YDim;
+        Layout Obstacles;
+        int TimeStepsPerFrame;
+        const Variant* Solver;
+    };
+
+    struct Result
+    {
+        long long Steps;
+        double Seconds;
+        double Mlups;
+        double SolidFraction;
+        double BytesPerUpdate;
+        //! What the CpuLattice zones counted over the timed frames, if counters were on and could be opened
+        bool Counted;
+        CounterSample Counters;
+    };
+
+    void AddSquare(CpuLbm& p_lbm, const int p_x0, const int p_y0, const int p_size)
+    {
+        for (int y = std::max(p_y0, 1); y < std::min(p_y0 + p_size, p_lbm.GetYDim() - 1); y++)
+            for (int x = std::max(p_x0, 0); x < std::min(p_x0 + p_size, p_lbm.GetXDim()); x++)
+                p_lbm.SetNodeType(x, y, NodeType::OBSTRUCTION);
+    }
+
+    //! BLOCK is one block in the first third of the channel, as in the interactive default. ARRAY is a staggered
+    //! bank of small blocks over the middle half, so many tiles hold both fluid and solid nodes.
+    void AddObstacles(CpuLbm& p_lbm, const Layout p_layout)
+    {
+        const int xDim = p_lbm.GetXDim();
+        const int yDim = p_lbm.GetYDim();
+        if (p_layout == Layout::BLOCK)
+        {
+            const int size = yDim / 8;
+            AddSquare(p_lbm, xDim / 4, yDim / 2 - size / 2, size);
+        }
+        else if (p_layout == Layout::ARRAY)
+        {
+            const int size = std::max(yDim / 16, 2);
+            const int spacing = 2*size;
+            int column = 0;
+            for (int x = xDim / 4; x + size < 3*xDim / 4; x += spacing, column++)
+                for (int y = (column % 2)*size + size; y + size < yDim - size; y += spacing)
+                    AddSquare(p_lbm, x, y, size);
+        }
+    }
+
+    double SolidFraction(CpuLbm& p_lbm)
+    {
+        long long solid = 0;
+        for (int y = 0; y < p_lbm.GetYDim(); y++)
+            for (int x = 0; x < p_lbm.GetXDim(); x++)
+                if (p_lbm.GetImage()[x + y*p_lbm.GetPitch()] == NodeType::OBSTRUCTION)
+                    solid++;
+        return static_cast<double>(solid) / (static_cast<double>(p_lbm.GetXDim())*p_lbm.GetYDim());
+    }
+
+    //! Main memory traffic the kernel needs at least: every distribution read and written once per pass over the
+    //! lattice, plus the node type. Temporal blocking makes one pass per StepsPerTile steps, the steps in between
+    //! stay in cache. Halo recomputation and skipped solid tiles aren't counted.
+    double BytesPerUpdate(const Variant& p_variant, const int p_timeStepsPerFrame)
+    {
+        const double perPass = 2.0*9*Packed::ElementSize(p_variant.Storage, p_variant.Precision) + sizeof(int);
+        if (p_variant.Streaming == StreamingMode::IN_PLACE || p_variant.StepsPerTile <= 1)
+            return perPass;
+        const int passes = (p_timeStepsPerFrame + p_variant.StepsPerTile - 1) / p_variant.StepsPerTile;
+        return perPass*passes / p_timeStepsPerFrame;
+    }
+
+    //! Runs whole frames of MarchSolution, as the window does, until about p_updates lattice updates are done or
+    //! for p_steps steps if that is set
+    Result Run(const Case& p_case, std::shared_ptr<ThreadPool> p_pool, const double p_updates, const int p_steps)
+    {
+        CpuLbm lbm(p_case.XDim, p_case.YDim, p_pool);
+        lbm.InitializeImage();
+        AddObstacles(lbm, p_case.Obstacles);
+        lbm.SetStreamingMode(p_case.Solver->Streaming);
+        lbm.SetPrecision(p_case.Solver->Precision);
+        lbm.SetDistributionStorage(p_case.Solver->Storage);
+        lbm.UseSimd(p_case.Solver->Simd);
+        lbm.SetTemporalBlocking(p_case.Solver->StepsPerTile, lbm.GetTileHeight());
+        lbm.SetTimeStepsPerFrame(p_case.TimeStepsPerFrame);
+        lbm.Initialize();
+        //warm up caches and the pool
+        lbm.MarchSolution();
+
+        const double nodes = static_cast<double>(p_case.XDim)*p_case.YDim;
+        const long long steps = p_steps > 0 ? p_steps : static_cast<long long>(p_updates / nodes);
+        const long long frames = std::max(1ll, (steps + p_case.TimeStepsPerFrame - 1) / p_case.TimeStepsPerFrame);
+        const long long start = lbm.GetTimeStep();
+        const bool counting = Profiler::IsCounting();
+        Profiler::Reset();
+        Stopwatch stopwatch;
+        stopwatch.Tick();
+        for (long long i = 0; i < frames; i++)
+        {
+            lbm.MarchSolution();
+            //keep the rings from filling on small domains
+            if (counting)
+                Profiler::Collect();
+        }
+
+        Result result;
+        result.Seconds = stopwatch.Tock();
+        const ZoneStats lattice = Profiler::GetStats("CpuLattice");
+        result.Counted = counting && lattice.CountedRuns > 0;
+        result.Counters = lattice.Counters;
+        //IN_PLACE rounds odd frames up, so count what was actually done
+        result.Steps = lbm.GetTimeStep() - start;
+        result.Mlups = result.Seconds > 0.0 ? nodes*result.Steps / result.Seconds*1e-6 : 0.0;
+        result.SolidFraction = SolidFraction(lbm);
+        result.BytesPerUpdate = BytesPerUpdate(*p_case.Solver, p_case.TimeStepsPerFrame);
+        return result;
+    }
+
+    //! Counters per lattice update. IPC and LLC traffic only mean something with hardware counters, the backend
+    //! stalls only where the CPU counts them; the rest are null. Low IPC with measured bytes close to the model's
+    //! is a variant bound by memory bandwidth, high IPC with few bytes one bound by compute.
+    void WriteCounters(FILE* p_file, const Case& p_case, const Result& p_result, const int p_threads)
+    {
+        if (!p_result.Counted)
+        {
+            fprintf(p_file, "null");
+            return;
+        }
+        const CounterSample& counters = p_result.Counters;
+        const double updates = static_cast<double>(p_case.XDim)*p_case.YDim*p_result.Steps;
+        const double cpuSeconds = counters.TaskClock*1e-9;
+        fprintf(p_file, "{\"cpuSeconds\": %.6f, \"utilization\": %.3f", cpuSeconds,
+            p_result.Seconds > 0.0 ? cpuSeconds / (p_result.Seconds*p_threads) : 0.0);
+        if (PerfCounters::HasHardwareCounters())
+            fprintf(p_file, ", \"ipc\": %.3f, \"instructionsPerUpdate\": %.2f, \"llcMissesPerUpdate\": %.4f, "
+                "\"measuredBytesPerUpdate\": %.2f", PerfCounters::Ipc(counters), counters.Instructions / updates,
+                counters.LlcMisses / updates, counters.LlcMisses*CacheLineBytes / updates);
+        else
+            fprintf(p_file, ", \"ipc\": null, \"instructionsPerUpdate\": null, \"llcMissesPerUpdate\": null, "
+                "\"measuredBytesPerUpdate\": null");
+        if (PerfCounters::HasStalledCycles() && counters.Cycles > 0)
+            fprintf(p_file, ", \"backendStallFraction\": %.3f}",
+                static_cast<double>(counters.StalledCycles) / counters.Cycles);
+        else
+            fprintf(p_file, ", \"backendStallFraction\": null}");
+    }
+
+    std::vector<int> ParseList(const std::string& p_list)
+    {
+        std::vector<int> values;
+        std::stringstream stream(p_list);
+        std::string value;
+        while (std::getline(stream, value, ','))
+            values.push_back(std::stoi(value));
+        return values;
+    }
+
+    bool HasGroup(const std::string& p_groups, const char* p_group)
+    {
+        return p_groups == "all" || ("," + p_groups + ",").find(std::string(",") + p_group + ",") != std::string::npos;
+    }
+
+    //! Each group varies one parameter around the baseline: a 1024x512 channel with one block, 15 steps per frame
+    //! and the fp32 variant
+    std::vector<Case> BuildCases(const std::string& p_groups, const std::vector<int>& p_sizes)
+    {
+        const Variant* baseline = &variants[0];
+        std::vector<Case> cases;
+        if (HasGroup(p_groups, "size"))
+            for (const int size : p_sizes)
+                cases.push_back({ "size", size, size / 2, Layout::BLOCK, 15, baseline });
+        if (HasGroup(p_groups, "layout"))
+            for (const Layout layout : { Layout::EMPTY, Layout::BLOCK, Layout::ARRAY })
+                cases.push_back({ "layout", 1024, 512, layout, 15, baseline });
+        if (HasGroup(p_groups, "frame"))
+            for (const int timeSteps : { 1, 2, 4, 15, 60 })
+                cases.push_back({ "frame", 1024, 512, Layout::BLOCK, timeSteps, baseline });
+        if (HasGroup(p_groups, "variant"))
+            for (const Variant& variant : variants)
+                cases.push_back({ "variant", 1024, 512, Layout::BLOCK, 15, &variant });
+        return cases;
+    }
+
+    void WriteJson(FILE* p_file, const int p_threads, const double p_updates, const int p_steps,
+        const std::vector<Case>& p_cases, const std::vector<Result>& p_results)
+    {
+        fprintf(p_file, "{\n  \"threads\": %d,\n  \"updatesPerRun\": %.0f,\n  \"steps\": %d,\n  \"results\": [",
+            p_threads, p_updates, p_steps);
+        for (size_t i = 0; i < p_cases.size(); i++)
+        {
+            const Case& c = p_cases[i];
+            const Result& r = p_results[i];
+            const Variant& v = *c.Solver;
+            fprintf(p_file, "%s\n    {\"group\": \"%s\", \"xDim\": %d, \"yDim\": %d, \"layout\": \"%s\", "
+                "\"solidFraction\": %.4f, \"timeStepsPerFrame\": %d, \"variant\": \"%s\", \"precision\": \"%s\", "
+                "\"storage\": \"%s\", \"streaming\": \"%s\", \"simd\": %s, \"stepsPerTile\": %d, \"steps\": %lld, "
+                "\"seconds\": %.6f, \"mlups\": %.3f, \"bytesPerUpdate\": %.2f, \"bandwidthGBs\": %.3f, \"counters\": ",
+                i == 0 ? "" : ",", c.Group, c.XDim, c.YDim, LayoutName(c.Obstacles), r.SolidFraction,
+                c.TimeStepsPerFrame, v.Name, Packed::PrecisionName(v.Precision), Packed::StorageName(v.Storage),
+                v.Streaming == StreamingMode::IN_PLACE ? "in-place" : "ping-pong", v.Simd ? "true" : "false",
+                v.StepsPerTile, r.Steps, r.Seconds, r.Mlups, r.BytesPerUpdate, r.Mlups*r.BytesPerUpdate*1e-3);
+            WriteCounters(p_file, c, r, p_threads);
+            fprintf(p_file, "}");
+        }
+        fprintf(p_file, "\n  ]\n}\n");
+    }
+}
+
+//! Host solver throughput, swept over domain sizes, obstacle layouts, time steps per frame and solver variants:
+//! shizuku_bench [-n <steps>] [-u <million updates per run>] [-t <threads>] [-s <sizes>] [-g <groups>] [-o <json>] [-c]
+//! Groups are size, layout, frame and variant, comma separated, or all. The table goes to stderr and the JSON to
+//! stdout unless -o names a file. -c reads the hardware counters of the solver threads, see PerfCounters.
+int main(int argc, char **argv)
+{
+    int steps = 0;
+    double updates = 50e6;
+    int threads = 0;
+    std::vector<int> sizes = { 128, 256, 512, 1024, 2048, 4096 };
+    std::string groups = "all";
+    std::string output;
+    bool counters = false;
+    const char* usage = "Usage: %s [-n <steps>] [-u <million updates per run>] [-t <threads>] [-s <sizes>] "
+        "[-g <groups>] [-o <json>] [-c]\n";
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string flag = argv[i];
+        if (flag == "-c")
+        {
+            counters = true;
+            continue;
+        }
+        if (flag != "-n" && flag != "-u" && flag != "-t" && flag != "-s" && flag != "-g" && flag != "-o")
+        {
+            fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+            fprintf(stderr, usage, argv[0]);
+            return 1;
+        }
+        if (i + 1 == argc)
+        {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            fprintf(stderr, usage, argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        try
+        {
+            if (flag == "-n")
+                steps = std::stoi(value);
+            else if (flag == "-u")
+                updates = std::stod(value)*1e6;
+            else if (flag == "-t")
+                threads = std::stoi(value);
+            else if (flag == "-s")
+                sizes = ParseList(value);
+            else if (flag == "-g")
+                groups = value;
+            else
+                output = value;
+        }
+        catch (const std::logic_error&)
+        {
+            fprintf(stderr, "Bad value '%s' for %s\n", value, flag.c_str());
+            fprintf(stderr, usage, argv[0]);
+            return 1;
+        }
+    }
+    std::shared_ptr<ThreadPool> pool = threads > 0 ? std::make_shared<ThreadPool>(threads)
+        : std::make_shared<ThreadPool>();
+
+    if (counters)
+    {
+        Profiler::Enable(true);
+        Profiler::EnableCounters(true);
+    }
+
+    const std::vector<Case> cases = BuildCases(groups, sizes);
+    std::vector<Result> results;
+    fprintf(stderr, "%d threads\n", pool->ThreadCount());
+    fprintf(stderr, "%-8s %-10s %-6s %5s %-15s %10s %8s %8s", "group", "domain", "layout", "tpf", "variant",
+        "MLUPS", "B/update", "GB/s");
+    fprintf(stderr, counters ? " %6s %10s\n" : "\n", "IPC", "LLC B/upd");
+    for (const Case& c : cases)
+    {
+        const Result r = Run(c, pool, updates, steps);
+        results.push_back(r);
+        const std::string domain = std::to_string(c.XDim) + "x" + std::to_string(c.YDim);
+        fprintf(stderr, "%-8s %-10s %-6s %5d %-15s %10.1f %8.1f %8.2f", c.Group, domain.c_str(),
+            LayoutName(c.Obstacles), c.TimeStepsPerFrame, c.Solver->Name, r.Mlups, r.BytesPerUpdate,
+            r.Mlups*r.BytesPerUpdate*1e-3);
+        if (!counters)
+            fprintf(stderr, "\n");
+        else if (r.Counted && PerfCounters::HasHardwareCounters())
+        {
+            const double nodeSteps = static_cast<double>(c.XDim)*c.YDim*r.Steps;
+            fprintf(stderr, " %6.2f %10.1f\n", PerfCounters::Ipc(r.Counters),
+                r.Counters.LlcMisses*CacheLineBytes / nodeSteps);
+        }
+        else
+            fprintf(stderr, " %6s %10s\n", "n/a", "n/a");
+    }
+    if (counters && !PerfCounters::HasHardwareCounters())
+        fprintf(stderr, "No hardware counters here, perf_event_open refused them\n");
+
+    FILE* file = output.empty() ? stdout : fopen(output.c_str(), "w");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Can't write %s\n", output.c_str());
+        return 1;
+    }
+    WriteJson(file, pool->ThreadCount(), updates, steps, cases, results);
+    if (file != stdout)
+        fclose(file);
+    return 0;
+}
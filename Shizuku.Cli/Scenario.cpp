@@ -0,0 +1,187 @@
+#include "Scenario.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace Shizuku::Cli;
+using namespace Shizuku::Flow;
+
+namespace
+{
+    std::runtime_error ParseError(const int p_line, const std::string& p_message)
+    {
+        return std::runtime_error("line " + std::to_string(p_line) + ": " + p_message);
+    }
+
+    template <typename T>
+    T Read(std::istringstream& p_args, const int p_line, const std::string& p_key)
+    {
+        T value;
+        if (!(p_args >> value))
+            throw ParseError(p_line, "missing or bad value for '" + p_key + "'");
+        return value;
+    }
+
+    Precision PrecisionFromName(const std::string& p_name, const int p_line)
+    {
+        for (const Precision precision : { Precision::FP32, Precision::FP64 })
+        {
+            if (p_name == Packed::PrecisionName(precision))
+                return precision;
+        }
+        throw ParseError(p_line, "unknown precision '" + p_name + "'");
+    }
+
+    DistributionStorage StorageFromName(const std::string& p_name, const int p_line)
+    {
+        for (const DistributionStorage storage : { DistributionStorage::FULL, DistributionStorage::FLOAT16,
+            DistributionStorage::BFLOAT16 })
+        {
+            if (p_name == Packed::StorageName(storage))
+                return storage;
+        }
+        throw ParseError(p_line, "unknown storage '" + p_name + "'");
+    }
+}
+
+Scenario::Scenario()
+    : XDim(256), YDim(128), InletVelocity(0.05f), Omega(1.975f), ThreadCount(0),
+    Precision(Precision::FP32), Storage(DistributionStorage::FULL), Streaming(StreamingMode::PING_PONG),
+    SleepThreshold(0.f), Steps(1000), OutputInterval(0), CheckpointInterval(0), HistoryInterval(0)
+{
+}
+
+Scenario Scenario::Load(const std::string& p_path)
+{
+    std::ifstream file(p_path);
+    if (!file)
+        throw std::runtime_error("cannot open " + p_path);
+    std::stringstream text;
+    text << file.rdbuf();
+    return Parse(text.str());
+}
+
+Scenario Scenario::Parse(const std::string& p_text)
+{
+    Scenario scenario;
+    std::istringstream lines(p_text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        lineNumber++;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        std::istringstream args(line);
+        std::string key;
+        if (!(args >> key))
+            continue;
+
+        if (key == "domain")
+        {
+            scenario.XDim = Read<int>(args, lineNumber, key);
+            scenario.YDim = Read<int>(args, lineNumber, key);
+            if (scenario.XDim < 2 || scenario.YDim < 2)
+                throw ParseError(lineNumber, "domain must be at least 2 x 2");
+        }
+        else if (key == "velocity")
+            scenario.InletVelocity = Read<float>(args, lineNumber, key);
+        else if (key == "omega")
+            scenario.Omega = Read<float>(args, lineNumber, key);
+        else if (key == "threads")
+            scenario.ThreadCount = Read<int>(args, lineNumber, key);
+        else if (key == "precision")
+            scenario.Precision = PrecisionFromName(Read<std::string>(args, lineNumber, key), lineNumber);
+        else if (key == "storage")
+            scenario.Storage = StorageFromName(Read<std::string>(args, lineNumber, key), lineNumber);
+        else if (key == "streaming")
+        {
+            const std::string mode = Read<std::string>(args, lineNumber, key);
+            if (mode == "pingpong")
+                scenario.Streaming = StreamingMode::PING_PONG;
+            else if (mode == "inplace")
+                scenario.Streaming = StreamingMode::IN_PLACE;
+            else
+                throw ParseError(lineNumber, "unknown streaming mode '" + mode + "'");
+        }
+        else if (key == "sleep")
+            scenario.SleepThreshold = Read<float>(args, lineNumber, key);
+        else if (key == "obst")
+        {
+            const std::string shape = Read<std::string>(args, lineNumber, key);
+            if (shape != "square")
+                throw ParseError(lineNumber, "unknown obstruction shape '" + shape + "'");
+            ObstDefinition obst = {};
+            obst.shape = Shape::SQUARE;
+            obst.x = Read<float>(args, lineNumber, key);
+            obst.y = Read<float>(args, lineNumber, key);
+            obst.r1 = Read<float>(args, lineNumber, key);
+            obst.r2 = obst.r1;
+            obst.state = State::NORMAL;
+            scenario.Obsts.push_back(obst);
+        }
+        else if (key == "steps")
+            scenario.Steps = Read<int>(args, lineNumber, key);
+        else if (key == "output")
+        {
+            scenario.OutputInterval = Read<int>(args, lineNumber, key);
+            scenario.OutputPrefix = Read<std::string>(args, lineNumber, key);
+        }
+        else if (key == "checkpoint")
+        {
+            scenario.CheckpointInterval = Read<int>(args, lineNumber, key);
+            scenario.CheckpointPrefix = Read<std::string>(args, lineNumber, key);
+        }
+        else if (key == "history")
+        {
+            scenario.HistoryInterval = Read<int>(args, lineNumber, key);
+            scenario.HistoryPath = Read<std::string>(args, lineNumber, key);
+        }
+        else if (key == "restart")
+            scenario.RestartPath = Read<std::string>(args, lineNumber, key);
+        else
+            throw ParseError(lineNumber, "unknown setting '" + key + "'");
+
+        std::string extra;
+        if (args >> extra)
+            throw ParseError(lineNumber, "unexpected '" + extra + "'");
+    }
+    scenario.Check(0);
+    return scenario;
+}
+
+void Scenario::Check(const long long p_startStep) const
+{
+    if (Steps < 0)
+        throw std::runtime_error("negative step count");
+    if (Streaming != StreamingMode::IN_PLACE)
+        return;
+    if (p_startStep % 2 != 0)
+        throw std::runtime_error("in-place streaming can't start from odd step " + std::to_string(p_startStep));
+    const std::pair<const char*, int> counts[] = { { "step count", Steps },
+        { "output interval", OutputPrefix.empty() ? 0 : OutputInterval },
+        { "checkpoint interval", CheckpointPrefix.empty() ? 0 : CheckpointInterval },
+        { "history interval", HistoryPath.empty() ? 0 : HistoryInterval } };
+    for (const auto& count : counts)
+    {
+        if (count.second % 2 != 0)
+            throw std::runtime_error(std::string("in-place streaming marches in step pairs, so the ") + count.first
+                + " has to be even, not " + std::to_string(count.second));
+    }
+}
+
+void Scenario::Apply(Simulation& p_simulation) const
+{
+    p_simulation.SetInletVelocity(InletVelocity);
+    p_simulation.SetOmega(Omega);
+    p_simulation.SetStreamingMode(Streaming);
+    p_simulation.SetPrecision(Precision);
+    p_simulation.SetDistributionStorage(Storage);
+    p_simulation.SetSleepThreshold(SleepThreshold);
+    p_simulation.ClearObstructions();
+    for (const ObstDefinition& obst : Obsts)
+        p_simulation.AddObstruction(obst);
+    p_simulation.Initialize();
+}
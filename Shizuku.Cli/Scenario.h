@@ -0,0 +1,56 @@
+#pragma once
+#include "Shizuku.Flow/Simulation.h"
+#include <string>
+#include <vector>
+
+namespace Shizuku { namespace Cli{
+    //! Run described by a scenario file: one setting per line, '#' starts a comment.
+    //!   domain <xDim> <yDim>
+    //!   velocity <u>
+    //!   omega <omega>
+    //!   threads <count>             0 for one per hardware thread
+    //!   precision fp32|fp64
+    //!   storage full|fp16|bf16      full stores the distributions at the precision above
+    //!   streaming pingpong|inplace
+    //!   sleep <threshold>           tiles changing less per step sleep, see Simulation::SetSleepThreshold
+    //!   obst square <x> <y> <r1>    model space, see Simulation
+    //!   steps <count>               steps to run, from the restart step if there is one
+    //!   output <interval> <prefix>  writes <prefix>_<step>.vtk every interval steps and at the end
+    //!   checkpoint <interval> <prefix>  writes <prefix>_<step>.ckpt every interval steps and at the end
+    //!   history <interval> <path>   records density and velocity every interval steps to a field history file
+    //!   restart <path>              carries on from a checkpoint, whose domain, obstructions and flow parameters
+    //!                               replace the ones above
+    //! In-place streaming marches in step pairs, so its step count and intervals have to be even.
+    struct Scenario
+    {
+        int XDim;
+        int YDim;
+        float InletVelocity;
+        float Omega;
+        int ThreadCount;
+        Flow::Precision Precision;
+        Flow::DistributionStorage Storage;
+        StreamingMode Streaming;
+        float SleepThreshold;
+        std::vector<Flow::ObstDefinition> Obsts;
+        int Steps;
+        int OutputInterval;
+        std::string OutputPrefix;
+        int CheckpointInterval;
+        std::string CheckpointPrefix;
+        int HistoryInterval;
+        std::string HistoryPath;
+        std::string RestartPath;
+
+        Scenario();
+
+        //! Throws std::runtime_error naming the line of the first bad setting
+        static Scenario Load(const std::string& p_path);
+        static Scenario Parse(const std::string& p_text);
+        //! Throws std::runtime_error if the run can't stop at every step it asks for, e.g. after changing Steps or
+        //! starting from the odd step p_startStep with in-place streaming
+        void Check(const long long p_startStep) const;
+
+        void Apply(Flow::Simulation& p_simulation) const;
+    };
+} }
@@ -0,0 +1,57 @@
+#include "VtkWriter.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace Shizuku::Cli;
+using namespace Shizuku::Flow;
+
+namespace
+{
+    //! Legacy VTK binary data is big endian
+    void WriteBigEndian(std::ofstream& p_file, const float p_value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &p_value, sizeof(bits));
+        const char bytes[4] = { static_cast<char>(bits >> 24), static_cast<char>(bits >> 16),
+            static_cast<char>(bits >> 8), static_cast<char>(bits) };
+        p_file.write(bytes, 4);
+    }
+}
+
+bool Shizuku::Cli::WriteVtk(Simulation& p_simulation, const std::string& p_path)
+{
+    const int xDim = p_simulation.GetXDim();
+    const int yDim = p_simulation.GetYDim();
+    const size_t nodeCount = static_cast<size_t>(xDim)*yDim;
+    std::vector<float> rho(nodeCount);
+    std::vector<float> u(nodeCount);
+    std::vector<float> v(nodeCount);
+    p_simulation.GetFields(rho.data(), u.data(), v.data());
+
+    std::ofstream file(p_path, std::ios::binary);
+    if (!file)
+        return false;
+    file << "# vtk DataFile Version 3.0\n"
+        << "Shizuku step " << p_simulation.GetTimeStep() << "\n"
+        << "BINARY\n"
+        << "DATASET STRUCTURED_POINTS\n"
+        << "DIMENSIONS " << xDim << " " << yDim << " 1\n"
+        << "ORIGIN 0 0 0\n"
+        << "SPACING 1 1 1\n"
+        << "POINT_DATA " << nodeCount << "\n";
+
+    file << "SCALARS rho float 1\nLOOKUP_TABLE default\n";
+    for (const float value : rho)
+        WriteBigEndian(file, value);
+    file << "\nVECTORS velocity float\n";
+    for (size_t i = 0; i < nodeCount; i++)
+    {
+        WriteBigEndian(file, u[i]);
+        WriteBigEndian(file, v[i]);
+        WriteBigEndian(file, 0.f);
+    }
+    file << "\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include "Shizuku.Flow/Simulation.h"
+#include <string>
+
+namespace Shizuku { namespace Cli{
+    //! Writes rho and the velocity of every node as a legacy binary VTK structured points file, which ParaView and
+    //! VisIt read directly. Returns false if the file can't be written.
+    bool WriteVtk(Flow::Simulation& p_simulation, const std::string& p_path);
+} }
@@ -0,0 +1,195 @@
+#include "Scenario.h"
+#include "VtkWriter.h"
+#include "Shizuku.Flow/Simulation.h"
+#include "Shizuku.Flow/Solver/CheckpointWriter.h"
+#include "Shizuku.Flow/Solver/FieldHistoryWriter.h"
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace Shizuku::Cli;
+using namespace Shizuku::Flow;
+
+namespace
+{
+    bool WriteOutput(Simulation& p_simulation, const Scenario& p_scenario)
+    {
+        const std::string path = p_scenario.OutputPrefix + "_" + std::to_string(p_simulation.GetTimeStep()) + ".vtk";
+        if (!WriteVtk(p_simulation, path))
+        {
+            fprintf(stderr, "Cannot write %s\n", path.c_str());
+            return false;
+        }
+        printf("Wrote %s\n", path.c_str());
+        return true;
+    }
+
+    //! Steps until the next multiple of p_interval after p_step; never if p_interval is 0
+    long long StepsToNext(const long long p_step, const int p_interval)
+    {
+        return p_interval > 0 ? p_interval - p_step % p_interval : std::numeric_limits<long long>::max();
+    }
+}
+
+//! Runs a scenario file without a display or GPU: shizuku.cli <scenario> [-n <steps>]
+int main(int argc, char **argv)
+{
+    std::string scenarioPath;
+    int stepsOverride = -1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "-n" && i + 1 < argc)
+        {
+            try
+            {
+                stepsOverride = std::stoi(argv[++i]);
+            }
+            catch (const std::logic_error&)
+            {
+                stepsOverride = -1;
+            }
+            if (stepsOverride < 0)
+            {
+                fprintf(stderr, "Bad step count '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else
+            scenarioPath = argv[i];
+    }
+    if (scenarioPath.empty())
+    {
+        fprintf(stderr, "Usage: %s <scenario> [-n <steps>]\n", argv[0]);
+        return 1;
+    }
+
+    Scenario scenario;
+    try
+    {
+        scenario = Scenario::Load(scenarioPath);
+    }
+    catch (const std::runtime_error& e)
+    {
+        fprintf(stderr, "%s: %s\n", scenarioPath.c_str(), e.what());
+        return 1;
+    }
+    if (stepsOverride >= 0)
+        scenario.Steps = stepsOverride;
+
+    Checkpoint restart;
+    if (!scenario.RestartPath.empty())
+    {
+        try
+        {
+            restart = CheckpointFile::Read(scenario.RestartPath);
+        }
+        catch (const std::runtime_error& e)
+        {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        scenario.XDim = restart.XDim;
+        scenario.YDim = restart.YDim;
+        scenario.Obsts = restart.Obsts;
+        scenario.Streaming = restart.Streaming;
+    }
+    try
+    {
+        scenario.Check(scenario.RestartPath.empty() ? 0 : restart.Step);
+    }
+    catch (const std::runtime_error& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    Simulation simulation(scenario.XDim, scenario.YDim, scenario.ThreadCount);
+    scenario.Apply(simulation);
+    if (!scenario.RestartPath.empty())
+    {
+        simulation.RestoreCheckpoint(restart);
+        printf("Restarted from %s at step %lld\n", scenario.RestartPath.c_str(), simulation.GetTimeStep());
+    }
+    printf("%d x %d, %d obstructions, %s with %s storage, %d steps\n", scenario.XDim, scenario.YDim,
+        static_cast<int>(scenario.Obsts.size()), Packed::PrecisionName(scenario.Precision),
+        Packed::StorageName(scenario.Storage), scenario.Steps);
+
+    const bool output = !scenario.OutputPrefix.empty();
+    const int outputInterval = output ? scenario.OutputInterval : 0;
+    const bool checkpoint = !scenario.CheckpointPrefix.empty();
+    const int checkpointInterval = checkpoint ? scenario.CheckpointInterval : 0;
+    std::unique_ptr<CheckpointWriter> checkpointWriter(checkpoint ? new CheckpointWriter() : nullptr);
+    int checkpointCount = 0;
+    const bool history = !scenario.HistoryPath.empty() && scenario.HistoryInterval > 0;
+    const int historyInterval = history ? scenario.HistoryInterval : 0;
+    std::unique_ptr<FieldHistoryWriter> historyWriter;
+    if (history)
+    {
+        try
+        {
+            historyWriter.reset(new FieldHistoryWriter(scenario.HistoryPath, scenario.XDim, scenario.YDim));
+        }
+        catch (const std::runtime_error& e)
+        {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+    }
+    const long long endStep = simulation.GetTimeStep() + scenario.Steps;
+    double updates = 0.0;
+    double seconds = 0.0;
+    while (simulation.GetTimeStep() < endStep)
+    {
+        const long long step = simulation.GetTimeStep();
+        const int steps = static_cast<int>(std::min({ endStep - step, StepsToNext(step, outputInterval),
+            StepsToNext(step, checkpointInterval), StepsToNext(step, historyInterval) }));
+        simulation.Step(steps);
+        const double stepUpdates = static_cast<double>(simulation.GetTimeStep() - step)*scenario.XDim*scenario.YDim;
+        updates += stepUpdates;
+        if (simulation.GetMlups() > 0.0)
+            seconds += stepUpdates / (simulation.GetMlups()*1.e6);
+
+        const long long now = simulation.GetTimeStep();
+        const bool last = now >= endStep;
+        if (output && (last || (outputInterval > 0 && now % outputInterval == 0))
+            && !WriteOutput(simulation, scenario))
+            return 1;
+        if (checkpoint && (last || (checkpointInterval > 0 && now % checkpointInterval == 0)))
+        {
+            const std::string path = scenario.CheckpointPrefix + "_" + std::to_string(now) + ".ckpt";
+            checkpointWriter->Write(path, simulation.CaptureCheckpoint());
+            checkpointCount++;
+            printf("Checkpoint %s\n", path.c_str());
+        }
+        if (history && now % historyInterval == 0)
+        {
+            FieldFrame frame = historyWriter->AcquireFrame();
+            frame.Step = now;
+            simulation.GetFields(frame.Rho.data(), frame.U.data(), frame.V.data());
+            historyWriter->Append(std::move(frame));
+        }
+    }
+    //the writer only keeps the error of its last write, so count the ones that made it
+    if (checkpointWriter && (!checkpointWriter->Wait() || checkpointWriter->GetWrittenCount() != checkpointCount))
+    {
+        fprintf(stderr, "Wrote %d of %d checkpoints. %s\n", checkpointWriter->GetWrittenCount(), checkpointCount,
+            checkpointWriter->GetLastError().c_str());
+        return 1;
+    }
+    if (historyWriter)
+    {
+        if (!historyWriter->Close())
+        {
+            fprintf(stderr, "%s\n", historyWriter->GetLastError().c_str());
+            return 1;
+        }
+        printf("Recorded %d frames to %s, %.1f MB\n", historyWriter->GetWrittenCount(), scenario.HistoryPath.c_str(),
+            historyWriter->GetBytesWritten()*1.e-6);
+    }
+
+    printf("%lld steps, %.1f MLUPS\n", simulation.GetTimeStep(), seconds > 0.0 ? updates / seconds*1.e-6 : 0.0);
+    return 0;
+}
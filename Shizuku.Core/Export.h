@@ -0,0 +1,13 @@
+#pragma once
+
+// CORE_API marks what the Shizuku.Core DLL exports. The portable build links the libraries statically and defines
+// SHIZUKU_STATIC, and other compilers have no __declspec, so it expands to nothing there.
+#if defined(_MSC_VER) && !defined(SHIZUKU_STATIC)
+#ifdef SHIZUKU_CORE_EXPORTS
+#define CORE_API __declspec(dllexport)
+#else
+#define CORE_API __declspec(dllimport)
+#endif
+#else
+#define CORE_API
+#endif
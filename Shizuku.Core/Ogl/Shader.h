@@ -4,11 +4,7 @@
 #include <glm/glm.hpp>
 #include <string>
 
-#ifdef SHIZUKU_CORE_EXPORTS  
-#define CORE_API __declspec(dllexport)   
-#else  
-#define CORE_API __declspec(dllimport)   
-#endif  
+#include "../Export.h"
 
 namespace Shizuku{
     namespace Core{
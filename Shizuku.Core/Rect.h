@@ -1,10 +1,6 @@
 #pragma once
 
-#ifdef SHIZUKU_CORE_EXPORTS  
-#define CORE_API __declspec(dllexport)   
-#else  
-#define CORE_API __declspec(dllimport)   
-#endif  
+#include "Export.h"
 
 namespace Shizuku{
     namespace Core{
@@ -2,11 +2,7 @@
 
 #include <algorithm>
 
-#ifdef SHIZUKU_CORE_EXPORTS  
-#define CORE_API __declspec(dllexport)   
-#else  
-#define CORE_API __declspec(dllimport)   
-#endif  
+#include "../Export.h"
 
 namespace Shizuku{ namespace Core{ namespace Types{
     template <typename T>
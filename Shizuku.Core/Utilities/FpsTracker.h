@@ -1,11 +1,7 @@
 #pragma once
 #include <time.h>
 
-#ifdef SHIZUKU_CORE_EXPORTS  
-#define CORE_API __declspec(dllexport)   
-#else  
-#define CORE_API __declspec(dllimport)   
-#endif  
+#include "../Export.h"
 
 namespace Shizuku{ namespace Core
 {
@@ -0,0 +1,91 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Shizuku::Core;
+
+namespace
+{
+    // Longest duration told apart, about a day; longer ones land in the last bucket
+    const int MaxBit = 46;
+
+    int HighestBit(std::uint64_t p_value)
+    {
+        int bit = -1;
+        while (p_value != 0)
+        {
+            p_value >>= 1;
+            bit++;
+        }
+        return bit;
+    }
+}
+
+const int LatencyHistogram::SubBucketBits;
+const int LatencyHistogram::SubBuckets;
+
+LatencyHistogram::LatencyHistogram() : m_counts((MaxBit - SubBucketBits + 2)*SubBuckets, 0), m_count(0), m_max(0.0)
+{
+}
+
+// Below SubBuckets every nanosecond has a bucket. Above, the bucket of value v with highest bit b >= SubBucketBits
+// is its top SubBucketBits + 1 bits, each power of two taking SubBuckets buckets after the exact ones.
+int LatencyHistogram::BucketIndex(const std::uint64_t p_nanoseconds)
+{
+    if (p_nanoseconds < static_cast<std::uint64_t>(SubBuckets))
+        return static_cast<int>(p_nanoseconds);
+    const int bit = std::min(HighestBit(p_nanoseconds), MaxBit);
+    const int shift = bit - SubBucketBits;
+    const int subBucket = static_cast<int>((p_nanoseconds >> shift) - SubBuckets);
+    return (shift + 1)*SubBuckets + std::min(subBucket, SubBuckets - 1);
+}
+
+double LatencyHistogram::BucketValue(const int p_index)
+{
+    if (p_index < SubBuckets)
+        return p_index;
+    const int shift = p_index / SubBuckets - 1;
+    const double width = std::ldexp(1.0, shift);
+    return (SubBuckets + p_index % SubBuckets)*width + (width - 1.0)*0.5;
+}
+
+void LatencyHistogram::Record(const double p_seconds)
+{
+    const double nanoseconds = std::min(std::max(p_seconds*1e9, 0.0), 1e18);
+    m_counts[BucketIndex(static_cast<std::uint64_t>(nanoseconds + 0.5))]++;
+    m_count++;
+    m_max = std::max(m_max, p_seconds);
+}
+
+void LatencyHistogram::Reset()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_count = 0;
+    m_max = 0.0;
+}
+
+long long LatencyHistogram::GetCount() const
+{
+    return m_count;
+}
+
+double LatencyHistogram::GetPercentile(const double p_percentile) const
+{
+    if (m_count == 0)
+        return 0.0;
+    const double fraction = std::min(std::max(p_percentile, 0.0), 100.0)*0.01;
+    const long long rank = std::max(1ll, static_cast<long long>(std::ceil(fraction*m_count)));
+    long long seen = 0;
+    for (size_t i = 0; i < m_counts.size(); i++)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+            return std::min(BucketValue(static_cast<int>(i))*1e-9, m_max);
+    }
+    return m_max;
+}
+
+double LatencyHistogram::GetMax() const
+{
+    return m_max;
+}
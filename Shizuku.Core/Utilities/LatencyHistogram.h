@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace Shizuku{ namespace Core
+{
+    // Fixed-size histogram of durations for percentiles, log-linear like HdrHistogram: durations are counted in
+    // nanoseconds, each power of two is split into SubBuckets equal buckets, so a percentile is off by at most
+    // 1/SubBuckets of its value (about 3%). Durations from 1 ns to a day fit in under 6 KB.
+    class LatencyHistogram
+    {
+    private:
+        std::vector<std::uint32_t> m_counts;
+        long long m_count;
+        double m_max;
+
+        static int BucketIndex(const std::uint64_t p_nanoseconds);
+        // Middle of the bucket, in nanoseconds
+        static double BucketValue(const int p_index);
+    public:
+        static const int SubBucketBits = 5;
+        static const int SubBuckets = 1 << SubBucketBits;
+
+        LatencyHistogram();
+
+        void Record(const double p_seconds);
+        void Reset();
+
+        long long GetCount() const;
+        // Seconds below which p_percentile (0 to 100) of the durations lie; 0 if nothing was recorded
+        double GetPercentile(const double p_percentile) const;
+        // Exact, not bucketed
+        double GetMax() const;
+    };
+}}
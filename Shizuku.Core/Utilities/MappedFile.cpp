@@ -0,0 +1,120 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Shizuku::Core;
+
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_mapping(nullptr), m_open(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const char* p_path)
+{
+    Close();
+#ifdef _WIN32
+    const HANDLE file = CreateFileA(p_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size > 0)
+    {
+        // the view keeps the file open, so the handle can go
+        m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (m_mapping == nullptr)
+        {
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr)
+        {
+            Close();
+            return false;
+        }
+    }
+    else
+        CloseHandle(file);
+#else
+    const int file = open(p_path, O_RDONLY);
+    if (file < 0)
+        return false;
+    struct stat info;
+    if (fstat(file, &info) != 0)
+    {
+        close(file);
+        return false;
+    }
+    m_size = static_cast<size_t>(info.st_size);
+    if (m_size > 0)
+    {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED)
+        {
+            close(file);
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<const unsigned char*>(data);
+    }
+    // the mapping outlives the descriptor
+    close(file);
+#endif
+    // an empty file has nothing to map but is still open
+    m_open = true;
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+#else
+    if (m_data != nullptr)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapping = nullptr;
+    m_open = false;
+}
+
+bool MappedFile::IsOpen() const
+{
+    return m_open;
+}
+
+const unsigned char* MappedFile::Data() const
+{
+    return m_data;
+}
+
+size_t MappedFile::Size() const
+{
+    return m_size;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+
+#include "../Export.h"
+
+namespace Shizuku{ namespace Core
+{
+    // Read-only mapping of a whole file. Pages are read in by the OS as they are touched, so readers can jump to any
+    // part of a large file without reading the rest.
+    class CORE_API MappedFile
+    {
+    private:
+        const unsigned char* m_data;
+        size_t m_size;
+        // File mapping object; only Windows needs it after the view is mapped
+        void* m_mapping;
+        bool m_open;
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Maps p_path, replacing any previous mapping. Returns false if the file can't be opened or mapped.
+        bool Open(const char* p_path);
+        void Close();
+        bool IsOpen() const;
+
+        // Null for an empty file
+        const unsigned char* Data() const;
+        size_t Size() const;
+    };
+}}
@@ -0,0 +1,149 @@
+#include "PerfCounters.h"
+#include <atomic>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace Shizuku::Core;
+
+namespace
+{
+    std::atomic<bool> s_hardware(false);
+    std::atomic<bool> s_stalledCycles(false);
+
+#ifdef __linux__
+    const int CounterCount = 5;
+
+    // The fields of CounterSample in order
+    long long& Field(CounterSample& p_sample, const int p_counter)
+    {
+        long long* fields[CounterCount] = { &p_sample.TaskClock, &p_sample.Cycles, &p_sample.Instructions,
+            &p_sample.LlcMisses, &p_sample.StalledCycles };
+        return *fields[p_counter];
+    }
+
+    // Task clock leads the group, as a software counter it opens wherever perf_event_open does, and the hardware
+    // counters join it if they can
+    class ThreadCounters
+    {
+    private:
+        int m_leader;
+        int m_fds[CounterCount];
+        // Position of each counter in the group read, -1 if it isn't open
+        int m_slots[CounterCount];
+        int m_opened;
+
+        int Open(const unsigned int p_type, const unsigned long long p_config, const int p_group)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = p_type;
+            attr.config = p_config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, p_group, 0));
+        }
+    public:
+        ThreadCounters() : m_leader(-1), m_opened(0)
+        {
+            const unsigned int types[CounterCount] = { PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+            const unsigned long long configs[CounterCount] = { PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_STALLED_CYCLES_BACKEND };
+            for (int i = 0; i < CounterCount; i++)
+            {
+                m_fds[i] = Open(types[i], configs[i], m_leader);
+                m_slots[i] = m_fds[i] >= 0 ? m_opened++ : -1;
+                if (i == 0)
+                {
+                    m_leader = m_fds[0];
+                    if (m_leader < 0)
+                        return;
+                }
+            }
+            if (m_slots[1] >= 0 && m_slots[2] >= 0)
+                s_hardware.store(true, std::memory_order_relaxed);
+            if (m_slots[4] >= 0)
+                s_stalledCycles.store(true, std::memory_order_relaxed);
+        }
+
+        ~ThreadCounters()
+        {
+            for (int i = CounterCount - 1; i >= 0; i--)
+            {
+                if (m_fds[i] >= 0)
+                    close(m_fds[i]);
+            }
+        }
+
+        ThreadCounters(const ThreadCounters&) = delete;
+        ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+        // Counts are scaled up by the share of time the group was scheduled, in case the PMU was multiplexed
+        bool Read(CounterSample& p_sample)
+        {
+            std::memset(&p_sample, 0, sizeof(p_sample));
+            if (m_leader < 0)
+                return false;
+            unsigned long long values[3 + CounterCount];
+            if (read(m_leader, values, sizeof(values)) < static_cast<ssize_t>((3 + m_opened)*sizeof(values[0])))
+                return false;
+            const double scale = values[2] > 0 ? static_cast<double>(values[1]) / values[2] : 1.0;
+            for (int i = 0; i < CounterCount; i++)
+            {
+                if (m_slots[i] >= 0)
+                    Field(p_sample, i) = static_cast<long long>(values[3 + m_slots[i]]*scale);
+            }
+            return true;
+        }
+    };
+#endif
+}
+
+CounterSample& CounterSample::operator+=(const CounterSample& p_other)
+{
+    TaskClock += p_other.TaskClock;
+    Cycles += p_other.Cycles;
+    Instructions += p_other.Instructions;
+    LlcMisses += p_other.LlcMisses;
+    StalledCycles += p_other.StalledCycles;
+    return *this;
+}
+
+CounterSample CounterSample::operator-(const CounterSample& p_other) const
+{
+    return CounterSample{ TaskClock - p_other.TaskClock, Cycles - p_other.Cycles,
+        Instructions - p_other.Instructions, LlcMisses - p_other.LlcMisses, StalledCycles - p_other.StalledCycles };
+}
+
+bool PerfCounters::Read(CounterSample& p_sample)
+{
+#ifdef __linux__
+    static thread_local ThreadCounters t_counters;
+    return t_counters.Read(p_sample);
+#else
+    std::memset(&p_sample, 0, sizeof(p_sample));
+    return false;
+#endif
+}
+
+bool PerfCounters::HasHardwareCounters()
+{
+    return s_hardware.load(std::memory_order_relaxed);
+}
+
+bool PerfCounters::HasStalledCycles()
+{
+    return s_stalledCycles.load(std::memory_order_relaxed);
+}
+
+double PerfCounters::Ipc(const CounterSample& p_sample)
+{
+    return p_sample.Cycles > 0 ? static_cast<double>(p_sample.Instructions) / p_sample.Cycles : 0.0;
+}
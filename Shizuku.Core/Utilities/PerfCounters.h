@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../Export.h"
+
+namespace Shizuku{ namespace Core
+{
+    // Counts of the calling thread. TaskClock is CPU time in nanoseconds, LlcMisses last level cache misses,
+    // StalledCycles cycles the back end stalled, waiting on memory mostly.
+    struct CounterSample
+    {
+        long long TaskClock;
+        long long Cycles;
+        long long Instructions;
+        long long LlcMisses;
+        long long StalledCycles;
+
+        CounterSample& operator+=(const CounterSample& p_other);
+        CounterSample operator-(const CounterSample& p_other) const;
+    };
+
+    // Per-thread hardware counters from perf_event_open, read as one group so the counts cover the same time. Only
+    // on Linux; each thread opens its counters on its first Read. Counters the CPU or kernel won't give (no PMU in
+    // a VM, perf_event_paranoid above 2, seccomp) read as 0, and without perf_event_open at all Read fails.
+    class CORE_API PerfCounters
+    {
+    public:
+        // False if no counter could be opened for the calling thread; p_sample is zeroed then
+        static bool Read(CounterSample& p_sample);
+        // Known after the first Read of any thread
+        static bool HasHardwareCounters();
+        static bool HasStalledCycles();
+
+        // Instructions per cycle, 0 without hardware counters
+        static double Ipc(const CounterSample& p_sample);
+    };
+}}
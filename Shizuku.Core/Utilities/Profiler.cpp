@@ -0,0 +1,118 @@
+#include "Profiler.h"
+#include "ProfilerImpl.h"
+
+using namespace Shizuku::Core;
+
+const int Profiler::AverageWindow;
+const int Profiler::RingCapacity;
+const int Profiler::TraceCapacity;
+std::atomic<bool> Profiler::s_enabled(false);
+std::atomic<bool> Profiler::s_counting(false);
+
+void Profiler::Enable(const bool p_enabled)
+{
+    s_enabled.store(p_enabled, std::memory_order_relaxed);
+}
+
+void Profiler::EnableCounters(const bool p_enabled)
+{
+    s_counting.store(p_enabled, std::memory_order_relaxed);
+}
+
+int Profiler::ZoneId(const char* p_name)
+{
+    return ProfilerImpl::Instance().ZoneId(p_name);
+}
+
+int Profiler::ZoneId(const std::string& p_name)
+{
+    return ProfilerImpl::Instance().ZoneId(p_name);
+}
+
+// The counters are read innermost, after the clock on the way in and before it on the way out, so the zone's own
+// bookkeeping is timed but not counted
+void Profiler::Begin(const int p_zone, const bool p_counted)
+{
+    ThreadZones& zones = ProfilerImpl::Local();
+    zones.Stack.push_back(OpenZone{ p_zone, ProfilerImpl::Now(), false, CounterSample(), 0.0 });
+    if (p_counted && IsCounting())
+    {
+        OpenZone& zone = zones.Stack.back();
+        zone.Counted = PerfCounters::Read(zone.Counters);
+    }
+}
+
+void Profiler::End()
+{
+    ThreadZones& zones = ProfilerImpl::Local();
+    if (zones.Stack.empty())
+        return;
+    CounterSample counters = CounterSample();
+    const bool counted = zones.Stack.back().Counted && PerfCounters::Read(counters);
+    const long long end = ProfilerImpl::Now();
+    const OpenZone zone = zones.Stack.back();
+    zones.Stack.pop_back();
+    const int parent = zones.Stack.empty() ? -1 : zones.Stack.back().Zone;
+    const ZoneRecord record = { zone.Zone, parent, static_cast<int>(zones.Stack.size()), zone.Start, end, counted,
+        counted ? counters - zone.Counters : CounterSample(), zone.Work };
+    if (!zones.Ring.Push(record))
+        zones.Dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::AddWork(const double p_units)
+{
+    ThreadZones& zones = ProfilerImpl::Local();
+    if (!zones.Stack.empty())
+        zones.Stack.back().Work += p_units;
+}
+
+void Profiler::Collect()
+{
+    ProfilerImpl::Instance().Collect();
+}
+
+std::vector<ZoneStats> Profiler::GetStats()
+{
+    return ProfilerImpl::Instance().GetStats();
+}
+
+double Profiler::GetAverage(const char* p_name)
+{
+    return ProfilerImpl::Instance().GetAverage(p_name);
+}
+
+ZoneStats Profiler::GetStats(const char* p_name)
+{
+    return ProfilerImpl::Instance().GetStats(p_name);
+}
+
+long long Profiler::GetDroppedCount()
+{
+    return ProfilerImpl::Instance().GetDroppedCount();
+}
+
+void Profiler::Reset()
+{
+    ProfilerImpl::Instance().Reset();
+}
+
+void Profiler::SetThreadName(const std::string& p_name)
+{
+    ProfilerImpl::Instance().SetThreadName(ProfilerImpl::Local().Index, p_name);
+}
+
+void Profiler::StartTrace()
+{
+    ProfilerImpl::Instance().StartTrace();
+    Enable(true);
+}
+
+void Profiler::StopTrace()
+{
+    ProfilerImpl::Instance().StopTrace();
+}
+
+bool Profiler::WriteTrace(const std::string& p_path)
+{
+    return ProfilerImpl::Instance().WriteTrace(p_path);
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../Export.h"
+#include "PerfCounters.h"
+
+namespace Shizuku{ namespace Core
+{
+    // Statistics of one zone over all threads, as of the last Profiler::Collect. Times are in seconds.
+    struct ZoneStats
+    {
+        std::string Name;
+        // Zone this one last ran inside of, -1 at the top level of its thread
+        int Parent;
+        int Depth;
+        long long Count;
+        double Total;
+        double Last;
+        double Max;
+        // Over the last Profiler::AverageWindow runs
+        double Average;
+        // Percentiles of every run since the last Reset, to within about 3%
+        double P50;
+        double P90;
+        double P99;
+        // Runs of the zone counted with the hardware counters, and what they counted between them
+        long long CountedRuns;
+        CounterSample Counters;
+        // Work the counted runs reported with Profiler::AddWork, in units of the zone's choosing (node updates for
+        // the lattice), so the counters can be taken per unit
+        double CountedWork;
+    };
+
+    // Zones are named spans of code timed by ScopedZone. Each thread writes the zones it closes into a ring of its
+    // own without locking; Collect drains the rings of all threads into ZoneStats, away from the timed code. Zones
+    // nest, and any name can be a zone, so a subsystem is instrumented without registering anything up front.
+    // Disabled, which is the default, a zone costs one relaxed load. Building with SHIZUKU_NO_PROFILER compiles
+    // SHIZUKU_ZONE out altogether.
+    // Counted zones also read the PerfCounters of their thread as they open and close, when counters are enabled
+    // as well. Reading them is a system call each time, so only zones that run for a while should be counted.
+    class CORE_API Profiler
+    {
+    private:
+        static std::atomic<bool> s_enabled;
+        static std::atomic<bool> s_counting;
+    public:
+        static const int AverageWindow = 20;
+        // Zones a thread can close between two Collects; the ones beyond are dropped and counted
+        static const int RingCapacity = 4096;
+        // Zones a trace holds at most; the ones beyond are dropped
+        static const int TraceCapacity = 1 << 20;
+
+        static void Enable(const bool p_enabled);
+        static bool IsEnabled()
+        {
+            return s_enabled.load(std::memory_order_relaxed);
+        }
+        static void EnableCounters(const bool p_enabled);
+        static bool IsCounting()
+        {
+            return s_counting.load(std::memory_order_relaxed);
+        }
+
+        // The id of zone p_name, registering it the first time. Takes a lock, so timed code should look ids up once.
+        static int ZoneId(const char* p_name);
+        static int ZoneId(const std::string& p_name);
+
+        // Called by ScopedZone. End closes the innermost zone the calling thread opened.
+        static void Begin(const int p_zone, const bool p_counted = false);
+        static void End();
+        // Adds p_units of work to the innermost zone the calling thread has open. Zones running on several threads,
+        // like the chunks of a ParallelFor, each report their own part.
+        static void AddWork(const double p_units);
+
+        // Drains the zones closed since the last call into the statistics. Reading statistics doesn't collect.
+        static void Collect();
+        // Indexed by zone id
+        static std::vector<ZoneStats> GetStats();
+        // Average of zone p_name, 0 if it hasn't run
+        static double GetAverage(const char* p_name);
+        // Statistics of zone p_name, all zero if it hasn't run
+        static ZoneStats GetStats(const char* p_name);
+        // Zones dropped because a ring was full
+        static long long GetDroppedCount();
+        // Clears the statistics and discards what the rings hold. Zone ids stay valid.
+        static void Reset();
+
+        // Labels the calling thread in traces
+        static void SetThreadName(const std::string& p_name);
+        // Enables the profiler and keeps every zone Collect sees from now on, with its thread and times, for
+        // WriteTrace. Starting again discards the previous trace.
+        static void StartTrace();
+        static void StopTrace();
+        // Writes the zones traced so far as Chrome trace events (chrome://tracing, Perfetto), one complete event per
+        // zone, with what counted zones counted as its arguments. Returns false if p_path can't be written.
+        static bool WriteTrace(const std::string& p_path);
+    };
+
+    // Times the enclosing scope as a zone if the profiler is enabled when it is constructed
+    class ScopedZone
+    {
+    private:
+        bool m_active;
+    public:
+        explicit ScopedZone(const int p_zone, const bool p_counted = false) : m_active(Profiler::IsEnabled())
+        {
+            if (m_active)
+                Profiler::Begin(p_zone, p_counted);
+        }
+        // For names only known at run time. Looks the name up, so only worth it where that cost doesn't matter.
+        explicit ScopedZone(const std::string& p_name) : m_active(Profiler::IsEnabled())
+        {
+            if (m_active)
+                Profiler::Begin(Profiler::ZoneId(p_name));
+        }
+        ~ScopedZone()
+        {
+            if (m_active)
+                Profiler::End();
+        }
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+    };
+}}
+
+#define SHIZUKU_ZONE_JOIN2(p_a, p_b) p_a##p_b
+#define SHIZUKU_ZONE_JOIN(p_a, p_b) SHIZUKU_ZONE_JOIN2(p_a, p_b)
+
+// Times the rest of the enclosing scope as zone p_name, a string literal. The id is looked up once per call site.
+// SHIZUKU_COUNTED_ZONE reads the hardware counters around it as well, and SHIZUKU_ZONE_WORK reports the work done
+// in it, see Profiler::AddWork.
+#ifdef SHIZUKU_NO_PROFILER
+#define SHIZUKU_ZONE(p_name) ((void)0)
+#define SHIZUKU_COUNTED_ZONE(p_name) ((void)0)
+#define SHIZUKU_ZONE_WORK(p_units) ((void)0)
+#else
+#define SHIZUKU_ZONE_COUNTED(p_name, p_counted) \
+    static const int SHIZUKU_ZONE_JOIN(s_zoneId, __LINE__) = Shizuku::Core::Profiler::ZoneId(p_name); \
+    const Shizuku::Core::ScopedZone SHIZUKU_ZONE_JOIN(zone, __LINE__)(SHIZUKU_ZONE_JOIN(s_zoneId, __LINE__), p_counted)
+#define SHIZUKU_ZONE(p_name) SHIZUKU_ZONE_COUNTED(p_name, false)
+#define SHIZUKU_COUNTED_ZONE(p_name) SHIZUKU_ZONE_COUNTED(p_name, true)
+#define SHIZUKU_ZONE_WORK(p_units) \
+    do { if (Shizuku::Core::Profiler::IsEnabled()) Shizuku::Core::Profiler::AddWork(p_units); } while (0)
+#endif
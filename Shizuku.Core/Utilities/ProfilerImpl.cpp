@@ -0,0 +1,279 @@
+#include "ProfilerImpl.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+using namespace Shizuku::Core;
+
+namespace
+{
+    // Marks the zones of a thread retired when it exits; the profiler keeps them until they are drained
+    struct ThreadHandle
+    {
+        std::shared_ptr<ThreadZones> Zones;
+
+        ~ThreadHandle()
+        {
+            if (Zones)
+                Zones->Retired.store(true, std::memory_order_release);
+        }
+    };
+
+    void WriteJsonString(FILE* p_file, const std::string& p_text)
+    {
+        fputc('"', p_file);
+        for (const char c : p_text)
+        {
+            if (c == '"' || c == '\\')
+                fputc('\\', p_file);
+            if (static_cast<unsigned char>(c) >= 0x20)
+                fputc(c, p_file);
+        }
+        fputc('"', p_file);
+    }
+}
+
+// The capacity has to divide 2^32 so the indices stay consistent when the counters wrap around
+ZoneRing::ZoneRing(const int p_capacity) : m_records(p_capacity), m_head(0), m_tail(0)
+{
+}
+
+bool ZoneRing::Push(const ZoneRecord& p_record)
+{
+    const unsigned int head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= m_records.size())
+        return false;
+    m_records[head % m_records.size()] = p_record;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+ThreadZones::ThreadZones() : Index(-1), Ring(Profiler::RingCapacity), Dropped(0), Retired(false)
+{
+    Stack.reserve(32);
+}
+
+ProfilerImpl::ProfilerImpl() : m_dropped(0), m_tracing(false), m_traceStart(0), m_traceDropped(0)
+{
+}
+
+ProfilerImpl& ProfilerImpl::Instance()
+{
+    static ProfilerImpl s_instance;
+    return s_instance;
+}
+
+long long ProfilerImpl::Now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+ThreadZones& ProfilerImpl::Local()
+{
+    static thread_local ThreadHandle t_handle;
+    if (!t_handle.Zones)
+    {
+        t_handle.Zones = std::make_shared<ThreadZones>();
+        Instance().Register(t_handle.Zones);
+    }
+    return *t_handle.Zones;
+}
+
+int ProfilerImpl::ZoneId(const std::string& p_name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = m_ids.find(p_name);
+    if (found != m_ids.end())
+        return found->second;
+    Aggregate zone;
+    zone.Stats = Empty(p_name);
+    zone.Recent.assign(Profiler::AverageWindow, 0.0);
+    zone.NextRecent = 0;
+    m_zones.push_back(zone);
+    const int id = static_cast<int>(m_zones.size()) - 1;
+    m_ids[p_name] = id;
+    return id;
+}
+
+void ProfilerImpl::Register(std::shared_ptr<ThreadZones> p_thread)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    p_thread->Index = static_cast<int>(m_threadNames.size());
+    m_threadNames.push_back(std::string());
+    m_threads.push_back(p_thread);
+}
+
+void ProfilerImpl::Add(const ZoneRecord& p_record)
+{
+    Aggregate& zone = m_zones[p_record.Zone];
+    ZoneStats& stats = zone.Stats;
+    const double seconds = (p_record.End - p_record.Start)*1e-9;
+    stats.Parent = p_record.Parent;
+    stats.Depth = p_record.Depth;
+    stats.Count++;
+    stats.Total += seconds;
+    stats.Last = seconds;
+    stats.Max = std::max(stats.Max, seconds);
+    zone.Recent[zone.NextRecent] = seconds;
+    zone.NextRecent = (zone.NextRecent + 1) % Profiler::AverageWindow;
+    const long long window = std::min<long long>(stats.Count, Profiler::AverageWindow);
+    double sum = 0.0;
+    for (int i = 0; i < window; i++)
+        sum += zone.Recent[i];
+    stats.Average = sum / window;
+    zone.Histogram.Record(seconds);
+    if (p_record.Counted)
+    {
+        stats.CountedRuns++;
+        stats.Counters += p_record.Counters;
+        stats.CountedWork += p_record.Work;
+    }
+}
+
+void ProfilerImpl::Collect()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& thread : m_threads)
+    {
+        //read before draining, so nothing the thread pushed before exiting is left behind
+        const bool retired = thread->Retired.load(std::memory_order_acquire);
+        thread->Ring.Drain([&](const ZoneRecord& p_record){
+            Add(p_record);
+            if (!m_tracing || p_record.Start < m_traceStart)
+                return;
+            if (m_trace.size() < static_cast<size_t>(Profiler::TraceCapacity))
+                m_trace.push_back(std::make_pair(thread->Index, p_record));
+            else
+                m_traceDropped++;
+        });
+        m_dropped += thread->Dropped.exchange(0, std::memory_order_relaxed);
+        if (retired)
+            thread.reset();
+    }
+    m_threads.erase(std::remove(m_threads.begin(), m_threads.end(), nullptr), m_threads.end());
+}
+
+// The percentiles are only worked out when asked for, rather than for every zone collected
+ZoneStats ProfilerImpl::Snapshot(const Aggregate& p_zone)
+{
+    ZoneStats stats = p_zone.Stats;
+    stats.P50 = p_zone.Histogram.GetPercentile(50.0);
+    stats.P90 = p_zone.Histogram.GetPercentile(90.0);
+    stats.P99 = p_zone.Histogram.GetPercentile(99.0);
+    return stats;
+}
+
+ZoneStats ProfilerImpl::Empty(const std::string& p_name)
+{
+    return ZoneStats{ p_name, -1, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, CounterSample(), 0.0 };
+}
+
+std::vector<ZoneStats> ProfilerImpl::GetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<ZoneStats> stats;
+    for (const Aggregate& zone : m_zones)
+        stats.push_back(Snapshot(zone));
+    return stats;
+}
+
+ZoneStats ProfilerImpl::GetStats(const std::string& p_name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = m_ids.find(p_name);
+    if (found == m_ids.end())
+        return Empty(p_name);
+    return Snapshot(m_zones[found->second]);
+}
+
+double ProfilerImpl::GetAverage(const std::string& p_name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = m_ids.find(p_name);
+    return found == m_ids.end() ? 0.0 : m_zones[found->second].Stats.Average;
+}
+
+long long ProfilerImpl::GetDroppedCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+void ProfilerImpl::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& thread : m_threads)
+    {
+        thread->Ring.Drain([](const ZoneRecord&){});
+        thread->Dropped.store(0, std::memory_order_relaxed);
+    }
+    for (Aggregate& zone : m_zones)
+    {
+        zone.Stats = Empty(zone.Stats.Name);
+        std::fill(zone.Recent.begin(), zone.Recent.end(), 0.0);
+        zone.NextRecent = 0;
+        zone.Histogram.Reset();
+    }
+    m_dropped = 0;
+}
+
+void ProfilerImpl::SetThreadName(const int p_thread, const std::string& p_name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threadNames[p_thread] = p_name;
+}
+
+void ProfilerImpl::StartTrace()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_trace.clear();
+    m_traceDropped = 0;
+    m_traceStart = Now();
+    m_tracing = true;
+}
+
+void ProfilerImpl::StopTrace()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tracing = false;
+}
+
+// Times are microseconds from the start of the trace, as the format wants
+bool ProfilerImpl::WriteTrace(const std::string& p_path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FILE* file = fopen(p_path.c_str(), "w");
+    if (file == nullptr)
+        return false;
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"droppedZones\": %lld}, \"traceEvents\": [\n",
+        m_traceDropped);
+    fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"Shizuku\"}}");
+    for (size_t i = 0; i < m_threadNames.size(); i++)
+    {
+        const std::string name = m_threadNames[i].empty() ? "Thread " + std::to_string(i) : m_threadNames[i];
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": ",
+            static_cast<int>(i));
+        WriteJsonString(file, name);
+        fprintf(file, "}}");
+    }
+    for (const auto& event : m_trace)
+    {
+        const ZoneRecord& record = event.second;
+        fprintf(file, ",\n{\"name\": ");
+        WriteJsonString(file, m_zones[record.Zone].Stats.Name);
+        fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f", event.first,
+            (record.Start - m_traceStart)*1e-3, (record.End - record.Start)*1e-3);
+        if (record.Counted)
+        {
+            const CounterSample& counters = record.Counters;
+            fprintf(file, ", \"args\": {\"taskClock\": %lld, \"cycles\": %lld, \"instructions\": %lld, "
+                "\"llcMisses\": %lld, \"stalledCycles\": %lld, \"work\": %.0f}", counters.TaskClock,
+                counters.Cycles, counters.Instructions, counters.LlcMisses, counters.StalledCycles, record.Work);
+        }
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n]}\n");
+    const bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "Profiler.h"
+
+namespace Shizuku{ namespace Core
+{
+    // A zone closed on some thread. Times are nanoseconds of the steady clock.
+    struct ZoneRecord
+    {
+        int Zone;
+        int Parent;
+        int Depth;
+        long long Start;
+        long long End;
+        bool Counted;
+        // Counted between Start and End
+        CounterSample Counters;
+        double Work;
+    };
+
+    // Single producer, single consumer ring: the owning thread pushes, Collect pops under the profiler lock
+    class ZoneRing
+    {
+    private:
+        std::vector<ZoneRecord> m_records;
+        std::atomic<unsigned int> m_head;
+        std::atomic<unsigned int> m_tail;
+    public:
+        ZoneRing(const int p_capacity);
+
+        // False if the ring is full
+        bool Push(const ZoneRecord& p_record);
+        template <typename Visit>
+        void Drain(Visit p_visit)
+        {
+            const unsigned int head = m_head.load(std::memory_order_acquire);
+            unsigned int tail = m_tail.load(std::memory_order_relaxed);
+            for (; tail != head; tail++)
+                p_visit(m_records[tail % m_records.size()]);
+            m_tail.store(tail, std::memory_order_release);
+        }
+    };
+
+    struct OpenZone
+    {
+        int Zone;
+        long long Start;
+        bool Counted;
+        CounterSample Counters;
+        double Work;
+    };
+
+    // Zones of one thread. The stack is only touched by the thread itself.
+    struct ThreadZones
+    {
+        // Order of registration, the thread id of traces
+        int Index;
+        ZoneRing Ring;
+        std::vector<OpenZone> Stack;
+        std::atomic<long long> Dropped;
+        // Set when the thread exits, so Collect can let go of it once drained
+        std::atomic<bool> Retired;
+
+        ThreadZones();
+    };
+
+    class ProfilerImpl
+    {
+    private:
+        struct Aggregate
+        {
+            ZoneStats Stats;
+            std::vector<double> Recent;
+            int NextRecent;
+            LatencyHistogram Histogram;
+        };
+
+        std::mutex m_mutex;
+        std::unordered_map<std::string, int> m_ids;
+        std::vector<Aggregate> m_zones;
+        std::vector<std::shared_ptr<ThreadZones>> m_threads;
+        long long m_dropped;
+        // Indexed by ThreadZones::Index, empty if unnamed. Kept after the threads exit for their trace events.
+        std::vector<std::string> m_threadNames;
+        bool m_tracing;
+        long long m_traceStart;
+        std::vector<std::pair<int, ZoneRecord>> m_trace;
+        long long m_traceDropped;
+
+        ProfilerImpl();
+        void Add(const ZoneRecord& p_record);
+        static ZoneStats Snapshot(const Aggregate& p_zone);
+        static ZoneStats Empty(const std::string& p_name);
+    public:
+        static ProfilerImpl& Instance();
+        static long long Now();
+        // Zones of the calling thread, registered on first use
+        static ThreadZones& Local();
+
+        int ZoneId(const std::string& p_name);
+        void Register(std::shared_ptr<ThreadZones> p_thread);
+        void Collect();
+        std::vector<ZoneStats> GetStats();
+        double GetAverage(const std::string& p_name);
+        ZoneStats GetStats(const std::string& p_name);
+        long long GetDroppedCount();
+        void Reset();
+        void SetThreadName(const int p_thread, const std::string& p_name);
+        void StartTrace();
+        void StopTrace();
+        bool WriteTrace(const std::string& p_path);
+    };
+}}
@@ -31,4 +31,14 @@ void Stopwatch::Reset()
 double Stopwatch::GetAverage()
 {
     return m_impl->GetAverage();
-}
\ No newline at end of file
+}
+
+double Stopwatch::GetPercentile(const double p_percentile)
+{
+    return m_impl->GetPercentile(p_percentile);
+}
+
+double Stopwatch::GetMax()
+{
+    return m_impl->GetMax();
+}
@@ -1,10 +1,6 @@
 #pragma once
 
-#ifdef SHIZUKU_CORE_EXPORTS  
-#define CORE_API __declspec(dllexport)   
-#else  
-#define CORE_API __declspec(dllimport)   
-#endif  
+#include "../Export.h"
 
 
 namespace Shizuku{ namespace Core
@@ -29,5 +25,9 @@ namespace Shizuku{ namespace Core
 
         // Return running average 
         double GetAverage();
+
+        // Over every Tock since construction or Reset, not just the averaged ones. p_percentile is 0 to 100.
+        double GetPercentile(const double p_percentile);
+        double GetMax();
     };
 }}
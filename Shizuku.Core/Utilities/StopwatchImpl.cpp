@@ -27,6 +27,7 @@ double StopwatchImpl::Tock()
     const double time = duration_cast<duration<double>>(high_resolution_clock::now() - m_before).count();
     m_total += time;
 
+    m_histogram.Record(time);
     m_recs.push(time);
     while (m_recs.size() > m_recCount)
     {
@@ -42,9 +43,20 @@ void StopwatchImpl::Reset()
     m_total = 0;
     while (m_recs.size() > 0)
         m_recs.pop();
+    m_histogram.Reset();
 }
 
 double StopwatchImpl::GetAverage()
 {
     return m_total / m_recs.size();
-}
\ No newline at end of file
+}
+
+double StopwatchImpl::GetPercentile(const double p_percentile)
+{
+    return m_histogram.GetPercentile(p_percentile);
+}
+
+double StopwatchImpl::GetMax()
+{
+    return m_histogram.GetMax();
+}
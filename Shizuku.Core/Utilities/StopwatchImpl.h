@@ -2,12 +2,9 @@
 #include <time.h>
 #include <queue>
 #include <chrono>
+#include "LatencyHistogram.h"
 
-#ifdef SHIZUKU_CORE_EXPORTS  
-#define CORE_API __declspec(dllexport)   
-#else  
-#define CORE_API __declspec(dllimport)   
-#endif  
+#include "../Export.h"
 
 namespace Shizuku{ namespace Core
 {
@@ -18,6 +15,7 @@ namespace Shizuku{ namespace Core
         double m_total;
         unsigned int m_recCount;
         std::queue<double> m_recs;
+        LatencyHistogram m_histogram;
     public:
         StopwatchImpl();
         StopwatchImpl(const int p_recCount);
@@ -31,5 +29,8 @@ namespace Shizuku{ namespace Core
 
         // Return running average 
         double GetAverage();
+
+        double GetPercentile(const double p_percentile);
+        double GetMax();
     };
 }}
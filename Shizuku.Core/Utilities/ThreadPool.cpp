@@ -0,0 +1,61 @@
+#include "ThreadPool.h"
+#include "ThreadPoolImpl.h"
+
+using namespace Shizuku::Core;
+
+ThreadPool::ThreadPool()
+{
+    m_impl = new ThreadPoolImpl(std::thread::hardware_concurrency());
+}
+
+ThreadPool::ThreadPool(const int p_threadCount)
+{
+    m_impl = new ThreadPoolImpl(p_threadCount);
+}
+
+ThreadPool::~ThreadPool()
+{
+    delete m_impl;
+}
+
+int ThreadPool::ThreadCount()
+{
+    return m_impl->ThreadCount();
+}
+
+void ThreadPool::ParallelFor(const int p_count, const int p_grain,
+    const std::function<void(const int, const int)>& p_body)
+{
+    m_impl->ParallelFor(p_count, p_grain, [&](const int, const int p_begin, const int p_end){
+        p_body(p_begin, p_end);
+    });
+}
+
+void ThreadPool::ParallelFor(const int p_count, const std::function<void(const int, const int)>& p_body)
+{
+    const int shares = ThreadCount() * 4;
+    ParallelFor(p_count, (p_count + shares - 1) / shares, p_body);
+}
+
+void ThreadPool::ParallelForWorker(const int p_count, const int p_grain,
+    const std::function<void(const int, const int, const int)>& p_body)
+{
+    m_impl->ParallelFor(p_count, p_grain, p_body);
+}
+
+void ThreadPool::ParallelForWorker(const int p_count,
+    const std::function<void(const int, const int, const int)>& p_body)
+{
+    const int shares = ThreadCount() * 4;
+    m_impl->ParallelFor(p_count, (p_count + shares - 1) / shares, p_body);
+}
+
+WorkerStats ThreadPool::GetWorkerStats(const int p_worker)
+{
+    return m_impl->GetWorkerStats(p_worker);
+}
+
+void ThreadPool::ResetWorkerStats()
+{
+    m_impl->ResetWorkerStats();
+}
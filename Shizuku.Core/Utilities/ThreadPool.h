@@ -0,0 +1,56 @@
+#pragma once
+#include <functional>
+
+#include "../Export.h"
+
+namespace Shizuku{ namespace Core
+{
+    class ThreadPoolImpl;
+
+    // Counters of one worker since the pool was created or ResetWorkerStats was called
+    struct WorkerStats
+    {
+        long long Chunks;
+        // Times this worker ran out of work and took half of another worker's remaining range
+        long long Steals;
+        double BusySeconds;
+        // BusySeconds over the wall time since the last reset
+        double Utilization;
+    };
+
+    class CORE_API ThreadPool
+    {
+    private:
+        ThreadPoolImpl* m_impl;
+    public:
+        // Uses one worker per hardware thread
+        ThreadPool();
+        ThreadPool(const int p_threadCount);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        int ThreadCount();
+
+        // Runs p_body over [0, p_count) in chunks of at most p_grain and blocks until all are done. Each worker starts
+        // on its own contiguous share and steals from the others when it runs dry, so uneven chunks (rows around
+        // obstacles) still balance. p_body is called with [begin, end), in no particular order.
+        // Calls from several threads take turns. Calling it from inside a body run by the same pool throws
+        // std::logic_error instead of deadlocking. If a body throws, the chunks not started yet are skipped and the
+        // first exception is rethrown here once every worker has stopped.
+        void ParallelFor(const int p_count, const int p_grain,
+            const std::function<void(const int, const int)>& p_body);
+        // Grain of about a quarter of each worker's share
+        void ParallelFor(const int p_count, const std::function<void(const int, const int)>& p_body);
+        // Same, with the worker running the chunk, 0 to ThreadCount() - 1, as the first argument, to index per-worker
+        // scratch space. One worker runs one chunk at a time.
+        void ParallelForWorker(const int p_count, const int p_grain,
+            const std::function<void(const int, const int, const int)>& p_body);
+        void ParallelForWorker(const int p_count, const std::function<void(const int, const int, const int)>& p_body);
+
+        // Worker 0 is the thread calling ParallelFor
+        WorkerStats GetWorkerStats(const int p_worker);
+        void ResetWorkerStats();
+    };
+}}
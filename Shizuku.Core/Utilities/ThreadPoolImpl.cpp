@@ -0,0 +1,263 @@
+#include "ThreadPoolImpl.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Shizuku::Core;
+
+namespace
+{
+    //! Pools whose bodies the calling thread is inside of, innermost first
+    struct RunningPool
+    {
+        const ThreadPoolImpl* Pool;
+        const RunningPool* Outer;
+    };
+
+    thread_local const RunningPool* t_running = nullptr;
+}
+
+ThreadPoolImpl::ThreadPoolImpl(const int p_threadCount)
+{
+    m_body = nullptr;
+    m_grain = 1;
+    m_generation = 0;
+    m_pending = 0;
+    m_stop = false;
+    m_failed = false;
+
+    const int threadCount = std::max(1, p_threadCount);
+    for (int i = 0; i < threadCount; ++i)
+    {
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    ResetWorkerStats();
+
+    //! The calling thread acts as worker 0, so only spawn the remaining workers
+    for (int i = 1; i < threadCount; ++i)
+    {
+        m_threads.push_back(std::thread(&ThreadPoolImpl::WorkerLoop, this, i));
+    }
+}
+
+ThreadPoolImpl::~ThreadPoolImpl()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workReady.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+int ThreadPoolImpl::ThreadCount()
+{
+    return static_cast<int>(m_workers.size());
+}
+
+bool ThreadPoolImpl::TakeChunk(Worker& p_worker, int& p_begin, int& p_end)
+{
+    std::lock_guard<std::mutex> lock(p_worker.Mutex);
+    if (p_worker.Next >= p_worker.End)
+        return false;
+    p_begin = p_worker.Next;
+    p_end = std::min(p_worker.Next + m_grain, p_worker.End);
+    p_worker.Next = p_end;
+    return true;
+}
+
+//! Moves the back half of the fullest other range into p_workerId's (empty) range
+bool ThreadPoolImpl::Steal(const int p_workerId)
+{
+    const int threadCount = ThreadCount();
+    int victim = -1;
+    int mostRemaining = 0;
+    for (int i = 1; i < threadCount; ++i)
+    {
+        const int candidate = (p_workerId + i) % threadCount;
+        Worker& worker = *m_workers[candidate];
+        std::lock_guard<std::mutex> lock(worker.Mutex);
+        const int remaining = worker.End - worker.Next;
+        if (remaining > mostRemaining)
+        {
+            victim = candidate;
+            mostRemaining = remaining;
+        }
+    }
+    if (victim < 0)
+        return false;
+
+    int begin, end;
+    {
+        Worker& worker = *m_workers[victim];
+        std::lock_guard<std::mutex> lock(worker.Mutex);
+        const int remaining = worker.End - worker.Next;
+        if (remaining <= 0)
+            return true;//finished in the meantime; look again
+        begin = remaining <= m_grain ? worker.Next : worker.Next + remaining / 2;
+        end = worker.End;
+        worker.End = begin;
+    }
+    Worker& self = *m_workers[p_workerId];
+    std::lock_guard<std::mutex> lock(self.Mutex);
+    self.Next = begin;
+    self.End = end;
+    ++self.Steals;
+    return true;
+}
+
+//! An exception can't leave a worker thread, so the first one is kept for ParallelFor to rethrow
+void ThreadPoolImpl::RunChunk(const int p_workerId, const int p_begin, const int p_end)
+{
+    if (m_failed.load(std::memory_order_relaxed))
+        return;
+    Worker& worker = *m_workers[p_workerId];
+    const auto start = std::chrono::steady_clock::now();
+    const RunningPool running = { this, t_running };
+    t_running = &running;
+    try
+    {
+        (*m_body)(p_workerId, p_begin, p_end);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error)
+            m_error = std::current_exception();
+        m_failed.store(true, std::memory_order_relaxed);
+    }
+    t_running = running.Outer;
+    const std::chrono::duration<double> busy = std::chrono::steady_clock::now() - start;
+    worker.BusySeconds += busy.count();
+    ++worker.Chunks;
+}
+
+void ThreadPoolImpl::RunWork(const int p_workerId)
+{
+    Worker& worker = *m_workers[p_workerId];
+    while (true)
+    {
+        int begin, end;
+        while (TakeChunk(worker, begin, end))
+        {
+            RunChunk(p_workerId, begin, end);
+        }
+        if (!Steal(p_workerId))
+            return;
+    }
+}
+
+void ThreadPoolImpl::WorkerLoop(const int p_workerId)
+{
+    unsigned int seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workReady.wait(lock, [&]{ return m_stop || m_generation != seenGeneration; });
+            if (m_stop)
+                return;
+            seenGeneration = m_generation;
+        }
+
+        RunWork(p_workerId);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        m_workDone.notify_one();
+    }
+}
+
+bool ThreadPoolImpl::IsRunningOnThisThread()
+{
+    for (const RunningPool* running = t_running; running != nullptr; running = running->Outer)
+    {
+        if (running->Pool == this)
+            return true;
+    }
+    return false;
+}
+
+//! Ends a loop once every worker is done with it, rethrowing what a body threw
+void ThreadPoolImpl::Finish()
+{
+    m_body = nullptr;
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::swap(error, m_error);
+        m_failed.store(false, std::memory_order_relaxed);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ThreadPoolImpl::ParallelFor(const int p_count, const int p_grain,
+    const std::function<void(const int, const int, const int)>& p_body)
+{
+    if (p_count <= 0)
+        return;
+    //the workers are busy with the outer loop, and this thread is one of them, so a nested loop could never finish
+    if (IsRunningOnThisThread())
+        throw std::logic_error("ParallelFor called from inside a body of the same pool");
+
+    std::lock_guard<std::mutex> call(m_callMutex);
+    m_body = &p_body;
+    m_grain = std::max(p_grain, 1);
+    if (m_threads.empty())
+    {
+        RunChunk(0, 0, p_count);
+        Finish();
+        return;
+    }
+
+    const int threadCount = ThreadCount();
+    for (int i = 0; i < threadCount; ++i)
+    {
+        Worker& worker = *m_workers[i];
+        std::lock_guard<std::mutex> lock(worker.Mutex);
+        worker.Next = static_cast<int>(static_cast<long long>(p_count)*i / threadCount);
+        worker.End = static_cast<int>(static_cast<long long>(p_count)*(i + 1) / threadCount);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = static_cast<int>(m_threads.size());
+        ++m_generation;
+    }
+    m_workReady.notify_all();
+
+    RunWork(0);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_workDone.wait(lock, [&]{ return m_pending == 0; });
+    }
+    Finish();
+}
+
+WorkerStats ThreadPoolImpl::GetWorkerStats(const int p_worker)
+{
+    const Worker& worker = *m_workers[p_worker];
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_statsStart;
+    WorkerStats stats;
+    stats.Chunks = worker.Chunks;
+    stats.Steals = worker.Steals;
+    stats.BusySeconds = worker.BusySeconds;
+    stats.Utilization = elapsed.count() > 0.0 ? worker.BusySeconds / elapsed.count() : 0.0;
+    return stats;
+}
+
+void ThreadPoolImpl::ResetWorkerStats()
+{
+    for (auto& worker : m_workers)
+    {
+        worker->Chunks = 0;
+        worker->Steals = 0;
+        worker->BusySeconds = 0.0;
+    }
+    m_statsStart = std::chrono::steady_clock::now();
+}
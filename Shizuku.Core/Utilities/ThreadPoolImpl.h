@@ -0,0 +1,68 @@
+#pragma once
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+namespace Shizuku{ namespace Core
+{
+    class ThreadPoolImpl
+    {
+    private:
+        //! Remaining range [Next, End) of one worker. The owner takes chunks from the front, thieves split off the back.
+        struct Worker
+        {
+            std::mutex Mutex;
+            int Next;
+            int End;
+            long long Chunks;
+            long long Steals;
+            double BusySeconds;
+            char Padding[64];
+        };
+
+        std::vector<std::thread> m_threads;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        //! Held for the whole of a ParallelFor, as the fields below describe one loop at a time
+        std::mutex m_callMutex;
+        std::mutex m_mutex;
+        std::condition_variable m_workReady;
+        std::condition_variable m_workDone;
+        const std::function<void(const int, const int, const int)>* m_body;
+        int m_grain;
+        unsigned int m_generation;
+        int m_pending;
+        bool m_stop;
+        //! First exception a body threw in the current loop; once set, the remaining chunks are skipped
+        std::exception_ptr m_error;
+        std::atomic<bool> m_failed;
+        std::chrono::steady_clock::time_point m_statsStart;
+
+        void WorkerLoop(const int p_workerId);
+        void RunWork(const int p_workerId);
+        bool TakeChunk(Worker& p_worker, int& p_begin, int& p_end);
+        bool Steal(const int p_workerId);
+        void RunChunk(const int p_workerId, const int p_begin, const int p_end);
+        bool IsRunningOnThisThread();
+        void Finish();
+    public:
+        ThreadPoolImpl(const int p_threadCount);
+        ~ThreadPoolImpl();
+
+        int ThreadCount();
+
+        //! p_body gets the worker id first. Throws std::logic_error when called from inside one of its own bodies,
+        //! which would otherwise deadlock, and rethrows the first exception a body threw.
+        void ParallelFor(const int p_count, const int p_grain,
+            const std::function<void(const int, const int, const int)>& p_body);
+
+        WorkerStats GetWorkerStats(const int p_worker);
+        void ResetWorkerStats();
+    };
+}}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+
+namespace Shizuku{ namespace Core
+{
+    // Lock-free hand-off of the latest value from one producer thread to one consumer thread. The producer fills
+    // Back() and publishes it; the consumer acquires the latest published value as Front(), which the producer
+    // doesn't touch until the consumer acquires again. Values published in between acquires are dropped.
+    template <typename T>
+    class TripleBuffer
+    {
+    private:
+        enum : unsigned int { IndexMask = 3, FreshBit = 4 };
+
+        T m_buffers[3];
+        // Buffer between the two sides, with FreshBit while it holds a value that wasn't acquired yet
+        std::atomic<unsigned int> m_middle;
+        unsigned int m_back;
+        unsigned int m_front;
+    public:
+        TripleBuffer() : m_buffers(), m_middle(1), m_back(0), m_front(2)
+        {
+        }
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        // Producer side
+        T& Back()
+        {
+            return m_buffers[m_back];
+        }
+
+        void Publish()
+        {
+            m_back = m_middle.exchange(m_back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+        }
+
+        // Consumer side. Returns whether Front() changed.
+        bool Acquire()
+        {
+            if ((m_middle.load(std::memory_order_relaxed) & FreshBit) == 0)
+                return false;
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & IndexMask;
+            return true;
+        }
+
+        T& Front()
+        {
+            return m_buffers[m_front];
+        }
+
+        // Any of the three, for setup and teardown while neither side is running
+        T& Buffer(const int p_index)
+        {
+            return m_buffers[p_index];
+        }
+    };
+}}
@@ -0,0 +1,11 @@
+#pragma once
+#include "Command.h"
+
+namespace Shizuku{ namespace Flow{ namespace Command{
+    class FLOW_API LoadCheckpoint : public Command
+    {
+    public:
+        LoadCheckpoint(Flow& p_flow);
+        void Start(boost::any const p_param);
+    };
+} } }
@@ -1,10 +1,6 @@
 #pragma once
 
-#ifdef SHIZUKU_FLOW_EXPORTS  
-#define FLOW_API __declspec(dllexport)   
-#else  
-#define FLOW_API __declspec(dllimport)   
-#endif  
+#include "../../Export.h"
 
 namespace Shizuku{ namespace Flow{ namespace Command{
     struct FLOW_API DepthParameter
@@ -1,11 +1,7 @@
 #pragma once
 #include "Shizuku.Core/Types/MinMax.h"
 
-#ifdef SHIZUKU_FLOW_EXPORTS  
-#define FLOW_API __declspec(dllexport)   
-#else  
-#define FLOW_API __declspec(dllimport)   
-#endif  
+#include "../../Export.h"
 
 namespace Shizuku{ namespace Flow{ namespace Command{
     struct FLOW_API MinMaxParameter
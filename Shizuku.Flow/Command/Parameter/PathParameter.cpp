@@ -0,0 +1,11 @@
+#include "Command/Parameter/PathParameter.h"
+
+using namespace Shizuku::Flow::Command;
+
+PathParameter::PathParameter()
+{
+}
+
+PathParameter::PathParameter(const std::string& p_path) : Path(p_path)
+{
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../../Export.h"
+#include <string>
+
+namespace Shizuku{ namespace Flow{ namespace Command{
+    struct FLOW_API PathParameter
+    {
+        std::string Path;
+        PathParameter();
+        PathParameter(const std::string& p_path);
+    };
+} } }
@@ -1,6 +1,5 @@
 #include "PauseSimulation.h"
 #include "Graphics/GraphicsManager.h"
-#include "Graphics/CudaLbm.h"
 #include "Flow.h"
 #include <boost/any.hpp>
 
@@ -15,7 +14,7 @@ void PauseSimulation::Start(boost::any const p_param)
     try
     {
         const bool& paused = boost::any_cast<bool>(p_param);
-        m_flow->Graphics()->GetCudaLbm()->SetPausedState(paused);
+        m_flow->Graphics()->SetPausedState(paused);
     }
     catch (boost::bad_any_cast &e)
     {
@@ -0,0 +1,27 @@
+#include "RecordFields.h"
+#include "Graphics/GraphicsManager.h"
+#include "Parameter/PathParameter.h"
+#include "Flow.h"
+
+using namespace Shizuku::Flow::Command;
+
+RecordFields::RecordFields(Flow& p_flow) : Command(p_flow)
+{
+}
+
+void RecordFields::Start(boost::any const p_param)
+{
+    GraphicsManager* graphicsManager = m_flow->Graphics();
+    try
+    {
+        const PathParameter& path = boost::any_cast<PathParameter>(p_param);
+        if (path.Path.empty())
+            graphicsManager->StopRecording();
+        else
+            graphicsManager->StartRecording(path.Path);
+    }
+    catch (boost::bad_any_cast &e)
+    {
+        throw (e.what());
+    }
+}
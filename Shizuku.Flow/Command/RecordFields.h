@@ -0,0 +1,12 @@
+#pragma once
+#include "Command.h"
+
+namespace Shizuku{ namespace Flow{ namespace Command{
+    //! Takes a PathParameter; an empty path stops
+    class FLOW_API RecordFields : public Command
+    {
+    public:
+        RecordFields(Flow& p_flow);
+        void Start(boost::any const p_param);
+    };
+} } }
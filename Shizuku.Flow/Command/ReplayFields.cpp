@@ -0,0 +1,27 @@
+#include "ReplayFields.h"
+#include "Graphics/GraphicsManager.h"
+#include "Parameter/PathParameter.h"
+#include "Flow.h"
+
+using namespace Shizuku::Flow::Command;
+
+ReplayFields::ReplayFields(Flow& p_flow) : Command(p_flow)
+{
+}
+
+void ReplayFields::Start(boost::any const p_param)
+{
+    GraphicsManager* graphicsManager = m_flow->Graphics();
+    try
+    {
+        const PathParameter& path = boost::any_cast<PathParameter>(p_param);
+        if (path.Path.empty())
+            graphicsManager->StopReplay();
+        else
+            graphicsManager->StartReplay(path.Path);
+    }
+    catch (boost::bad_any_cast &e)
+    {
+        throw (e.what());
+    }
+}
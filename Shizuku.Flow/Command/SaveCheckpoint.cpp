@@ -0,0 +1,23 @@
+#include "SaveCheckpoint.h"
+#include "Graphics/GraphicsManager.h"
+#include "Parameter/PathParameter.h"
+#include "Flow.h"
+
+using namespace Shizuku::Flow::Command;
+
+SaveCheckpoint::SaveCheckpoint(Flow& p_flow) : Command(p_flow)
+{
+}
+
+void SaveCheckpoint::Start(boost::any const p_param)
+{
+    try
+    {
+        const PathParameter& path = boost::any_cast<PathParameter>(p_param);
+        m_flow->Graphics()->SaveCheckpoint(path.Path);
+    }
+    catch (boost::bad_any_cast &e)
+    {
+        throw (e.what());
+    }
+}
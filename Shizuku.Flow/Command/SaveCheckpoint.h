@@ -0,0 +1,11 @@
+#pragma once
+#include "Command.h"
+
+namespace Shizuku{ namespace Flow{ namespace Command{
+    class FLOW_API SaveCheckpoint : public Command
+    {
+    public:
+        SaveCheckpoint(Flow& p_flow);
+        void Start(boost::any const p_param);
+    };
+} } }
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace Shizuku { namespace Flow{
+    //! What Query::GetCounter reports of a counted profiler zone since the profiler was last reset. Except IPC and
+    //! UPDATES, the counts are per update, the unit of work the zone reports: a node of one step for "CpuLattice", a
+    //! node rasterized for "ImageRows". IPC, INSTRUCTIONS, LLC_MISSES and LLC_BYTES need hardware counters.
+    enum CounterStatistic
+    {
+        IPC,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        //! LLC misses times the cache line, the memory traffic to compare with the bytes the variant has to move
+        LLC_BYTES,
+        CPU_NANOSECONDS,
+        //! Updates the counted runs did between them
+        UPDATES
+    };
+} }
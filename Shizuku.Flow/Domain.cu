@@ -6,6 +6,7 @@ Domain::Domain()
 {
     m_xDim = BLOCKSIZEX * 2;
     m_yDim = BLOCKSIZEX;
+    m_pitch = m_xDim;
     m_xDimVisible = m_xDim;
     m_yDimVisible = m_yDim;
 }
@@ -30,29 +31,34 @@ __host__ __device__ int Domain::GetYDimVisible()
     return m_yDimVisible;
 }
 
+__host__ __device__ int Domain::GetPitch()
+{
+    return m_pitch;
+}
+
 __host__ void Domain::SetXDim(const int xDim)
 {
     //x dimension must be multiple of BLOCKSIZEX
-    int xDimAsMultipleOfBlocksize = ceil(static_cast<float>(xDim)/BLOCKSIZEX)*BLOCKSIZEX;
-    m_xDim = xDimAsMultipleOfBlocksize < MAX_XDIM ? xDimAsMultipleOfBlocksize : MAX_XDIM;
+    m_xDim = ceil(static_cast<float>(xDim)/BLOCKSIZEX)*BLOCKSIZEX;
+    //rows padded to 32 floats (128 bytes)
+    m_pitch = (m_xDim + 31) / 32 * 32;
 }
 
 __host__ void Domain::SetYDim(const int yDim)
 {
     //y dimension must be multiple of BLOCKSIZEY
-    int yDimAsMultipleOfBlocksize = ceil(static_cast<float>(yDim)/BLOCKSIZEY)*BLOCKSIZEY;
-    m_yDim = yDimAsMultipleOfBlocksize < MAX_YDIM ? yDimAsMultipleOfBlocksize : MAX_YDIM;
+    m_yDim = ceil(static_cast<float>(yDim)/BLOCKSIZEY)*BLOCKSIZEY;
 }
 
 __host__ void Domain::SetXDimVisible(const int xDimVisible)
 {
-    m_xDimVisible = xDimVisible < MAX_XDIM ? xDimVisible : MAX_XDIM;
+    m_xDimVisible = xDimVisible;
     SetXDim(xDimVisible);
 }
 
 __host__ void Domain::SetYDimVisible(const int yDimVisible)
 {
-    m_yDimVisible = yDimVisible < MAX_YDIM ? yDimVisible : MAX_YDIM;
+    m_yDimVisible = yDimVisible;
     SetYDim(yDimVisible);
 }
 
@@ -101,12 +107,6 @@ __device__ int f_mem(const int f_num, const int x, const int y,
     return (x + y*pitch) + f_num*pitch*yDim;
 }
 
-__device__ int f_mem(const int f_num, const int x, const int y)
-{
-
-    return (x + y*MAX_XDIM) + f_num*MAX_XDIM*MAX_YDIM;
-}
-
 __device__ void Swap(float &a, float &b)
 {
     float c = a;
@@ -7,6 +7,7 @@ class Domain
     int m_yDim;
     int m_xDimVisible;
     int m_yDimVisible;
+    int m_pitch;
 
 public:
     Domain();
@@ -15,6 +16,8 @@ public:
     __host__ __device__ int GetYDim();
     __host__ void SetXDim(const int xDim);
     __host__ void SetYDim(const int yDim);
+    //! Floats per lattice row: xDim padded so that rows stay aligned for coalesced access
+    __host__ __device__ int GetPitch();
 
     __host__ __device__ int GetXDimVisible();
     __host__ __device__ int GetYDimVisible();
@@ -33,6 +36,5 @@ __device__ float dmax(const float a, const float b);
 __device__ float dmax(const float a, const float b, const float c, const float d);
 __device__ int f_mem(const int f_num, const int x, const int y, const size_t pitch,
     const int yDim);
-__device__ int f_mem(const int f_num, const int x, const int y);
 __device__ void Swap(float &a, float &b);
 
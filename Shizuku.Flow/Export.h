@@ -0,0 +1,12 @@
+#pragma once
+
+//! FLOW_API marks what the Shizuku.Flow DLL exports; empty in static builds (SHIZUKU_STATIC) and off MSVC
+#if defined(_MSC_VER) && !defined(SHIZUKU_STATIC)
+#ifdef SHIZUKU_FLOW_EXPORTS
+#define FLOW_API __declspec(dllexport)
+#else
+#define FLOW_API __declspec(dllimport)
+#endif
+#else
+#define FLOW_API
+#endif
@@ -2,11 +2,7 @@
 
 #include "Shizuku.Core/Rect.h"
 
-#ifdef SHIZUKU_FLOW_EXPORTS  
-#define FLOW_API __declspec(dllexport)   
-#else  
-#define FLOW_API __declspec(dllimport)   
-#endif  
+#include "Export.h"
 
 using namespace Shizuku::Core;
 
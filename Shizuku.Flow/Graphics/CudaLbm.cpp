@@ -1,18 +1,42 @@
 #include "CudaLbm.h"
 #include "Domain.h"
-#include "ObstManager.h"
 #include "CudaCheck.h"
+#include "Solver/Checkpoint.h"
+#include "Solver/ObstRaster.h"
 
 #include "Shizuku.Core/Types/Point.h"
+#include "Shizuku.Core/Utilities/Profiler.h"
 
 #include <algorithm>
+#include <utility>
+#include <vector>
 
+using namespace Shizuku::Core;
 using namespace Shizuku::Core::Types;
 
 namespace {
-    Point<float> ModelSpacePosFromSimPos(const Point<int>& p_simPos, const int p_xDimVisible)
+    //! Merges p_rect with the rects it overlaps, so the old and new footprints of a drag are rasterized once
+    void AddToUnion(std::vector<CellRect>& p_rects, CellRect p_rect)
     {
-        return Point<float>(static_cast<float>(p_simPos.X) / p_xDimVisible*2.f - 1.f, static_cast<float>(p_simPos.Y) / p_xDimVisible*2.f - 1.f);
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+            for (auto it = p_rects.begin(); it != p_rects.end(); ++it)
+            {
+                if (Overlap(*it, p_rect))
+                {
+                    p_rect.XBegin = std::min(p_rect.XBegin, it->XBegin);
+                    p_rect.XEnd = std::max(p_rect.XEnd, it->XEnd);
+                    p_rect.YBegin = std::min(p_rect.YBegin, it->YBegin);
+                    p_rect.YEnd = std::max(p_rect.YEnd, it->YEnd);
+                    p_rects.erase(it);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        p_rects.push_back(p_rect);
     }
 }
 
@@ -21,12 +45,36 @@ CudaLbm::CudaLbm()
     m_domain = new Domain;
     m_isPaused = false;
     m_timeStepsPerFrame = 15;
+    m_streamingMode = StreamingMode::PING_PONG;
+    m_fA_d = nullptr;
+    m_fB_d = nullptr;
+    m_boundaryCodes_d = nullptr;
+    m_solidMask_d = nullptr;
+    m_maskWordsPerRow = 0;
+    m_latticePitch = 0;
+    m_latticeYDim = 0;
+    m_activeBlocks_d = nullptr;
+    m_activeBlockCount = 0;
+    m_fluidBlockCount = 0;
+    m_blocksPerRow = 0;
+    m_threadPool = std::make_shared<ThreadPool>();
 }
 
 CudaLbm::CudaLbm(const int maxX, const int maxY)
 {
     m_maxX = maxX;
     m_maxY = maxY;
+    m_threadPool = std::make_shared<ThreadPool>();
+}
+
+std::shared_ptr<ThreadPool> CudaLbm::GetThreadPool()
+{
+    return m_threadPool;
+}
+
+void CudaLbm::SetThreadPool(std::shared_ptr<ThreadPool> p_threadPool)
+{
+    m_threadPool = p_threadPool;
 }
 
 Domain* CudaLbm::GetDomain()
@@ -49,9 +97,17 @@ float* CudaLbm::GetFB()
     return m_fB_d;
 }
 
-int* CudaLbm::GetImage()
+NodeType* CudaLbm::GetBoundaryCodes()
 {
-    return m_Im_d;
+    return m_boundaryCodes_d;
+}
+
+SolidMask CudaLbm::GetSolidMask()
+{
+    SolidMask mask;
+    mask.Words = m_solidMask_d;
+    mask.WordsPerRow = m_maskWordsPerRow;
+    return mask;
 }
 
 float* CudaLbm::GetFloorTemp()
@@ -64,16 +120,6 @@ int* CudaLbm::GetFloorHit()
     return m_FloorHit_d;
 }
 
-ObstDefinition* CudaLbm::GetDeviceObst()
-{
-    return m_obst_d;
-}
-
-ObstDefinition* CudaLbm::GetHostObst()
-{
-    return &m_obst_h[0];
-}
-
 float CudaLbm::GetInletVelocity()
 {
     return m_inletVelocity;
@@ -119,58 +165,103 @@ void CudaLbm::SetTimeStepsPerFrame(const int timeSteps)
     m_timeStepsPerFrame = timeSteps;
 }
 
+StreamingMode CudaLbm::GetStreamingMode()
+{
+    return m_streamingMode;
+}
+
+void CudaLbm::SetStreamingMode(const StreamingMode p_mode)
+{
+    m_streamingMode = p_mode;
+}
+
 void CudaLbm::AllocateDeviceMemory()
 {
-    size_t memsize_lbm, memsize_int, memsize_float, memsize_inputs;
+    size_t memsize_int, memsize_float;
 
+    //floor buffers follow the render mesh, which stays MAX_XDIM x MAX_YDIM
     int domainSize = ceil(MAX_XDIM / BLOCKSIZEX)*BLOCKSIZEX*ceil(MAX_YDIM / BLOCKSIZEY)*BLOCKSIZEY;
-    memsize_lbm = domainSize*sizeof(float)*9;
     memsize_int = domainSize*sizeof(int);
     memsize_float = domainSize*sizeof(float);
-    memsize_inputs = sizeof(m_obst_h);
-
-    float* fA_h = new float[domainSize * 9];
-    float* fB_h = new float[domainSize * 9];
-    float* floor_h = new float[domainSize];
-    m_Im_h = new int[domainSize];
 
-    gpuErrchk(cudaMalloc((void **)&m_fA_d, memsize_lbm));
-    gpuErrchk(cudaMalloc((void **)&m_fB_d, memsize_lbm));
     gpuErrchk(cudaMalloc((void **)&m_FloorTemp_d, memsize_float));
     gpuErrchk(cudaMalloc((void **)&m_FloorHit_d, memsize_int));
-    gpuErrchk(cudaMalloc((void **)&m_Im_d, memsize_int));
-    gpuErrchk(cudaMalloc((void **)&m_obst_d, memsize_inputs));
+
+    ResizeLattice();
 }
 
-void CudaLbm::DeallocateDeviceMemory()
+bool CudaLbm::IsLatticeSizedToDomain()
+{
+    return m_fA_d != nullptr && m_latticePitch == m_domain->GetPitch() && m_latticeYDim == m_domain->GetYDim();
+}
+
+void CudaLbm::ResizeLattice()
+{
+    DeallocateLattice();
+
+    m_latticePitch = m_domain->GetPitch();
+    m_latticeYDim = m_domain->GetYDim();
+    const size_t nodeCount = static_cast<size_t>(m_latticePitch)*m_latticeYDim;
+    const size_t memsize_lbm = nodeCount*sizeof(float)*9;
+    m_maskWordsPerRow = SolidMask::WordsForPitch(m_latticePitch);
+    const size_t maskWordCount = static_cast<size_t>(m_maskWordsPerRow)*m_latticeYDim;
+
+    gpuErrchk(cudaMalloc((void **)&m_fA_d, memsize_lbm));
+    gpuErrchk(cudaMemset(m_fA_d, 0, memsize_lbm));
+    if (m_streamingMode == StreamingMode::PING_PONG)
+    {
+        gpuErrchk(cudaMalloc((void **)&m_fB_d, memsize_lbm));
+        gpuErrchk(cudaMemset(m_fB_d, 0, memsize_lbm));
+    }
+    gpuErrchk(cudaMalloc((void **)&m_boundaryCodes_d, nodeCount*sizeof(NodeType)));
+    gpuErrchk(cudaMalloc((void **)&m_solidMask_d, maskWordCount*sizeof(unsigned long long)));
+    m_boundaryCodes_h.assign(nodeCount, NodeType::FLUID);
+    m_solidMask_h.assign(maskWordCount, 0);
+    //x dimension can change within the pitch without a resize, so size the block list for the full pitch
+    const size_t blockCount = static_cast<size_t>((m_latticePitch + BLOCKSIZEX - 1) / BLOCKSIZEX)
+        *(m_latticeYDim / BLOCKSIZEY);
+    gpuErrchk(cudaMalloc((void **)&m_activeBlocks_d, blockCount*sizeof(int)));
+
+    InitializeDeviceImage();
+}
+
+void CudaLbm::DeallocateLattice()
 {
     gpuErrchk(cudaFree(m_fA_d));
     gpuErrchk(cudaFree(m_fB_d));
-    gpuErrchk(cudaFree(m_Im_d));
+    gpuErrchk(cudaFree(m_boundaryCodes_d));
+    gpuErrchk(cudaFree(m_solidMask_d));
+    gpuErrchk(cudaFree(m_activeBlocks_d));
+    m_fA_d = nullptr;
+    m_fB_d = nullptr;
+    m_boundaryCodes_d = nullptr;
+    m_solidMask_d = nullptr;
+    m_maskWordsPerRow = 0;
+    m_activeBlocks_d = nullptr;
+    m_activeBlockCount = 0;
+    m_fluidBlockCount = 0;
+    m_blocksPerRow = 0;
+
+    m_boundaryCodes_h.clear();
+    m_solidMask_h.clear();
+    m_latticePitch = 0;
+    m_latticeYDim = 0;
+}
+
+void CudaLbm::DeallocateDeviceMemory()
+{
+    DeallocateLattice();
     gpuErrchk(cudaFree(m_FloorTemp_d));
     gpuErrchk(cudaFree(m_FloorHit_d));
-    gpuErrchk(cudaFree(m_obst_d));
-
-    //TODO - separate method for host memory
-    delete[] m_Im_h;
 }
 
 void CudaLbm::InitializeDeviceMemory()
 {
     int domainSize = ceil(MAX_XDIM / BLOCKSIZEX)*BLOCKSIZEX*ceil(MAX_YDIM / BLOCKSIZEY)*BLOCKSIZEY;
-    size_t memsize_lbm, memsize_float, memsize_inputs, memsize_int;
-    memsize_lbm = domainSize*sizeof(float)*9;
+    size_t memsize_float, memsize_int;
     memsize_float = domainSize*sizeof(float);
     memsize_int = domainSize*sizeof(int);
 
-    float* f_h = new float[domainSize*9];
-    for (int i = 0; i < domainSize * 9; i++)
-    {
-        f_h[i] = 0;
-    }
-    gpuErrchk(cudaMemcpy(m_fA_d, f_h, memsize_lbm, cudaMemcpyHostToDevice));
-    gpuErrchk(cudaMemcpy(m_fB_d, f_h, memsize_lbm, cudaMemcpyHostToDevice));
-    delete[] f_h;
     float* floor_h = new float[domainSize];
     for (int i = 0; i < domainSize; i++)
     {
@@ -188,61 +279,297 @@ void CudaLbm::InitializeDeviceMemory()
     delete[] floorHit_h;
 
     //UpdateDeviceImage();
+}
 
-    for (int i = 0; i < MAXOBSTS; i++)
+//! Image codes of cells [p_xBegin, p_xEnd) x [p_yBegin, p_yEnd) with the obstructions p_obsts. Rows near
+//! obstacles cost more, so they are scheduled in small chunks for the pool to balance by stealing. The chunks of
+//! this and UploadImage are counted as ImageRows, per node rasterized.
+void CudaLbm::RasterizeImage(const std::vector<ObstDefinition>& p_obsts, const int p_xBegin, const int p_xEnd,
+    const int p_yBegin, const int p_yEnd)
+{
+    const int xDimVisible = GetDomain()->GetXDimVisible();
+    const CellRect target = { p_xBegin, p_xEnd, p_yBegin, p_yEnd };
+    //obstructions reaching into the target, with their footprints clipped to it, listed in every band of rows they
+    //reach so a row only goes through the ones that can cover it
+    const int bandRows = 16;
+    std::vector<std::vector<std::pair<const ObstDefinition*, CellRect>>> bands(
+        (p_yEnd - p_yBegin + bandRows - 1) / bandRows);
+    for (const ObstDefinition& obst : p_obsts)
     {
-        m_obst_h[i].r1 = 0;
-        m_obst_h[i].x = 0;
-        m_obst_h[i].y = -1000;
-        m_obst_h[i].state = State::SELECTED;
-    }    
+        CellRect rect = CellRectFromFootprint(obst, xDimVisible);
+        if (!Overlap(rect, target))
+            continue;
+        rect.XBegin = std::max(rect.XBegin, p_xBegin);
+        rect.XEnd = std::min(rect.XEnd, p_xEnd);
+        rect.YBegin = std::max(rect.YBegin, p_yBegin);
+        rect.YEnd = std::min(rect.YEnd, p_yEnd);
+        for (int band = (rect.YBegin - p_yBegin) / bandRows; band <= (rect.YEnd - 1 - p_yBegin) / bandRows; band++)
+            bands[band].push_back(std::make_pair(&obst, rect));
+    }
+
+    m_threadPool->ParallelFor(p_yEnd - p_yBegin, 4, [&](const int p_rowBegin, const int p_rowEnd){
+        SHIZUKU_COUNTED_ZONE("ImageRows");
+        SHIZUKU_ZONE_WORK(static_cast<double>(p_rowEnd - p_rowBegin)*(p_xEnd - p_xBegin));
+        for (int y = p_yBegin + p_rowBegin; y < p_yBegin + p_rowEnd; y++)
+        {
+            NodeType* imRow = m_boundaryCodes_h.data() + static_cast<size_t>(y)*m_latticePitch;
+            for (int x = p_xBegin; x < p_xEnd; x++)
+                imRow[x] = ImageFcn(x, y);
+            for (const auto& obst : bands[(y - p_yBegin) / bandRows])
+            {
+                const CellRect& rect = obst.second;
+                if (y < rect.YBegin || y >= rect.YEnd)
+                    continue;
+                for (int x = rect.XBegin; x < rect.XEnd; x++)
+                {
+                    const Point<float> modelCoord = ModelSpacePosFromSimPos(Point<int>(x, y), xDimVisible);
+                    if (IsInsideFootprint(*obst.first, modelCoord))
+                        imRow[x] = NodeType::OBSTRUCTION;
+                }
+            }
+        }
+    });
+}
 
-    memsize_inputs = sizeof(m_obst_h);
-    gpuErrchk(cudaMemcpy(m_obst_d, m_obst_h, memsize_inputs, cudaMemcpyHostToDevice));
+//! Packs cells [p_xBegin, p_xEnd) x [p_yBegin, p_yEnd) of the host image into the solid mask and uploads both. The
+//! mask is repacked in whole words.
+void CudaLbm::UploadImage(const int p_xBegin, const int p_xEnd, const int p_yBegin, const int p_yEnd)
+{
+    const int wordBegin = p_xBegin / 64;
+    const int wordEnd = (p_xEnd + 63) / 64;
+    m_threadPool->ParallelFor(p_yEnd - p_yBegin, 16, [&](const int p_rowBegin, const int p_rowEnd){
+        SHIZUKU_COUNTED_ZONE("ImageRows");
+        for (int y = p_yBegin + p_rowBegin; y < p_yBegin + p_rowEnd; y++)
+        {
+            const NodeType* imRow = m_boundaryCodes_h.data() + static_cast<size_t>(y)*m_latticePitch;
+            for (int word = wordBegin; word < wordEnd; word++)
+            {
+                const int xEnd = std::min(word*64 + 64, m_latticePitch);
+                unsigned long long bits = 0;
+                for (int x = word*64; x < xEnd; x++)
+                    bits |= static_cast<unsigned long long>(imRow[x] != NodeType::FLUID) << (x & 63);
+                m_solidMask_h[word + static_cast<size_t>(y)*m_maskWordsPerRow] = bits;
+            }
+        }
+    });
+
+    const size_t codeOffset = p_xBegin + static_cast<size_t>(p_yBegin)*m_latticePitch;
+    gpuErrchk(cudaMemcpy2D(m_boundaryCodes_d + codeOffset, m_latticePitch*sizeof(NodeType),
+        m_boundaryCodes_h.data() + codeOffset, m_latticePitch*sizeof(NodeType), (p_xEnd - p_xBegin)*sizeof(NodeType),
+        p_yEnd - p_yBegin, cudaMemcpyHostToDevice));
+    const size_t maskPitchBytes = static_cast<size_t>(m_maskWordsPerRow)*sizeof(unsigned long long);
+    const size_t maskOffset = wordBegin + static_cast<size_t>(p_yBegin)*m_maskWordsPerRow;
+    gpuErrchk(cudaMemcpy2D(m_solidMask_d + maskOffset, maskPitchBytes, m_solidMask_h.data() + maskOffset,
+        maskPitchBytes, (wordEnd - wordBegin)*sizeof(unsigned long long), p_yEnd - p_yBegin,
+        cudaMemcpyHostToDevice));
 }
 
 void CudaLbm::InitializeDeviceImage()
 {
-    int domainSize = ceil(MAX_XDIM / BLOCKSIZEX)*BLOCKSIZEX*ceil(MAX_YDIM / BLOCKSIZEY)*BLOCKSIZEY;
-    for (int i = 0; i < domainSize; i++)
+    RasterizeImage(std::vector<ObstDefinition>(), 0, m_domain->GetXDim(), 0, m_latticeYDim);
+    UploadImage(0, m_latticePitch, 0, m_latticeYDim);
+    UpdateActiveBlocks();
+}
+
+void CudaLbm::UpdateDeviceImage(const std::vector<ObstDefinition>& p_obsts)
+{
+    SHIZUKU_ZONE("UpdateDeviceImage");
+    RasterizeImage(p_obsts, 0, m_domain->GetXDim(), 0, m_latticeYDim);
+    UploadImage(0, m_latticePitch, 0, m_latticeYDim);
+    UpdateActiveBlocks();
+}
+
+void CudaLbm::UpdateDeviceImage(const std::vector<ObstDefinition>& p_obsts,
+    const std::vector<ObstDefinition>& p_changed)
+{
+    const int xDim = m_domain->GetXDim();
+    const int yDim = m_latticeYDim;
+    if (m_blocksPerRow != (xDim + BLOCKSIZEX - 1) / BLOCKSIZEX)
+    {
+        UpdateDeviceImage(p_obsts);
+        return;
+    }
+    SHIZUKU_ZONE("UpdateDeviceImage");
+
+    const int xDimVisible = GetDomain()->GetXDimVisible();
+    std::vector<CellRect> rects;
+    for (const ObstDefinition& obst : p_changed)
     {
-        int x = i%MAX_XDIM;
-        int y = i/MAX_XDIM;
-        m_Im_h[i] = ImageFcn(x, y);
+        CellRect rect = CellRectFromFootprint(obst, xDimVisible);
+        rect.XBegin = std::max(rect.XBegin, 0);
+        rect.XEnd = std::min(rect.XEnd, xDim);
+        rect.YBegin = std::max(rect.YBegin, 0);
+        rect.YEnd = std::min(rect.YEnd, yDim);
+        if (rect.XBegin < rect.XEnd && rect.YBegin < rect.YEnd)
+            AddToUnion(rects, rect);
     }
-    size_t memsize_int = domainSize*sizeof(int);
-    gpuErrchk(cudaMemcpy(m_Im_d, m_Im_h, memsize_int, cudaMemcpyHostToDevice));
+
+    for (const CellRect& rect : rects)
+    {
+        RasterizeImage(p_obsts, rect.XBegin, rect.XEnd, rect.YBegin, rect.YEnd);
+        UploadImage(rect.XBegin, rect.XEnd, rect.YBegin, rect.YEnd);
+
+        //block types also depend on the one-node ring around each block
+        ClassifyBlocks((rect.XBegin - 1) / BLOCKSIZEX, (rect.XEnd + BLOCKSIZEX) / BLOCKSIZEX,
+            (rect.YBegin - 1) / BLOCKSIZEY, (rect.YEnd + BLOCKSIZEY) / BLOCKSIZEY);
+    }
+    if (!rects.empty())
+        UploadActiveBlocks();
 }
 
-//! TODO: use Cuda for this
-void CudaLbm::UpdateDeviceImage(ObstManager& p_obstMgr)
+void CudaLbm::UpdateActiveBlocks()
 {
-    int domainSize = ceil(MAX_XDIM / BLOCKSIZEX)*BLOCKSIZEX*ceil(MAX_YDIM / BLOCKSIZEY)*BLOCKSIZEY;
-    for (int i = 0; i < domainSize; i++)
+    const int xDim = m_domain->GetXDim();
+    m_blocksPerRow = (xDim + BLOCKSIZEX - 1) / BLOCKSIZEX;
+    const int blockRows = m_latticeYDim / BLOCKSIZEY;
+    m_blockTypes.assign(static_cast<size_t>(m_blocksPerRow)*blockRows, 0);
+    ClassifyBlocks(0, m_blocksPerRow, 0, blockRows);
+    UploadActiveBlocks();
+}
+
+static_assert(BLOCKSIZEX == 64, "ClassifyBlocks reads a block row as one solid mask word");
+
+//! Blocks [p_bxBegin, p_bxEnd) x [p_byBegin, p_byEnd), clamped to the lattice
+void CudaLbm::ClassifyBlocks(const int p_bxBegin, const int p_bxEnd, const int p_byBegin, const int p_byEnd)
+{
+    const int xDim = m_domain->GetXDim();
+    const int yDim = m_latticeYDim;
+    const int bxBegin = std::max(p_bxBegin, 0);
+    const int bxEnd = std::min(p_bxEnd, m_blocksPerRow);
+    const int byBegin = std::max(p_byBegin, 0);
+    const int byEnd = std::min(p_byEnd, yDim / BLOCKSIZEY);
+    if (bxBegin >= bxEnd || byBegin >= byEnd)
+        return;
+    m_threadPool->ParallelFor(byEnd - byBegin, [&](const int p_rowBegin, const int p_rowEnd){
+        for (int by = byBegin + p_rowBegin; by < byBegin + p_rowEnd; by++)
+        {
+            for (int bx = bxBegin; bx < bxEnd; bx++)
+            {
+                const int xBegin = std::max(bx*BLOCKSIZEX - 1, 0);
+                const int xEnd = std::min((bx + 1)*BLOCKSIZEX + 1, xDim);
+                const int yBegin = std::max(by*BLOCKSIZEY - 1, 0);
+                const int yEnd = std::min((by + 1)*BLOCKSIZEY + 1, yDim);
+                //each block row is one mask word; nodes past xDim are not marched
+                const int nodesInRow = std::min(BLOCKSIZEX, xDim - bx*BLOCKSIZEX);
+                const unsigned long long inBlock = nodesInRow == 64 ? ~0ull : (1ull << nodesInRow) - 1ull;
+                bool allFluid = true;
+                for (int y = by*BLOCKSIZEY; y < (by + 1)*BLOCKSIZEY; y++)
+                    allFluid = allFluid && (m_solidMask_h[bx + y*m_maskWordsPerRow] & inBlock) == 0;
+                if (allFluid)
+                {
+                    m_blockTypes[bx + by*m_blocksPerRow] = 1;
+                    continue;
+                }
+                bool allSolid = true;
+                for (int y = yBegin; y < yEnd && allSolid; y++)
+                {
+                    for (int x = xBegin; x < xEnd; x++)
+                    {
+                        const NodeType im = m_boundaryCodes_h[x + y*m_latticePitch];
+                        allSolid = allSolid && (im == NodeType::OBSTRUCTION || im == NodeType::WALL);
+                    }
+                }
+                m_blockTypes[bx + by*m_blocksPerRow] = allSolid ? 0 : 2;
+            }
+        }
+    });
+}
+
+void CudaLbm::UploadActiveBlocks()
+{
+    std::vector<int> activeBlocks;
+    std::vector<int> boundaryBlocks;
+    for (int block = 0; block < static_cast<int>(m_blockTypes.size()); block++)
     {
-        int x = i%MAX_XDIM;
-        int y = i/MAX_XDIM;
-        m_Im_h[i] = ImageFcn(x, y);
-        const int xDimVisible = GetDomain()->GetXDimVisible();
-        const Point<float> modelCoord = ModelSpacePosFromSimPos(Point<int>(x, y), xDimVisible);
-        if (p_obstMgr.IsInsideObstruction(modelCoord))
-            m_Im_h[i] = 1;
+        if (m_blockTypes[block] == 1)
+            activeBlocks.push_back(block);
+        else if (m_blockTypes[block] == 2)
+            boundaryBlocks.push_back(block);
     }
-    size_t memsize_int = domainSize*sizeof(int);
-    gpuErrchk(cudaMemcpy(m_Im_d, m_Im_h, memsize_int, cudaMemcpyHostToDevice));
+    m_fluidBlockCount = static_cast<int>(activeBlocks.size());
+    activeBlocks.insert(activeBlocks.end(), boundaryBlocks.begin(), boundaryBlocks.end());
+    m_activeBlockCount = static_cast<int>(activeBlocks.size());
+    if (m_activeBlockCount > 0)
+        gpuErrchk(cudaMemcpy(m_activeBlocks_d, activeBlocks.data(), m_activeBlockCount*sizeof(int),
+            cudaMemcpyHostToDevice));
 }
 
-int CudaLbm::ImageFcn(const int x, const int y){
+int* CudaLbm::GetActiveBlocks()
+{
+    return m_activeBlocks_d;
+}
+
+int CudaLbm::GetActiveBlockCount()
+{
+    return m_activeBlockCount;
+}
+
+int CudaLbm::GetFluidBlockCount()
+{
+    return m_fluidBlockCount;
+}
+
+int CudaLbm::GetBlocksPerRow()
+{
+    return m_blocksPerRow;
+}
+
+NodeType CudaLbm::ImageFcn(const int x, const int y){
     int xDim = GetDomain()->GetXDim();
     int yDim = GetDomain()->GetYDim();
     if (x < 0.1f)
-        return 3;//west
+        return NodeType::DIRICHLET_WEST;
     else if ((xDim - x) < 1.1f)
-        return 2;//east
+        return NodeType::NEUMANN_EAST;
     else if ((yDim - y) < 1.1f)
-        return 11;//11;//xsymmetry top
+        return NodeType::SYMMETRY_TOP;
     else if (y < 0.1f)
-        return 12;//12;//xsymmetry bottom
-    return 0;
+        return NodeType::SYMMETRY_BOTTOM;
+    return NodeType::FLUID;
 }
 
+
+void CudaLbm::CaptureCheckpoint(Checkpoint& p_checkpoint)
+{
+    const int xDim = m_domain->GetXDim();
+    const int yDim = m_latticeYDim;
+    p_checkpoint.XDim = xDim;
+    p_checkpoint.YDim = yDim;
+    p_checkpoint.Streaming = m_streamingMode;
+    p_checkpoint.Omega = m_omega;
+    p_checkpoint.InletVelocity = m_inletVelocity;
+
+    //the 9 planes are contiguous, so the lattice is 9*yDim rows of pitch nodes
+    p_checkpoint.Distributions.resize(static_cast<size_t>(xDim)*yDim * 9);
+    gpuErrchk(cudaMemcpy2D(p_checkpoint.Distributions.data(), xDim*sizeof(float), m_fA_d,
+        m_latticePitch*sizeof(float), xDim*sizeof(float), yDim * 9, cudaMemcpyDeviceToHost));
+    p_checkpoint.Image.resize(static_cast<size_t>(xDim)*yDim);
+    for (int y = 0; y < yDim; y++)
+    {
+        std::copy_n(m_boundaryCodes_h.data() + static_cast<size_t>(y)*m_latticePitch, xDim,
+            p_checkpoint.Image.data() + static_cast<size_t>(y)*xDim);
+    }
+}
+
+void CudaLbm::RestoreCheckpoint(const Checkpoint& p_checkpoint)
+{
+    m_omega = p_checkpoint.Omega;
+    m_inletVelocity = p_checkpoint.InletVelocity;
+    if (p_checkpoint.Streaming != m_streamingMode)
+    {
+        SetStreamingMode(p_checkpoint.Streaming);
+        ResizeLattice();
+    }
+    UpdateDeviceImage(p_checkpoint.Obsts);
+
+    const int xDim = p_checkpoint.XDim;
+    const int yDim = p_checkpoint.YDim;
+    gpuErrchk(cudaMemcpy2D(m_fA_d, m_latticePitch*sizeof(float), p_checkpoint.Distributions.data(),
+        xDim*sizeof(float), xDim*sizeof(float), yDim * 9, cudaMemcpyHostToDevice));
+    //same values in both lattices, as InitializeDomain does, so nodes the active blocks skip are consistent too
+    if (m_fB_d != nullptr)
+    {
+        gpuErrchk(cudaMemcpy(m_fB_d, m_fA_d, static_cast<size_t>(m_latticePitch)*yDim * 9 * sizeof(float),
+            cudaMemcpyDeviceToDevice));
+    }
+}
@@ -1,18 +1,20 @@
 #pragma once
 #include "../common.h"
+#include "../SolidMask.h"
 #include "ObstDefinition.h"
 #include "Shizuku.Core/Rect.h"
+#include "Shizuku.Core/Utilities/ThreadPool.h"
+#include <memory>
+#include <vector>
 
 using namespace Shizuku::Flow;
 
 class Domain;
+namespace Shizuku { namespace Flow{
+    struct Checkpoint;
+} }
 
-namespace Shizuku {
-    namespace Flow {
-        class ObstManager;
-    }
-}
-
+//! Once a SolverThread runs it, it must only be changed from commands posted to the thread
 class CudaLbm
 {
 private:
@@ -21,28 +23,51 @@ private:
     Domain* m_domain;
     float* m_fA_d;
     float* m_fB_d;
-    int* m_Im_d;
-    int* m_Im_h;
+    //! Device image: node codes for the boundary conditions, one byte per node, and the solid mask packed from them
+    NodeType* m_boundaryCodes_d;
+    unsigned long long* m_solidMask_d;
+    int m_maskWordsPerRow;
+    //! Host image the obstructions are rasterized into, in the device layout, and the solid mask packed from it
+    std::vector<NodeType> m_boundaryCodes_h;
+    std::vector<unsigned long long> m_solidMask_h;
     float* m_FloorTemp_d;
     int* m_FloorHit_d;
-    ObstDefinition* m_obst_d;
-    ObstDefinition m_obst_h[MAXOBSTS];
     float m_inletVelocity;
     float m_omega;
     bool m_isPaused;
     int m_timeStepsPerFrame;
+    StreamingMode m_streamingMode;
+    int m_latticePitch;
+    int m_latticeYDim;
+    int* m_activeBlocks_d;
+    int m_activeBlockCount;
+    int m_fluidBlockCount;
+    int m_blocksPerRow;
+    //! Per MarchLBM block: 0 solid, 1 fluid, 2 boundary
+    std::vector<unsigned char> m_blockTypes;
+    std::shared_ptr<Shizuku::Core::ThreadPool> m_threadPool;
+
+    void DeallocateLattice();
+    void UpdateActiveBlocks();
+    void ClassifyBlocks(const int p_bxBegin, const int p_bxEnd, const int p_byBegin, const int p_byEnd);
+    void UploadActiveBlocks();
+    void RasterizeImage(const std::vector<ObstDefinition>& p_obsts, const int p_xBegin, const int p_xEnd,
+        const int p_yBegin, const int p_yEnd);
+    void UploadImage(const int p_xBegin, const int p_xEnd, const int p_yBegin, const int p_yEnd);
 public:
     CudaLbm();
     CudaLbm(const int maxX, const int maxY);
     Domain* GetDomain();
     Shizuku::Core::Rect<int> GetDomainSize();
     float* GetFA();
+    //! Null in IN_PLACE mode, which only allocates fA
     float* GetFB();
-    int* GetImage();
+    //! Image code (NodeType) of each node, pitch bytes per row
+    NodeType* GetBoundaryCodes();
+    //! For the solidity tests of the render kernels, which only need FLUID or not
+    SolidMask GetSolidMask();
     float* GetFloorTemp();
     int* GetFloorHit();
-    ObstDefinition* GetDeviceObst();
-    ObstDefinition* GetHostObst();
     float GetInletVelocity();
     float GetOmega();
     void SetInletVelocity(const float velocity);
@@ -52,13 +77,44 @@ public:
     bool IsPaused();
     int GetTimeStepsPerFrame();
     void SetTimeStepsPerFrame(const int timeSteps);
+    StreamingMode GetStreamingMode();
+    //! Takes effect the next time the lattice is allocated (AllocateDeviceMemory, ResizeLattice)
+    void SetStreamingMode(const StreamingMode p_mode);
+
+    //! Lattice and image are sized from the Domain (pitch x yDim) and have to be resized when it changes
+    bool IsLatticeSizedToDomain();
+    void ResizeLattice();
+
+    //! Indices (bx + by*blocks per row) of the MarchLBM blocks to launch. Blocks whose nodes and one-node ring are all
+    //! solid are left out; only other solid nodes read them. The first GetFluidBlockCount blocks are all FLUID and
+    //! need no boundary checks. Rebuilt with the image.
+    int* GetActiveBlocks();
+    int GetActiveBlockCount();
+    int GetFluidBlockCount();
+    int GetBlocksPerRow();
 
     void AllocateDeviceMemory();
     void InitializeDeviceMemory();
     void DeallocateDeviceMemory();
     void InitializeDeviceImage();
-    void UpdateDeviceImage(ObstManager& p_obstMgr);
-    int ImageFcn(const int x, const int y);
+    //! Rasterizes the obstructions p_obsts (ObstManager::ObstDefinitions) over the whole image
+    void UpdateDeviceImage(const std::vector<ObstDefinition>& p_obsts);
+    //! Re-rasterizes and uploads only the cells under p_changed, the old and new footprints of the obstructions
+    //! that were created, deleted or moved (ObstManager::TakeChangedObsts). Falls back to the full rebuild if the
+    //! image is not in sync with the domain.
+    void UpdateDeviceImage(const std::vector<ObstDefinition>& p_obsts, const std::vector<ObstDefinition>& p_changed);
+    NodeType ImageFcn(const int x, const int y);
+
+    //! Stages the lattice, image and parameters into p_checkpoint; Step and Obsts are left to the caller, which
+    //! tracks them. Copies synchronously, so only call it between batches.
+    void CaptureCheckpoint(Checkpoint& p_checkpoint);
+    //! Carries on from p_checkpoint, which has to be the size of the domain. The image is rasterized from its
+    //! obstructions.
+    void RestoreCheckpoint(const Checkpoint& p_checkpoint);
+
+    //! Host passes (image rebuild, active blocks) run their rows on this pool. Can be shared with a CpuLbm.
+    std::shared_ptr<Shizuku::Core::ThreadPool> GetThreadPool();
+    void SetThreadPool(std::shared_ptr<Shizuku::Core::ThreadPool> p_threadPool);
 
    
 };
@@ -0,0 +1,52 @@
+#include "FieldRecorder.h"
+#include "CudaCheck.h"
+
+using namespace Shizuku::Flow;
+
+FieldRecorder::FieldRecorder(const std::string& p_path, const int p_xDim, const int p_yDim)
+    : m_writer(p_path, p_xDim, p_yDim, FieldHistoryFile::DefaultTileSize, 8), m_xDim(p_xDim), m_yDim(p_yDim),
+    m_lastStep(-1), m_lastFlowGeneration(-1)
+{
+    m_staging.resize(static_cast<size_t>(p_xDim)*p_yDim);
+}
+
+bool FieldRecorder::Record(const FieldSnapshot& p_snapshot)
+{
+    Domain domain = p_snapshot.SimDomain;
+    if (domain.GetXDim() != m_xDim || domain.GetYDim() != m_yDim)
+        return false;
+    if (p_snapshot.Step == m_lastStep && p_snapshot.FlowGeneration == m_lastFlowGeneration)
+        return true;
+    m_lastStep = p_snapshot.Step;
+    m_lastFlowGeneration = p_snapshot.FlowGeneration;
+
+    //drops the row padding of the snapshot
+    gpuErrchk(cudaMemcpy2D(m_staging.data(), m_xDim*sizeof(float4), p_snapshot.Fields,
+        domain.GetPitch()*sizeof(float4), m_xDim*sizeof(float4), m_yDim, cudaMemcpyDeviceToHost));
+
+    FieldFrame frame = m_writer.AcquireFrame();
+    frame.Step = p_snapshot.Step;
+    for (size_t i = 0; i < m_staging.size(); i++)
+    {
+        frame.Rho[i] = m_staging[i].x;
+        frame.U[i] = m_staging[i].y;
+        frame.V[i] = m_staging[i].z;
+    }
+    m_writer.Append(std::move(frame));
+    return true;
+}
+
+bool FieldRecorder::Close()
+{
+    return m_writer.Close();
+}
+
+std::string FieldRecorder::GetLastError()
+{
+    return m_writer.GetLastError();
+}
+
+int FieldRecorder::GetRecordedCount()
+{
+    return m_writer.GetWrittenCount();
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "FieldSnapshot.h"
+#include "Solver/FieldHistoryWriter.h"
+#include "cuda_runtime.h"
+#include <string>
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    //! Records the density and velocity of published snapshots to a field history. The fields are copied to the
+    //! host on the render thread; compression and writing happen on the FieldHistoryWriter's thread.
+    class FieldRecorder
+    {
+    private:
+        FieldHistoryWriter m_writer;
+        int m_xDim;
+        int m_yDim;
+        long long m_lastStep;
+        int m_lastFlowGeneration;
+        std::vector<float4> m_staging;
+    public:
+        //! Records a lattice of p_xDim x p_yDim to p_path. Throws std::runtime_error if it can't be created.
+        FieldRecorder(const std::string& p_path, const int p_xDim, const int p_yDim);
+
+        //! Queues the fields of p_snapshot, unless they were queued already. Returns false if the snapshot isn't
+        //! the size of the recording.
+        bool Record(const FieldSnapshot& p_snapshot);
+        //! Finishes the file. Returns false if any write failed, see GetLastError.
+        bool Close();
+        std::string GetLastError();
+        int GetRecordedCount();
+    };
+} }
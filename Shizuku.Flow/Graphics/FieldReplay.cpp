@@ -0,0 +1,103 @@
+#include "FieldReplay.h"
+#include "CudaCheck.h"
+#include "common.h"
+#include <stdexcept>
+
+using namespace Shizuku::Flow;
+
+namespace
+{
+    //! Frames decoded ahead; one is being uploaded
+    const int PrefetchFrames = 4;
+    //! Replay snapshots don't belong to any flow of the solver, whose generations start at 0
+    const int ReplayFlowGeneration = -1;
+}
+
+FieldReplay::FieldReplay(const std::string& p_path, const Domain& p_domain, const std::vector<NodeType>& p_image)
+    : m_reader(std::make_shared<FieldHistoryReader>()), m_hasFrame(false)
+{
+    m_reader->Open(p_path);
+    Domain domain = p_domain;
+    const int xDim = domain.GetXDim();
+    const int yDim = domain.GetYDim();
+    const int pitch = domain.GetPitch();
+    if (m_reader->GetXDim() != xDim || m_reader->GetYDim() != yDim)
+    {
+        throw std::runtime_error(p_path + " is " + std::to_string(m_reader->GetXDim()) + "x"
+            + std::to_string(m_reader->GetYDim()) + ", the domain is " + std::to_string(xDim) + "x"
+            + std::to_string(yDim));
+    }
+    if (p_image.size() != static_cast<size_t>(xDim)*yDim)
+        throw std::runtime_error("the image doesn't match " + p_path);
+    if (m_reader->GetFrameCount() == 0)
+        throw std::runtime_error(p_path + " has no frames");
+
+    //the image doesn't change during a replay, so the boundary codes and the mask are uploaded once
+    const size_t nodeCount = static_cast<size_t>(pitch)*yDim;
+    const int maskWordsPerRow = SolidMask::WordsForPitch(pitch);
+    std::vector<NodeType> codes(nodeCount, NodeType::FLUID);
+    std::vector<unsigned long long> mask(static_cast<size_t>(maskWordsPerRow)*yDim, 0ull);
+    for (int y = 0; y < yDim; y++)
+    {
+        for (int x = 0; x < xDim; x++)
+        {
+            const NodeType code = p_image[x + static_cast<size_t>(y)*xDim];
+            codes[x + static_cast<size_t>(y)*pitch] = code;
+            if (code != NodeType::FLUID)
+                mask[(x >> 6) + static_cast<size_t>(y)*maskWordsPerRow] |= 1ull << (x & 63);
+        }
+    }
+
+    m_snapshot = FieldSnapshot();
+    m_snapshot.SimDomain = domain;
+    m_snapshot.MaskWordsPerRow = maskWordsPerRow;
+    m_snapshot.NodeCapacity = nodeCount;
+    m_snapshot.MaskWordCapacity = mask.size();
+    m_snapshot.FlowGeneration = ReplayFlowGeneration;
+    gpuErrchk(cudaMalloc((void **)&m_snapshot.Fields, nodeCount*sizeof(float4)));
+    gpuErrchk(cudaMalloc((void **)&m_snapshot.BoundaryCodes, nodeCount*sizeof(NodeType)));
+    gpuErrchk(cudaMalloc((void **)&m_snapshot.SolidMaskWords, mask.size()*sizeof(unsigned long long)));
+    gpuErrchk(cudaMemcpy(m_snapshot.BoundaryCodes, codes.data(), nodeCount*sizeof(NodeType),
+        cudaMemcpyHostToDevice));
+    gpuErrchk(cudaMemcpy(m_snapshot.SolidMaskWords, mask.data(), mask.size()*sizeof(unsigned long long),
+        cudaMemcpyHostToDevice));
+    //the padding columns are never drawn, but keep them defined
+    m_staging.assign(nodeCount, make_float4(1.f, 0.f, 0.f, 0.f));
+
+    m_prefetcher.reset(new FieldHistoryPrefetcher(m_reader, PrefetchFrames, true));
+}
+
+FieldReplay::~FieldReplay()
+{
+    //the decode thread goes before the buffers it may still be writing to
+    m_prefetcher.reset();
+    gpuErrchk(cudaFree(m_snapshot.Fields));
+    gpuErrchk(cudaFree(m_snapshot.BoundaryCodes));
+    gpuErrchk(cudaFree(m_snapshot.SolidMaskWords));
+}
+
+const FieldSnapshot* FieldReplay::Advance(const bool p_advance)
+{
+    const FieldFrame* frame = p_advance || !m_hasFrame ? m_prefetcher->TryAcquire() : nullptr;
+    if (frame != nullptr)
+    {
+        Domain domain = m_snapshot.SimDomain;
+        const int xDim = domain.GetXDim();
+        const int yDim = domain.GetYDim();
+        const int pitch = domain.GetPitch();
+        for (int y = 0; y < yDim; y++)
+        {
+            for (int x = 0; x < xDim; x++)
+            {
+                const size_t i = x + static_cast<size_t>(y)*xDim;
+                m_staging[x + static_cast<size_t>(y)*pitch] = make_float4(frame->Rho[i], frame->U[i], frame->V[i],
+                    0.f);
+            }
+        }
+        gpuErrchk(cudaMemcpy(m_snapshot.Fields, m_staging.data(), m_staging.size()*sizeof(float4),
+            cudaMemcpyHostToDevice));
+        m_snapshot.Step = frame->Step;
+        m_hasFrame = true;
+    }
+    return m_hasFrame ? &m_snapshot : nullptr;
+}
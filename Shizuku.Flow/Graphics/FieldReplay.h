@@ -0,0 +1,36 @@
+#pragma once
+#include "FieldSnapshot.h"
+#include "Solver/FieldHistory.h"
+#include "Solver/FieldHistoryPrefetcher.h"
+#include "cuda_runtime.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    //! Plays a field history back as FieldSnapshots, in place of the solver's, so the surface, contours and caustics
+    //! are drawn by the usual path without solving anything. Frames are decoded ahead by a FieldHistoryPrefetcher
+    //! and uploaded one per call. The recording has no strain rate, so that contour stays blank.
+    class FieldReplay
+    {
+    private:
+        std::shared_ptr<FieldHistoryReader> m_reader;
+        std::unique_ptr<FieldHistoryPrefetcher> m_prefetcher;
+        FieldSnapshot m_snapshot;
+        std::vector<float4> m_staging;
+        bool m_hasFrame;
+    public:
+        //! Plays p_path on p_domain, which has to be the size of the recording. p_image holds the NodeType of each
+        //! node (XDim x YDim, see Checkpoint::Image) for the obstruction shading. Throws std::runtime_error if the
+        //! file can't be read or doesn't fit.
+        FieldReplay(const std::string& p_path, const Domain& p_domain, const std::vector<NodeType>& p_image);
+        ~FieldReplay();
+
+        FieldReplay(const FieldReplay&) = delete;
+        FieldReplay& operator=(const FieldReplay&) = delete;
+
+        //! Snapshot of the next frame if it is decoded by now, else of the current one; null until the first frame
+        //! is in. p_advance false holds the current frame. Replays in a loop.
+        const FieldSnapshot* Advance(const bool p_advance);
+    };
+} }
@@ -0,0 +1,35 @@
+#pragma once
+#include "../Domain.h"
+#include "../SolidMask.h"
+#include "../common.h"
+#include "cuda_runtime.h"
+#include <cstddef>
+
+namespace Shizuku { namespace Flow{
+    //! Solution after a batch of steps as published by SolverThread, in device memory. Nodes are laid out as the
+    //! lattice of SimDomain (pitch x yDim). The buffers only grow, so they can be larger than that.
+    struct FieldSnapshot
+    {
+        Domain SimDomain;
+        //! rho, u, v and strain rate magnitude of each node; rho is 1 in obstructions
+        float4* Fields;
+        //! Copies of the CudaLbm image the fields were computed with
+        NodeType* BoundaryCodes;
+        unsigned long long* SolidMaskWords;
+        int MaskWordsPerRow;
+        size_t NodeCapacity;
+        size_t MaskWordCapacity;
+        //! Time steps since the flow was initialized
+        long long Step;
+        //! Counts flow initializations, so the render side knows when to reset the meshes
+        int FlowGeneration;
+
+        SolidMask GetSolidMask() const
+        {
+            SolidMask mask;
+            mask.Words = SolidMaskWords;
+            mask.WordsPerRow = MaskWordsPerRow;
+            return mask;
+        }
+    };
+} }
@@ -3,18 +3,23 @@
 #include "ObstManager.h"
 #include "Floor.h"
 #include "CudaLbm.h"
+#include "SolverThread.h"
 #include "kernel.h"
 #include "Domain.h"
 #include "CudaCheck.h"
-#include "TimerKey.h"
 #include "ObstDefinition.h"
 #include "PillarDefinition.h"
 #include "RenderParams.h"
 #include "HitParams.h"
+#include "Solver/Checkpoint.h"
+#include "Solver/CheckpointWriter.h"
+#include "FieldRecorder.h"
+#include "FieldReplay.h"
 
 #include "Shizuku.Core/Ogl/Shader.h"
 #include "Shizuku.Core/Types/Box.h"
 #include "Shizuku.Core/Types/Point.h"
+#include "Shizuku.Core/Utilities/Profiler.h"
 
 //#include "helper_cuda.h"
 
@@ -102,9 +107,14 @@ GraphicsManager::GraphicsManager()
 {
     m_waterSurface = std::make_shared<WaterSurface>();
     m_waterSurface->CreateCudaLbm();
+    m_solver = std::make_shared<SolverThread>(m_waterSurface->GetCudaLbm());
+    m_flowGeneration = 0;
+    m_inletVelocity = 0.f;
+    m_omega = 0.f;
+    m_checkpointWriter = std::make_shared<CheckpointWriter>();
+    m_paused = false;
     m_floor = std::make_shared<Floor>(m_waterSurface->Ogl);
     m_obstMgr = std::make_shared<ObstManager>(m_waterSurface->Ogl);
-    m_obstructions = m_waterSurface->GetCudaLbm()->GetHostObst();
     m_rotate = { 55.f, 60.f, 30.f };
     m_translate = { 0.f, 0.6f, 0.f };
     m_surfaceShadingMode = RayTracing;
@@ -120,13 +130,6 @@ GraphicsManager::GraphicsManager()
         Types::Color(glm::vec4(0.8)), //obst
         Types::Color(glm::uvec4(255, 255, 153, 255)) //obst highlight
     };
-
-    const int framesForAverage = 20;
-    m_timers[TimerKey::SolveFluid] = Stopwatch(framesForAverage);
-    m_timers[TimerKey::PrepareFloor] = Stopwatch(framesForAverage);
-    m_timers[TimerKey::PrepareSurface] = Stopwatch(framesForAverage);
-    m_timers[TimerKey::ProcessFloor] = Stopwatch(framesForAverage);
-    m_timers[TimerKey::ProcessSurface] = Stopwatch(framesForAverage);
 }
 
 void GraphicsManager::Initialize()
@@ -219,20 +222,29 @@ void GraphicsManager::SetScaleFactor(const float scaleFactor)
 
 void GraphicsManager::SetVelocity(const float p_velocity)
 {
-    CudaLbm* cudaLbm = GetCudaLbm();
-    cudaLbm->SetInletVelocity(p_velocity);
+    m_inletVelocity = p_velocity;
+    m_solver->Post([p_velocity](CudaLbm& p_lbm){ p_lbm.SetInletVelocity(p_velocity); });
 }
 
 void GraphicsManager::SetViscosity(const float p_viscosity)
 {
-    CudaLbm* cudaLbm = GetCudaLbm();
-    cudaLbm->SetOmega(1.0f/p_viscosity);
+    const float omega = 1.0f/p_viscosity;
+    m_omega = omega;
+    m_solver->Post([omega](CudaLbm& p_lbm){ p_lbm.SetOmega(omega); });
 }
 
 void GraphicsManager::SetTimestepsPerFrame(const int p_steps)
 {
-    CudaLbm* cudaLbm = GetCudaLbm();
-    cudaLbm->SetTimeStepsPerFrame(p_steps);
+    m_solver->Post([p_steps](CudaLbm& p_lbm){ p_lbm.SetTimeStepsPerFrame(p_steps); });
+}
+
+void GraphicsManager::SetPausedState(const bool p_paused)
+{
+    m_paused = p_paused;
+    //a replay keeps the solver paused and holds its frame instead
+    if (m_replay)
+        return;
+    m_solver->Post([p_paused](CudaLbm& p_lbm){ p_lbm.SetPausedState(p_paused); });
 }
 
 void GraphicsManager::SetFloorWireframeVisibility(const bool p_visible)
@@ -250,6 +262,11 @@ CudaLbm* GraphicsManager::GetCudaLbm()
     return m_waterSurface->GetCudaLbm().get();
 }
 
+Rect<int> GraphicsManager::GetDomainSize()
+{
+    return Rect<int>(m_domain.GetXDimVisible(), m_domain.GetYDimVisible());
+}
+
 bool GraphicsManager::IsCudaCapable()
 {
     int deviceCount = 0;
@@ -293,9 +310,8 @@ void GraphicsManager::SetUpShaders()
 {
     m_waterSurface->CompileShaders();
     m_waterSurface->AllocateStorageBuffers();
-    m_waterSurface->InitializeObstSsbo();
     UpdateLbmInputs();
-    m_waterSurface->InitializeComputeShaderData();
+    m_waterSurface->InitializeComputeShaderData(m_domain);
 
     m_waterSurface->SetUpEnvironmentTexture();
     m_floor->Initialize();
@@ -309,92 +325,200 @@ void GraphicsManager::SetUpCuda()
     cudaGLSetGLDevice(0);
 
     CudaLbm* cudaLbm = GetCudaLbm();
+    SetDomainDimensions();
     cudaLbm->AllocateDeviceMemory();
     cudaLbm->InitializeDeviceMemory();
+    m_domain = *cudaLbm->GetDomain();
 
-    DoInitializeFlow();
+    m_solver->PostInitializeFlow();
+    m_solver->Start();
 }
 
 void GraphicsManager::InitializeFlow()
 {
-    DoInitializeFlow();
+    m_solver->PostInitializeFlow();
 }
 
-void GraphicsManager::DoInitializeFlow()
+void GraphicsManager::SaveCheckpoint(const std::string& p_path)
 {
-    CudaLbm* cudaLbm = GetCudaLbm();
-    const float u = cudaLbm->GetInletVelocity();
+    m_solver->PostSaveCheckpoint(p_path, m_obstMgr->ObstDefinitions(), m_checkpointWriter);
+}
 
-    float* fA_d = cudaLbm->GetFA();
-    float* fB_d = cudaLbm->GetFB();
-    int* im_d = cudaLbm->GetImage();
-    float* floor_d = cudaLbm->GetFloorTemp();
-    ObstDefinition* obst_d = cudaLbm->GetDeviceObst();
+bool GraphicsManager::LoadCheckpoint(const std::string& p_path)
+{
+    const std::shared_ptr<Checkpoint> checkpoint = ReadCheckpoint(p_path);
+    if (!checkpoint)
+        return false;
+    ApplyCheckpoint(checkpoint);
+    m_statusMessage = "Loaded checkpoint " + p_path;
+    return true;
+}
 
-    cudaGraphicsResource* cudaSolutionField = m_waterSurface->GetCudaPosColorResource();
-    float4 *dptr;
-    cudaGraphicsMapResources(1, &cudaSolutionField, 0);
-    size_t num_bytes,num_bytes2;
-    cudaGraphicsResourceGetMappedPointer((void **)&dptr, &num_bytes, cudaSolutionField);
+std::shared_ptr<Checkpoint> GraphicsManager::ReadCheckpoint(const std::string& p_path)
+{
+    std::shared_ptr<Checkpoint> checkpoint;
+    try
+    {
+        checkpoint = std::make_shared<Checkpoint>(CheckpointFile::Read(p_path));
+    }
+    catch (const std::exception& e)
+    {
+        m_statusMessage = std::string("Couldn't load checkpoint: ") + e.what();
+        return nullptr;
+    }
+    if (checkpoint->XDim != m_domain.GetXDim() || checkpoint->YDim != m_domain.GetYDim())
+    {
+        m_statusMessage = "Couldn't load checkpoint: " + p_path + " is " + std::to_string(checkpoint->XDim) + "x"
+            + std::to_string(checkpoint->YDim) + ", the domain is " + std::to_string(m_domain.GetXDim()) + "x"
+            + std::to_string(m_domain.GetYDim());
+        return nullptr;
+    }
+    return checkpoint;
+}
 
-    Domain* domain = cudaLbm->GetDomain();
-    InitializeDomain(dptr, fA_d, im_d, u, *domain);
-    InitializeDomain(dptr, fB_d, im_d, u, *domain);
+void GraphicsManager::ApplyCheckpoint(std::shared_ptr<Checkpoint> p_checkpoint)
+{
+    m_obstMgr->ReplaceObsts(p_checkpoint->Obsts);
+    //the image is rebuilt from the obstructions by the restore
+    m_obstMgr->TakeChangedObsts();
+    m_inletVelocity = p_checkpoint->InletVelocity;
+    m_omega = p_checkpoint->Omega;
+    m_solver->PostRestoreCheckpoint(p_checkpoint);
+}
 
-    InitializeSurface(dptr, *domain);
-    InitializeFloor(dptr, *domain);
+bool GraphicsManager::StartRecording(const std::string& p_path)
+{
+    if (m_replay)
+        return false;
+    StopRecording();
+    try
+    {
+        m_recorder = std::make_shared<FieldRecorder>(p_path, m_domain.GetXDim(), m_domain.GetYDim());
+    }
+    catch (const std::exception& e)
+    {
+        m_statusMessage = std::string("Couldn't record: ") + e.what();
+        return false;
+    }
+    SaveCheckpoint(p_path + ".ckpt");
+    m_statusMessage = "Recording to " + p_path;
+    return true;
+}
 
-    cudaGraphicsUnmapResources(1, &cudaSolutionField, 0);
+void GraphicsManager::StopRecording()
+{
+    if (!m_recorder)
+        return;
+    if (m_recorder->Close())
+        m_statusMessage = "Recorded " + std::to_string(m_recorder->GetRecordedCount()) + " frames";
+    else
+        m_statusMessage = "Recording failed: " + m_recorder->GetLastError();
+    m_recorder.reset();
 }
 
-void GraphicsManager::RunCuda()
+bool GraphicsManager::IsRecording()
 {
-    m_timers[TimerKey::SolveFluid].Tick();
+    return m_recorder != nullptr;
+}
 
-    if (m_scaleFactor != m_oldScaleFactor)
+bool GraphicsManager::StartReplay(const std::string& p_path)
+{
+    StopRecording();
+    StopReplay();
+    //the checkpoint of the recording start has the obstructions and the image to draw them with
+    const std::shared_ptr<Checkpoint> checkpoint = ReadCheckpoint(p_path + ".ckpt");
+    if (!checkpoint)
+        return false;
+    try
+    {
+        m_replay = std::make_shared<FieldReplay>(p_path, m_domain, checkpoint->Image);
+    }
+    catch (const std::exception& e)
     {
-        DoInitializeFlow();
-        m_oldScaleFactor = m_scaleFactor;
+        m_statusMessage = std::string("Couldn't replay: ") + e.what();
+        return false;
     }
+    ApplyCheckpoint(checkpoint);
+    m_statusMessage = "Replaying " + p_path;
+    m_solver->Post([](CudaLbm& p_lbm){ p_lbm.SetPausedState(true); });
+    return true;
+}
+
+void GraphicsManager::StopReplay()
+{
+    if (!m_replay)
+        return;
+    m_replay.reset();
+    const bool paused = m_paused;
+    m_solver->Post([paused](CudaLbm& p_lbm){ p_lbm.SetPausedState(paused); });
+    //the solver's snapshots need the meshes reset, whatever their generation
+    m_flowGeneration = -1;
+}
+
+bool GraphicsManager::IsReplaying()
+{
+    return m_replay != nullptr;
+}
+
+std::string GraphicsManager::GetStatusMessage()
+{
+    return m_statusMessage;
+}
+
+void GraphicsManager::RunCuda()
+{
+    SHIZUKU_ZONE("RunCuda");
+    //draws the latest snapshot of the solver thread, which may be the same as last frame's, or the next frame of the
+    //replay
+    const FieldSnapshot* snapshot = m_replay ? m_replay->Advance(!m_paused) : m_solver->AcquireSnapshot();
+    if (snapshot == nullptr)
+        return;
+    m_domain = snapshot->SimDomain;
+    if (m_recorder && !m_recorder->Record(*snapshot))
+    {
+        StopRecording();
+        m_statusMessage = "The domain was resized, so the recording stopped. " + m_statusMessage;
+    }
+
+    SHIZUKU_ZONE("PrepareFloor");
 
     // map OpenGL buffer object for writing from CUDA
     CudaLbm* cudaLbm = GetCudaLbm();
     cudaGraphicsResource* vbo_resource = m_waterSurface->GetCudaPosColorResource();
     cudaGraphicsResource* normalResource = m_waterSurface->GetCudaNormalResource();
-    cudaGraphicsResource* obstResource = m_obstMgr->GetCudaObstsResource();
+    const std::array<cudaGraphicsResource*, 3> obstResources = m_obstMgr->GetCudaObstResources();
 
     float4* dptr;
     float4* dptrNormal;
-    ObstDefinition* dObsts;
 
     gpuErrchk(cudaGraphicsResourceSetMapFlags(vbo_resource, cudaGraphicsRegisterFlagsWriteDiscard));
     gpuErrchk(cudaGraphicsResourceSetMapFlags(normalResource, cudaGraphicsRegisterFlagsWriteDiscard));
-    gpuErrchk(cudaGraphicsResourceSetMapFlags(obstResource, cudaGraphicsRegisterFlagsReadOnly));
 
-    cudaGraphicsResource* resources[3] = { vbo_resource, normalResource, obstResource };
-    gpuErrchk(cudaGraphicsMapResources(3, resources, 0));
+    cudaGraphicsResource* resources[5] = { vbo_resource, normalResource, obstResources[0], obstResources[1],
+        obstResources[2] };
+    gpuErrchk(cudaGraphicsMapResources(5, resources, 0));
     size_t num_bytes;
     gpuErrchk(cudaGraphicsResourceGetMappedPointer((void **)&dptr, &num_bytes, vbo_resource));
     gpuErrchk(cudaGraphicsResourceGetMappedPointer((void **)&dptrNormal, &num_bytes, normalResource));
-    gpuErrchk(cudaGraphicsResourceGetMappedPointer((void **)&dObsts, &num_bytes, obstResource));
+    const ObstGridView obsts = m_obstMgr->GetMappedObstGridView();
+
+    //the flow was restarted, possibly on a new domain
+    if (snapshot->FlowGeneration != m_flowGeneration)
+    {
+        InitializeSurface(dptr, m_domain);
+        InitializeFloor(dptr, m_domain);
+        m_flowGeneration = snapshot->FlowGeneration;
+    }
 
     UpdateLbmInputs();
 
     float* floorTemp_d = cudaLbm->GetFloorTemp();
-    ObstDefinition* obst_d = cudaLbm->GetDeviceObst();
-    ObstDefinition* obst_h = cudaLbm->GetHostObst();
 
-    Domain* domain = cudaLbm->GetDomain();
-    if (!cudaLbm->IsPaused())
-        MarchSolution(cudaLbm);
-
-    cudaThreadSynchronize();
-    m_timers[TimerKey::SolveFluid].Tock();
-
-    m_timers[TimerKey::PrepareFloor].Tick();
-
-    UpdateSolutionVbo(dptr, dptrNormal, cudaLbm, m_contourVar, m_contourMinMax.Min, m_contourMinMax.Max,
-        m_waterDepth);
+    {
+        SHIZUKU_ZONE("UpdateSolutionVbo");
+        UpdateSolutionVbo(dptr, dptrNormal, *snapshot, m_contourVar, m_contourMinMax.Min, m_contourMinMax.Max,
+            m_waterDepth);
+    }
  
     //SetObstructionVelocitiesToZero(obst_h, obst_d, *domain);
     float3 cameraPosition = { m_translate.x, m_translate.y, - m_translate.z };
@@ -403,30 +527,36 @@ void GraphicsManager::RunCuda()
     {
         if (m_surfaceShadingMode == Phong)
         {
-            SurfacePhongLighting(dptr, dptrNormal, dObsts, cameraPosition, *domain);
+            SurfacePhongLighting(dptr, dptrNormal, obsts, cameraPosition, m_domain);
         }
     }
 
     const float obstHeight = PillarHeightFromDepth(m_waterDepth);
-    LightFloor(dptr, dptrNormal, floorTemp_d, dObsts, m_obstMgr->ObstCount(), cameraPosition, *domain, *GetCudaLbm(), m_waterDepth, obstHeight);
+    {
+        SHIZUKU_ZONE("LightFloor");
+        LightFloor(dptr, dptrNormal, floorTemp_d, obsts, cameraPosition, m_domain, snapshot->GetSolidMask(),
+            cudaLbm->GetFloorHit(), m_waterDepth, obstHeight);
+    }
 
-    gpuErrchk(cudaGraphicsUnmapResources(3, resources, 0));
+    gpuErrchk(cudaGraphicsUnmapResources(5, resources, 0));
 
+    //the snapshot must not be in use when the next one is acquired. Kernels run asynchronously, so most of their
+    //time shows up in this zone.
+    SHIZUKU_ZONE("SynchronizeFloor");
     cudaThreadSynchronize();
-    m_timers[TimerKey::PrepareFloor].Tock();
 }
 
 void GraphicsManager::RunSurfaceRefraction()
 {
-    m_timers[TimerKey::PrepareSurface].Tick();
+    SHIZUKU_ZONE("PrepareSurface");
 
     if (ShouldRefractSurface())
     {
-        CudaLbm* cudaLbm = GetCudaLbm();
         cudaGraphicsResource* vbo_resource = m_waterSurface->GetCudaPosColorResource();
         cudaGraphicsResource* floorLightTextureResource = m_floor->CudaFloorLightTextureResource();
         cudaGraphicsResource* envTextureResource = m_waterSurface->GetCudaEnvTextureResource();
         cudaGraphicsResource* normalResource = m_waterSurface->GetCudaNormalResource();
+        const std::array<cudaGraphicsResource*, 3> obstResources = m_obstMgr->GetCudaObstResources();
 
         float4* dptr;
         float4* dptrNormal;
@@ -436,8 +566,9 @@ void GraphicsManager::RunSurfaceRefraction()
         size_t num_bytes;
 
         gpuErrchk(cudaGraphicsResourceSetMapFlags(normalResource, cudaGraphicsRegisterFlagsReadOnly));
-        cudaGraphicsResource* resources[4] = { vbo_resource, floorLightTextureResource, envTextureResource, normalResource };
-        gpuErrchk(cudaGraphicsMapResources(4, resources, 0));
+        cudaGraphicsResource* resources[7] = { vbo_resource, floorLightTextureResource, envTextureResource, normalResource,
+            obstResources[0], obstResources[1], obstResources[2] };
+        gpuErrchk(cudaGraphicsMapResources(7, resources, 0));
         gpuErrchk(cudaGraphicsResourceGetMappedPointer((void **)&dptr, &num_bytes, vbo_resource));
         gpuErrchk(cudaGraphicsSubResourceGetMappedArray(&floorLightTexture, floorLightTextureResource, 0, 0));
         gpuErrchk(cudaGraphicsSubResourceGetMappedArray(&envTexture, envTextureResource, 0, 0));
@@ -447,22 +578,24 @@ void GraphicsManager::RunSurfaceRefraction()
         const Box<float> cameraDatumSize(0.05f, 0.05f, m_cameraPosition.z);
         m_waterSurface->UpdateCameraDatum(PillarDefinition(cameraDatumPos, cameraDatumSize));
 
-        ObstDefinition* obst_d = cudaLbm->GetDeviceObst();
-        Domain* domain = cudaLbm->GetDomain();
+        const ObstGridView obsts = m_obstMgr->GetMappedObstGridView();
         const float obstHeight = PillarHeightFromDepth(m_waterDepth);
-        RefractSurface(dptr, dptrNormal, floorLightTexture, envTexture, obst_d, m_cameraPosition, *domain, m_waterDepth, obstHeight,
-            m_surfaceShadingMode == SimplifiedRayTracing);
+        {
+            SHIZUKU_ZONE("RefractSurface");
+            RefractSurface(dptr, dptrNormal, floorLightTexture, envTexture, obsts, m_cameraPosition, m_domain, m_waterDepth, obstHeight,
+                m_surfaceShadingMode == SimplifiedRayTracing);
+        }
 
-        gpuErrchk(cudaGraphicsUnmapResources(4, resources, 0));
+        gpuErrchk(cudaGraphicsUnmapResources(7, resources, 0));
     }
 
+    SHIZUKU_ZONE("SynchronizeSurface");
     cudaThreadSynchronize();
-    m_timers[TimerKey::PrepareSurface].Tock();
 }
 
 void GraphicsManager::RunComputeShader()
 {
-    m_waterSurface->RunComputeShader(m_translate, m_contourVar, m_contourMinMax);
+    m_waterSurface->RunComputeShader(m_translate, m_contourVar, m_contourMinMax, m_domain);
 }
 
 void GraphicsManager::RunSimulation()
@@ -479,27 +612,37 @@ void GraphicsManager::RunSimulation()
 
 void GraphicsManager::RenderCausticsToTexture()
 {
-    CudaLbm* cudaLbm = GetCudaLbm();
-    m_floor->RenderCausticsToTexture(*cudaLbm->GetDomain(), m_viewSize);
+    SHIZUKU_ZONE("RenderCausticsToTexture");
+    m_floor->RenderCausticsToTexture(m_domain, m_viewSize);
 }
 
+//! GL calls only queue the draws, so these zones time the submission, not the GPU
 void GraphicsManager::Render()
 {
+    SHIZUKU_ZONE("Render");
     const float obstHeight = PillarHeightFromDepth(m_waterDepth);
     const RenderParams& params{ m_topView, m_modelView, m_projection, glm::vec3(m_cameraPosition), m_schema };
-    m_obstMgr->Render(params);
+    {
+        SHIZUKU_ZONE("RenderObstructions");
+        m_obstMgr->Render(params);
+    }
 
-    CudaLbm* cudaLbm = GetCudaLbm();
-    m_floor->Render(*cudaLbm->GetDomain(), params);
+    {
+        SHIZUKU_ZONE("RenderFloor");
+        m_floor->Render(m_domain, params);
 
-    if (m_drawFloorWireframe)
-        m_floor->RenderCausticsMesh(*cudaLbm->GetDomain(), params);
+        if (m_drawFloorWireframe)
+            m_floor->RenderCausticsMesh(m_domain, params);
+    }
 
-    m_waterSurface->Render(m_contourVar, *cudaLbm->GetDomain(),
-        params, m_drawFloorWireframe, m_viewSize, obstHeight, m_obstMgr->ObstCount(), m_floor->CausticsTex());
+    {
+        SHIZUKU_ZONE("RenderWaterSurface");
+        m_waterSurface->Render(m_contourVar, m_domain,
+            params, m_drawFloorWireframe, m_viewSize, obstHeight, m_obstMgr->ObstCount(), m_floor->CausticsTex());
+    }
 
     if (m_lightProbeEnabled)
-        m_floor->RenderCausticsBeams(*cudaLbm->GetDomain(), params);
+        m_floor->RenderCausticsBeams(m_domain, params);
 }
 
 bool GraphicsManager::ShouldRefractSurface()
@@ -559,14 +702,12 @@ bool GraphicsManager::TryStartMoveSelectedObstructions(const Point<int>& p_scree
 void GraphicsManager::MoveSelectedObstructions(const Point<int>& p_screenPos)
 {
     m_obstMgr->MoveSelectedObsts(HitParams{ p_screenPos, m_modelView, m_projection, m_viewSize });
-    m_obstTouched = true;
 }
 
 void GraphicsManager::AddObstruction(const Point<float>& p_modelSpacePos)
 {
     const ObstDefinition obst = { m_currentObstShape, p_modelSpacePos.X, p_modelSpacePos.Y, m_currentObstSize, 0, 0, 0, State::NORMAL };
     m_obstMgr->CreateObst(obst);
-    m_obstTouched = true;
 }
 
 void GraphicsManager::PreSelectObstruction(const Point<int>& p_screenPos)
@@ -593,7 +734,6 @@ void GraphicsManager::TogglePreSelection()
 void GraphicsManager::DeleteSelectedObstructions()
 {
     m_obstMgr->DeleteSelectedObsts();
-    m_obstTouched = true;
 }
 
 void GraphicsManager::ClearSelection()
@@ -633,6 +773,7 @@ bool GraphicsManager::IsRayTracingPaused()
 
 void GraphicsManager::UpdateGraphicsInputs()
 {
+    SHIZUKU_ZONE("UpdateGraphicsInputs");
     glViewport(0, 0, m_viewSize.Width, m_viewSize.Height);
     UpdateDomainDimensions();
     if (!m_rayTracingPaused)
@@ -640,32 +781,77 @@ void GraphicsManager::UpdateGraphicsInputs()
         m_cameraPosition = GetCameraPosition();
     }
 
-    if (!GetCudaLbm()->IsPaused() && m_obstTouched)
+    //! Obstruction edits only re-rasterize the cells they touched; m_obstTouched (rescale) rebuilds it all. The
+    //! solver thread gets copies of the definitions, as the obstructions keep changing here.
+    const std::vector<ObstDefinition> changedObsts = m_obstMgr->TakeChangedObsts();
+    if (m_obstTouched || !changedObsts.empty())
     {
-        GetCudaLbm()->UpdateDeviceImage(*m_obstMgr);
-        m_obstTouched = false;
+        const std::vector<ObstDefinition> obsts = m_obstMgr->ObstDefinitions();
+        if (m_obstTouched)
+            m_solver->Post([obsts](CudaLbm& p_lbm){ p_lbm.UpdateDeviceImage(obsts); });
+        else
+            m_solver->Post([obsts, changedObsts](CudaLbm& p_lbm){ p_lbm.UpdateDeviceImage(obsts, changedObsts); });
     }
+    m_obstTouched = false;
 }
 
-void GraphicsManager::UpdateDomainDimensions()
+void GraphicsManager::SetDomainDimensions()
 {
+    //the surface and floor meshes are MAX_XDIM x MAX_YDIM, so the rendered domain can't be larger
     CudaLbm* cudaLbm = GetCudaLbm();
     cudaLbm->GetDomain()->SetXDimVisible(MAX_XDIM / m_scaleFactor);
     cudaLbm->GetDomain()->SetYDimVisible(MAX_YDIM / m_scaleFactor);
 }
 
+//! Rescales the domain on the solver thread, which also restarts the flow
+void GraphicsManager::UpdateDomainDimensions()
+{
+    if (m_scaleFactor == m_oldScaleFactor)
+        return;
+    m_oldScaleFactor = m_scaleFactor;
+    //the recording is of the old size
+    StopReplay();
+
+    const int xDimVisible = MAX_XDIM / m_scaleFactor;
+    const int yDimVisible = MAX_YDIM / m_scaleFactor;
+    m_solver->Post([xDimVisible, yDimVisible](CudaLbm& p_lbm){
+        p_lbm.GetDomain()->SetXDimVisible(xDimVisible);
+        p_lbm.GetDomain()->SetYDimVisible(yDimVisible);
+        if (!p_lbm.IsLatticeSizedToDomain())
+            p_lbm.ResizeLattice();
+    });
+    m_solver->PostInitializeFlow();
+    m_obstTouched = true;
+}
+
 void GraphicsManager::UpdateLbmInputs()
 {
-    float omega = 1.975f;
-    CudaLbm* cudaLbm = GetCudaLbm();
-    cudaLbm->SetOmega(omega);
-    const float u = cudaLbm->GetInletVelocity();
-    m_waterSurface->UpdateLbmInputs(u, omega);
+    const float omega = 1.975f;
+    if (omega != m_omega)
+    {
+        m_omega = omega;
+        m_solver->Post([omega](CudaLbm& p_lbm){ p_lbm.SetOmega(omega); });
+    }
+    m_waterSurface->UpdateLbmInputs(m_inletVelocity, omega);
 }
 
-std::map<TimerKey, Stopwatch>& GraphicsManager::GetTimers()
+double GraphicsManager::GetTime(const char* p_zone, const TimeStatistic p_statistic)
 {
-    return m_timers;
+    Profiler::Collect();
+    const ZoneStats stats = Profiler::GetStats(p_zone);
+    switch (p_statistic)
+    {
+    case TimeStatistic::P50:
+        return stats.P50;
+    case TimeStatistic::P90:
+        return stats.P90;
+    case TimeStatistic::P99:
+        return stats.P99;
+    case TimeStatistic::MAX:
+        return stats.Max;
+    default:
+        return stats.Average;
+    }
 }
 
 void GraphicsManager::ProbeLightPaths(const Point<int>& p_screenPos)
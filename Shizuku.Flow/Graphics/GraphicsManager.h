@@ -1,13 +1,13 @@
 #pragma once
 #include "../common.h"
+#include "../Domain.h"
 #include "ShadingMode.h"
-#include "TimerKey.h"
+#include "TimeStatistic.h"
 #include "Schema.h"
 #include "Info/ObstInfo.h"
 #include "Shizuku.Core/Rect.h"
 #include "Shizuku.Core/Types/MinMax.h"
 #include "Shizuku.Core/Types/Point.h"
-#include "Shizuku.Core/Utilities/Stopwatch.h"
 #include <GLEW/glew.h>
 #include <glm/glm.hpp>
 #include <boost/optional.hpp>
@@ -29,6 +29,11 @@ namespace Shizuku{ namespace Flow{
     enum Shape;
     class Floor;
     class WaterSurface;
+    class SolverThread;
+    class CheckpointWriter;
+    struct Checkpoint;
+    class FieldRecorder;
+    class FieldReplay;
 
     class GraphicsManager
     {
@@ -41,7 +46,6 @@ namespace Shizuku{ namespace Flow{
         Shape m_currentObstShape;
         bool m_rayTracingPaused = false;
         glm::vec4 m_cameraPosition;
-        ObstDefinition* m_obstructions;
         float m_scaleFactor = 1.f;
         float m_oldScaleFactor = 1.f;
         glm::mat4 m_modelView;
@@ -59,10 +63,24 @@ namespace Shizuku{ namespace Flow{
         float m_perspectiveViewAngle;
 
         Rect<int> m_viewSize;
-        std::map<TimerKey, Stopwatch> m_timers;
         std::shared_ptr<ObstManager> m_obstMgr;
         Schema m_schema;
 
+        std::shared_ptr<SolverThread> m_solver;
+        //! Domain of the last acquired snapshot, which is what the render path draws
+        Domain m_domain;
+        int m_flowGeneration;
+        //! Solver inputs as last posted to m_solver
+        float m_inletVelocity;
+        float m_omega;
+        std::shared_ptr<CheckpointWriter> m_checkpointWriter;
+        bool m_paused;
+        std::shared_ptr<FieldRecorder> m_recorder;
+        //! Set while a recording is played back instead of the solver's snapshots
+        std::shared_ptr<FieldReplay> m_replay;
+        //! Outcome of the last checkpoint, recording or replay action, see GetStatusMessage
+        std::string m_statusMessage;
+
         bool m_obstTouched;
 
     public:
@@ -93,12 +111,15 @@ namespace Shizuku{ namespace Flow{
         void SetVelocity(const float p_velocity);
         void SetViscosity(const float p_viscosity);
         void SetTimestepsPerFrame(const int p_steps);
+        void SetPausedState(const bool p_paused);
         void SetFloorWireframeVisibility(const bool p_visible);
 
         void EnableLightProbe(const bool enable);
         void ProbeLightPaths(const Point<int>& p_screenPos);
 
+        //! Owned by the solver thread once it runs, see SolverThread::Post
         CudaLbm* GetCudaLbm();
+        Rect<int> GetDomainSize();
 
         bool IsCudaCapable();
 
@@ -114,6 +135,24 @@ namespace Shizuku{ namespace Flow{
         void RenderCausticsToTexture();
         void Render();
         void InitializeFlow();
+        //! Queues the state after the current batch to be written to p_path in the background
+        void SaveCheckpoint(const std::string& p_path);
+        //! Carries on from the checkpoint at p_path. Fails if it can't be read or doesn't fit the current domain.
+        bool LoadCheckpoint(const std::string& p_path);
+        //! Records the fields of every solver snapshot from now on to the field history p_path, and the state at the
+        //! start to p_path + ".ckpt" for the replay
+        bool StartRecording(const std::string& p_path);
+        void StopRecording();
+        bool IsRecording();
+        //! Pauses the solver and plays the recording at p_path (see StartRecording) in a loop instead. Pausing holds
+        //! the current frame. The solver carries on from the start of the recording once the replay stops.
+        bool StartReplay(const std::string& p_path);
+        void StopReplay();
+        bool IsReplaying();
+        //! What the last checkpoint load, recording or replay did, or why it failed, for the window to show. Empty
+        //! until one of them ran.
+        std::string GetStatusMessage();
+        void SetDomainDimensions();
         void UpdateDomainDimensions();
         void UpdateLbmInputs();
 
@@ -145,11 +184,15 @@ namespace Shizuku{ namespace Flow{
         void TogglePreSelection();
         void DeleteSelectedObstructions();
 
-        std::map<TimerKey, Stopwatch>& GetTimers();
+        //! Collects the profiler and returns p_statistic of zone p_zone, in seconds. SolveFluid is timed per batch on
+        //! the solver thread, PrepareFloor and PrepareSurface per frame.
+        double GetTime(const char* p_zone, const TimeStatistic p_statistic);
 
     private:
-        void DoInitializeFlow();
         bool ShouldRefractSurface();
+        //! Null if p_path can't be read or doesn't fit the domain
+        std::shared_ptr<Checkpoint> ReadCheckpoint(const std::string& p_path);
+        void ApplyCheckpoint(std::shared_ptr<Checkpoint> p_checkpoint);
 
         glm::vec4 GetCameraPosition();
     };
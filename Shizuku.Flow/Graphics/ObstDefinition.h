@@ -26,4 +26,16 @@ namespace Shizuku { namespace Flow{
         float v;
         int state;
     };
+
+    //! Obstructions and their ObstGrid as laid out in the obstruction SSBOs, for kernels. Cells are row major over
+    //! [-1, 1]^2; the obstructions of cell c are Obsts[Items[k]] for Starts[c] <= k < Starts[c+1], and entry
+    //! CellsPerSide^2 lists the ones reaching outside the domain.
+    struct ObstGridView
+    {
+        int ObstCount;
+        int CellsPerSide;
+        const ObstDefinition* Obsts;
+        const int* Starts;
+        const int* Items;
+    };
 } }
\ No newline at end of file
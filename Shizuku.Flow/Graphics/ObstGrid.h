@@ -0,0 +1,253 @@
+#pragma once
+
+#include "ObstDefinition.h"
+#include "Shizuku.Core/Types/Point.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    class Obst;
+
+    //! Uniform grid over the square obstruction footprints (x +- r1, y +- r1, 2.5 r1 for lines) on the model
+    //! space domain [-1, 1]^2. Point and ray queries only visit the obstructions in the cells they touch. Footprints
+    //! reaching outside the domain are kept in a separate list that every query visits.
+    //! Item is anything with a Def() returning its ObstDefinition; the viewer uses Obst (ObstGrid).
+    template <typename Item>
+    class ObstGridT
+    {
+    private:
+        struct CellRange
+        {
+            int XBegin;
+            int XEnd;
+            int YBegin;
+            int YEnd;
+            bool Outside;
+        };
+
+        int m_cellsPerSide;
+        float m_cellSize;
+        std::vector<std::vector<std::shared_ptr<Item>>> m_cells;
+        std::vector<std::shared_ptr<Item>> m_outside;
+        std::unordered_map<const Item*, CellRange> m_ranges;
+
+        int CellCoord(const float p_modelCoord) const
+        {
+            const int cell = static_cast<int>(std::floor((p_modelCoord + 1.f) / m_cellSize));
+            return std::min(std::max(cell, 0), m_cellsPerSide - 1);
+        }
+
+        CellRange RangeFromFootprint(Item& p_obst) const
+        {
+            const ObstDefinition& def = p_obst.Def();
+            const bool line = def.shape == Shape::HORIZONTAL_LINE || def.shape == Shape::VERTICAL_LINE;
+            //lines are 4 r1 long, and the ray test of the refraction kernel takes hits up to 2.5 r1 from their center
+            const float r1 = (line ? 2.5f : 1.f)*std::abs(def.r1);
+            CellRange range;
+            range.Outside = def.x - r1 < -1.f || def.x + r1 > 1.f || def.y - r1 < -1.f || def.y + r1 > 1.f;
+            range.XBegin = CellCoord(def.x - r1);
+            range.XEnd = CellCoord(def.x + r1) + 1;
+            range.YBegin = CellCoord(def.y - r1);
+            range.YEnd = CellCoord(def.y + r1) + 1;
+            return range;
+        }
+
+        static void RemoveFrom(std::vector<std::shared_ptr<Item>>& p_list, const Item* p_obst)
+        {
+            p_list.erase(std::remove_if(p_list.begin(), p_list.end(),
+                [&](const std::shared_ptr<Item>& p_item){ return p_item.get() == p_obst; }), p_list.end());
+        }
+    public:
+        ObstGridT(const int p_cellsPerSide)
+        {
+            m_cellsPerSide = std::max(p_cellsPerSide, 1);
+            m_cellSize = 2.f / m_cellsPerSide;
+            m_cells.resize(static_cast<size_t>(m_cellsPerSide)*m_cellsPerSide);
+        }
+
+        void Insert(const std::shared_ptr<Item>& p_obst)
+        {
+            const CellRange range = RangeFromFootprint(*p_obst);
+            m_ranges[p_obst.get()] = range;
+            if (range.Outside)
+            {
+                m_outside.push_back(p_obst);
+                return;
+            }
+            for (int y = range.YBegin; y < range.YEnd; ++y)
+            {
+                for (int x = range.XBegin; x < range.XEnd; ++x)
+                {
+                    m_cells[x + y*m_cellsPerSide].push_back(p_obst);
+                }
+            }
+        }
+
+        void Remove(const std::shared_ptr<Item>& p_obst)
+        {
+            const auto it = m_ranges.find(p_obst.get());
+            if (it == m_ranges.end())
+                return;
+            const CellRange& range = it->second;
+            if (range.Outside)
+            {
+                RemoveFrom(m_outside, p_obst.get());
+            }
+            else
+            {
+                for (int y = range.YBegin; y < range.YEnd; ++y)
+                {
+                    for (int x = range.XBegin; x < range.XEnd; ++x)
+                    {
+                        RemoveFrom(m_cells[x + y*m_cellsPerSide], p_obst.get());
+                    }
+                }
+            }
+            m_ranges.erase(it);
+        }
+
+        //! Call after changing the definition of an inserted obstruction
+        void Update(const std::shared_ptr<Item>& p_obst)
+        {
+            Remove(p_obst);
+            Insert(p_obst);
+        }
+
+        void Clear()
+        {
+            for (auto& cell : m_cells)
+            {
+                cell.clear();
+            }
+            m_outside.clear();
+            m_ranges.clear();
+        }
+
+        int CellsPerSide() const
+        {
+            return m_cellsPerSide;
+        }
+
+        //! Layout of ObstGridView: cell starts and items, with items as given by p_indices
+        void Flatten(const std::unordered_map<const Item*, int>& p_indices, std::vector<int>& p_starts,
+            std::vector<int>& p_items) const
+        {
+            const int cellCount = m_cellsPerSide*m_cellsPerSide;
+            p_starts.resize(cellCount + 2);
+            p_items.clear();
+            for (int cell = 0; cell <= cellCount; ++cell)
+            {
+                p_starts[cell] = static_cast<int>(p_items.size());
+                for (const auto& obst : cell < cellCount ? m_cells[cell] : m_outside)
+                {
+                    p_items.push_back(p_indices.at(obst.get()));
+                }
+            }
+            p_starts[cellCount + 1] = static_cast<int>(p_items.size());
+        }
+
+        //! Calls p_visit(Item&) for the obstructions whose footprint may contain p_point until it returns true, and
+        //! returns whether it did. Read-only, so it can run on several threads at once.
+        template <typename Visit>
+        bool FindAt(const Core::Types::Point<float>& p_point, Visit p_visit) const
+        {
+            for (const auto& obst : m_outside)
+            {
+                if (p_visit(*obst))
+                    return true;
+            }
+            if (p_point.X < -1.f || p_point.X > 1.f || p_point.Y < -1.f || p_point.Y > 1.f)
+                return false;
+            for (const auto& obst : m_cells[CellCoord(p_point.X) + CellCoord(p_point.Y)*m_cellsPerSide])
+            {
+                if (p_visit(*obst))
+                    return true;
+            }
+            return false;
+        }
+
+        //! Obstructions, each once, whose footprint the ray may cross while p_zMin <= z <= p_zMax. Vec3 is indexed
+        //! [0] to [2], like glm::vec3.
+        //! Clips the ray to the z slab and the domain, then walks the cells under its xy projection (Amanatides-Woo)
+        template <typename Vec3>
+        std::vector<std::shared_ptr<Item>> AlongRay(const Vec3& p_origin, const Vec3& p_dir, const float p_zMin,
+            const float p_zMax) const
+        {
+            std::vector<std::shared_ptr<Item>> result(m_outside);
+            std::unordered_set<const Item*> seen;
+
+            float tMin = 0.f;
+            float tMax = std::numeric_limits<float>::max();
+            const float slabMin[3] = { -1.f, -1.f, p_zMin };
+            const float slabMax[3] = { 1.f, 1.f, p_zMax };
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (p_dir[axis] == 0.f)
+                {
+                    if (p_origin[axis] < slabMin[axis] || p_origin[axis] > slabMax[axis])
+                        return result;
+                    continue;
+                }
+                float t0 = (slabMin[axis] - p_origin[axis]) / p_dir[axis];
+                float t1 = (slabMax[axis] - p_origin[axis]) / p_dir[axis];
+                if (t0 > t1)
+                    std::swap(t0, t1);
+                tMin = std::max(tMin, t0);
+                tMax = std::min(tMax, t1);
+            }
+            if (tMin > tMax)
+                return result;
+
+            int cell[2] = { CellCoord(p_origin[0] + tMin*p_dir[0]), CellCoord(p_origin[1] + tMin*p_dir[1]) };
+            int step[2];
+            float tNext[2];
+            float tDelta[2];
+            for (int axis = 0; axis < 2; ++axis)
+            {
+                if (p_dir[axis] > 0.f)
+                {
+                    step[axis] = 1;
+                    tNext[axis] = (-1.f + (cell[axis] + 1)*m_cellSize - p_origin[axis]) / p_dir[axis];
+                    tDelta[axis] = m_cellSize / p_dir[axis];
+                }
+                else if (p_dir[axis] < 0.f)
+                {
+                    step[axis] = -1;
+                    tNext[axis] = (-1.f + cell[axis] * m_cellSize - p_origin[axis]) / p_dir[axis];
+                    tDelta[axis] = -m_cellSize / p_dir[axis];
+                }
+                else
+                {
+                    step[axis] = 0;
+                    tNext[axis] = std::numeric_limits<float>::max();
+                    tDelta[axis] = 0.f;
+                }
+            }
+
+            while (true)
+            {
+                for (const auto& obst : m_cells[cell[0] + cell[1] * m_cellsPerSide])
+                {
+                    if (seen.insert(obst.get()).second)
+                        result.push_back(obst);
+                }
+                const int axis = tNext[0] < tNext[1] ? 0 : 1;
+                if (tNext[axis] > tMax)
+                    break;
+                cell[axis] += step[axis];
+                if (cell[axis] < 0 || cell[axis] >= m_cellsPerSide)
+                    break;
+                tNext[axis] += tDelta[axis];
+            }
+            return result;
+        }
+    };
+
+    typedef ObstGridT<Obst> ObstGrid;
+} }
@@ -3,10 +3,33 @@
 #include "common.h"
 #include "Shizuku.Core/Ogl/Ogl.h"
 
+#include <unordered_map>
+
 using namespace Shizuku::Core;
 using namespace Shizuku::Flow;
 
 namespace {
+    //! Writes p_data to the start of the SSBO p_name. If it does not fit, the buffer is reallocated to the next
+    //! power of two multiple of p_capacity, which also needs a new CUDA registration.
+    template <typename T>
+    void UploadToSsbo(Ogl& p_ogl, const std::string& p_name, const std::vector<T>& p_data,
+        unsigned int& p_capacity, cudaGraphicsResource*& p_cudaResource)
+    {
+        const GLuint id = p_ogl.GetBuffer(p_name)->GetId();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+        if (p_data.size() > p_capacity)
+        {
+            while (p_capacity < p_data.size())
+                p_capacity *= 2;
+            cudaGraphicsUnregisterResource(p_cudaResource);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, p_capacity*sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+            cudaGraphicsGLRegisterBuffer(&p_cudaResource, id, cudaGraphicsMapFlagsReadOnly);
+        }
+        if (!p_data.empty())
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, p_data.size()*sizeof(T), p_data.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
     float PillarHeightFromDepth(const float p_depth)
     {
         return p_depth + 0.3f;
@@ -67,29 +90,50 @@ namespace {
 }
 
 ObstManager::ObstManager(std::shared_ptr<Ogl> p_ogl)
+    : m_grid(OBST_GRID_CELLS)
 {
     m_ogl = p_ogl;
     m_obsts = std::make_shared<std::set<std::shared_ptr<Obst>>>();
-    m_obstData = new ObstDefinition[MAXOBSTS];
     m_selection = std::set<std::shared_ptr<Obst>>();
+    m_layoutChanged = false;
+    m_obstCapacity = 64;
+    m_gridItemCapacity = 256;
 }
 
 void ObstManager::Initialize()
 {
-    for (int i = 0; i < MAXOBSTS; i++)
-    {
-        m_obstData[i] = ObstDefinition();
-    }
-
-    m_ogl->CreateBuffer(GL_SHADER_STORAGE_BUFFER, m_obstData, MAXOBSTS, "managed_obsts", GL_STATIC_DRAW);
+    std::vector<ObstDefinition> obsts(m_obstCapacity, ObstDefinition());
+    std::vector<int> starts(OBST_GRID_CELLS*OBST_GRID_CELLS + 2, 0);
+    std::vector<int> items(m_gridItemCapacity, 0);
+    m_ogl->CreateBuffer(GL_SHADER_STORAGE_BUFFER, obsts.data(), obsts.size(), "managed_obsts", GL_DYNAMIC_DRAW);
+    m_ogl->CreateBuffer(GL_SHADER_STORAGE_BUFFER, starts.data(), starts.size(), "managed_obst_grid_starts",
+        GL_DYNAMIC_DRAW);
+    m_ogl->CreateBuffer(GL_SHADER_STORAGE_BUFFER, items.data(), items.size(), "managed_obst_grid_items",
+        GL_DYNAMIC_DRAW);
+
+    cudaGraphicsGLRegisterBuffer(&m_cudaObstsResource, m_ogl->GetBuffer("managed_obsts")->GetId(),
+        cudaGraphicsMapFlagsReadOnly);
+    cudaGraphicsGLRegisterBuffer(&m_cudaGridStartsResource, m_ogl->GetBuffer("managed_obst_grid_starts")->GetId(),
+        cudaGraphicsMapFlagsReadOnly);
+    cudaGraphicsGLRegisterBuffer(&m_cudaGridItemsResource, m_ogl->GetBuffer("managed_obst_grid_items")->GetId(),
+        cudaGraphicsMapFlagsReadOnly);
+}
 
-    std::shared_ptr<Ogl::Buffer> obstSsbo = m_ogl->GetBuffer("managed_obsts");
-    cudaGraphicsGLRegisterBuffer(&m_cudaObstsResource, obstSsbo->GetId(), cudaGraphicsMapFlagsReadOnly);
+std::array<cudaGraphicsResource*, 3> ObstManager::GetCudaObstResources()
+{
+    return { m_cudaObstsResource, m_cudaGridStartsResource, m_cudaGridItemsResource };
 }
 
-cudaGraphicsResource* ObstManager::GetCudaObstsResource()
+ObstGridView ObstManager::GetMappedObstGridView()
 {
-    return m_cudaObstsResource;
+    ObstGridView view;
+    view.ObstCount = static_cast<int>(m_obstData.size());
+    view.CellsPerSide = m_grid.CellsPerSide();
+    size_t num_bytes;
+    cudaGraphicsResourceGetMappedPointer((void **)&view.Obsts, &num_bytes, m_cudaObstsResource);
+    cudaGraphicsResourceGetMappedPointer((void **)&view.Starts, &num_bytes, m_cudaGridStartsResource);
+    cudaGraphicsResourceGetMappedPointer((void **)&view.Items, &num_bytes, m_cudaGridItemsResource);
+    return view;
 }
 
 int ObstManager::ObstCount()
@@ -109,25 +153,9 @@ int ObstManager::PreSelectedObstCount()
 
 boost::optional<const Info::ObstInfo> ObstManager::ObstInfo(const HitParams& p_params)
 {
-    float dist = std::numeric_limits<float>::max();
-    std::shared_ptr<Obst> closest;
-    bool hit(false);
-    for (const auto& obst : *m_obsts)
-    {
-        HitResult result = obst->Hit(p_params);
-        if (result.Hit)
-        {
-            assert(result.Dist.is_initialized());
-            hit = true;
-            if (result.Dist < dist)
-            {
-                dist = result.Dist.value();
-                closest = obst;
-            }
-        }
-    }
-
-    if (hit)
+    float dist;
+    const std::shared_ptr<Obst> closest = ClosestHit(p_params, nullptr, dist);
+    if (closest)
     {
         return Info::ObstInfo{
             m_selection.find(closest) != m_selection.end(),
@@ -152,7 +180,34 @@ void ObstManager::SetWaterHeight(const float p_height)
 
 void ObstManager::CreateObst(const ObstDefinition& p_obst)
 {
-    m_obsts->insert(std::make_shared<Obst>(m_ogl, p_obst, PillarHeightFromDepth(m_waterHeight)));
+    const std::shared_ptr<Obst> obst = std::make_shared<Obst>(m_ogl, p_obst, PillarHeightFromDepth(m_waterHeight));
+    m_obsts->insert(obst);
+    m_grid.Insert(obst);
+    m_changedObsts.push_back(p_obst);
+    m_layoutChanged = true;
+    RefreshObstStates();
+}
+
+void ObstManager::ReplaceObsts(const std::vector<ObstDefinition>& p_obsts)
+{
+    DoClearSelection();
+    m_preSelection.clear();
+
+    for (const auto& obst : *m_obsts)
+    {
+        m_changedObsts.push_back(obst->Def());
+        m_grid.Remove(obst);
+    }
+    m_obsts->clear();
+    for (const auto& def : p_obsts)
+    {
+        const std::shared_ptr<Obst> obst = std::make_shared<Obst>(m_ogl, def, PillarHeightFromDepth(m_waterHeight));
+        m_obsts->insert(obst);
+        m_grid.Insert(obst);
+        m_changedObsts.push_back(def);
+    }
+    m_layoutChanged = true;
+
     RefreshObstStates();
 }
 
@@ -175,25 +230,9 @@ void ObstManager::ClearSelection()
 
 void ObstManager::AddObstructionToPreSelection(const HitParams& p_params)
 {
-    float dist = std::numeric_limits<float>::max();
-    std::shared_ptr<Obst> closest;
-    bool hit(false);
-    for (const auto& obst : *m_obsts)
-    {
-        HitResult result = obst->Hit(p_params);
-        if (result.Hit)
-        {
-            assert(result.Dist.is_initialized());
-            hit = true;
-            if (result.Dist < dist)
-            {
-                dist = result.Dist.value();
-                closest = obst;
-            }
-        }
-    }
-
-    if (hit)
+    float dist;
+    const std::shared_ptr<Obst> closest = ClosestHit(p_params, nullptr, dist);
+    if (closest)
     {
         m_preSelection.insert(closest);
         closest->SetHighlight(true);
@@ -221,25 +260,9 @@ void ObstManager::DoClearPreSelection()
 
 void ObstManager::RemoveObstructionFromPreSelection(const HitParams& p_params)
 {
-    float dist = std::numeric_limits<float>::max();
-    std::shared_ptr<Obst> closest;
-    bool hit(false);
-    for (const auto& obst : m_selection)
-    {
-        HitResult result = obst->Hit(p_params);
-        if (result.Hit)
-        {
-            assert(result.Dist.is_initialized());
-            hit = true;
-            if (result.Dist < dist)
-            {
-                dist = result.Dist.value();
-                closest = obst;
-            }
-        }
-    }
-
-    if (hit)
+    float dist;
+    const std::shared_ptr<Obst> closest = ClosestHit(p_params, &m_selection, dist);
+    if (closest)
     {
         m_preSelection.erase(closest);
         closest->SetHighlight(false);
@@ -292,24 +315,34 @@ void ObstManager::RefreshObstStates()
     for (const auto& obst : m_preSelection)
         obst->SetHighlight(true);
 
-    int i = 0;
-    for (auto& obst : *m_obsts)
+    m_obstData.clear();
+    for (const auto& obst : *m_obsts)
+        m_obstData.push_back(obst->Def());
+    UploadToSsbo(*m_ogl, "managed_obsts", m_obstData, m_obstCapacity, m_cudaObstsResource);
+
+    if (m_layoutChanged)
     {
-        m_obstData[i] = obst->Def();
-        ++i;
-        if (i >= MAXOBSTS)
-            break;
+        std::unordered_map<const Obst*, int> indices;
+        int i = 0;
+        for (const auto& obst : *m_obsts)
+            indices[obst.get()] = i++;
+        m_grid.Flatten(indices, m_gridStarts, m_gridItems);
+        unsigned int startsCapacity = m_gridStarts.size();
+        UploadToSsbo(*m_ogl, "managed_obst_grid_starts", m_gridStarts, startsCapacity, m_cudaGridStartsResource);
+        UploadToSsbo(*m_ogl, "managed_obst_grid_items", m_gridItems, m_gridItemCapacity, m_cudaGridItemsResource);
+        m_layoutChanged = false;
     }
-
-    m_ogl->UpdateBufferData(GL_SHADER_STORAGE_BUFFER, m_obstData, MAXOBSTS, "managed_obsts", GL_STATIC_DRAW);
 }
 
 void ObstManager::DeleteSelectedObsts()
 {
     for (const auto& obst : m_selection)
     {
+        m_changedObsts.push_back(obst->Def());
+        m_grid.Remove(obst);
         m_obsts->erase(obst);
     }
+    m_layoutChanged = true;
 
     DoClearSelection();
 
@@ -318,21 +351,8 @@ void ObstManager::DeleteSelectedObsts()
 
 bool ObstManager::TryStartMoveSelectedObsts(const HitParams& p_params)
 {
-    float dist = std::numeric_limits<float>::max();
-    bool hit(false);
-    for (const auto& obst : m_selection)
-    {
-        HitResult result = obst->Hit(p_params);
-        if (result.Hit)
-        {
-            assert(result.Dist.is_initialized());
-            hit = true;
-            if (result.Dist < dist)
-            {
-                dist = result.Dist.value();
-            }
-        }
-    }
+    float dist;
+    const bool hit = ClosestHit(p_params, &m_selection, dist) != nullptr;
 
     if (hit)
     {
@@ -359,10 +379,14 @@ void ObstManager::MoveSelectedObsts(const HitParams& p_dest)
     for (const auto& obst : m_selection)
     {
         ObstDefinition def = obst->Def();
+        m_changedObsts.push_back(def);
         def.x += trans.x;
         def.y += trans.y;
         obst->SetDef(def);
+        m_grid.Update(obst);
+        m_changedObsts.push_back(def);
     }
+    m_layoutChanged = true;
 
     m_moveOrigin = destModelCoord;
 }
@@ -385,14 +409,54 @@ glm::vec3 ObstManager::GetSurfaceOrFloorIntersect(const HitParams& p_params)
     return GetModelSpaceCoordFromScreenPos(p_params, boost::none, m_waterHeight);
 }
 
+std::vector<ObstDefinition> ObstManager::TakeChangedObsts()
+{
+    std::vector<ObstDefinition> changed;
+    changed.swap(m_changedObsts);
+    return changed;
+}
+
+std::vector<ObstDefinition> ObstManager::ObstDefinitions()
+{
+    std::vector<ObstDefinition> defs;
+    defs.reserve(m_obsts->size());
+    for (const auto& obst : *m_obsts)
+        defs.push_back(obst->Def());
+    return defs;
+}
+
 bool ObstManager::IsInsideObstruction(const Point<float>& p_modelCoord)
 {
-    const float tolerance = 0.f;
-    for (const auto obst : *m_obsts)
+    return m_grid.FindAt(p_modelCoord, [&](Obst& p_obst){ return p_obst.Hit(p_modelCoord).Hit; });
+}
+
+std::vector<std::shared_ptr<Obst>> ObstManager::ObstsNearRay(const HitParams& p_params)
+{
+    glm::vec3 rayOrigin, rayDir;
+    GetMouseRay(rayOrigin, rayDir, p_params);
+    return m_grid.AlongRay(rayOrigin, rayDir, -1.f, -1.f + PillarHeightFromDepth(m_waterHeight));
+}
+
+//! Closest obstruction hit by the mouse ray, optionally only among p_among. Null if there is none.
+std::shared_ptr<Obst> ObstManager::ClosestHit(const HitParams& p_params,
+    const std::set<std::shared_ptr<Obst>>* p_among, float& p_dist)
+{
+    p_dist = std::numeric_limits<float>::max();
+    std::shared_ptr<Obst> closest;
+    for (const auto& obst : ObstsNearRay(p_params))
     {
-        if (obst->Hit(p_modelCoord).Hit)
-            return true;
+        if (p_among != nullptr && p_among->find(obst) == p_among->end())
+            continue;
+        HitResult result = obst->Hit(p_params);
+        if (result.Hit)
+        {
+            assert(result.Dist.is_initialized());
+            if (!closest || result.Dist.value() < p_dist)
+            {
+                p_dist = result.Dist.value();
+                closest = obst;
+            }
+        }
     }
-
-    return false;
+    return closest;
 }
@@ -3,6 +3,7 @@
 #include "HitParams.h"
 #include "RenderParams.h"
 #include "ObstDefinition.h"
+#include "ObstGrid.h"
 #include "Info/ObstInfo.h"
 
 #include "Shizuku.Core/Types/Point.h"
@@ -11,8 +12,10 @@
 #include <GLEW/glew.h>
 #include "cuda_gl_interop.h"
 
+#include <array>
 #include <memory>
 #include <set>
+#include <vector>
 
 namespace Shizuku{
 namespace Core{
@@ -37,15 +40,31 @@ namespace Shizuku { namespace Flow{
         std::shared_ptr<std::set<std::shared_ptr<Obst>>> m_obsts;
         std::set<std::shared_ptr<Obst>> m_selection;
         std::set<std::shared_ptr<Obst>> m_preSelection;
-        ObstDefinition* m_obstData;
+        std::vector<ObstDefinition> m_changedObsts;
+        ObstGrid m_grid;
+
+        //! Contents of the obstruction SSBOs, see ObstGridView
+        std::vector<ObstDefinition> m_obstData;
+        std::vector<int> m_gridStarts;
+        std::vector<int> m_gridItems;
+        //! Set when obstructions are added, removed or moved, which changes m_gridStarts and m_gridItems
+        bool m_layoutChanged;
+        unsigned int m_obstCapacity;
+        unsigned int m_gridItemCapacity;
 
         std::shared_ptr<Core::ShaderProgram> m_shaderProgram;
 
         cudaGraphicsResource* m_cudaObstsResource;
+        cudaGraphicsResource* m_cudaGridStartsResource;
+        cudaGraphicsResource* m_cudaGridItemsResource;
 
         void RefreshObstStates();
         void DoClearSelection();
         void DoClearPreSelection();
+        //! Candidates for Obst::Hit(p_params) from m_grid, in no particular order
+        std::vector<std::shared_ptr<Obst>> ObstsNearRay(const HitParams& p_params);
+        std::shared_ptr<Obst> ClosestHit(const HitParams& p_params, const std::set<std::shared_ptr<Obst>>* p_among,
+            float& p_dist);
 
     public:
         ObstManager(std::shared_ptr<Core::Ogl> p_ogl);
@@ -59,8 +78,17 @@ namespace Shizuku { namespace Flow{
         int SelectedObstCount();
         int PreSelectedObstCount();
         bool IsInsideObstruction(const Point<float>& p_modelCoord);
+        //! Footprints touched since the last call: created and deleted obstructions, and the old and new definition of
+        //! moved ones. Only the image under these needs to be re-rasterized (CudaLbm::UpdateDeviceImage).
+        std::vector<ObstDefinition> TakeChangedObsts();
+        //! Copies of the definitions of all obstructions, e.g. for the solver thread
+        std::vector<ObstDefinition> ObstDefinitions();
         boost::optional<const Info::ObstInfo> ObstInfo(const HitParams& p_params);
-        cudaGraphicsResource* GetCudaObstsResource();
+        //! Obstruction definitions, grid cell starts and grid items. The buffers are reallocated as obstructions are
+        //! added, so get the resources again before each map.
+        std::array<cudaGraphicsResource*, 3> GetCudaObstResources();
+        //! Device pointers of the resources of GetCudaObstResources(), which must be mapped
+        ObstGridView GetMappedObstGridView();
 
         void AddObstructionToPreSelection(const HitParams& p_params);
         void RemoveObstructionFromPreSelection(const HitParams& p_params);
@@ -72,6 +100,8 @@ namespace Shizuku { namespace Flow{
         void ClearSelection();
 
         void CreateObst(const ObstDefinition& p_obst);
+        //! Deletes all obstructions and creates p_obsts instead, e.g. when loading a checkpoint
+        void ReplaceObsts(const std::vector<ObstDefinition>& p_obsts);
         void DeleteSelectedObsts();
         bool TryStartMoveSelectedObsts(const HitParams& p_params);
         void MoveSelectedObsts(const HitParams& p_dest);
@@ -0,0 +1,204 @@
+#include "SolverThread.h"
+#include "CudaLbm.h"
+#include "kernel.h"
+#include "Domain.h"
+#include "CudaCheck.h"
+#include "Solver/Checkpoint.h"
+#include "Solver/CheckpointWriter.h"
+#include "Shizuku.Core/Utilities/Profiler.h"
+
+using namespace Shizuku::Core;
+using namespace Shizuku::Flow;
+
+namespace
+{
+    void FreeSnapshot(FieldSnapshot& p_snapshot)
+    {
+        gpuErrchk(cudaFree(p_snapshot.Fields));
+        gpuErrchk(cudaFree(p_snapshot.BoundaryCodes));
+        gpuErrchk(cudaFree(p_snapshot.SolidMaskWords));
+        p_snapshot.Fields = nullptr;
+        p_snapshot.BoundaryCodes = nullptr;
+        p_snapshot.SolidMaskWords = nullptr;
+        p_snapshot.NodeCapacity = 0;
+        p_snapshot.MaskWordCapacity = 0;
+    }
+
+    void ReserveSnapshot(FieldSnapshot& p_snapshot, const size_t p_nodeCount, const size_t p_maskWordCount)
+    {
+        if (p_snapshot.NodeCapacity < p_nodeCount)
+        {
+            gpuErrchk(cudaFree(p_snapshot.Fields));
+            gpuErrchk(cudaFree(p_snapshot.BoundaryCodes));
+            gpuErrchk(cudaMalloc((void **)&p_snapshot.Fields, p_nodeCount*sizeof(float4)));
+            gpuErrchk(cudaMalloc((void **)&p_snapshot.BoundaryCodes, p_nodeCount*sizeof(NodeType)));
+            p_snapshot.NodeCapacity = p_nodeCount;
+        }
+        if (p_snapshot.MaskWordCapacity < p_maskWordCount)
+        {
+            gpuErrchk(cudaFree(p_snapshot.SolidMaskWords));
+            gpuErrchk(cudaMalloc((void **)&p_snapshot.SolidMaskWords, p_maskWordCount*sizeof(unsigned long long)));
+            p_snapshot.MaskWordCapacity = p_maskWordCount;
+        }
+    }
+}
+
+SolverThread::SolverThread(std::shared_ptr<CudaLbm> p_lbm)
+    : m_lbm(p_lbm), m_stop(false), m_hasSnapshot(false), m_stream(0), m_step(0), m_flowGeneration(0)
+{
+}
+
+SolverThread::~SolverThread()
+{
+    Stop();
+    for (int i = 0; i < 3; i++)
+        FreeSnapshot(m_snapshots.Buffer(i));
+}
+
+void SolverThread::Start()
+{
+    if (m_thread.joinable())
+        return;
+    m_stop = false;
+    m_thread = std::thread(&SolverThread::Run, this);
+}
+
+void SolverThread::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_commands.clear();
+    }
+    m_commandPosted.notify_one();
+    m_thread.join();
+}
+
+bool SolverThread::IsRunning()
+{
+    return m_thread.joinable();
+}
+
+void SolverThread::Post(const std::function<void(CudaLbm&)>& p_command)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_commands.push_back(p_command);
+    }
+    m_commandPosted.notify_one();
+}
+
+void SolverThread::PostInitializeFlow()
+{
+    Post([this](CudaLbm&){ InitializeFlow(); });
+}
+
+void SolverThread::PostSaveCheckpoint(const std::string& p_path, const std::vector<ObstDefinition>& p_obsts,
+    std::shared_ptr<CheckpointWriter> p_writer)
+{
+    Post([this, p_path, p_obsts, p_writer](CudaLbm& p_lbm){
+        Checkpoint checkpoint;
+        p_lbm.CaptureCheckpoint(checkpoint);
+        checkpoint.Step = m_step;
+        checkpoint.Obsts = p_obsts;
+        p_writer->Write(p_path, std::move(checkpoint));
+    });
+}
+
+void SolverThread::PostRestoreCheckpoint(std::shared_ptr<const Checkpoint> p_checkpoint)
+{
+    Post([this, p_checkpoint](CudaLbm& p_lbm){
+        p_lbm.RestoreCheckpoint(*p_checkpoint);
+        m_step = p_checkpoint->Step;
+        m_flowGeneration++;
+    });
+}
+
+const FieldSnapshot* SolverThread::AcquireSnapshot()
+{
+    if (m_snapshots.Acquire())
+        m_hasSnapshot = true;
+    return m_hasSnapshot ? &m_snapshots.Front() : nullptr;
+}
+
+void SolverThread::Run()
+{
+    Profiler::SetThreadName("Solver");
+    gpuErrchk(cudaStreamCreateWithFlags(&m_stream, cudaStreamNonBlocking));
+    while (true)
+    {
+        std::vector<std::function<void(CudaLbm&)>> commands;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            //paused and nothing to apply: sleep until something is posted
+            m_commandPosted.wait(lock, [&]{ return m_stop || !m_commands.empty() || !m_lbm->IsPaused(); });
+            if (m_stop)
+                break;
+            commands.swap(m_commands);
+        }
+
+        if (!commands.empty())
+        {
+            SHIZUKU_ZONE("ApplyCommands");
+            for (const auto& command : commands)
+                command(*m_lbm);
+        }
+        //lattice allocation, flow initialization and image uploads go through the default stream, which m_stream
+        //doesn't wait for
+        gpuErrchk(cudaStreamSynchronize(0));
+
+        if (m_lbm->IsPaused())
+        {
+            PublishSnapshot();
+        }
+        else
+        {
+            SHIZUKU_ZONE("SolveFluid");
+            MarchSolution(m_lbm.get(), m_stream);
+            m_step += m_lbm->GetTimeStepsPerFrame();
+            PublishSnapshot();
+        }
+    }
+    gpuErrchk(cudaStreamSynchronize(m_stream));
+    gpuErrchk(cudaStreamDestroy(m_stream));
+    m_stream = 0;
+}
+
+void SolverThread::InitializeFlow()
+{
+    CudaLbm& lbm = *m_lbm;
+    const float u = lbm.GetInletVelocity();
+    Domain* domain = lbm.GetDomain();
+    const StreamingMode streamingMode = lbm.GetStreamingMode();
+    InitializeDomain(lbm.GetFA(), u, *domain, streamingMode);
+    if (streamingMode == StreamingMode::PING_PONG)
+        InitializeDomain(lbm.GetFB(), u, *domain, streamingMode);
+    m_step = 0;
+    m_flowGeneration++;
+}
+
+void SolverThread::PublishSnapshot()
+{
+    SHIZUKU_ZONE("PublishSnapshot");
+    FieldSnapshot& snapshot = m_snapshots.Back();
+    Domain* domain = m_lbm->GetDomain();
+    const SolidMask mask = m_lbm->GetSolidMask();
+    const size_t nodeCount = static_cast<size_t>(domain->GetPitch())*domain->GetYDim();
+    const size_t maskWordCount = static_cast<size_t>(mask.WordsPerRow)*domain->GetYDim();
+    ReserveSnapshot(snapshot, nodeCount, maskWordCount);
+
+    ComputeFieldSnapshot(snapshot.Fields, m_lbm.get(), m_stream);
+    gpuErrchk(cudaMemcpyAsync(snapshot.BoundaryCodes, m_lbm->GetBoundaryCodes(), nodeCount*sizeof(NodeType),
+        cudaMemcpyDeviceToDevice, m_stream));
+    gpuErrchk(cudaMemcpyAsync(snapshot.SolidMaskWords, mask.Words, maskWordCount*sizeof(unsigned long long),
+        cudaMemcpyDeviceToDevice, m_stream));
+    snapshot.SimDomain = *domain;
+    snapshot.MaskWordsPerRow = mask.WordsPerRow;
+    snapshot.Step = m_step;
+    snapshot.FlowGeneration = m_flowGeneration;
+    gpuErrchk(cudaStreamSynchronize(m_stream));
+
+    m_snapshots.Publish();
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "FieldSnapshot.h"
+#include "ObstDefinition.h"
+#include "Shizuku.Core/Utilities/TripleBuffer.h"
+#include "cuda_runtime.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CudaLbm;
+
+namespace Shizuku { namespace Flow{
+    struct Checkpoint;
+    class CheckpointWriter;
+
+    //! Runs a CudaLbm on its own thread, so the frame rate isn't capped by the solver and the solver isn't throttled
+    //! by vsync. The thread marches GetTimeStepsPerFrame steps at a time on its own stream and publishes the fields
+    //! after each batch through a triple buffer; each batch is timed as the profiler zone "SolveFluid". Anything that
+    //! changes the CudaLbm once the thread runs has to be posted as a command; commands run between batches, in the
+    //! order posted.
+    class SolverThread
+    {
+    private:
+        std::shared_ptr<CudaLbm> m_lbm;
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_commandPosted;
+        std::vector<std::function<void(CudaLbm&)>> m_commands;
+        bool m_stop;
+
+        Core::TripleBuffer<FieldSnapshot> m_snapshots;
+        bool m_hasSnapshot;
+        cudaStream_t m_stream;
+        long long m_step;
+        int m_flowGeneration;
+
+        void Run();
+        void InitializeFlow();
+        void PublishSnapshot();
+    public:
+        SolverThread(std::shared_ptr<CudaLbm> p_lbm);
+        ~SolverThread();
+
+        SolverThread(const SolverThread&) = delete;
+        SolverThread& operator=(const SolverThread&) = delete;
+
+        void Start();
+        //! Finishes the current batch and joins the thread. Commands that haven't run yet are dropped.
+        void Stop();
+        bool IsRunning();
+
+        void Post(const std::function<void(CudaLbm&)>& p_command);
+        //! Resets the distributions to the inlet velocity and the step count to zero
+        void PostInitializeFlow();
+        //! Stages the state after the current batch, with the obstructions p_obsts, and queues it on p_writer
+        void PostSaveCheckpoint(const std::string& p_path, const std::vector<ObstDefinition>& p_obsts,
+            std::shared_ptr<CheckpointWriter> p_writer);
+        //! Carries on from p_checkpoint, which has to be the size of the domain. Counts as a flow initialization.
+        void PostRestoreCheckpoint(std::shared_ptr<const Checkpoint> p_checkpoint);
+
+        //! Latest published snapshot, null until the first one. It isn't written to until the next call, by which
+        //! time the caller has to be done with its device buffers.
+        const FieldSnapshot* AcquireSnapshot();
+    };
+} }
@@ -7,6 +7,7 @@
 #include <soil.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <GLEW/glew.h>
+#include <algorithm>
 #include <string>
 #include <cstring>
 #include <iostream>
@@ -23,6 +24,8 @@ WaterSurface::WaterSurface()
     m_lightingProgram = std::make_shared<ShaderProgram>();
     m_obstProgram = std::make_shared<ShaderProgram>();
     m_outputProgram = std::make_shared<ShaderProgram>();
+    m_obstCount = 0;
+    m_obstCapacity = 1;
 
     Ogl = std::make_shared < Shizuku::Core::Ogl >();
 
@@ -144,7 +147,7 @@ void WaterSurface::AllocateStorageBuffers()
     CreateShaderStorageBuffer(GLfloat(0), MAX_XDIM*MAX_YDIM*9, "LbmA");
     CreateShaderStorageBuffer(GLfloat(0), MAX_XDIM*MAX_YDIM*9, "LbmB");
     CreateShaderStorageBuffer(GLint(0), MAX_XDIM*MAX_YDIM, "Floor");
-    CreateShaderStorageBuffer(ObstDefinition{}, MAXOBSTS, "Obstructions");
+    CreateShaderStorageBuffer(ObstDefinition{}, m_obstCapacity, "Obstructions");
     CreateShaderStorageBuffer(float4{0,0,0,1e6}, 1, "RayIntersection");
 }
 
@@ -216,21 +219,34 @@ void WaterSurface::SetUpOutputTexture(const Rect<int>& p_viewSize)
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void WaterSurface::InitializeObstSsbo()
+//! Reallocates the "Obstructions" SSBO for at least p_count obstructions, keeping its contents and zeroing the rest
+void WaterSurface::GrowObstSsbo(const int p_count)
 {
-    std::shared_ptr<CudaLbm> cudaLbm = GetCudaLbm();
-    ObstDefinition* obst_h = cudaLbm->GetHostObst();
+    const int oldCapacity = m_obstCapacity;
+    while (m_obstCapacity < p_count)
+        m_obstCapacity *= 2;
 
-    std::shared_ptr<Ogl::Buffer> obstSsbo = Ogl->GetBuffer("Obstructions");
-    Ogl->BindSSBO(0, *obstSsbo, GL_SHADER_STORAGE_BUFFER);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, MAXOBSTS*sizeof(ObstDefinition), obst_h, GL_STATIC_DRAW);
-    Ogl->UnbindBO(GL_SHADER_STORAGE_BUFFER);
+    const GLuint id = Ogl->GetBuffer("Obstructions")->GetId();
+    const GLsizeiptr oldSize = oldCapacity*sizeof(ObstDefinition);
+    GLuint temp;
+    glGenBuffers(1, &temp);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+    glBufferData(GL_COPY_WRITE_BUFFER, oldSize, nullptr, GL_STREAM_COPY);
+    glBindBuffer(GL_COPY_READ_BUFFER, id);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+    const std::vector<ObstDefinition> zeros(m_obstCapacity, ObstDefinition{});
+    glBufferData(GL_COPY_READ_BUFFER, m_obstCapacity*sizeof(ObstDefinition), zeros.data(), GL_STATIC_DRAW);
+    glCopyBufferSubData(GL_COPY_WRITE_BUFFER, GL_COPY_READ_BUFFER, 0, 0, oldSize);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &temp);
 }
 
 int WaterSurface::RayCastMouseClick(glm::vec3 &rayCastIntersection, const glm::vec3 rayOrigin,
-    const glm::vec3 rayDir)
+    const glm::vec3 rayDir, Domain &domain)
 {
-    Domain domain = *m_cudaLbm->GetDomain();
     int xDim = domain.GetXDim();
     int yDim = domain.GetYDim();
     glm::vec4 intersectionCoord{ 0, 0, 0, 0 };
@@ -243,7 +259,7 @@ int WaterSurface::RayCastMouseClick(glm::vec3 &rayCastIntersection, const glm::v
 
     shader->SetUniform("maxXDim", MAX_XDIM);
     shader->SetUniform("maxyDim", MAX_YDIM);
-    shader->SetUniform("maxObsts", MAXOBSTS);
+    shader->SetUniform("obstCount", m_obstCount);
     shader->SetUniform("xDim", xDim);
     shader->SetUniform("yDim", yDim);
     shader->SetUniform("xDimVisible", domain.GetXDimVisible());
@@ -347,7 +363,7 @@ void WaterSurface::SetUpWallVao()
 }
 
 void WaterSurface::RunComputeShader(const glm::vec3 p_cameraPosition, const ContourVariable p_contVar,
-        const MinMax<float>& p_minMax)
+        const MinMax<float>& p_minMax, Domain& p_domain)
 {
     std::shared_ptr<Ogl::Buffer> ssbo_lbmA = Ogl->GetBuffer("LbmA");
     Ogl->BindSSBO(0, *ssbo_lbmA);
@@ -364,16 +380,15 @@ void WaterSurface::RunComputeShader(const glm::vec3 p_cameraPosition, const Cont
 
     shader->Use();
 
-    Domain domain = *m_cudaLbm->GetDomain();
-    const int xDim = domain.GetXDim();
-    const int yDim = domain.GetYDim();
+    const int xDim = p_domain.GetXDim();
+    const int yDim = p_domain.GetYDim();
     shader->SetUniform("maxXDim", MAX_XDIM);
     shader->SetUniform("maxyDim", MAX_YDIM);
-    shader->SetUniform("maxObsts", MAXOBSTS);
+    shader->SetUniform("obstCount", m_obstCount);
     shader->SetUniform("xDim", xDim);
     shader->SetUniform("yDim", yDim);
-    shader->SetUniform("xDimVisible", domain.GetXDimVisible());
-    shader->SetUniform("yDimVisible", domain.GetYDimVisible());
+    shader->SetUniform("xDimVisible", p_domain.GetXDimVisible());
+    shader->SetUniform("yDimVisible", p_domain.GetYDimVisible());
     shader->SetUniform("cameraPosition", p_cameraPosition);
     shader->SetUniform("uMax", m_inletVelocity);
     shader->SetUniform("omega", m_omega);
@@ -407,6 +422,10 @@ void WaterSurface::RunComputeShader(const glm::vec3 p_cameraPosition, const Cont
 
 void WaterSurface::UpdateObstructionsUsingComputeShader(const int obstId, ObstDefinition &newObst, const float scaleFactor)
 {
+    if (obstId >= m_obstCapacity)
+        GrowObstSsbo(obstId + 1);
+    m_obstCount = std::max(m_obstCount, obstId + 1);
+
     std::shared_ptr<Ogl::Buffer> ssbo_obsts = Ogl->GetBuffer("Obstructions");
     Ogl->BindSSBO(0, *ssbo_obsts);
     std::shared_ptr<ShaderProgram> const shader = m_obstProgram;
@@ -427,7 +446,7 @@ void WaterSurface::UpdateObstructionsUsingComputeShader(const int obstId, ObstDe
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
-void WaterSurface::InitializeComputeShaderData()
+void WaterSurface::InitializeComputeShaderData(Domain &domain)
 {
 
     std::shared_ptr<Ogl::Buffer> ssbo_lbmA = Ogl->GetBuffer("LbmA");
@@ -441,10 +460,9 @@ void WaterSurface::InitializeComputeShaderData()
 
     shader->Use();
 
-    Domain domain = *m_cudaLbm->GetDomain();
     shader->SetUniform("maxXDim", MAX_XDIM);
     shader->SetUniform("maxYDim", MAX_YDIM);
-    shader->SetUniform("maxObsts", MAXOBSTS);//
+    shader->SetUniform("obstCount", m_obstCount);
     shader->SetUniform("xDim", domain.GetXDim());
     shader->SetUniform("yDim", domain.GetYDim());
     shader->SetUniform("xDimVisible", domain.GetXDim());
@@ -553,6 +571,7 @@ void WaterSurface::RenderSurface(Domain &domain, const RenderParams& p_params, c
     m_surfaceRayTrace->SetUniform("cameraPos", p_params.Camera);
     m_surfaceRayTrace->SetUniform("obstHeight", p_obstHeight);
     m_surfaceRayTrace->SetUniform("obstCount", p_obstCount);
+    m_surfaceRayTrace->SetUniform("obstGridCells", OBST_GRID_CELLS);
     m_surfaceRayTrace->SetUniform("obstColor", p_params.Schema.Obst.Value());
     m_surfaceRayTrace->SetUniform("obstColorHighlight", p_params.Schema.ObstHighlight.Value());
     m_surfaceRayTrace->SetUniform("viewSize", glm::vec2((float)p_viewSize.Width, (float)p_viewSize.Height));
@@ -563,6 +582,8 @@ void WaterSurface::RenderSurface(Domain &domain, const RenderParams& p_params, c
     
     std::shared_ptr<Ogl::Buffer> obstSsbo = Ogl->GetBuffer("managed_obsts");
     Ogl->BindSSBO(0, *obstSsbo, GL_SHADER_STORAGE_BUFFER);
+    Ogl->BindSSBO(1, *Ogl->GetBuffer("managed_obst_grid_starts"), GL_SHADER_STORAGE_BUFFER);
+    Ogl->BindSSBO(2, *Ogl->GetBuffer("managed_obst_grid_items"), GL_SHADER_STORAGE_BUFFER);
     
     const int yDimVisible = domain.GetYDimVisible();
     glDrawElements(GL_TRIANGLES, (MAX_XDIM - 1)*(yDimVisible - 1)*3*2 , GL_UNSIGNED_INT, (GLvoid*)0);
@@ -65,7 +65,11 @@ namespace Shizuku { namespace Flow {
         std::vector<Ssbo> m_ssbos;
         float m_omega;
         float m_inletVelocity;
+        //! Obstructions of the compute shader solver, in the "Obstructions" SSBO
+        int m_obstCount;
+        int m_obstCapacity;
         void CreateElementArrayBuffer();
+        void GrowObstSsbo(const int p_count);
 
         void RenderSurface(Domain &p_domain, const RenderParams& p_params, const Rect<int>& p_viewSize,
             const float obstHeight, const int obstCount, GLuint p_causticsTex);
@@ -97,8 +101,8 @@ namespace Shizuku { namespace Flow {
         void SetUpSurfaceVao();
         void SetUpOutputVao();
         void SetUpWallVao();
-        void InitializeObstSsbo();
-        void InitializeComputeShaderData();
+        //! Like RunComputeShader, takes GraphicsManager's copy of the domain; the solver thread writes CudaLbm's own
+        void InitializeComputeShaderData(Domain &domain);
 
         void BindFloorLightTexture();
         void BindEnvTexture();
@@ -110,10 +114,11 @@ namespace Shizuku { namespace Flow {
         float GetInletVelocity();
         void UpdateLbmInputs(const float u, const float omega);
 
-        void RunComputeShader(const glm::vec3 p_cameraPosition, const ContourVariable p_contVar, const Types::MinMax<float>& p_minMax);
+        void RunComputeShader(const glm::vec3 p_cameraPosition, const ContourVariable p_contVar, const Types::MinMax<float>& p_minMax,
+            Domain& p_domain);
         void UpdateObstructionsUsingComputeShader(const int obstId, Shizuku::Flow::ObstDefinition &newObst, const float scaleFactor);
         int RayCastMouseClick(glm::vec3 &rayCastIntersection, const glm::vec3 rayOrigin,
-            const glm::vec3 rayDir);
+            const glm::vec3 rayDir, Domain &domain);
 
         void Render(const ContourVariable p_contour, Domain &domain, const RenderParams& p_params,
             const bool p_drawWireframe, const Rect<int>& p_viewSize, const float obstHeight, const int obstCount, GLuint p_causticsTex);
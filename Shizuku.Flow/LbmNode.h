@@ -1,34 +1,357 @@
 #pragma once
-#include "cuda_runtime.h"
-
-class LbmNode
-{
-    float m_f[9];
-    int m_xDim, m_yDim;
-public:
-    __host__ __device__ LbmNode();
-    __device__ int GetXDim();
-    __device__ int GetYDim();
-    __device__ void SetXDim(const int xDim);
-    __device__ void SetYDim(const int yDim);
-    __device__ float ComputeRho();
-    __device__ float ComputeU();
-    __device__ float ComputeV();
-    __device__ void ReadIncomingDistributions(float* f, const int x, const int y);
-    __device__ void ReadDistributions(float* f, const int x, const int y);
-    __device__ void Initialize(float* f, const float rho, const float u, const float v);
-    __device__ void ComputeFeqs(float* fOut, const float rho, const float u,
-        const float v);
-    __device__ void ComputeFeqs(float* fOut);
-    __device__ float ComputeStrainRateMagnitude();
-    __device__ void DirichletWest(const int y, const int xDim, const int yDim,
-        const float uMax);
-    __device__ void NeumannEast(const int y, const int xDim, const int yDim);
-    __device__ void MovingWall(const float rho, const float u, const float v);
-    __device__ void BounceBackWall();
-    __device__ void ApplyBCs(const int y, const int im, const int xDim, const int yDim,
-        const float uMax);
-    __device__ void Collide(const float omega);
-    __device__ void WriteDistributions(float* f, const int x, const int y);
-};
+#include "common.h"
+#include <cmath>
 
+namespace Shizuku { namespace Flow{
+    //! One D2Q9 node: streaming reads and writes, BCs and the collision. The CUDA kernels (MarchLBM) and the host
+    //! solver (CpuLbm) both run this code, so they advance a node identically.
+    //! Distributions are laid out like f_mem: one plane per direction, p_pitch values per row.
+    //! Real is the arithmetic type. The kernels use the float instantiation (LbmNode); the host runs the same source
+    //! in double as the reference for measuring the rounding error of the float engines.
+    template <typename Real>
+    class LbmNodeT
+    {
+    private:
+        Real m_f[9];
+        int m_xDim, m_yDim;
+        int m_pitch;
+
+        SHIZUKU_HOST_DEVICE int FMem(const int p_fNum, const int p_x, const int p_y) const
+        {
+            return p_x + p_y*m_pitch + p_fNum*m_pitch*m_yDim;
+        }
+
+        SHIZUKU_HOST_DEVICE static Real Sqrt(const Real p_value)
+        {
+#ifdef __CUDA_ARCH__
+            return sqrt(p_value);
+#else
+            return std::sqrt(p_value);
+#endif
+        }
+    public:
+        SHIZUKU_HOST_DEVICE LbmNodeT(const int p_xDim, const int p_yDim, const int p_pitch)
+            : m_xDim(p_xDim), m_yDim(p_yDim), m_pitch(p_pitch)
+        {
+        }
+
+        SHIZUKU_HOST_DEVICE Real ComputeRho() const
+        {
+            return m_f[0] + m_f[1] + m_f[2] + m_f[3] + m_f[4] + m_f[5] + m_f[6] + m_f[7] + m_f[8];
+        }
+
+        SHIZUKU_HOST_DEVICE Real ComputeU() const
+        {
+            return m_f[1] - m_f[3] + m_f[5] - m_f[6] - m_f[7] + m_f[8];
+        }
+
+        SHIZUKU_HOST_DEVICE Real ComputeV() const
+        {
+            return m_f[2] - m_f[4] + m_f[5] + m_f[6] - m_f[7] - m_f[8];
+        }
+
+        //! Pull-streaming read. Neighbors past the west and east edges are clamped to the edge column; links from
+        //! below the bottom row or above the top one read 0, and the BCs of those rows overwrite them.
+        SHIZUKU_HOST_DEVICE void ReadIncomingDistributions(const Real* p_f, const int p_x, const int p_y)
+        {
+            const int xW = p_x > 0 ? p_x - 1 : 0;
+            const int xE = p_x < m_xDim - 1 ? p_x + 1 : m_xDim - 1;
+            const bool south = p_y > 0;
+            const bool north = p_y < m_yDim - 1;
+            m_f[0] = p_f[FMem(0, p_x, p_y)];
+            m_f[1] = p_f[FMem(1, xW, p_y)];
+            m_f[3] = p_f[FMem(3, xE, p_y)];
+            m_f[2] = south ? p_f[FMem(2, p_x, p_y - 1)] : Real(0);
+            m_f[5] = south ? p_f[FMem(5, xW, p_y - 1)] : Real(0);
+            m_f[6] = south ? p_f[FMem(6, xE, p_y - 1)] : Real(0);
+            m_f[4] = north ? p_f[FMem(4, p_x, p_y + 1)] : Real(0);
+            m_f[7] = north ? p_f[FMem(7, xE, p_y + 1)] : Real(0);
+            m_f[8] = north ? p_f[FMem(8, xW, p_y + 1)] : Real(0);
+        }
+
+        SHIZUKU_HOST_DEVICE void ReadDistributions(const Real* p_f, const int p_x, const int p_y)
+        {
+            for (int i = 0; i < 9; i++)
+            {
+                m_f[i] = p_f[FMem(i, p_x, p_y)];
+            }
+        }
+
+        SHIZUKU_HOST_DEVICE void WriteDistributions(Real* p_f, const int p_x, const int p_y) const
+        {
+            for (int i = 0; i < 9; i++)
+            {
+                p_f[FMem(i, p_x, p_y)] = m_f[i];
+            }
+        }
+
+        //! IN_PLACE lattices keep direction i in the slot of its opposite between step pairs
+        SHIZUKU_HOST_DEVICE void ReadOppositeDistributions(const Real* p_f, const int p_x, const int p_y)
+        {
+            const int opposite[9] = { 0, 3, 4, 1, 2, 7, 8, 5, 6 };
+            for (int i = 0; i < 9; i++)
+            {
+                m_f[i] = p_f[FMem(opposite[i], p_x, p_y)];
+            }
+        }
+
+        SHIZUKU_HOST_DEVICE void WriteOppositeDistributions(Real* p_f, const int p_x, const int p_y) const
+        {
+            const int opposite[9] = { 0, 3, 4, 1, 2, 7, 8, 5, 6 };
+            for (int i = 0; i < 9; i++)
+            {
+                p_f[FMem(opposite[i], p_x, p_y)] = m_f[i];
+            }
+        }
+
+        //! First step of an IN_PLACE pair. Neighbor x-c_i left its post-collision f_i in its opposite slot.
+        //! Links from outside the domain read 0; the BCs on the domain edges overwrite them.
+        SHIZUKU_HOST_DEVICE void ReadInPlaceIncoming(const Real* p_f, const int p_x, const int p_y)
+        {
+            const int c_x[9] = { 0, 1, 0, -1, 0, 1, -1, -1, 1 };
+            const int c_y[9] = { 0, 0, 1, 0, -1, 1, 1, -1, -1 };
+            const int opposite[9] = { 0, 3, 4, 1, 2, 7, 8, 5, 6 };
+            for (int i = 0; i < 9; i++)
+            {
+                const int xSrc = p_x - c_x[i];
+                const int ySrc = p_y - c_y[i];
+                if (xSrc >= 0 && xSrc < m_xDim && ySrc >= 0 && ySrc < m_yDim)
+                    m_f[i] = p_f[FMem(opposite[i], xSrc, ySrc)];
+                else
+                    m_f[i] = Real(0);
+            }
+        }
+
+        //! Push f_i to neighbor x+c_i. These are exactly the slots ReadInPlaceIncoming read, so nodes never race.
+        SHIZUKU_HOST_DEVICE void WriteInPlaceOutgoing(Real* p_f, const int p_x, const int p_y) const
+        {
+            const int c_x[9] = { 0, 1, 0, -1, 0, 1, -1, -1, 1 };
+            const int c_y[9] = { 0, 0, 1, 0, -1, 1, 1, -1, -1 };
+            for (int i = 0; i < 9; i++)
+            {
+                const int xDst = p_x + c_x[i];
+                const int yDst = p_y + c_y[i];
+                if (xDst >= 0 && xDst < m_xDim && yDst >= 0 && yDst < m_yDim)
+                    p_f[FMem(i, xDst, yDst)] = m_f[i];
+            }
+        }
+
+        //! Row buffer access: p_planes[i][p_index] is direction i
+        SHIZUKU_HOST_DEVICE void ReadDistributions(const Real* const p_planes[9], const int p_index)
+        {
+            for (int i = 0; i < 9; i++)
+            {
+                m_f[i] = p_planes[i][p_index];
+            }
+        }
+
+        SHIZUKU_HOST_DEVICE void WriteDistributions(Real* const p_planes[9], const int p_index) const
+        {
+            for (int i = 0; i < 9; i++)
+            {
+                p_planes[i][p_index] = m_f[i];
+            }
+        }
+
+        SHIZUKU_HOST_DEVICE void Initialize(const Real p_rho, const Real p_u, const Real p_v)
+        {
+            ComputeFeqs(m_f, p_rho, p_u, p_v);
+        }
+
+        //! The 1/36 weight is a double literal: the float instantiation multiplies in double and rounds
+        SHIZUKU_HOST_DEVICE static void ComputeFeqs(Real* p_fOut, const Real rho, const Real u, const Real v)
+        {
+            Real usqr = u*u + v*v;
+            p_fOut[0] = Real(0.4444444444)*(rho - Real(1.5)*usqr);
+            p_fOut[1] = Real(0.1111111111)*(rho + Real(3)*u + Real(4.5)*u*u - Real(1.5)*usqr);
+            p_fOut[2] = Real(0.1111111111)*(rho + Real(3)*v + Real(4.5)*v*v - Real(1.5)*usqr);
+            p_fOut[3] = Real(0.1111111111)*(rho - Real(3)*u + Real(4.5)*u*u - Real(1.5)*usqr);
+            p_fOut[4] = Real(0.1111111111)*(rho - Real(3)*v + Real(4.5)*v*v - Real(1.5)*usqr);
+            p_fOut[5] = 0.02777777778*(rho + Real(3)*(u + v) + Real(4.5)*(u + v)*(u + v) - Real(1.5)*usqr);
+            p_fOut[6] = 0.02777777778*(rho + Real(3)*(-u + v) + Real(4.5)*(-u + v)*(-u + v) - Real(1.5)*usqr);
+            p_fOut[7] = 0.02777777778*(rho + Real(3)*(-u - v) + Real(4.5)*(-u - v)*(-u - v) - Real(1.5)*usqr);
+            p_fOut[8] = 0.02777777778*(rho + Real(3)*(u - v) + Real(4.5)*(u - v)*(u - v) - Real(1.5)*usqr);
+        }
+
+        SHIZUKU_HOST_DEVICE void ComputeFeqs(Real* p_fOut) const
+        {
+            ComputeFeqs(p_fOut, ComputeRho(), ComputeU(), ComputeV());
+        }
+
+        SHIZUKU_HOST_DEVICE Real ComputeStrainRateMagnitude() const
+        {
+            Real fEq[9];
+            ComputeFeqs(fEq);
+            Real qxx = (m_f[1]-fEq[1]) + (m_f[3]-fEq[3]) + (m_f[5]-fEq[5]) + (m_f[6]-fEq[6])
+                + (m_f[7]-fEq[7]) + (m_f[8]-fEq[8]);
+            Real qxy = (m_f[5]-fEq[5]) - (m_f[6]-fEq[6]) + (m_f[7]-fEq[7]) - (m_f[8]-fEq[8]);
+            Real qyy = (m_f[5]-fEq[5]) + (m_f[2]-fEq[2]) + (m_f[6]-fEq[6]) + (m_f[7]-fEq[7])
+                + (m_f[4]-fEq[4]) + (m_f[8]-fEq[8]);
+            return Sqrt(qxx*qxx + qxy*qxy * 2 + qyy*qyy);
+        }
+
+        SHIZUKU_HOST_DEVICE void DirichletWest(const int p_y, const Real p_uMax)
+        {
+            if (p_y == 0){
+                m_f[2] = m_f[4];
+                m_f[6] = m_f[7];
+            }
+            else if (p_y == m_yDim - 1){
+                m_f[4] = m_f[2];
+                m_f[7] = m_f[6];
+            }
+            Real u, v;
+            u = p_uMax;
+            v = Real(0);
+            m_f[1] = m_f[3] + u*Real(0.66666667);
+            m_f[5] = m_f[7] - Real(0.5)*(m_f[2] - m_f[4]) + v*Real(0.5) + u*Real(0.166666667);
+            m_f[8] = m_f[6] + Real(0.5)*(m_f[2] - m_f[4]) - v*Real(0.5) + u*Real(0.166666667);
+        }
+
+        SHIZUKU_HOST_DEVICE void NeumannEast(const int p_y)
+        {
+            if (p_y == 0){
+                m_f[2] = m_f[4];
+                m_f[5] = m_f[8];
+            }
+            else if (p_y == m_yDim - 1){
+                m_f[4] = m_f[2];
+                m_f[8] = m_f[5];
+            }
+            Real rho, u, v;
+            v = Real(0);
+            rho = Real(1);
+            u = -rho + ((m_f[0] + m_f[2] + m_f[4]) + Real(2)*m_f[1] + Real(2)*m_f[5] + Real(2)*m_f[8]);
+            m_f[3] = m_f[1] - u*Real(0.66666667);
+            m_f[7] = m_f[5] + Real(0.5)*(m_f[2] - m_f[4]) - v*Real(0.5) - u*Real(0.166666667);
+            m_f[6] = m_f[8] - Real(0.5)*(m_f[2] - m_f[4]) + v*Real(0.5) - u*Real(0.166666667);
+        }
+
+        SHIZUKU_HOST_DEVICE void SymmetryTop()
+        {
+            m_f[4] = m_f[2];
+            m_f[7] = m_f[6];
+            m_f[8] = m_f[5];
+        }
+
+        SHIZUKU_HOST_DEVICE void SymmetryBottom()
+        {
+            m_f[2] = m_f[4];
+            m_f[6] = m_f[7];
+            m_f[5] = m_f[8];
+        }
+
+        //! Boundary condition of node type Type on the incoming distributions. Only the edge types do anything; the
+        //! branches on Type fold away in each instantiation.
+        template <NodeType Type>
+        SHIZUKU_HOST_DEVICE void ApplyBC(const int p_y, const Real p_uMax)
+        {
+            if (Type == NodeType::NEUMANN_EAST)
+                NeumannEast(p_y);
+            else if (Type == NodeType::DIRICHLET_WEST)
+                DirichletWest(p_y, p_uMax);
+            else if (Type == NodeType::SYMMETRY_TOP)
+                SymmetryTop();
+            else if (Type == NodeType::SYMMETRY_BOTTOM)
+                SymmetryBottom();
+        }
+
+        //! Runtime dispatch of p_im to ApplyBC
+        SHIZUKU_HOST_DEVICE void ApplyBCs(const int p_y, const NodeType p_im, const Real p_uMax)
+        {
+            switch (p_im)
+            {
+            case NodeType::NEUMANN_EAST: ApplyBC<NodeType::NEUMANN_EAST>(p_y, p_uMax); break;
+            case NodeType::DIRICHLET_WEST: ApplyBC<NodeType::DIRICHLET_WEST>(p_y, p_uMax); break;
+            case NodeType::SYMMETRY_TOP: ApplyBC<NodeType::SYMMETRY_TOP>(p_y, p_uMax); break;
+            case NodeType::SYMMETRY_BOTTOM: ApplyBC<NodeType::SYMMETRY_BOTTOM>(p_y, p_uMax); break;
+            default: break;
+            }
+        }
+
+        //! BCs and collision of a node of type Type, or bounce-back for the solid types. The FLUID instantiation is the
+        //! plain collision without any checks.
+        template <NodeType Type>
+        SHIZUKU_HOST_DEVICE void Update(const int p_y, const Real p_uMax, const Real p_omega)
+        {
+            if (Type == NodeType::OBSTRUCTION || Type == NodeType::WALL)
+            {
+                BounceBackWall();
+                return;
+            }
+            ApplyBC<Type>(p_y, p_uMax);
+            Collide(p_omega);
+        }
+
+        //! Runtime dispatch of p_im to Update<Type>, for rows that mix node types
+        SHIZUKU_HOST_DEVICE void Update(const int p_y, const NodeType p_im, const Real p_uMax, const Real p_omega)
+        {
+            switch (p_im)
+            {
+            case NodeType::OBSTRUCTION: case NodeType::WALL: Update<NodeType::OBSTRUCTION>(p_y, p_uMax, p_omega); break;
+            case NodeType::NEUMANN_EAST: Update<NodeType::NEUMANN_EAST>(p_y, p_uMax, p_omega); break;
+            case NodeType::DIRICHLET_WEST: Update<NodeType::DIRICHLET_WEST>(p_y, p_uMax, p_omega); break;
+            case NodeType::SYMMETRY_TOP: Update<NodeType::SYMMETRY_TOP>(p_y, p_uMax, p_omega); break;
+            case NodeType::SYMMETRY_BOTTOM: Update<NodeType::SYMMETRY_BOTTOM>(p_y, p_uMax, p_omega); break;
+            default: Update<NodeType::FLUID>(p_y, p_uMax, p_omega); break;
+            }
+        }
+
+        SHIZUKU_HOST_DEVICE void MovingWall(const Real p_rho, const Real p_u, const Real p_v)
+        {
+            ComputeFeqs(m_f, p_rho, p_u, p_v);
+        }
+
+        SHIZUKU_HOST_DEVICE void BounceBackWall()
+        {
+            Real temp;
+            temp = m_f[1]; m_f[1] = m_f[3]; m_f[3] = temp;
+            temp = m_f[2]; m_f[2] = m_f[4]; m_f[4] = temp;
+            temp = m_f[5]; m_f[5] = m_f[7]; m_f[7] = temp;
+            temp = m_f[6]; m_f[6] = m_f[8]; m_f[8] = temp;
+        }
+
+        SHIZUKU_HOST_DEVICE void Collide(const Real p_omega)
+        {
+            const Real two = 2;
+            const Real three = 3;
+            const Real four = 4;
+            const Real quarter = Real(0.25);
+            const Real ninth = Real(0.11111111);
+            const Real sixth = Real(0.16666666667);
+            const Real twelfth = Real(0.08333333333);
+            const Real eighteenth = Real(0.05555555556);
+            const Real thirtySixth = Real(0.027777777);
+
+            Real Q = ComputeStrainRateMagnitude();
+            Real tau0 = Real(1) / p_omega;
+            Real tau = Real(0.5)*tau0 + Real(0.5)*Sqrt(tau0*tau0 + Real(18)*Real(SMAG_CONST)*Sqrt(two)*Q);
+            Real omegaTurb = Real(1) / tau;
+
+            Real m1, m2, m4, m6, m7, m8;
+
+            Real u = ComputeU();
+            Real v = ComputeV();
+
+            m1 = -two*m_f[0] + m_f[1] + m_f[2] + m_f[3] + m_f[4] + four*m_f[5] + four*m_f[6] + four*m_f[7]
+                + four*m_f[8] - three*(u*u + v*v);
+            m2 = three*m_f[0] - three*m_f[1] - three*m_f[2] - three*m_f[3] - three*m_f[4] + three*(u*u + v*v); //ep
+            m4 = -m_f[1] + m_f[3] + two*m_f[5] - two*m_f[6] - two*m_f[7] + two*m_f[8];//qx_eq
+            m6 = -m_f[2] + m_f[4] + two*m_f[5] + two*m_f[6] - two*m_f[7] - two*m_f[8];//qy_eq
+            m7 = m_f[1] - m_f[2] + m_f[3] - m_f[4] - (u*u - v*v);//pxx_eq
+            m8 = m_f[5] - m_f[6] + m_f[7] - m_f[8] - (u*v);//pxy_eq
+
+            m_f[0] = m_f[0] - (-m1 + m2)*ninth;
+            m_f[1] = m_f[1] - (-m1*thirtySixth - eighteenth*m2 - sixth*m4 + m7*omegaTurb*quarter);
+            m_f[2] = m_f[2] - (-m1*thirtySixth - eighteenth*m2 - sixth*m6 - m7*omegaTurb*quarter);
+            m_f[3] = m_f[3] - (-m1*thirtySixth - eighteenth*m2 + sixth*m4 + m7*omegaTurb*quarter);
+            m_f[4] = m_f[4] - (-m1*thirtySixth - eighteenth*m2 + sixth*m6 - m7*omegaTurb*quarter);
+            m_f[5] = m_f[5] - (eighteenth*m1 + m2*thirtySixth + twelfth*m4 + twelfth*m6 + m8*omegaTurb*quarter);
+            m_f[6] = m_f[6] - (eighteenth*m1 + m2*thirtySixth - twelfth*m4 + twelfth*m6 - m8*omegaTurb*quarter);
+            m_f[7] = m_f[7] - (eighteenth*m1 + m2*thirtySixth - twelfth*m4 - twelfth*m6 + m8*omegaTurb*quarter);
+            m_f[8] = m_f[8] - (eighteenth*m1 + m2*thirtySixth + twelfth*m4 - twelfth*m6 - m8*omegaTurb*quarter);
+        }
+    };
+
+    typedef LbmNodeT<float> LbmNode;
+} }
@@ -2,16 +2,10 @@
 
 #include "Query.h"
 #include "Flow.h"
-#include "TimerKey.h"
 #include "Graphics/GraphicsManager.h"
-#include "Graphics/CudaLbm.h"
-#include "Shizuku.Core/Utilities/Stopwatch.h"
+#include "Shizuku.Core/Utilities/Profiler.h"
 
-#ifdef SHIZUKU_FLOW_EXPORTS  
-#define FLOW_API __declspec(dllexport)   
-#else  
-#define FLOW_API __declspec(dllimport)   
-#endif  
+#include "Export.h"
 
 using namespace Shizuku::Core;
 using namespace Shizuku::Flow;
@@ -27,13 +21,52 @@ Query::Query(Flow& p_flow)
 
 Rect<int> Query::SimulationDomain()
 {
-    return m_flow->Graphics()->GetCudaLbm()->GetDomainSize();
+    return m_flow->Graphics()->GetDomainSize();
 }
 
-double Query::GetTime(TimerKey p_key)
+double Query::GetTime(const char* p_zone, const TimeStatistic p_statistic)
 {
-    std::map<TimerKey, Stopwatch> timers = m_flow->Graphics()->GetTimers();
-    return timers[p_key].GetAverage();
+    return m_flow->Graphics()->GetTime(p_zone, p_statistic);
+}
+
+void Query::ResetTimes()
+{
+    Profiler::Reset();
+}
+
+void Query::EnableCounters(const bool p_enabled)
+{
+    Profiler::EnableCounters(p_enabled);
+}
+
+bool Query::HasHardwareCounters()
+{
+    return PerfCounters::HasHardwareCounters();
+}
+
+double Query::GetCounter(const char* p_zone, const CounterStatistic p_statistic)
+{
+    Profiler::Collect();
+    const ZoneStats stats = Profiler::GetStats(p_zone);
+    if (stats.CountedRuns == 0 || stats.CountedWork <= 0.0)
+        return 0.0;
+    const double updates = stats.CountedWork;
+    const int cacheLineBytes = 64;
+    switch (p_statistic)
+    {
+    case CounterStatistic::IPC:
+        return PerfCounters::Ipc(stats.Counters);
+    case CounterStatistic::INSTRUCTIONS:
+        return stats.Counters.Instructions / updates;
+    case CounterStatistic::LLC_MISSES:
+        return stats.Counters.LlcMisses / updates;
+    case CounterStatistic::LLC_BYTES:
+        return stats.Counters.LlcMisses*cacheLineBytes / updates;
+    case CounterStatistic::CPU_NANOSECONDS:
+        return stats.Counters.TaskClock / updates;
+    default:
+        return updates;
+    }
 }
 
 Types::Point<float> Query::ProbeModelSpaceCoord(const Types::Point<int>& p_screenPoint)
@@ -60,3 +93,18 @@ boost::optional<const Info::ObstInfo> Query::ObstInfo(const Types::Point<int>& p
 {
     return m_flow->Graphics()->ObstInfo(p_screenPoint);
 }
+
+bool Query::IsRecording()
+{
+    return m_flow->Graphics()->IsRecording();
+}
+
+bool Query::IsReplaying()
+{
+    return m_flow->Graphics()->IsReplaying();
+}
+
+std::string Query::StatusMessage()
+{
+    return m_flow->Graphics()->GetStatusMessage();
+}
@@ -1,21 +1,19 @@
 #pragma once
 
 #include "Info/ObstInfo.h"
+#include "CounterStatistic.h"
+#include "TimeStatistic.h"
 #include "Shizuku.Core/Rect.h"
 #include "Shizuku.Core/Types/Point.h"
+#include <string>
 
-#ifdef SHIZUKU_FLOW_EXPORTS  
-#define FLOW_API __declspec(dllexport)   
-#else  
-#define FLOW_API __declspec(dllimport)   
-#endif  
+#include "Export.h"
 
 using namespace Shizuku::Core;
 using namespace Shizuku::Flow;
 
 namespace Shizuku { namespace Flow{
     class Flow;
-    enum TimerKey;
     struct FLOW_API Query
     {
     private:
@@ -24,11 +22,25 @@ namespace Shizuku { namespace Flow{
         Query();
         Query(Flow& p_flow);
         Rect<int> SimulationDomain();
-        double GetTime(TimerKey p_key);
+        //! Duration of profiler zone p_zone in seconds, e.g. "SolveFluid"
+        double GetTime(const char* p_zone, const TimeStatistic p_statistic = TimeStatistic::AVERAGE);
+        //! Clears the durations of all zones, so the percentiles start over
+        void ResetTimes();
+        //! Reads the hardware counters around the counted zones while enabled. Those are host work on the worker
+        //! threads, e.g. "ImageRows"; the counters can't see inside the GPU passes.
+        void EnableCounters(const bool p_enabled);
+        //! False until a counted zone has run with counters enabled, and where the CPU or kernel won't count
+        bool HasHardwareCounters();
+        //! 0 if p_zone hasn't been counted or reported no work
+        double GetCounter(const char* p_zone, const CounterStatistic p_statistic);
         Types::Point<float> ProbeModelSpaceCoord(const Types::Point<int>& p_screenPoint);
         int ObstructionCount();
         int SelectedObstructionCount();
         int PreSelectedObstructionCount();
         boost::optional<const Info::ObstInfo> ObstInfo(const Types::Point<int>& p_screenPoint);
+        bool IsRecording();
+        bool IsReplaying();
+        //! See GraphicsManager::GetStatusMessage
+        std::string StatusMessage();
     };
 } }
@@ -16,7 +16,6 @@ layout(binding = 0) buffer ssbo_obsts
     Obstruction obsts[];
 };
 
-uniform int maxObsts;
 uniform int targetObstId;
 uniform Obstruction targetObst;
 
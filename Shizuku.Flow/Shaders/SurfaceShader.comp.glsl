@@ -41,7 +41,7 @@ uniform int xDimVisible;
 uniform int yDimVisible;
 uniform int maxXDim;
 uniform int maxYDim;
-uniform int maxObsts;
+uniform int obstCount;
 uniform vec3 cameraPosition;
 uniform float uMax;
 uniform float omega;
@@ -92,7 +92,7 @@ float packColor(vec4 color)
 int FindOverlappingObstruction(const float x, const float y,
     const float tolerance = 0.f)
 {
-    for (int i = 0; i < 3; i++){
+    for (int i = 0; i < obstCount; i++){
         if (obsts[i].state != 1) 
         {
             const float r1 = obsts[i].r1;
@@ -2,7 +2,6 @@
 
 #define WATER_REFRACTIVE_INDEX 1.33f
 #define CAUSTICS_TEX_SIZE 1024.f
-#define MAX_OBST 20
 #define OBST_ALBEDO vec3(0.8f)
 
 struct Obstruction
@@ -22,6 +21,18 @@ layout(binding = 0) buffer ssbo_obsts
     Obstruction obsts[];
 };
 
+// ObstGrid of obsts: cell c holds obsts[gridItems[k]] for gridStarts[c] <= k < gridStarts[c+1], the last entry lists
+// the ones reaching outside the domain
+layout(binding = 1) buffer ssbo_obst_grid_starts
+{
+    int gridStarts[];
+};
+
+layout(binding = 2) buffer ssbo_obst_grid_items
+{
+    int gridItems[];
+};
+
 in vec3 fNormal;
 in vec4 posInModel;
 in float fWaterDepth;
@@ -33,6 +44,8 @@ uniform vec3 cameraPos;
 uniform vec2 viewSize;
 uniform float obstHeight;
 uniform int obstCount;
+// Cells per side of the obstruction grid, OBST_GRID_CELLS in common.h
+uniform int obstGridCells;
 uniform vec4 obstColor;
 uniform vec4 obstColorHighlight;
 
@@ -107,6 +120,80 @@ bool RayIntersectsWithBox(vec3 rayOrigin, vec3 rayDir, Obstruction obst, float b
     return true;
 }
 
+void ClosestObstInCell(const int cell, vec3 rayOrigin, vec3 rayDir, inout float closest, inout vec3 normal,
+    inout int closestObstIdx)
+{
+    for (int k = gridStarts[cell]; k < gridStarts[cell+1]; ++k)
+    {
+        const int i = gridItems[k];
+        float dist;
+        vec3 n;
+        if (RayIntersectsWithBox(rayOrigin, rayDir, obsts[i], obstHeight, n, dist) && dist < closest)
+        {
+            closest = dist;
+            normal = n;
+            closestObstIdx = i;
+        }
+    }
+}
+
+// Closest obstruction hit by the ray, testing only those outside the domain and in the grid cells under the segment
+// from rayOrigin.xy to endPos, walked in order (Amanatides-Woo)
+void ClosestObstAlongSegment(vec3 rayOrigin, vec3 rayDir, vec2 endPos, inout float closest, inout vec3 normal,
+    inout int closestObstIdx)
+{
+    ClosestObstInCell(obstGridCells*obstGridCells, rayOrigin, rayDir, closest, normal, closestObstIdx);
+
+    const vec2 from = rayOrigin.xy;
+    const vec2 delta = endPos - from;
+    float tMin = 0.f;
+    float tMax = 1.f;
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (delta[axis] == 0.f)
+        {
+            if (from[axis] < -1.f || from[axis] > 1.f)
+                return;
+            continue;
+        }
+        float t0 = (-1.f - from[axis]) / delta[axis];
+        float t1 = (1.f - from[axis]) / delta[axis];
+        if (t0 > t1)
+            Swap(t0, t1);
+        tMin = max(tMin, t0);
+        tMax = min(tMax, t1);
+    }
+    if (tMin > tMax)
+        return;
+
+    const float cellSize = 2.f / float(obstGridCells);
+    ivec2 cell = clamp(ivec2(floor((from + tMin*delta + 1.f) / cellSize)), ivec2(0), ivec2(obstGridCells - 1));
+    const ivec2 step = ivec2(sign(delta));
+    vec2 tNext = vec2(1e30);
+    vec2 tDelta = vec2(0.f);
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (step[axis] != 0)
+        {
+            const float boundary = -1.f + (cell[axis] + (step[axis] > 0 ? 1 : 0))*cellSize;
+            tNext[axis] = (boundary - from[axis]) / delta[axis];
+            tDelta[axis] = cellSize / abs(delta[axis]);
+        }
+    }
+
+    while (true)
+    {
+        ClosestObstInCell(cell.x + cell.y*obstGridCells, rayOrigin, rayDir, closest, normal, closestObstIdx);
+        const int axis = tNext.x < tNext.y ? 0 : 1;
+        if (tNext[axis] > tMax)
+            break;
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= obstGridCells)
+            break;
+        tNext[axis] += tDelta[axis];
+    }
+}
+
 vec3 PhongLighting(vec3 posInModel, vec3 eyeDir, vec3 n)
 {
     vec3 diffuseLightDirection1 = vec3(0.577367, 0.577367, -0.577367 );
@@ -164,25 +251,15 @@ void main()
 
     float closest = 1e30;
     vec3 normal;
-    bool hit = false;
-    int closestObstIdx;
-    for (int i = 0; i < obstCount; ++i)
+    int closestObstIdx = -1;
+    if (obstCount > 0)
     {
-        float dist;
-        vec3 n;
-        if (RayIntersectsWithBox(posInModel.xyz, refractedRay, obsts[i], obstHeight, n, dist))
-        {
-            hit = true;
-            if (dist < closest)
-            {
-                closest = dist;
-                normal = n;
-                closestObstIdx = i;
-            }
-        }
+        // pillars stand on the floor, so hits are above where the ray reaches z = -1
+        const vec2 floorHit = posInModel.xy + refractedRay.xy*(posInModel.z + 1.f) / max(-refractedRay.z, 1e-6f);
+        ClosestObstAlongSegment(posInModel.xyz, refractedRay, floorHit, closest, normal, closestObstIdx);
     }
 
-    if (hit)
+    if (closestObstIdx >= 0)
     {
         const vec3 lightFactor = PhongLighting(posInModel.xyz, normalize(eyeRayInModel), normal);
         if (obsts[closestObstIdx].state == 0)
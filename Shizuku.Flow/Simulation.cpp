@@ -0,0 +1,286 @@
+#include "Simulation.h"
+#include "Solver/CpuLbm.h"
+#include "Solver/ObstRaster.h"
+#include "Shizuku.Core/Utilities/ThreadPool.h"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+using namespace Shizuku::Core;
+using namespace Shizuku::Core::Types;
+using namespace Shizuku::Flow;
+
+class Shizuku::Flow::SimulationImpl
+{
+private:
+    CpuLbm m_lbm;
+    std::vector<ObstDefinition> m_obsts;
+    bool m_imageChanged;
+
+    std::shared_ptr<ThreadPool> CreateThreadPool(const int p_threadCount)
+    {
+        if (p_threadCount > 0)
+            return std::make_shared<ThreadPool>(p_threadCount);
+        return std::make_shared<ThreadPool>();
+    }
+
+    //! Same rasterization as CudaLbm::RasterizeImage, with the whole row visible
+    void RasterizeImage()
+    {
+        const int xDim = m_lbm.GetXDim();
+        const int yDim = m_lbm.GetYDim();
+        m_lbm.InitializeImage();
+        for (const ObstDefinition& obst : m_obsts)
+        {
+            const CellRect rect = CellRectFromFootprint(obst, xDim);
+            for (int y = std::max(rect.YBegin, 0); y < std::min(rect.YEnd, yDim); y++)
+            {
+                for (int x = std::max(rect.XBegin, 0); x < std::min(rect.XEnd, xDim); x++)
+                {
+                    if (IsInsideFootprint(obst, ModelSpacePosFromSimPos(Point<int>(x, y), xDim)))
+                        m_lbm.SetNodeType(x, y, NodeType::OBSTRUCTION);
+                }
+            }
+        }
+        m_imageChanged = false;
+    }
+
+public:
+    SimulationImpl(const int p_xDim, const int p_yDim, const int p_threadCount)
+        : m_lbm(p_xDim, p_yDim, CreateThreadPool(p_threadCount)), m_imageChanged(true)
+    {
+    }
+
+    CpuLbm& Lbm()
+    {
+        return m_lbm;
+    }
+
+    //! For changes to the obstructions, which need the image rasterized again
+    std::vector<ObstDefinition>& EditObsts()
+    {
+        m_imageChanged = true;
+        return m_obsts;
+    }
+
+    const std::vector<ObstDefinition>& Obsts() const
+    {
+        return m_obsts;
+    }
+
+    void UpdateImage()
+    {
+        if (m_imageChanged)
+            RasterizeImage();
+    }
+
+    //! Takes the image as saved rather than rasterizing the obstructions again
+    void SetImage(const std::vector<ObstDefinition>& p_obsts, const std::vector<NodeType>& p_image)
+    {
+        m_obsts = p_obsts;
+        const int xDim = m_lbm.GetXDim();
+        for (int y = 0; y < m_lbm.GetYDim(); y++)
+            for (int x = 0; x < xDim; x++)
+                m_lbm.SetNodeType(x, y, p_image[x + static_cast<size_t>(y)*xDim]);
+        m_imageChanged = false;
+    }
+};
+
+Simulation::Simulation(const int p_xDim, const int p_yDim)
+    : Simulation(p_xDim, p_yDim, 0)
+{
+}
+
+Simulation::Simulation(const int p_xDim, const int p_yDim, const int p_threadCount)
+{
+    m_impl = new SimulationImpl(p_xDim, p_yDim, p_threadCount);
+    m_impl->UpdateImage();
+    m_impl->Lbm().Initialize();
+}
+
+Simulation::~Simulation()
+{
+    delete m_impl;
+}
+
+int Simulation::GetXDim()
+{
+    return m_impl->Lbm().GetXDim();
+}
+
+int Simulation::GetYDim()
+{
+    return m_impl->Lbm().GetYDim();
+}
+
+float Simulation::GetInletVelocity()
+{
+    return m_impl->Lbm().GetInletVelocity();
+}
+
+void Simulation::SetInletVelocity(const float p_velocity)
+{
+    m_impl->Lbm().SetInletVelocity(p_velocity);
+}
+
+float Simulation::GetOmega()
+{
+    return m_impl->Lbm().GetOmega();
+}
+
+void Simulation::SetOmega(const float p_omega)
+{
+    m_impl->Lbm().SetOmega(p_omega);
+}
+
+StreamingMode Simulation::GetStreamingMode()
+{
+    return m_impl->Lbm().GetStreamingMode();
+}
+
+void Simulation::SetStreamingMode(const StreamingMode p_mode)
+{
+    m_impl->Lbm().SetStreamingMode(p_mode);
+}
+
+Precision Simulation::GetPrecision()
+{
+    return m_impl->Lbm().GetPrecision();
+}
+
+void Simulation::SetPrecision(const Precision p_precision)
+{
+    m_impl->Lbm().SetPrecision(p_precision);
+}
+
+DistributionStorage Simulation::GetDistributionStorage()
+{
+    return m_impl->Lbm().GetDistributionStorage();
+}
+
+void Simulation::SetDistributionStorage(const DistributionStorage p_storage)
+{
+    m_impl->Lbm().SetDistributionStorage(p_storage);
+}
+
+float Simulation::GetSleepThreshold()
+{
+    return m_impl->Lbm().GetSleepThreshold();
+}
+
+void Simulation::SetSleepThreshold(const float p_threshold)
+{
+    m_impl->Lbm().SetSleepThreshold(p_threshold);
+}
+
+int Simulation::GetActiveTileCount()
+{
+    return m_impl->Lbm().GetActiveTileCount();
+}
+
+int Simulation::GetTileCount()
+{
+    return m_impl->Lbm().GetTileCount();
+}
+
+void Simulation::AddObstruction(const ObstDefinition& p_obst)
+{
+    m_impl->EditObsts().push_back(p_obst);
+}
+
+void Simulation::ClearObstructions()
+{
+    m_impl->EditObsts().clear();
+}
+
+std::vector<ObstDefinition> Simulation::GetObstructions()
+{
+    return m_impl->Obsts();
+}
+
+void Simulation::Initialize()
+{
+    m_impl->UpdateImage();
+    m_impl->Lbm().Initialize();
+}
+
+void Simulation::Step(const int p_steps)
+{
+    m_impl->UpdateImage();
+    m_impl->Lbm().March(p_steps);
+}
+
+long long Simulation::GetTimeStep()
+{
+    return m_impl->Lbm().GetTimeStep();
+}
+
+double Simulation::GetMlups()
+{
+    return m_impl->Lbm().GetMlups();
+}
+
+void Simulation::GetFields(float* p_rho, float* p_u, float* p_v)
+{
+    CpuLbm& lbm = m_impl->Lbm();
+    const int xDim = lbm.GetXDim();
+    const int yDim = lbm.GetYDim();
+    for (int y = 0; y < yDim; y++)
+    {
+        for (int x = 0; x < xDim; x++)
+        {
+            const size_t i = x + static_cast<size_t>(y)*xDim;
+            if (p_rho)
+                p_rho[i] = lbm.ComputeRho(x, y);
+            if (p_u)
+                p_u[i] = lbm.ComputeU(x, y);
+            if (p_v)
+                p_v[i] = lbm.ComputeV(x, y);
+        }
+    }
+}
+
+Checkpoint Simulation::CaptureCheckpoint()
+{
+    m_impl->UpdateImage();
+    CpuLbm& lbm = m_impl->Lbm();
+    Checkpoint checkpoint;
+    checkpoint.XDim = lbm.GetXDim();
+    checkpoint.YDim = lbm.GetYDim();
+    checkpoint.Streaming = lbm.GetStreamingMode();
+    checkpoint.Omega = lbm.GetOmega();
+    checkpoint.InletVelocity = lbm.GetInletVelocity();
+    checkpoint.Step = lbm.GetTimeStep();
+    checkpoint.SetDistributions(lbm.GetF(), lbm.GetPitch());
+    const NodeType* image = lbm.GetImage();
+    checkpoint.Image.resize(static_cast<size_t>(checkpoint.XDim)*checkpoint.YDim);
+    for (int y = 0; y < checkpoint.YDim; y++)
+    {
+        std::copy_n(image + static_cast<size_t>(y)*lbm.GetPitch(), checkpoint.XDim,
+            checkpoint.Image.data() + static_cast<size_t>(y)*checkpoint.XDim);
+    }
+    checkpoint.Obsts = m_impl->Obsts();
+    return checkpoint;
+}
+
+void Simulation::RestoreCheckpoint(const Checkpoint& p_checkpoint)
+{
+    CpuLbm& lbm = m_impl->Lbm();
+    if (p_checkpoint.XDim != lbm.GetXDim() || p_checkpoint.YDim != lbm.GetYDim())
+    {
+        throw std::invalid_argument("checkpoint is " + std::to_string(p_checkpoint.XDim) + " x "
+            + std::to_string(p_checkpoint.YDim) + ", simulation is " + std::to_string(lbm.GetXDim()) + " x "
+            + std::to_string(lbm.GetYDim()));
+    }
+    const size_t nodes = static_cast<size_t>(p_checkpoint.XDim)*p_checkpoint.YDim;
+    if (p_checkpoint.Image.size() != nodes || p_checkpoint.Distributions.size() != nodes*9)
+        throw std::invalid_argument("checkpoint buffers don't match its domain");
+    m_impl->SetImage(p_checkpoint.Obsts, p_checkpoint.Image);
+    lbm.SetOmega(p_checkpoint.Omega);
+    lbm.SetInletVelocity(p_checkpoint.InletVelocity);
+    lbm.SetStreamingMode(p_checkpoint.Streaming);
+    std::vector<float> f(static_cast<size_t>(lbm.GetPitch())*lbm.GetYDim()*9, 0.f);
+    p_checkpoint.GetDistributions(f.data(), lbm.GetPitch());
+    lbm.SetF(f.data());
+    lbm.SetTimeStep(p_checkpoint.Step);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Graphics/ObstDefinition.h"
+#include "Solver/Checkpoint.h"
+#include "Solver/PackedLattice.h"
+#include "common.h"
+#include <vector>
+
+#include "Export.h"
+
+namespace Shizuku { namespace Flow{
+    class SimulationImpl;
+    //! Domain, obstructions and parameters of a flow, marched by the host solver. Doesn't touch GL or CUDA, so it
+    //! runs without a display or GPU. Obstructions use the model space of the viewer: x in [-1, 1] across the domain,
+    //! y on the same scale from -1 at the bottom row.
+    class FLOW_API Simulation{
+    public:
+        Simulation(const int p_xDim, const int p_yDim);
+        //! p_threadCount workers for the solver; 0 picks one per hardware thread
+        Simulation(const int p_xDim, const int p_yDim, const int p_threadCount);
+        ~Simulation();
+
+        Simulation(const Simulation&) = delete;
+        Simulation& operator=(const Simulation&) = delete;
+
+        int GetXDim();
+        int GetYDim();
+
+        float GetInletVelocity();
+        void SetInletVelocity(const float p_velocity);
+        float GetOmega();
+        void SetOmega(const float p_omega);
+        StreamingMode GetStreamingMode();
+        void SetStreamingMode(const StreamingMode p_mode);
+        Precision GetPrecision();
+        void SetPrecision(const Precision p_precision);
+        DistributionStorage GetDistributionStorage();
+        void SetDistributionStorage(const DistributionStorage p_storage);
+        //! Tiles changing by less than p_threshold per step sleep until a neighbor changes, see
+        //! CpuLbm::SetSleepThreshold. 0, the default, keeps every tile with fluid in it running.
+        float GetSleepThreshold();
+        void SetSleepThreshold(const float p_threshold);
+        //! Tiles the solver updated in the last step, out of GetTileCount
+        int GetActiveTileCount();
+        int GetTileCount();
+
+        //! Obstructions are rasterized as square footprints of half width r1, like CudaLbm does
+        void AddObstruction(const ObstDefinition& p_obst);
+        void ClearObstructions();
+        std::vector<ObstDefinition> GetObstructions();
+
+        //! Uniform inflow at the inlet velocity; resets the time step
+        void Initialize();
+        //! With IN_PLACE streaming the solver marches in step pairs, so an odd p_steps runs one step more; compare
+        //! GetTimeStep before and after for the steps actually run
+        void Step(const int p_steps);
+        long long GetTimeStep();
+        //! Million lattice updates per second of the last Step
+        double GetMlups();
+
+        //! Density and velocity of every node, row major (x + y*xDim). Any of the pointers can be null.
+        void GetFields(float* p_rho, float* p_u, float* p_v);
+
+        //! Copy of the whole state, e.g. for CheckpointFile::Write or a CheckpointWriter. Distributions are stored as
+        //! fp32 whatever the storage.
+        Checkpoint CaptureCheckpoint();
+        //! Carries on from p_checkpoint: obstructions, image, parameters, streaming mode, distributions and time step.
+        //! Throws std::invalid_argument if it was saved from a domain of another size or its buffers don't match it.
+        void RestoreCheckpoint(const Checkpoint& p_checkpoint);
+
+    private:
+        SimulationImpl* m_impl;
+    };
+} }
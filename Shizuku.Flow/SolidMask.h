@@ -0,0 +1,32 @@
+#pragma once
+#include "cuda_runtime.h"
+
+//! One bit per lattice node, set wherever the image is not FLUID. Rows are padded to whole 64-bit words, so node
+//! (x, y) is bit x % 64 of Words[x / 64 + y*WordsPerRow] and a MarchLBM block row (BLOCKSIZEX = 64) is one word.
+struct SolidMask
+{
+    const unsigned long long* Words;
+    int WordsPerRow;
+
+    __host__ __device__ static int WordsForPitch(const int p_pitch)
+    {
+        return (p_pitch + 63) / 64;
+    }
+
+    __host__ __device__ bool IsSolid(const int p_x, const int p_y) const
+    {
+        return (Words[(p_x >> 6) + p_y*WordsPerRow] >> (p_x & 63)) & 1ull;
+    }
+
+    //! Bits of nodes p_x .. p_x + p_count - 1 of row p_y, lowest bit for p_x. p_count is at most 32.
+    __host__ __device__ unsigned int Bits(const int p_x, const int p_y, const int p_count) const
+    {
+        const unsigned long long* row = Words + p_y*WordsPerRow;
+        const int word = p_x >> 6;
+        const int bit = p_x & 63;
+        unsigned long long bits = row[word] >> bit;
+        if (bit + p_count > 64 && word + 1 < WordsPerRow)
+            bits |= row[word + 1] << (64 - bit);
+        return static_cast<unsigned int>(bits & ((1ull << p_count) - 1ull));
+    }
+};
@@ -0,0 +1,193 @@
+#include "ActiveTiles.h"
+#include "common.h"
+#include <algorithm>
+
+using namespace Shizuku::Flow;
+
+namespace
+{
+    bool IsSolid(const NodeType p_im)
+    {
+        return p_im == NodeType::OBSTRUCTION || p_im == NodeType::WALL;
+    }
+}
+
+ActiveTiles::ActiveTiles()
+{
+    m_xDim = 0;
+    m_yDim = 0;
+    m_tileSize = 1;
+    m_tilesX = 0;
+    m_tilesY = 0;
+    m_activeTileCount = 0;
+}
+
+int ActiveTiles::TileIndex(const int p_tileX, const int p_tileY) const
+{
+    return p_tileX + p_tileY*m_tilesX;
+}
+
+void ActiveTiles::Resize(const int p_xDim, const int p_yDim, const int p_tileSize)
+{
+    m_xDim = p_xDim;
+    m_yDim = p_yDim;
+    m_tileSize = p_tileSize;
+    m_tilesX = (p_xDim + p_tileSize - 1) / p_tileSize;
+    m_tilesY = (p_yDim + p_tileSize - 1) / p_tileSize;
+    m_types = std::vector<TileType>(m_tilesX*m_tilesY, TileType::FLUID);
+    m_asleep = std::vector<unsigned char>(m_tilesX*m_tilesY, 0);
+    m_rowChanges = std::vector<float>(m_tilesX*p_yDim, 0.f);
+    m_fluidRows = std::vector<unsigned char>(m_tilesX*p_yDim, 1);
+    m_spans = std::vector<std::vector<Span>>(p_yDim);
+    BuildSpans();
+}
+
+void ActiveTiles::Classify(const NodeType* p_image, const int p_pitch)
+{
+    for (int tileY = 0; tileY < m_tilesY; ++tileY)
+    {
+        for (int tileX = 0; tileX < m_tilesX; ++tileX)
+        {
+            const int xBegin = tileX*m_tileSize;
+            const int yBegin = tileY*m_tileSize;
+            const int xEnd = std::min(xBegin + m_tileSize, m_xDim);
+            const int yEnd = std::min(yBegin + m_tileSize, m_yDim);
+
+            bool allSolid = true;
+            bool anyBoundary = false;
+            //tile plus its one-node ring, clipped to the domain
+            for (int y = std::max(yBegin - 1, 0); y < std::min(yEnd + 1, m_yDim); ++y)
+            {
+                for (int x = std::max(xBegin - 1, 0); x < std::min(xEnd + 1, m_xDim); ++x)
+                {
+                    const NodeType im = p_image[x + y*p_pitch];
+                    allSolid = allSolid && IsSolid(im);
+                }
+            }
+            for (int y = yBegin; y < yEnd; ++y)
+            {
+                bool fluidRow = true;
+                for (int x = xBegin; x < xEnd; ++x)
+                    fluidRow = fluidRow && p_image[x + y*p_pitch] == NodeType::FLUID;
+                m_fluidRows[tileX + y*m_tilesX] = fluidRow ? 1 : 0;
+                anyBoundary = anyBoundary || !fluidRow;
+            }
+
+            TileType type = TileType::FLUID;
+            if (allSolid)
+                type = TileType::SOLID;
+            else if (anyBoundary)
+                type = TileType::BOUNDARY;
+            m_types[TileIndex(tileX, tileY)] = type;
+        }
+    }
+    WakeAll();
+}
+
+void ActiveTiles::WakeAll()
+{
+    std::fill(m_asleep.begin(), m_asleep.end(), 0);
+    std::fill(m_rowChanges.begin(), m_rowChanges.end(), 0.f);
+    BuildSpans();
+}
+
+float* ActiveTiles::RowChanges(const int p_y)
+{
+    return &m_rowChanges[static_cast<size_t>(p_y)*m_tilesX];
+}
+
+void ActiveTiles::UpdateSleeping(const float p_threshold)
+{
+    std::vector<unsigned char> changing(m_types.size(), 0);
+    for (int y = 0; y < m_yDim; ++y)
+    {
+        float* changes = RowChanges(y);
+        for (int tileX = 0; tileX < m_tilesX; ++tileX)
+        {
+            //NaN compares false, so a blown-up tile keeps running
+            const int tile = TileIndex(tileX, y / m_tileSize);
+            if (m_types[tile] != TileType::SOLID && !m_asleep[tile] && !(changes[tileX] < p_threshold))
+                changing[tile] = 1;
+            changes[tileX] = 0.f;
+        }
+    }
+
+    for (int tileY = 0; tileY < m_tilesY; ++tileY)
+    {
+        for (int tileX = 0; tileX < m_tilesX; ++tileX)
+        {
+            const int tile = TileIndex(tileX, tileY);
+            if (m_types[tile] == TileType::SOLID)
+                continue;
+            bool nearChange = false;
+            for (int ty = std::max(tileY - 1, 0); ty <= std::min(tileY + 1, m_tilesY - 1); ++ty)
+            {
+                for (int tx = std::max(tileX - 1, 0); tx <= std::min(tileX + 1, m_tilesX - 1); ++tx)
+                {
+                    nearChange = nearChange || changing[TileIndex(tx, ty)] != 0;
+                }
+            }
+            m_asleep[tile] = nearChange ? 0 : 1;
+        }
+    }
+    BuildSpans();
+}
+
+void ActiveTiles::BuildSpans()
+{
+    m_activeTileCount = 0;
+    for (int tile = 0; tile < static_cast<int>(m_types.size()); ++tile)
+    {
+        if (m_types[tile] != TileType::SOLID && !m_asleep[tile])
+            ++m_activeTileCount;
+    }
+    for (int y = 0; y < m_yDim; ++y)
+    {
+        std::vector<Span>& spans = m_spans[y];
+        spans.clear();
+        const int tileY = y / m_tileSize;
+        for (int tileX = 0; tileX < m_tilesX; ++tileX)
+        {
+            const int tile = TileIndex(tileX, tileY);
+            if (m_types[tile] == TileType::SOLID || m_asleep[tile])
+                continue;
+            const int xBegin = tileX*m_tileSize;
+            const int xEnd = std::min(xBegin + m_tileSize, m_xDim);
+            const bool boundary = m_fluidRows[tileX + y*m_tilesX] == 0;
+            if (!spans.empty() && spans.back().End == xBegin && spans.back().Boundary == boundary)
+                spans.back().End = xEnd;
+            else
+                spans.push_back(Span{ xBegin, xEnd, boundary });
+        }
+    }
+}
+
+const std::vector<ActiveTiles::Span>& ActiveTiles::RowSpans(const int p_y) const
+{
+    return m_spans[p_y];
+}
+
+int ActiveTiles::GetTileSize() const
+{
+    return m_tileSize;
+}
+
+int ActiveTiles::GetTileCount() const
+{
+    return m_tilesX*m_tilesY;
+}
+
+int ActiveTiles::GetActiveTileCount() const
+{
+    return m_activeTileCount;
+}
+
+ActiveTiles::TileType ActiveTiles::GetTileType(const int p_tileX, const int p_tileY) const
+{
+    return m_types[TileIndex(p_tileX, p_tileY)];
+}
+
+bool ActiveTiles::IsAsleep(const int p_tileX, const int p_tileY) const
+{
+    return m_asleep[TileIndex(p_tileX, p_tileY)] != 0;
+}
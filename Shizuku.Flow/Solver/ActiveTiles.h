@@ -0,0 +1,62 @@
+#pragma once
+#include "common.h"
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    //! Square tiles over a node image (same codes as CudaLbm::ImageFcn), used by CpuLbm to skip work.
+    //! A tile is SOLID when it and the one-node ring around it are all bounce-back nodes: nothing outside the tile
+    //! but other solid nodes ever reads its distributions, so it can be left out of the update entirely.
+    //! Non-solid tiles can additionally be put to sleep once their distributions stop changing.
+    class ActiveTiles
+    {
+    public:
+        enum TileType{FLUID,BOUNDARY,SOLID};
+
+        //! Node columns [Begin, End) of consecutive active tiles in a node row. Without Boundary every node in the span
+        //! is FLUID and needs no boundary checks.
+        struct Span
+        {
+            int Begin;
+            int End;
+            bool Boundary;
+        };
+    private:
+        int m_xDim;
+        int m_yDim;
+        int m_tileSize;
+        int m_tilesX;
+        int m_tilesY;
+        std::vector<TileType> m_types;
+        std::vector<unsigned char> m_asleep;
+        //! Largest change of each tile column in each node row during the current step, see RowChanges
+        std::vector<float> m_rowChanges;
+        std::vector<unsigned char> m_fluidRows;
+        std::vector<std::vector<Span>> m_spans;
+        int m_activeTileCount;
+
+        int TileIndex(const int p_tileX, const int p_tileY) const;
+        void BuildSpans();
+    public:
+        ActiveTiles();
+
+        void Resize(const int p_xDim, const int p_yDim, const int p_tileSize);
+        //! Rebuilds the tile types from the image and wakes every tile
+        void Classify(const NodeType* p_image, const int p_pitch);
+        void WakeAll();
+        //! One value per tile column for node row p_y, which the solver raises to the largest change of the
+        //! distributions it writes in that row. Each row must be written by one thread only.
+        float* RowChanges(const int p_y);
+        //! Tiles whose largest recorded change is below p_threshold fall asleep, unless a neighboring tile is still
+        //! changing. Sleeping tiles next to a changing tile wake up. The recorded changes are reset for the next step.
+        void UpdateSleeping(const float p_threshold);
+
+        //! Spans to update in node row p_y
+        const std::vector<Span>& RowSpans(const int p_y) const;
+
+        int GetTileSize() const;
+        int GetTileCount() const;
+        int GetActiveTileCount() const;
+        TileType GetTileType(const int p_tileX, const int p_tileY) const;
+        bool IsAsleep(const int p_tileX, const int p_tileY) const;
+    };
+} }
@@ -0,0 +1,190 @@
+#include "Checkpoint.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+using namespace Shizuku::Flow;
+
+namespace
+{
+    const char Magic[8] = { 'S', 'H', 'Z', 'K', 'C', 'K', 'P', 'T' };
+
+    //! Fixed part at the start of the file. Fields are written in the native byte order and float format of the
+    //! machine, like everything after it, so checkpoints only move between machines of the same kind. The payload
+    //! follows in order: distributions (float), image (byte) and obstructions (ObstRecord).
+    struct Header
+    {
+        char Magic[8];
+        std::uint32_t Version;
+        std::uint32_t HeaderSize;
+        std::int32_t XDim;
+        std::int32_t YDim;
+        std::int32_t Streaming;
+        float Omega;
+        float InletVelocity;
+        std::int32_t ObstCount;
+        std::int64_t Step;
+    };
+    static_assert(sizeof(Header) == 48, "Checkpoint header layout changed");
+    static_assert(sizeof(NodeType) == 1, "Checkpoints store one byte per node of the image");
+
+    struct ObstRecord
+    {
+        std::int32_t Shape;
+        float X;
+        float Y;
+        float R1;
+        float R2;
+        float U;
+        float V;
+        std::int32_t State;
+    };
+    static_assert(sizeof(ObstRecord) == 32, "Checkpoint obstruction layout changed");
+
+    size_t NodeCount(const int p_xDim, const int p_yDim)
+    {
+        return static_cast<size_t>(p_xDim)*p_yDim;
+    }
+
+    size_t FileSize(const Header& p_header)
+    {
+        const size_t nodes = NodeCount(p_header.XDim, p_header.YDim);
+        return sizeof(Header) + nodes*9*sizeof(float) + nodes + p_header.ObstCount*sizeof(ObstRecord);
+    }
+}
+
+Checkpoint::Checkpoint()
+    : XDim(0), YDim(0), Streaming(StreamingMode::PING_PONG), Omega(0.f), InletVelocity(0.f), Step(0)
+{
+}
+
+void Checkpoint::SetDistributions(const float* p_f, const int p_pitch)
+{
+    const size_t planeSize = static_cast<size_t>(p_pitch)*YDim;
+    Distributions.resize(NodeCount(XDim, YDim)*9);
+    for (int i = 0; i < 9; i++)
+    {
+        for (int y = 0; y < YDim; y++)
+        {
+            std::memcpy(&Distributions[XDim*(y + static_cast<size_t>(i)*YDim)], p_f + i*planeSize + y*p_pitch,
+                XDim*sizeof(float));
+        }
+    }
+}
+
+void Checkpoint::GetDistributions(float* p_f, const int p_pitch) const
+{
+    const size_t planeSize = static_cast<size_t>(p_pitch)*YDim;
+    for (int i = 0; i < 9; i++)
+    {
+        for (int y = 0; y < YDim; y++)
+        {
+            std::memcpy(p_f + i*planeSize + y*p_pitch, &Distributions[XDim*(y + static_cast<size_t>(i)*YDim)],
+                XDim*sizeof(float));
+        }
+    }
+}
+
+void CheckpointFile::Write(const std::string& p_path, const Checkpoint& p_checkpoint)
+{
+    const size_t nodes = NodeCount(p_checkpoint.XDim, p_checkpoint.YDim);
+    if (p_checkpoint.Distributions.size() != nodes*9 || p_checkpoint.Image.size() != nodes)
+        throw std::runtime_error("checkpoint buffers don't match its domain");
+
+    Header header;
+    std::memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = Version;
+    header.HeaderSize = sizeof(Header);
+    header.XDim = p_checkpoint.XDim;
+    header.YDim = p_checkpoint.YDim;
+    header.Streaming = p_checkpoint.Streaming;
+    header.Omega = p_checkpoint.Omega;
+    header.InletVelocity = p_checkpoint.InletVelocity;
+    header.ObstCount = static_cast<std::int32_t>(p_checkpoint.Obsts.size());
+    header.Step = p_checkpoint.Step;
+
+    std::vector<ObstRecord> obsts;
+    for (const ObstDefinition& obst : p_checkpoint.Obsts)
+        obsts.push_back(ObstRecord{ obst.shape, obst.x, obst.y, obst.r1, obst.r2, obst.u, obst.v, obst.state });
+
+    const std::string tempPath = p_path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            throw std::runtime_error("cannot create " + tempPath);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(p_checkpoint.Distributions.data()), nodes*9*sizeof(float));
+        file.write(reinterpret_cast<const char*>(p_checkpoint.Image.data()), nodes);
+        file.write(reinterpret_cast<const char*>(obsts.data()), obsts.size()*sizeof(ObstRecord));
+        file.close();
+        if (!file)
+            throw std::runtime_error("cannot write " + tempPath);
+    }
+    //replace the old checkpoint in one step, so a crash leaves either the old or the new one
+#ifdef _WIN32
+    if (!MoveFileExA(tempPath.c_str(), p_path.c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+    if (std::rename(tempPath.c_str(), p_path.c_str()) != 0)
+#endif
+        throw std::runtime_error("cannot rename " + tempPath + " to " + p_path);
+}
+
+Checkpoint CheckpointFile::Read(const std::string& p_path)
+{
+    std::ifstream file(p_path, std::ios::binary | std::ios::ate);
+    if (!file)
+        throw std::runtime_error("cannot open " + p_path);
+    const std::streamoff size = file.tellg();
+    std::vector<char> data(static_cast<size_t>(size));
+    file.seekg(0);
+    if (!file.read(data.data(), size))
+        throw std::runtime_error("cannot read " + p_path);
+
+    Header header;
+    if (data.size() < sizeof(Header))
+        throw std::runtime_error(p_path + " is not a checkpoint");
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0)
+        throw std::runtime_error(p_path + " is not a checkpoint");
+    if (header.Version != Version || header.HeaderSize != sizeof(Header))
+        throw std::runtime_error(p_path + " is a version " + std::to_string(header.Version)
+            + " checkpoint, expected version " + std::to_string(Version));
+    if (header.XDim <= 0 || header.YDim <= 0 || header.ObstCount < 0 || data.size() != FileSize(header))
+        throw std::runtime_error(p_path + " is truncated or corrupt");
+
+    Checkpoint checkpoint;
+    checkpoint.XDim = header.XDim;
+    checkpoint.YDim = header.YDim;
+    checkpoint.Streaming = header.Streaming == StreamingMode::IN_PLACE ? StreamingMode::IN_PLACE
+        : StreamingMode::PING_PONG;
+    checkpoint.Omega = header.Omega;
+    checkpoint.InletVelocity = header.InletVelocity;
+    checkpoint.Step = header.Step;
+
+    const size_t nodes = NodeCount(header.XDim, header.YDim);
+    const char* payload = data.data() + sizeof(Header);
+    checkpoint.Distributions.resize(nodes*9);
+    std::memcpy(checkpoint.Distributions.data(), payload, nodes*9*sizeof(float));
+    payload += nodes*9*sizeof(float);
+    checkpoint.Image.resize(nodes);
+    std::memcpy(checkpoint.Image.data(), payload, nodes*sizeof(NodeType));
+    payload += nodes;
+    for (int i = 0; i < header.ObstCount; i++)
+    {
+        ObstRecord record;
+        std::memcpy(&record, payload + i*sizeof(ObstRecord), sizeof(ObstRecord));
+        ObstDefinition obst = { record.Shape, record.X, record.Y, record.R1, record.R2, record.U, record.V,
+            record.State };
+        checkpoint.Obsts.push_back(obst);
+    }
+    return checkpoint;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "../Graphics/ObstDefinition.h"
+#include "../common.h"
+#include <string>
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    //! Complete state of a flow, enough to carry on marching where it was saved. Written by the viewer (CudaLbm)
+    //! and the headless Simulation alike, so the lattice is stored without row padding.
+    struct Checkpoint
+    {
+        int XDim;
+        int YDim;
+        StreamingMode Streaming;
+        float Omega;
+        float InletVelocity;
+        //! Time steps since the flow was initialized
+        long long Step;
+        //! 9 planes of XDim x YDim nodes. Directions are in the slots of the streaming mode, i.e. opposite slots in
+        //! IN_PLACE mode (see CpuLbm::GetF).
+        std::vector<float> Distributions;
+        //! NodeType of each node, XDim x YDim
+        std::vector<NodeType> Image;
+        std::vector<ObstDefinition> Obsts;
+
+        Checkpoint();
+
+        //! Copies between the padded lattice and image layouts of the solvers (p_pitch per row) and the checkpoint
+        void SetDistributions(const float* p_f, const int p_pitch);
+        void GetDistributions(float* p_f, const int p_pitch) const;
+    };
+
+    namespace CheckpointFile{
+        //! Bumped on any change to the layout; Read rejects other versions
+        const unsigned int Version = 1;
+
+        //! Writes to p_path + ".tmp" and renames it over p_path once complete, so a crash mid-write leaves the
+        //! previous checkpoint intact. Throws std::runtime_error if the file can't be written.
+        void Write(const std::string& p_path, const Checkpoint& p_checkpoint);
+        //! Reads the whole file with one bulk read and validates it before unpacking. Throws std::runtime_error if
+        //! the file can't be read or isn't a checkpoint of this version.
+        Checkpoint Read(const std::string& p_path);
+    }
+} }
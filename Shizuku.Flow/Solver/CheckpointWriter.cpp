@@ -0,0 +1,88 @@
+#include "CheckpointWriter.h"
+#include <stdexcept>
+
+using namespace Shizuku::Flow;
+
+CheckpointWriter::CheckpointWriter()
+    : m_writing(false), m_stop(false), m_written(0)
+{
+    m_thread = std::thread(&CheckpointWriter::Run, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_queueChanged.notify_all();
+    m_thread.join();
+}
+
+void CheckpointWriter::Write(const std::string& p_path, Checkpoint&& p_checkpoint)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.emplace_back(p_path, std::move(p_checkpoint));
+    }
+    m_queueChanged.notify_all();
+}
+
+bool CheckpointWriter::IsBusy()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_writing || !m_queue.empty();
+}
+
+bool CheckpointWriter::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queueChanged.wait(lock, [&]{ return !m_writing && m_queue.empty(); });
+    return m_lastError.empty();
+}
+
+std::string CheckpointWriter::GetLastError()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+int CheckpointWriter::GetWrittenCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+}
+
+void CheckpointWriter::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        //the queue is drained before stopping
+        m_queueChanged.wait(lock, [&]{ return m_stop || !m_queue.empty(); });
+        if (m_queue.empty())
+            return;
+
+        std::pair<std::string, Checkpoint> item = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_writing = true;
+        m_lastError.clear();
+        lock.unlock();
+        std::string error;
+        try
+        {
+            CheckpointFile::Write(item.first, item.second);
+        }
+        catch (const std::runtime_error& e)
+        {
+            error = e.what();
+        }
+        lock.lock();
+        m_writing = false;
+        if (error.empty())
+            m_written++;
+        else
+            m_lastError = error;
+        m_queueChanged.notify_all();
+    }
+}
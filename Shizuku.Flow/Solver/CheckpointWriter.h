@@ -0,0 +1,44 @@
+#pragma once
+#include "Checkpoint.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace Shizuku { namespace Flow{
+    //! Writes checkpoints on a thread of its own, so the solver only pays for the staging copy. Writes happen in the
+    //! order queued; the destructor finishes the queued ones.
+    class CheckpointWriter
+    {
+    private:
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_queueChanged;
+        std::deque<std::pair<std::string, Checkpoint>> m_queue;
+        bool m_writing;
+        bool m_stop;
+        std::string m_lastError;
+        int m_written;
+
+        void Run();
+    public:
+        CheckpointWriter();
+        ~CheckpointWriter();
+
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+        //! Takes over p_checkpoint, the staging copy
+        void Write(const std::string& p_path, Checkpoint&& p_checkpoint);
+        bool IsBusy();
+        //! Blocks until the queue is empty. Returns false if the last write failed, see GetLastError.
+        bool Wait();
+        //! Error of the last write, empty if it succeeded. Compare GetWrittenCount with the writes queued to catch
+        //! earlier failures.
+        std::string GetLastError();
+        //! Checkpoints completed so far
+        int GetWrittenCount();
+    };
+} }
@@ -0,0 +1,1028 @@
+#include "CpuLbm.h"
+#include "LbmNode.h"
+#include "SimdCollide.h"
+#include "PackedLattice.h"
+#include "common.h"
+#include "Shizuku.Core/Utilities/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Shizuku::Core;
+using namespace Shizuku::Flow;
+
+namespace
+{
+    const int c_x[9] = { 0, 1, 0, -1, 0, 1, -1, -1, 1 };
+    const int c_y[9] = { 0, 0, 1, 0, -1, 1, 1, -1, -1 };
+    const int opposite[9] = { 0, 3, 4, 1, 2, 7, 8, 5, 6 };
+
+    //! Rows are padded to a multiple of 16 elements, whole SIMD vectors of every storage type. The lattices are
+    //! plain vectors, so rows aren't necessarily aligned to cache lines or vectors.
+    int PitchFromXDim(const int p_xDim)
+    {
+        const int alignment = 16;
+        return (p_xDim + alignment - 1) / alignment*alignment;
+    }
+
+    //! Max that keeps a NaN, so a blown-up tile never looks steady
+    template <typename Real>
+    Real MaxKeepingNaN(const Real p_max, const Real p_value)
+    {
+        return p_max != p_max || p_value <= p_max ? p_max : p_value;
+    }
+}
+
+CpuLbm::CpuLbm(const int p_xDim, const int p_yDim)
+    : CpuLbm(p_xDim, p_yDim, std::make_shared<ThreadPool>())
+{
+}
+
+CpuLbm::CpuLbm(const int p_xDim, const int p_yDim, std::shared_ptr<ThreadPool> p_threadPool)
+    : m_stopwatch(1)
+{
+    m_xDim = p_xDim;
+    m_yDim = p_yDim;
+    m_pitch = PitchFromXDim(p_xDim);
+    m_inletVelocity = INITIAL_UMAX;
+    m_omega = 1.975f;
+    m_timeStepsPerFrame = 15;
+    m_timeStep = 0;
+    m_threadPool = p_threadPool;
+    m_mlups = 0.0;
+    m_useSimd = true;
+    m_streamingMode = StreamingMode::PING_PONG;
+    m_stepsPerTile = 4;
+    m_tileHeight = 32;
+    m_sleepThreshold = 0.f;
+    m_precision = Precision::FP32;
+    m_storage = DistributionStorage::FULL;
+    m_imageChanged = true;
+    m_activeTiles.Resize(m_xDim, m_yDim, 32);
+
+    const size_t latticeSize = static_cast<size_t>(m_pitch)*m_yDim * 9;
+    m_fA = std::vector<float>(latticeSize, 0.f);
+    m_fB = std::vector<float>(latticeSize, 0.f);
+    m_image = std::vector<NodeType>(static_cast<size_t>(m_pitch)*m_yDim, NodeType::FLUID);
+    ResizeScratch();
+    InitializeImage();
+}
+
+void CpuLbm::ResizeScratch()
+{
+    m_scratch.resize(m_threadPool->ThreadCount());
+    const bool useDouble = m_precision == Precision::FP64;
+    const size_t rowsSize = static_cast<size_t>(m_pitch) * 18;
+    const size_t tileSize = m_stepsPerTile > 1
+        ? static_cast<size_t>(m_pitch)*(m_tileHeight + 2 * m_stepsPerTile) * 9 : 0;
+    for (WorkerScratch& scratch : m_scratch)
+    {
+        scratch.Rows.resize(useDouble ? 0 : rowsSize);
+        scratch.Rows.shrink_to_fit();
+        scratch.DoubleRows.resize(useDouble ? rowsSize : 0);
+        scratch.DoubleRows.shrink_to_fit();
+        for (int i = 0; i < 2; ++i)
+        {
+            scratch.Tile[i].resize(useDouble ? 0 : tileSize);
+            scratch.Tile[i].shrink_to_fit();
+            scratch.DoubleTile[i].resize(useDouble ? tileSize : 0);
+            scratch.DoubleTile[i].shrink_to_fit();
+        }
+    }
+}
+
+template <>
+float* CpuLbm::ScratchRows<float>(const int p_worker)
+{
+    return m_scratch[p_worker].Rows.data();
+}
+
+template <>
+double* CpuLbm::ScratchRows<double>(const int p_worker)
+{
+    return m_scratch[p_worker].DoubleRows.data();
+}
+
+template <>
+float* CpuLbm::TileScratch<float>(const int p_worker, const int p_index)
+{
+    return m_scratch[p_worker].Tile[p_index].data();
+}
+
+template <>
+double* CpuLbm::TileScratch<double>(const int p_worker, const int p_index)
+{
+    return m_scratch[p_worker].DoubleTile[p_index].data();
+}
+
+int CpuLbm::GetXDim()
+{
+    return m_xDim;
+}
+
+int CpuLbm::GetYDim()
+{
+    return m_yDim;
+}
+
+int CpuLbm::GetPitch()
+{
+    return m_pitch;
+}
+
+float CpuLbm::GetInletVelocity()
+{
+    return m_inletVelocity;
+}
+
+float CpuLbm::GetOmega()
+{
+    return m_omega;
+}
+
+void CpuLbm::SetInletVelocity(const float p_velocity)
+{
+    m_inletVelocity = p_velocity;
+    m_activeTiles.WakeAll();
+}
+
+void CpuLbm::SetOmega(const float p_omega)
+{
+    m_omega = p_omega;
+    m_activeTiles.WakeAll();
+}
+
+int CpuLbm::GetTimeStepsPerFrame()
+{
+    return m_timeStepsPerFrame;
+}
+
+void CpuLbm::SetTimeStepsPerFrame(const int p_timeSteps)
+{
+    m_timeStepsPerFrame = p_timeSteps;
+}
+
+long long CpuLbm::GetTimeStep()
+{
+    return m_timeStep;
+}
+
+void CpuLbm::SetTimeStep(const long long p_timeStep)
+{
+    m_timeStep = p_timeStep;
+}
+
+int CpuLbm::GetThreadCount()
+{
+    return m_threadPool->ThreadCount();
+}
+
+void CpuLbm::UseSimd(const bool p_useSimd)
+{
+    m_useSimd = p_useSimd;
+}
+
+bool CpuLbm::IsUsingSimd()
+{
+    return m_useSimd;
+}
+
+void CpuLbm::SetTemporalBlocking(const int p_steps, const int p_rows)
+{
+    m_stepsPerTile = std::max(p_steps, 1);
+    m_tileHeight = std::max(p_rows, 1);
+    ResizeScratch();
+    m_activeTiles.WakeAll();
+}
+
+int CpuLbm::GetStepsPerTile()
+{
+    return m_stepsPerTile;
+}
+
+int CpuLbm::GetTileHeight()
+{
+    return m_tileHeight;
+}
+
+void CpuLbm::SetStreamingMode(const StreamingMode p_mode)
+{
+    if (p_mode == m_streamingMode)
+        return;
+    if (IsFloatLattice())
+        SwitchStreamingMode(m_fA, m_fB, p_mode);
+    else if (IsDoubleLattice())
+        SwitchStreamingMode(m_doubleA, m_doubleB, p_mode);
+    else
+        SwitchStreamingMode(m_packedA, m_packedB, p_mode);
+    m_streamingMode = p_mode;
+    m_activeTiles.WakeAll();
+}
+
+template <typename T>
+void CpuLbm::SwitchStreamingMode(std::vector<T>& p_fA, std::vector<T>& p_fB, const StreamingMode p_mode)
+{
+    SwapOppositePlanes(p_fA);
+    if (p_mode == StreamingMode::IN_PLACE)
+        std::vector<T>().swap(p_fB);
+    else
+        p_fB = p_fA;
+}
+
+StreamingMode CpuLbm::GetStreamingMode()
+{
+    return m_streamingMode;
+}
+
+//! Opposite directions share their weight, so packed planes can be swapped as they are
+template <typename T>
+void CpuLbm::SwapOppositePlanes(std::vector<T>& p_f)
+{
+    const size_t planeSize = static_cast<size_t>(m_pitch)*m_yDim;
+    for (int i = 1; i < 9; ++i)
+    {
+        if (opposite[i] > i)
+            std::swap_ranges(p_f.begin() + i*planeSize, p_f.begin() + (i + 1)*planeSize,
+                p_f.begin() + opposite[i]*planeSize);
+    }
+}
+
+bool CpuLbm::IsFloatLattice()
+{
+    return m_storage == DistributionStorage::FULL && m_precision == Precision::FP32;
+}
+
+bool CpuLbm::IsDoubleLattice()
+{
+    return m_storage == DistributionStorage::FULL && m_precision == Precision::FP64;
+}
+
+//! Converts through fp32 lattices. Only a double lattice holds more than fp32 does, and it is only left for a format
+//! that holds less.
+void CpuLbm::SetLatticeFormat(const Precision p_precision, const DistributionStorage p_storage)
+{
+    if (p_precision == m_precision && p_storage == m_storage)
+        return;
+    const bool pingPong = m_streamingMode == StreamingMode::PING_PONG;
+    if (IsDoubleLattice())
+    {
+        m_fA.assign(m_doubleA.begin(), m_doubleA.end());
+        m_fB.assign(m_doubleB.begin(), m_doubleB.end());
+        std::vector<double>().swap(m_doubleA);
+        std::vector<double>().swap(m_doubleB);
+    }
+    else if (!IsFloatLattice())
+    {
+        UnpackLattice(m_packedA, m_fA);
+        if (pingPong)
+            UnpackLattice(m_packedB, m_fB);
+        std::vector<std::uint16_t>().swap(m_packedA);
+        std::vector<std::uint16_t>().swap(m_packedB);
+    }
+    m_precision = p_precision;
+    m_storage = p_storage;
+    if (IsDoubleLattice())
+    {
+        m_doubleA.assign(m_fA.begin(), m_fA.end());
+        m_doubleB.assign(m_fB.begin(), m_fB.end());
+    }
+    else if (!IsFloatLattice())
+    {
+        PackLattice(m_fA, m_packedA);
+        if (pingPong)
+            PackLattice(m_fB, m_packedB);
+    }
+    if (!IsFloatLattice())
+    {
+        std::vector<float>().swap(m_fA);
+        std::vector<float>().swap(m_fB);
+    }
+    ResizeScratch();
+    m_activeTiles.WakeAll();
+}
+
+void CpuLbm::SetPrecision(const Precision p_precision)
+{
+    SetLatticeFormat(p_precision, m_storage);
+}
+
+Precision CpuLbm::GetPrecision()
+{
+    return m_precision;
+}
+
+void CpuLbm::SetDistributionStorage(const DistributionStorage p_storage)
+{
+    SetLatticeFormat(m_precision, p_storage);
+}
+
+DistributionStorage CpuLbm::GetDistributionStorage()
+{
+    return m_storage;
+}
+
+void CpuLbm::PackLattice(const std::vector<float>& p_f, std::vector<std::uint16_t>& p_packed)
+{
+    const size_t planeSize = static_cast<size_t>(m_pitch)*m_yDim;
+    p_packed.resize(planeSize * 9);
+    for (int i = 0; i < 9; ++i)
+        Packed::Pack(m_storage, i, &p_f[i*planeSize], &p_packed[i*planeSize], static_cast<int>(planeSize));
+}
+
+void CpuLbm::UnpackLattice(const std::vector<std::uint16_t>& p_packed, std::vector<float>& p_f)
+{
+    const size_t planeSize = static_cast<size_t>(m_pitch)*m_yDim;
+    p_f.resize(planeSize * 9);
+    for (int i = 0; i < 9; ++i)
+        Packed::Unpack(m_storage, i, &p_packed[i*planeSize], &p_f[i*planeSize], static_cast<int>(planeSize));
+}
+
+const float* CpuLbm::GetF()
+{
+    if (IsFloatLattice())
+        return m_fA.data();
+    if (IsDoubleLattice())
+        m_fHost.assign(m_doubleA.begin(), m_doubleA.end());
+    else
+        UnpackLattice(m_packedA, m_fHost);
+    return m_fHost.data();
+}
+
+void CpuLbm::SetF(const float* p_f)
+{
+    const size_t latticeSize = static_cast<size_t>(m_pitch)*m_yDim * 9;
+    const bool pingPong = m_streamingMode == StreamingMode::PING_PONG;
+    if (IsFloatLattice())
+    {
+        m_fA.assign(p_f, p_f + latticeSize);
+        if (pingPong)
+            m_fB = m_fA;
+    }
+    else if (IsDoubleLattice())
+    {
+        m_doubleA.assign(p_f, p_f + latticeSize);
+        if (pingPong)
+            m_doubleB = m_doubleA;
+    }
+    else
+    {
+        m_fHost.assign(p_f, p_f + latticeSize);
+        PackLattice(m_fHost, m_packedA);
+        if (pingPong)
+            m_packedB = m_packedA;
+    }
+    m_activeTiles.WakeAll();
+}
+
+const NodeType* CpuLbm::GetImage()
+{
+    return m_image.data();
+}
+
+void CpuLbm::SetSleepThreshold(const float p_threshold)
+{
+    m_sleepThreshold = p_threshold;
+    m_activeTiles.WakeAll();
+}
+
+float CpuLbm::GetSleepThreshold()
+{
+    return m_sleepThreshold;
+}
+
+bool CpuLbm::IsSleepEnabled()
+{
+    return m_sleepThreshold > 0.f && m_streamingMode == StreamingMode::PING_PONG;
+}
+
+int CpuLbm::GetTileCount()
+{
+    return m_activeTiles.GetTileCount();
+}
+
+int CpuLbm::GetActiveTileCount()
+{
+    if (m_imageChanged)
+    {
+        m_activeTiles.Classify(m_image.data(), m_pitch);
+        m_imageChanged = false;
+    }
+    return m_activeTiles.GetActiveTileCount();
+}
+
+//! Same boundary codes as CudaLbm::ImageFcn
+NodeType CpuLbm::ImageFcn(const int p_x, const int p_y)
+{
+    if (p_x < 0.1f)
+        return NodeType::DIRICHLET_WEST;
+    else if ((m_xDim - p_x) < 1.1f)
+        return NodeType::NEUMANN_EAST;
+    else if ((m_yDim - p_y) < 1.1f)
+        return NodeType::SYMMETRY_TOP;
+    else if (p_y < 0.1f)
+        return NodeType::SYMMETRY_BOTTOM;
+    return NodeType::FLUID;
+}
+
+void CpuLbm::InitializeImage()
+{
+    for (int y = 0; y < m_yDim; ++y)
+    {
+        for (int x = 0; x < m_xDim; ++x)
+        {
+            m_image[x + y*m_pitch] = ImageFcn(x, y);
+        }
+    }
+    m_imageChanged = true;
+}
+
+void CpuLbm::SetNodeType(const int p_x, const int p_y, const NodeType p_type)
+{
+    m_image[p_x + p_y*m_pitch] = p_type;
+    m_imageChanged = true;
+}
+
+template <typename Real>
+void CpuLbm::InitializeLattice(std::vector<Real>& p_f)
+{
+    p_f.assign(static_cast<size_t>(m_pitch)*m_yDim * 9, Real(0));
+    LbmNodeT<Real> lbm(m_xDim, m_yDim, m_pitch);
+    lbm.Initialize(Real(1), m_inletVelocity, Real(0));
+    for (int y = 0; y < m_yDim; ++y)
+    {
+        for (int x = 0; x < m_xDim; ++x)
+        {
+            if (m_streamingMode == StreamingMode::IN_PLACE)
+                lbm.WriteOppositeDistributions(p_f.data(), x, y);
+            else
+                lbm.WriteDistributions(p_f.data(), x, y);
+        }
+    }
+}
+
+void CpuLbm::Initialize()
+{
+    const bool pingPong = m_streamingMode == StreamingMode::PING_PONG;
+    if (IsFloatLattice())
+    {
+        InitializeLattice(m_fA);
+        if (pingPong)
+            m_fB = m_fA;
+    }
+    else if (IsDoubleLattice())
+    {
+        InitializeLattice(m_doubleA);
+        if (pingPong)
+            m_doubleB = m_doubleA;
+    }
+    else
+    {
+        InitializeLattice(m_fHost);
+        PackLattice(m_fHost, m_packedA);
+        if (pingPong)
+            m_packedB = m_packedA;
+    }
+    m_timeStep = 0;
+    m_activeTiles.WakeAll();
+}
+
+template <typename Real>
+void CpuLbm::LoadRun(const Real* p_source, Real* p_row, const int p_count, const int /*p_direction*/)
+{
+    std::memcpy(p_row, p_source, p_count*sizeof(Real));
+}
+
+void CpuLbm::LoadRun(const std::uint16_t* p_source, float* p_row, const int p_count, const int p_direction)
+{
+    Packed::Unpack(m_storage, p_direction, p_source, p_row, p_count);
+}
+
+//! FP64 on a packed lattice. Every 16-bit value is exact in fp32, so widening after unpacking loses nothing.
+void CpuLbm::LoadRun(const std::uint16_t* p_source, double* p_row, const int p_count, const int p_direction)
+{
+    float values[64];
+    for (int done = 0; done < p_count; done += 64)
+    {
+        const int count = std::min(64, p_count - done);
+        Packed::Unpack(m_storage, p_direction, p_source + done, values, count);
+        std::copy(values, values + count, p_row + done);
+    }
+}
+
+template <typename Real>
+void CpuLbm::StoreRun(Real* p_target, const Real* p_row, const int p_count, const int /*p_direction*/)
+{
+    if (p_target != p_row)
+        std::memcpy(p_target, p_row, p_count*sizeof(Real));
+}
+
+void CpuLbm::StoreRun(std::uint16_t* p_target, const float* p_row, const int p_count, const int p_direction)
+{
+    Packed::Pack(m_storage, p_direction, p_row, p_target, p_count);
+}
+
+//! Rounds to fp32 first, so a value can round twice on its way to 16 bits
+void CpuLbm::StoreRun(std::uint16_t* p_target, const double* p_row, const int p_count, const int p_direction)
+{
+    float values[64];
+    for (int done = 0; done < p_count; done += 64)
+    {
+        const int count = std::min(64, p_count - done);
+        std::copy(p_row + done, p_row + done + count, values);
+        Packed::Pack(m_storage, p_direction, values, p_target + done, count);
+    }
+}
+
+//! Unpacked lattices take the collision results directly; packed ones get them through p_buffer and StoreRun
+template <typename Real>
+Real* CpuLbm::OutputRow(Real* p_f, const size_t p_offset, Real* /*p_buffer*/)
+{
+    return p_f + p_offset;
+}
+
+template <typename Real>
+Real* CpuLbm::OutputRow(std::uint16_t* /*p_f*/, const size_t /*p_offset*/, Real* p_buffer)
+{
+    return p_buffer;
+}
+
+//! Largest difference between p_count collided values and the same node's values one step earlier in p_previous
+template <typename Real, typename T>
+Real CpuLbm::MaxChange(const T* p_previous, const Real* p_row, const int p_count, const int p_direction)
+{
+    Real previous[64];
+    Real maxChange = 0;
+    for (int done = 0; done < p_count; done += 64)
+    {
+        const int count = std::min(64, p_count - done);
+        LoadRun(p_previous + done, previous, count, p_direction);
+        for (int x = 0; x < count; ++x)
+            maxChange = MaxKeepingNaN(maxChange, std::abs(p_row[done + x] - previous[x]));
+    }
+    return maxChange;
+}
+
+//! Raises the tile changes of row p_y (ActiveTiles::RowChanges) to the largest change of the nodes of p_span.
+//! p_previous is row p_y of the step before, p_planeSize values per direction.
+template <typename Real, typename T>
+void CpuLbm::RecordChanges(const T* p_previous, const size_t p_planeSize, Real* const p_rowOut[9], const int p_y,
+    const ActiveTiles::Span& p_span)
+{
+    float* changes = m_activeTiles.RowChanges(p_y);
+    const int tileSize = m_activeTiles.GetTileSize();
+    for (int begin = p_span.Begin; begin < p_span.End;)
+    {
+        const int end = std::min((begin / tileSize + 1)*tileSize, p_span.End);
+        Real maxChange = 0;
+        for (int i = 0; i < 9; ++i)
+            maxChange = MaxKeepingNaN(maxChange, MaxChange(p_previous + i*p_planeSize + begin, p_rowOut[i] + begin,
+                end - begin, i));
+        float& change = changes[begin / tileSize];
+        change = MaxKeepingNaN(change, static_cast<float>(maxChange));
+        begin = end;
+    }
+}
+
+//! Pull-streams nodes [p_xBegin, p_xEnd) of row p_y into one contiguous buffer per direction, with the same edge
+//! handling as LbmNode::ReadIncomingDistributions: x is clamped, links from outside in y read 0. p_fIn holds the
+//! rows from p_yOrigin on, p_planeSize values per direction.
+template <typename T, typename Real>
+void CpuLbm::StreamRow(const T* p_fIn, const size_t p_planeSize, const int p_yOrigin, Real* const p_row[9],
+    const int p_y, const int p_xBegin, const int p_xEnd)
+{
+    const int last = m_xDim - 1;
+    for (int i = 0; i < 9; ++i)
+    {
+        const int ySource = p_y - c_y[i];
+        if (ySource < 0 || ySource >= m_yDim)
+        {
+            std::fill(p_row[i] + p_xBegin, p_row[i] + p_xEnd, Real(0));
+            continue;
+        }
+        const T* source = p_fIn + i*p_planeSize + static_cast<size_t>(ySource - p_yOrigin)*m_pitch;
+        Real* row = p_row[i];
+        const int shift = -c_x[i];
+        int xBegin = p_xBegin;
+        int xEnd = p_xEnd;
+        if (xBegin + shift < 0)
+        {
+            LoadRun(source, row + xBegin, 1, i);
+            ++xBegin;
+        }
+        if (xEnd - 1 + shift > last)
+        {
+            LoadRun(source + last, row + xEnd - 1, 1, i);
+            --xEnd;
+        }
+        if (xEnd > xBegin)
+            LoadRun(source + xBegin + shift, row + xBegin, xEnd - xBegin, i);
+    }
+}
+
+//! Copies between a row buffer and plane p_plane of the lattice, where node x of row p_y maps to lattice node
+//! (x + p_dx, p_y + p_dy), for nodes [p_xBegin, p_xEnd). Lattice nodes outside the domain are skipped and read as 0.
+template <typename T, typename Real>
+void CpuLbm::CopyLinkRow(T* p_f, Real* p_row, const int p_plane, const int p_y, const int p_dx, const int p_dy,
+    const bool p_toLattice, const int p_xBegin, const int p_xEnd)
+{
+    const int yLattice = p_y + p_dy;
+    if (yLattice < 0 || yLattice >= m_yDim)
+    {
+        if (!p_toLattice)
+            std::fill(p_row + p_xBegin, p_row + p_xEnd, Real(0));
+        return;
+    }
+    T* lattice = p_f + static_cast<size_t>(p_plane)*m_pitch*m_yDim + static_cast<size_t>(yLattice)*m_pitch + p_dx;
+    const int xBegin = std::max(p_xBegin, -p_dx);
+    const int xEnd = std::min(p_xEnd, m_xDim - p_dx);
+    if (p_toLattice)
+    {
+        StoreRun(lattice + xBegin, p_row + xBegin, xEnd - xBegin, p_plane);
+        return;
+    }
+    LoadRun(lattice + xBegin, p_row + xBegin, xEnd - xBegin, p_plane);
+    if (xBegin > p_xBegin)
+        p_row[p_xBegin] = Real(0);
+    if (xEnd < p_xEnd)
+        p_row[p_xEnd - 1] = Real(0);
+}
+
+//! BCs, collision and bounce-back of the nodes of p_span in one streamed row. p_row holds the incoming
+//! distributions and is modified by the BCs; the result goes to p_rowOut. All-fluid spans skip the node type checks.
+void CpuLbm::CollideRow(float* const p_row[9], float* const p_rowOut[9], const int p_y,
+    const ActiveTiles::Span& p_span)
+{
+    if (!m_useSimd)
+    {
+        CollideNodes(p_row, p_rowOut, p_y, p_span);
+        return;
+    }
+
+    LbmNode lbm(m_xDim, m_yDim, m_pitch);
+    const float omega = m_omega;
+    const float uMax = m_inletVelocity;
+    const NodeType* image = &m_image[static_cast<size_t>(p_y)*m_pitch];
+    const int xBegin = p_span.Begin;
+    const int xEnd = p_span.End;
+
+    //! BCs modify the incoming distributions before the collision, so apply them in the row buffer
+    if (p_span.Boundary)
+    {
+        for (int x = xBegin; x < xEnd; ++x)
+        {
+            const NodeType im = image[x];
+            if (im != NodeType::FLUID && im != NodeType::OBSTRUCTION && im != NodeType::WALL)
+            {
+                lbm.ReadDistributions(p_row, x);
+                lbm.ApplyBCs(p_y, im, uMax);
+                lbm.WriteDistributions(p_row, x);
+            }
+        }
+    }
+
+    const float* in[9];
+    float* out[9];
+    for (int i = 0; i < 9; ++i)
+    {
+        in[i] = p_row[i] + xBegin;
+        out[i] = p_rowOut[i] + xBegin;
+    }
+    Simd::Collide(in, out, xEnd - xBegin, omega);
+    if (!p_span.Boundary)
+        return;
+
+    //! Solid nodes were collided along with the rest; overwrite them with the bounced-back populations
+    for (int x = xBegin; x < xEnd; ++x)
+    {
+        const NodeType im = image[x];
+        if (im == NodeType::OBSTRUCTION || im == NodeType::WALL)
+        {
+            lbm.ReadDistributions(p_row, x);
+            lbm.BounceBackWall();
+            lbm.WriteDistributions(p_rowOut, x);
+        }
+    }
+}
+
+//! The SIMD kernel is fp32 only
+void CpuLbm::CollideRow(double* const p_row[9], double* const p_rowOut[9], const int p_y,
+    const ActiveTiles::Span& p_span)
+{
+    CollideNodes(p_row, p_rowOut, p_y, p_span);
+}
+
+//! Node by node version of CollideRow
+template <typename Real>
+void CpuLbm::CollideNodes(Real* const p_row[9], Real* const p_rowOut[9], const int p_y,
+    const ActiveTiles::Span& p_span)
+{
+    LbmNodeT<Real> lbm(m_xDim, m_yDim, m_pitch);
+    const Real omega = m_omega;
+    const Real uMax = m_inletVelocity;
+    const NodeType* image = &m_image[static_cast<size_t>(p_y)*m_pitch];
+    for (int x = p_span.Begin; x < p_span.End; ++x)
+    {
+        lbm.ReadDistributions(p_row, x);
+        if (p_span.Boundary)
+            lbm.Update(p_y, image[x], uMax, omega);
+        else
+            lbm.template Update<NodeType::FLUID>(p_y, uMax, omega);
+        lbm.WriteDistributions(p_rowOut, x);
+    }
+}
+
+template <typename Real, typename T>
+void CpuLbm::MarchRows(const int p_worker, const T* p_fIn, T* p_fOut, const int p_yBegin, const int p_yEnd)
+{
+    Real* buffer = ScratchRows<Real>(p_worker);
+    Real* row[9];
+    Real* rowOut[9];
+    for (int i = 0; i < 9; ++i)
+        row[i] = &buffer[static_cast<size_t>(i)*m_pitch];
+
+    const size_t planeSize = static_cast<size_t>(m_pitch)*m_yDim;
+    const bool sleep = IsSleepEnabled();
+    for (int y = p_yBegin; y < p_yEnd; ++y)
+    {
+        for (int i = 0; i < 9; ++i)
+            rowOut[i] = OutputRow(p_fOut, i*planeSize + static_cast<size_t>(y)*m_pitch,
+                &buffer[static_cast<size_t>(i + 9)*m_pitch]);
+        for (const ActiveTiles::Span& span : m_activeTiles.RowSpans(y))
+        {
+            StreamRow(p_fIn, planeSize, 0, row, y, span.Begin, span.End);
+            CollideRow(row, rowOut, y, span);
+            if (sleep)
+                RecordChanges(p_fIn + static_cast<size_t>(y)*m_pitch, planeSize, rowOut, y, span);
+            for (int i = 0; i < 9; ++i)
+                StoreRun(p_fOut + i*planeSize + static_cast<size_t>(y)*m_pitch + span.Begin, rowOut[i] + span.Begin,
+                    span.End - span.Begin, i);
+        }
+    }
+}
+
+//! Advances tiles [p_tileBegin, p_tileEnd) by p_steps. Step s of a tile produces its rows widened by p_steps - s on
+//! either side, so the last step only needs rows the tile computed itself. Intermediate steps live in the worker's
+//! two unpacked tile buffers of (tile height + 2*p_steps) rows; only the final rows are written to p_fOut. Nodes of
+//! skipped tiles are copied into the intermediate rows from p_fIn, so the next step streams from the same values
+//! the step-by-step march reads from the lattice and nothing stale is left in the buffers.
+template <typename Real, typename T>
+void CpuLbm::MarchTiles(const int p_worker, const T* p_fIn, T* p_fOut, const int p_steps, const int p_tileBegin,
+    const int p_tileEnd)
+{
+    const int maxRows = m_tileHeight + 2 * p_steps;
+    const size_t scratchPlane = static_cast<size_t>(m_pitch)*maxRows;
+    Real* const scratch[2] = { TileScratch<Real>(p_worker, 0), TileScratch<Real>(p_worker, 1) };
+    Real* buffer = ScratchRows<Real>(p_worker);
+    Real* row[9];
+    Real* rowOut[9];
+    for (int i = 0; i < 9; ++i)
+        row[i] = &buffer[static_cast<size_t>(i)*m_pitch];
+
+    const size_t latticePlane = static_cast<size_t>(m_pitch)*m_yDim;
+    const bool sleep = IsSleepEnabled();
+    for (int tile = p_tileBegin; tile < p_tileEnd; ++tile)
+    {
+        const int yBegin = tile*m_tileHeight;
+        const int yEnd = std::min(yBegin + m_tileHeight, m_yDim);
+        const int yOrigin = std::max(yBegin - p_steps, 0);
+        for (int s = 1; s <= p_steps; ++s)
+        {
+            const bool first = s == 1;
+            const bool last = s == p_steps;
+            const Real* in = scratch[(s - 1) % 2];
+            Real* out = scratch[s % 2];
+
+            const int rowBegin = std::max(yBegin - (p_steps - s), 0);
+            const int rowEnd = std::min(yEnd + (p_steps - s), m_yDim);
+            for (int y = rowBegin; y < rowEnd; ++y)
+            {
+                for (int i = 0; i < 9; ++i)
+                {
+                    if (last)
+                        rowOut[i] = OutputRow(p_fOut, i*latticePlane + static_cast<size_t>(y)*m_pitch,
+                            &buffer[static_cast<size_t>(i + 9)*m_pitch]);
+                    else
+                        rowOut[i] = out + i*scratchPlane + static_cast<size_t>(y - yOrigin)*m_pitch;
+                }
+                int skippedBegin = 0;
+                for (const ActiveTiles::Span& span : m_activeTiles.RowSpans(y))
+                {
+                    if (!last)
+                    {
+                        for (int i = 0; i < 9; ++i)
+                            LoadRun(p_fIn + i*latticePlane + static_cast<size_t>(y)*m_pitch + skippedBegin,
+                                rowOut[i] + skippedBegin, span.Begin - skippedBegin, i);
+                        skippedBegin = span.End;
+                    }
+                    if (first)
+                        StreamRow(p_fIn, latticePlane, 0, row, y, span.Begin, span.End);
+                    else
+                        StreamRow(in, scratchPlane, yOrigin, row, y, span.Begin, span.End);
+                    CollideRow(row, rowOut, y, span);
+                    if (!last)
+                        continue;
+                    if (sleep && first)
+                        RecordChanges(p_fIn + static_cast<size_t>(y)*m_pitch, latticePlane, rowOut, y, span);
+                    else if (sleep)
+                        RecordChanges(in + static_cast<size_t>(y - yOrigin)*m_pitch, scratchPlane, rowOut, y, span);
+                    for (int i = 0; i < 9; ++i)
+                        StoreRun(p_fOut + i*latticePlane + static_cast<size_t>(y)*m_pitch + span.Begin,
+                            rowOut[i] + span.Begin, span.End - span.Begin, i);
+                }
+                if (!last)
+                {
+                    for (int i = 0; i < 9; ++i)
+                        LoadRun(p_fIn + i*latticePlane + static_cast<size_t>(y)*m_pitch + skippedBegin,
+                            rowOut[i] + skippedBegin, m_xDim - skippedBegin, i);
+                }
+            }
+        }
+    }
+}
+
+//! One step of the AA pattern. With p_exchange, node x gathers f_i from the opposite slot of neighbor x-c_i and
+//! scatters its result to slot i of neighbor x+c_i. Both touch the same nine slots, and no other node touches
+//! them, so rows can be processed in any order. Otherwise node x reads its own slots and writes them back swapped.
+template <typename Real, typename T>
+void CpuLbm::MarchRowsInPlace(const int p_worker, T* p_f, const bool p_exchange, const int p_yBegin,
+    const int p_yEnd)
+{
+    Real* buffer = ScratchRows<Real>(p_worker);
+    Real* row[9];
+    Real* rowOut[9];
+    for (int i = 0; i < 9; ++i)
+    {
+        row[i] = &buffer[static_cast<size_t>(i)*m_pitch];
+        rowOut[i] = &buffer[static_cast<size_t>(i + 9)*m_pitch];
+    }
+
+    for (int y = p_yBegin; y < p_yEnd; ++y)
+    {
+        for (const ActiveTiles::Span& span : m_activeTiles.RowSpans(y))
+        {
+            for (int i = 0; i < 9; ++i)
+            {
+                if (p_exchange)
+                    CopyLinkRow(p_f, row[i], opposite[i], y, -c_x[i], -c_y[i], false, span.Begin, span.End);
+                else
+                    CopyLinkRow(p_f, row[i], i, y, 0, 0, false, span.Begin, span.End);
+            }
+            CollideRow(row, rowOut, y, span);
+            for (int i = 0; i < 9; ++i)
+            {
+                if (p_exchange)
+                    CopyLinkRow(p_f, rowOut[i], i, y, c_x[i], c_y[i], true, span.Begin, span.End);
+                else
+                    CopyLinkRow(p_f, rowOut[i], opposite[i], y, 0, 0, true, span.Begin, span.End);
+            }
+        }
+    }
+}
+
+//! Each chunk is a counted zone reporting its node updates as work, so what all the workers counted adds up in
+//! CpuLattice
+template <typename Real, typename T>
+void CpuLbm::MarchLattice(std::vector<T>& p_fA, std::vector<T>& p_fB, const int p_steps)
+{
+    if (m_streamingMode == StreamingMode::IN_PLACE)
+    {
+        T* f = p_fA.data();
+        for (int i = 0; i < p_steps; ++i)
+        {
+            const bool exchange = i % 2 == 0;
+            m_threadPool->ParallelForWorker(m_yDim, [&](const int p_worker, const int p_yBegin, const int p_yEnd){
+                SHIZUKU_COUNTED_ZONE("CpuLattice");
+                SHIZUKU_ZONE_WORK(static_cast<double>(p_yEnd - p_yBegin)*m_xDim);
+                MarchRowsInPlace<Real>(p_worker, f, exchange, p_yBegin, p_yEnd);
+            });
+            ++m_timeStep;
+        }
+    }
+    else if (m_stepsPerTile > 1)
+    {
+        const int tileCount = (m_yDim + m_tileHeight - 1) / m_tileHeight;
+        for (int done = 0; done < p_steps; done += m_stepsPerTile)
+        {
+            const int tileSteps = std::min(m_stepsPerTile, p_steps - done);
+            const T* fIn = p_fA.data();
+            T* fOut = p_fB.data();
+            m_threadPool->ParallelForWorker(tileCount, 1,
+                [&](const int p_worker, const int p_tileBegin, const int p_tileEnd){
+                SHIZUKU_COUNTED_ZONE("CpuLattice");
+                const int rows = std::min(p_tileEnd*m_tileHeight, m_yDim) - p_tileBegin*m_tileHeight;
+                SHIZUKU_ZONE_WORK(static_cast<double>(rows)*m_xDim*tileSteps);
+                MarchTiles<Real>(p_worker, fIn, fOut, tileSteps, p_tileBegin, p_tileEnd);
+            });
+            std::swap(p_fA, p_fB);
+            m_timeStep += tileSteps;
+            if (IsSleepEnabled())
+                m_activeTiles.UpdateSleeping(m_sleepThreshold);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < p_steps; ++i)
+        {
+            const T* fIn = p_fA.data();
+            T* fOut = p_fB.data();
+            m_threadPool->ParallelForWorker(m_yDim, [&](const int p_worker, const int p_yBegin, const int p_yEnd){
+                SHIZUKU_COUNTED_ZONE("CpuLattice");
+                SHIZUKU_ZONE_WORK(static_cast<double>(p_yEnd - p_yBegin)*m_xDim);
+                MarchRows<Real>(p_worker, fIn, fOut, p_yBegin, p_yEnd);
+            });
+            std::swap(p_fA, p_fB);
+            ++m_timeStep;
+            if (IsSleepEnabled())
+                m_activeTiles.UpdateSleeping(m_sleepThreshold);
+        }
+    }
+}
+
+void CpuLbm::March(const int p_steps)
+{
+    SHIZUKU_ZONE("CpuMarch");
+    m_stopwatch.Tick();
+    if (m_imageChanged)
+    {
+        m_activeTiles.Classify(m_image.data(), m_pitch);
+        m_imageChanged = false;
+    }
+    const bool inPlace = m_streamingMode == StreamingMode::IN_PLACE;
+    const int steps = inPlace ? (p_steps + 1) / 2 * 2 : p_steps;
+    if (IsFloatLattice())
+        MarchLattice<float>(m_fA, m_fB, steps);
+    else if (IsDoubleLattice())
+        MarchLattice<double>(m_doubleA, m_doubleB, steps);
+    else if (m_precision == Precision::FP64)
+        MarchLattice<double>(m_packedA, m_packedB, steps);
+    else
+        MarchLattice<float>(m_packedA, m_packedB, steps);
+    const double seconds = m_stopwatch.Tock();
+
+    const double updates = static_cast<double>(m_xDim)*m_yDim*steps;
+    m_mlups = seconds > 0.0 ? updates / seconds*1e-6 : 0.0;
+}
+
+void CpuLbm::MarchSolution()
+{
+    March(m_timeStepsPerFrame);
+}
+
+//! Distributions of node (p_x, p_y) after the last completed step, whatever the storage and streaming mode
+template <typename Real>
+LbmNodeT<Real> CpuLbm::ReadNode(const int p_x, const int p_y)
+{
+    const size_t planeSize = static_cast<size_t>(m_pitch)*m_yDim;
+    const size_t node = p_x + static_cast<size_t>(p_y)*m_pitch;
+    Real f[9];
+    const Real* planes[9];
+    for (int i = 0; i < 9; ++i)
+    {
+        const size_t slot = m_streamingMode == StreamingMode::IN_PLACE ? opposite[i] : i;
+        if (IsFloatLattice())
+        {
+            f[i] = m_fA[slot*planeSize + node];
+        }
+        else if (IsDoubleLattice())
+        {
+            f[i] = static_cast<Real>(m_doubleA[slot*planeSize + node]);
+        }
+        else
+        {
+            float value;
+            Packed::Unpack(m_storage, static_cast<int>(slot), &m_packedA[slot*planeSize + node], &value, 1);
+            f[i] = value;
+        }
+        planes[i] = &f[i];
+    }
+    LbmNodeT<Real> lbm(m_xDim, m_yDim, m_pitch);
+    lbm.ReadDistributions(planes, 0);
+    return lbm;
+}
+
+//! Moments are taken in double at FP64 and rounded once
+float CpuLbm::ComputeRho(const int p_x, const int p_y)
+{
+    if (m_precision == Precision::FP64)
+        return static_cast<float>(ReadNode<double>(p_x, p_y).ComputeRho());
+    return ReadNode<float>(p_x, p_y).ComputeRho();
+}
+
+float CpuLbm::ComputeU(const int p_x, const int p_y)
+{
+    if (m_precision == Precision::FP64)
+        return static_cast<float>(ReadNode<double>(p_x, p_y).ComputeU());
+    return ReadNode<float>(p_x, p_y).ComputeU();
+}
+
+float CpuLbm::ComputeV(const int p_x, const int p_y)
+{
+    if (m_precision == Precision::FP64)
+        return static_cast<float>(ReadNode<double>(p_x, p_y).ComputeV());
+    return ReadNode<float>(p_x, p_y).ComputeV();
+}
+
+double CpuLbm::GetMlups()
+{
+    return m_mlups;
+}
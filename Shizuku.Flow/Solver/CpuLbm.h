@@ -0,0 +1,206 @@
+#pragma once
+#include "Shizuku.Core/Utilities/ThreadPool.h"
+#include "Shizuku.Core/Utilities/Stopwatch.h"
+#include "ActiveTiles.h"
+#include "PackedLattice.h"
+#include "common.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace Shizuku::Core;
+
+namespace Shizuku { namespace Flow{
+    template <typename Real>
+    class LbmNodeT;
+
+    //! Multithreaded host implementation of the D2Q9 solver in kernel.cu (MarchLBM).
+    //! The lattice is split into row bands, one per worker of the thread pool.
+    class CpuLbm
+    {
+    private:
+        //! Buffers of one pool worker, kept between marches. Every value is written before it is read, so they are
+        //! sized once and never cleared. Only the ones of the current precision are allocated.
+        struct WorkerScratch
+        {
+            //! 9 streamed rows, then 9 collided ones
+            std::vector<float> Rows;
+            std::vector<double> DoubleRows;
+            //! The two intermediate lattices of MarchTiles
+            std::vector<float> Tile[2];
+            std::vector<double> DoubleTile[2];
+        };
+
+        int m_xDim;
+        int m_yDim;
+        int m_pitch;
+        std::vector<float> m_fA;
+        std::vector<float> m_fB;
+        std::vector<std::uint16_t> m_packedA;
+        std::vector<std::uint16_t> m_packedB;
+        std::vector<double> m_doubleA;
+        std::vector<double> m_doubleB;
+        std::vector<float> m_fHost;
+        Precision m_precision;
+        DistributionStorage m_storage;
+        std::vector<NodeType> m_image;
+        float m_inletVelocity;
+        float m_omega;
+        int m_timeStepsPerFrame;
+        long long m_timeStep;
+        std::shared_ptr<ThreadPool> m_threadPool;
+        Stopwatch m_stopwatch;
+        double m_mlups;
+        bool m_useSimd;
+        StreamingMode m_streamingMode;
+        int m_stepsPerTile;
+        int m_tileHeight;
+        ActiveTiles m_activeTiles;
+        bool m_imageChanged;
+        float m_sleepThreshold;
+        std::vector<WorkerScratch> m_scratch;
+
+        //! Sizes the worker buffers for the precision and temporal blocking settings
+        void ResizeScratch();
+        bool IsSleepEnabled();
+        //! FULL storage keeps the distributions in m_fA/m_fB at FP32 and in m_doubleA/m_doubleB at FP64; the 16-bit
+        //! formats use m_packedA/m_packedB at either precision
+        bool IsFloatLattice();
+        bool IsDoubleLattice();
+        void SetLatticeFormat(const Precision p_precision, const DistributionStorage p_storage);
+        template <typename Real>
+        Real* ScratchRows(const int p_worker);
+        template <typename Real>
+        Real* TileScratch(const int p_worker, const int p_index);
+
+        //! Lattice element T is float, double or std::uint16_t (packed, see DistributionStorage). Row buffers and
+        //! arithmetic are Real, float or double as the precision says.
+        template <typename Real, typename T>
+        void MarchLattice(std::vector<T>& p_fA, std::vector<T>& p_fB, const int p_steps);
+        template <typename Real, typename T>
+        void MarchRows(const int p_worker, const T* p_fIn, T* p_fOut, const int p_yBegin, const int p_yEnd);
+        template <typename Real, typename T>
+        void MarchRowsInPlace(const int p_worker, T* p_f, const bool p_exchange, const int p_yBegin, const int p_yEnd);
+        template <typename Real, typename T>
+        void MarchTiles(const int p_worker, const T* p_fIn, T* p_fOut, const int p_steps, const int p_tileBegin,
+            const int p_tileEnd);
+        template <typename T, typename Real>
+        void StreamRow(const T* p_fIn, const size_t p_planeSize, const int p_yOrigin, Real* const p_row[9],
+            const int p_y, const int p_xBegin, const int p_xEnd);
+        template <typename T, typename Real>
+        void CopyLinkRow(T* p_f, Real* p_row, const int p_plane, const int p_y, const int p_dx, const int p_dy,
+            const bool p_toLattice, const int p_xBegin, const int p_xEnd);
+        void CollideRow(float* const p_row[9], float* const p_rowOut[9], const int p_y,
+            const ActiveTiles::Span& p_span);
+        void CollideRow(double* const p_row[9], double* const p_rowOut[9], const int p_y,
+            const ActiveTiles::Span& p_span);
+        template <typename Real>
+        void CollideNodes(Real* const p_row[9], Real* const p_rowOut[9], const int p_y,
+            const ActiveTiles::Span& p_span);
+        template <typename T>
+        void SwitchStreamingMode(std::vector<T>& p_fA, std::vector<T>& p_fB, const StreamingMode p_mode);
+        template <typename T>
+        void SwapOppositePlanes(std::vector<T>& p_f);
+
+        template <typename Real>
+        void LoadRun(const Real* p_source, Real* p_row, const int p_count, const int p_direction);
+        void LoadRun(const std::uint16_t* p_source, float* p_row, const int p_count, const int p_direction);
+        void LoadRun(const std::uint16_t* p_source, double* p_row, const int p_count, const int p_direction);
+        template <typename Real>
+        void StoreRun(Real* p_target, const Real* p_row, const int p_count, const int p_direction);
+        void StoreRun(std::uint16_t* p_target, const float* p_row, const int p_count, const int p_direction);
+        void StoreRun(std::uint16_t* p_target, const double* p_row, const int p_count, const int p_direction);
+        template <typename Real>
+        Real* OutputRow(Real* p_f, const size_t p_offset, Real* p_buffer);
+        template <typename Real>
+        Real* OutputRow(std::uint16_t* p_f, const size_t p_offset, Real* p_buffer);
+        template <typename Real, typename T>
+        Real MaxChange(const T* p_previous, const Real* p_row, const int p_count, const int p_direction);
+        template <typename Real, typename T>
+        void RecordChanges(const T* p_previous, const size_t p_planeSize, Real* const p_rowOut[9], const int p_y,
+            const ActiveTiles::Span& p_span);
+        template <typename Real>
+        void InitializeLattice(std::vector<Real>& p_f);
+        void PackLattice(const std::vector<float>& p_f, std::vector<std::uint16_t>& p_packed);
+        void UnpackLattice(const std::vector<std::uint16_t>& p_packed, std::vector<float>& p_f);
+        template <typename Real>
+        LbmNodeT<Real> ReadNode(const int p_x, const int p_y);
+    public:
+        CpuLbm(const int p_xDim, const int p_yDim);
+        CpuLbm(const int p_xDim, const int p_yDim, std::shared_ptr<ThreadPool> p_threadPool);
+
+        int GetXDim();
+        int GetYDim();
+        int GetPitch();
+        float GetInletVelocity();
+        float GetOmega();
+        void SetInletVelocity(const float p_velocity);
+        void SetOmega(const float p_omega);
+        int GetTimeStepsPerFrame();
+        void SetTimeStepsPerFrame(const int p_timeSteps);
+        long long GetTimeStep();
+        //! For restarting from a checkpoint
+        void SetTimeStep(const long long p_timeStep);
+        int GetThreadCount();
+
+        //! Collide whole rows with the SoA vector kernel in SimdCollide instead of node by node
+        void UseSimd(const bool p_useSimd);
+        bool IsUsingSimd();
+
+        //! Temporal blocking: the lattice is cut into bands of p_rows rows, and each band is advanced p_steps steps
+        //! in a private buffer before moving on, recomputing a halo that shrinks by one row per step. 1 step turns it
+        //! off. Only used in PING_PONG mode.
+        void SetTemporalBlocking(const int p_steps, const int p_rows);
+        int GetStepsPerTile();
+        int GetTileHeight();
+
+        //! Tiles that are solid along with their surrounding ring are always skipped. With a threshold above 0, tiles
+        //! whose distributions changed by less than it in a step also go to sleep until a neighbor changes again.
+        //! Changes are measured while the rows are written, after every step, or with temporal blocking between the
+        //! last two steps of every tile pass. Sleeping is approximate and only used in PING_PONG mode.
+        void SetSleepThreshold(const float p_threshold);
+        float GetSleepThreshold();
+        int GetTileCount();
+        int GetActiveTileCount();
+
+        //! Can be switched at any time; the lattice is converted and the second lattice released or reallocated.
+        //! IN_PLACE marches in step pairs, so March rounds odd step counts up.
+        void SetStreamingMode(const StreamingMode p_mode);
+        StreamingMode GetStreamingMode();
+
+        //! FP64 computes in double, without the SIMD kernel, as the reference for validation runs. The current state is
+        //! converted.
+        void SetPrecision(const Precision p_precision);
+        Precision GetPrecision();
+        //! fp16/bf16 storage halves the lattice memory and traffic at some accuracy cost (see StorageDrift), at either
+        //! precision. The current state is converted.
+        void SetDistributionStorage(const DistributionStorage p_storage);
+        DistributionStorage GetDistributionStorage();
+
+        //! Host copy of the distributions after the last completed step. In IN_PLACE mode direction i is stored
+        //! in the plane of its opposite direction. Packed and double lattices are converted into a separate buffer
+        //! first.
+        const float* GetF();
+        //! Replaces the distributions with p_f, laid out as GetF returns them, e.g. from a checkpoint. Both lattices
+        //! of PING_PONG mode get the same values, as after Initialize.
+        void SetF(const float* p_f);
+
+        //! Use SetNodeType to modify, so the active tiles are rebuilt
+        const NodeType* GetImage();
+        NodeType ImageFcn(const int p_x, const int p_y);
+        void InitializeImage();
+        void SetNodeType(const int p_x, const int p_y, const NodeType p_type);
+
+        //! Uniform inflow, same as InitializeLBM
+        void Initialize();
+        void MarchSolution();
+        void March(const int p_steps);
+
+        float ComputeRho(const int p_x, const int p_y);
+        float ComputeU(const int p_x, const int p_y);
+        float ComputeV(const int p_x, const int p_y);
+
+        //! Million lattice updates per second of the last MarchSolution/March call
+        double GetMlups();
+    };
+} }
@@ -0,0 +1,554 @@
+#include "FieldHistory.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Shizuku::Flow;
+
+namespace
+{
+    const char Magic[8] = { 'S', 'H', 'Z', 'K', 'H', 'I', 'S', 'T' };
+    const char IndexMagic[8] = { 'S', 'H', 'Z', 'K', 'H', 'I', 'D', 'X' };
+    const std::uint32_t FrameMagic = 0x454d5246; //"FRME"
+    const int ChannelCount = 3;
+
+    enum Encoding : std::uint32_t
+    {
+        Raw = 0,
+        XorRle = 1
+    };
+
+    //! Start of the file, little endian like everything after it
+    struct Header
+    {
+        char Magic[8];
+        std::uint32_t Version;
+        std::uint32_t HeaderSize;
+        std::int32_t XDim;
+        std::int32_t YDim;
+        std::int32_t TileSize;
+        std::int32_t ChannelCount;
+        std::uint32_t Reserved[4];
+    };
+    static_assert(sizeof(Header) == 48, "Field history header layout changed");
+
+    //! Start of each frame, followed by a TileEntry per tile (row major) and the tile blocks
+    struct FrameHeader
+    {
+        std::uint32_t Magic;
+        std::uint32_t TileCount;
+        std::int64_t Step;
+        //! Whole frame including this header, so frames can be walked without the index
+        std::uint64_t FrameSize;
+    };
+    static_assert(sizeof(FrameHeader) == 24, "Field history frame layout changed");
+
+    struct TileEntry
+    {
+        //! From the start of the frame
+        std::uint64_t Offset;
+        std::uint32_t Size;
+        std::uint32_t Encoding;
+    };
+    static_assert(sizeof(TileEntry) == 16, "Field history tile layout changed");
+
+    struct IndexEntry
+    {
+        std::int64_t Step;
+        std::uint64_t Offset;
+    };
+
+    //! End of a closed file, after the IndexEntry of each frame
+    struct Trailer
+    {
+        std::uint64_t FrameCount;
+        std::uint64_t IndexOffset;
+        char Magic[8];
+    };
+    static_assert(sizeof(Trailer) == 24, "Field history trailer layout changed");
+
+    const int MaxLiteralRun = 128;
+    const int MinZeroRun = 2;
+    const int MaxZeroRun = 129;
+
+    //! Tokens below 128 are followed by token+1 literal bytes; the others stand for token-128+2 zeros
+    void RleEncode(const unsigned char* p_in, const size_t p_size, std::vector<unsigned char>& p_out)
+    {
+        size_t i = 0;
+        while (i < p_size)
+        {
+            size_t zeros = 0;
+            while (i + zeros < p_size && p_in[i + zeros] == 0 && zeros < MaxZeroRun)
+                zeros++;
+            if (zeros >= MinZeroRun)
+            {
+                p_out.push_back(static_cast<unsigned char>(128 + zeros - MinZeroRun));
+                i += zeros;
+                continue;
+            }
+            const size_t start = i;
+            while (i < p_size && i - start < MaxLiteralRun && !(p_in[i] == 0 && i + 1 < p_size && p_in[i + 1] == 0))
+                i++;
+            p_out.push_back(static_cast<unsigned char>(i - start - 1));
+            p_out.insert(p_out.end(), p_in + start, p_in + i);
+        }
+    }
+
+    void RleDecode(const unsigned char* p_in, const size_t p_size, unsigned char* p_out, const size_t p_outSize)
+    {
+        size_t i = 0;
+        size_t o = 0;
+        while (i < p_size)
+        {
+            const unsigned char token = p_in[i++];
+            if (token < 128)
+            {
+                const size_t count = token + 1;
+                if (i + count > p_size || o + count > p_outSize)
+                    throw std::runtime_error("corrupt tile");
+                std::memcpy(p_out + o, p_in + i, count);
+                i += count;
+                o += count;
+            }
+            else
+            {
+                const size_t count = token - 128 + MinZeroRun;
+                if (o + count > p_outSize)
+                    throw std::runtime_error("corrupt tile");
+                std::memset(p_out + o, 0, count);
+                o += count;
+            }
+        }
+        if (o != p_outSize)
+            throw std::runtime_error("corrupt tile");
+    }
+
+    std::uint32_t Bits(const float p_value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &p_value, sizeof(bits));
+        return bits;
+    }
+
+    float Value(const std::uint32_t p_bits)
+    {
+        float value;
+        std::memcpy(&value, &p_bits, sizeof(value));
+        return value;
+    }
+
+    //! Residuals of p_width x p_height values at p_field (rows p_stride apart) as 4 byte planes of nodes bytes
+    //! each, most significant first
+    void SplitResiduals(const float* p_field, const int p_stride, const int p_width, const int p_height,
+        unsigned char* p_planes)
+    {
+        const size_t nodes = static_cast<size_t>(p_width)*p_height;
+        for (int y = 0; y < p_height; y++)
+        {
+            const float* row = p_field + static_cast<size_t>(y)*p_stride;
+            for (int x = 0; x < p_width; x++)
+            {
+                const std::uint32_t predicted = x > 0 ? Bits(row[x - 1]) : y > 0 ? Bits(row[x - p_stride]) : 0;
+                const std::uint32_t residual = Bits(row[x]) ^ predicted;
+                const size_t n = static_cast<size_t>(y)*p_width + x;
+                p_planes[n] = static_cast<unsigned char>(residual >> 24);
+                p_planes[nodes + n] = static_cast<unsigned char>(residual >> 16);
+                p_planes[2 * nodes + n] = static_cast<unsigned char>(residual >> 8);
+                p_planes[3 * nodes + n] = static_cast<unsigned char>(residual);
+            }
+        }
+    }
+
+    void JoinResiduals(const unsigned char* p_planes, const int p_width, const int p_height, float* p_field,
+        const int p_stride)
+    {
+        const size_t nodes = static_cast<size_t>(p_width)*p_height;
+        for (int y = 0; y < p_height; y++)
+        {
+            float* row = p_field + static_cast<size_t>(y)*p_stride;
+            for (int x = 0; x < p_width; x++)
+            {
+                const size_t n = static_cast<size_t>(y)*p_width + x;
+                const std::uint32_t residual = static_cast<std::uint32_t>(p_planes[n]) << 24
+                    | static_cast<std::uint32_t>(p_planes[nodes + n]) << 16
+                    | static_cast<std::uint32_t>(p_planes[2 * nodes + n]) << 8
+                    | static_cast<std::uint32_t>(p_planes[3 * nodes + n]);
+                const std::uint32_t predicted = x > 0 ? Bits(row[x - 1]) : y > 0 ? Bits(row[x - p_stride]) : 0;
+                row[x] = Value(residual ^ predicted);
+            }
+        }
+    }
+
+    template <typename T>
+    void Put(std::vector<unsigned char>& p_buffer, const T& p_value)
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&p_value);
+        p_buffer.insert(p_buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    T Load(const unsigned char* p_data)
+    {
+        T value;
+        std::memcpy(&value, p_data, sizeof(T));
+        return value;
+    }
+
+    int TileCount(const int p_dim, const int p_tileSize)
+    {
+        return (p_dim + p_tileSize - 1) / p_tileSize;
+    }
+}
+
+FieldFrame::FieldFrame() : Step(0)
+{
+}
+
+FieldHistoryAppender::FieldHistoryAppender(const std::string& p_path, const int p_xDim, const int p_yDim,
+    const int p_tileSize)
+    : m_path(p_path), m_xDim(p_xDim), m_yDim(p_yDim), m_tileSize(p_tileSize), m_offset(0)
+{
+    if (p_xDim <= 0 || p_yDim <= 0 || p_tileSize <= 0)
+        throw std::runtime_error("invalid field history dimensions");
+    m_file.open(p_path, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+        throw std::runtime_error("cannot create " + p_path);
+
+    Header header = {};
+    std::memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = FieldHistoryFile::Version;
+    header.HeaderSize = sizeof(Header);
+    header.XDim = p_xDim;
+    header.YDim = p_yDim;
+    header.TileSize = p_tileSize;
+    header.ChannelCount = ChannelCount;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.flush();
+    if (!m_file)
+        throw std::runtime_error("cannot write " + p_path);
+    m_offset = sizeof(header);
+}
+
+FieldHistoryAppender::~FieldHistoryAppender()
+{
+    try
+    {
+        Close();
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+}
+
+void FieldHistoryAppender::Append(const FieldFrame& p_frame)
+{
+    const size_t nodes = static_cast<size_t>(m_xDim)*m_yDim;
+    if (!m_file.is_open())
+        throw std::runtime_error(m_path + " is closed");
+    if (p_frame.Rho.size() != nodes || p_frame.U.size() != nodes || p_frame.V.size() != nodes)
+        throw std::runtime_error("field frame doesn't match the field history domain");
+
+    const int tilesX = TileCount(m_xDim, m_tileSize);
+    const int tilesY = TileCount(m_yDim, m_tileSize);
+    const size_t tableSize = sizeof(FrameHeader) + static_cast<size_t>(tilesX)*tilesY*sizeof(TileEntry);
+    m_frameBuffer.assign(tableSize, 0);
+
+    const float* const fields[ChannelCount] = { p_frame.Rho.data(), p_frame.U.data(), p_frame.V.data() };
+    for (int tileY = 0; tileY < tilesY; tileY++)
+    {
+        for (int tileX = 0; tileX < tilesX; tileX++)
+        {
+            const int x0 = tileX*m_tileSize;
+            const int y0 = tileY*m_tileSize;
+            const int width = std::min(m_tileSize, m_xDim - x0);
+            const int height = std::min(m_tileSize, m_yDim - y0);
+            const size_t tileNodes = static_cast<size_t>(width)*height;
+            const size_t rawSize = tileNodes*ChannelCount*sizeof(float);
+
+            m_tileBuffer.resize(rawSize);
+            for (int c = 0; c < ChannelCount; c++)
+            {
+                SplitResiduals(fields[c] + x0 + static_cast<size_t>(y0)*m_xDim, m_xDim, width, height,
+                    m_tileBuffer.data() + c*tileNodes*sizeof(float));
+            }
+            TileEntry entry;
+            entry.Offset = m_frameBuffer.size();
+            RleEncode(m_tileBuffer.data(), rawSize, m_frameBuffer);
+            entry.Encoding = XorRle;
+            if (m_frameBuffer.size() - entry.Offset >= rawSize)
+            {
+                //noise doesn't compress; keep the values as they are
+                m_frameBuffer.resize(entry.Offset);
+                for (int c = 0; c < ChannelCount; c++)
+                {
+                    for (int y = 0; y < height; y++)
+                    {
+                        const unsigned char* row = reinterpret_cast<const unsigned char*>(
+                            fields[c] + x0 + static_cast<size_t>(y0 + y)*m_xDim);
+                        m_frameBuffer.insert(m_frameBuffer.end(), row, row + width*sizeof(float));
+                    }
+                }
+                entry.Encoding = Raw;
+            }
+            entry.Size = static_cast<std::uint32_t>(m_frameBuffer.size() - entry.Offset);
+            std::memcpy(m_frameBuffer.data() + sizeof(FrameHeader)
+                + (static_cast<size_t>(tileY)*tilesX + tileX)*sizeof(TileEntry), &entry, sizeof(entry));
+        }
+    }
+
+    FrameHeader frameHeader;
+    frameHeader.Magic = FrameMagic;
+    frameHeader.TileCount = static_cast<std::uint32_t>(tilesX*tilesY);
+    frameHeader.Step = p_frame.Step;
+    frameHeader.FrameSize = m_frameBuffer.size();
+    std::memcpy(m_frameBuffer.data(), &frameHeader, sizeof(frameHeader));
+
+    //one write per frame, so a crash leaves at most the last frame incomplete
+    m_file.write(reinterpret_cast<const char*>(m_frameBuffer.data()), m_frameBuffer.size());
+    m_file.flush();
+    if (!m_file)
+        throw std::runtime_error("cannot write " + m_path);
+    m_steps.push_back(p_frame.Step);
+    m_offsets.push_back(m_offset);
+    m_offset += m_frameBuffer.size();
+}
+
+void FieldHistoryAppender::Close()
+{
+    if (!m_file.is_open())
+        return;
+    std::vector<unsigned char> index;
+    for (size_t i = 0; i < m_steps.size(); i++)
+        Put(index, IndexEntry{ m_steps[i], m_offsets[i] });
+    Trailer trailer;
+    trailer.FrameCount = m_steps.size();
+    trailer.IndexOffset = m_offset;
+    std::memcpy(trailer.Magic, IndexMagic, sizeof(IndexMagic));
+    Put(index, trailer);
+
+    m_file.write(reinterpret_cast<const char*>(index.data()), index.size());
+    m_file.close();
+    if (!m_file)
+        throw std::runtime_error("cannot write " + m_path);
+    m_offset += index.size();
+}
+
+bool FieldHistoryAppender::IsOpen()
+{
+    return m_file.is_open();
+}
+
+int FieldHistoryAppender::GetFrameCount()
+{
+    return static_cast<int>(m_steps.size());
+}
+
+unsigned long long FieldHistoryAppender::GetBytesWritten()
+{
+    return m_offset;
+}
+
+FieldHistoryReader::FieldHistoryReader()
+    : m_xDim(0), m_yDim(0), m_tileSize(0), m_tilesX(0), m_tilesY(0), m_recovered(false)
+{
+}
+
+void FieldHistoryReader::Open(const std::string& p_path)
+{
+    m_steps.clear();
+    m_offsets.clear();
+    m_recovered = false;
+    if (!m_file.Open(p_path.c_str()))
+        throw std::runtime_error("cannot open " + p_path);
+    const unsigned char* data = m_file.Data();
+    const size_t size = m_file.Size();
+
+    if (size < sizeof(Header))
+        throw std::runtime_error(p_path + " is not a field history");
+    const Header header = Load<Header>(data);
+    if (std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0)
+        throw std::runtime_error(p_path + " is not a field history");
+    if (header.Version != FieldHistoryFile::Version || header.HeaderSize != sizeof(Header))
+        throw std::runtime_error(p_path + " is a version " + std::to_string(header.Version)
+            + " field history, expected version " + std::to_string(FieldHistoryFile::Version));
+    if (header.XDim <= 0 || header.YDim <= 0 || header.TileSize <= 0 || header.ChannelCount != ChannelCount)
+        throw std::runtime_error(p_path + " is corrupt");
+    m_xDim = header.XDim;
+    m_yDim = header.YDim;
+    m_tileSize = header.TileSize;
+    m_tilesX = TileCount(m_xDim, m_tileSize);
+    m_tilesY = TileCount(m_yDim, m_tileSize);
+    const size_t tileCount = static_cast<size_t>(m_tilesX)*m_tilesY;
+    const size_t tableSize = sizeof(FrameHeader) + tileCount*sizeof(TileEntry);
+
+    if (size >= sizeof(Header) + sizeof(Trailer))
+    {
+        const Trailer trailer = Load<Trailer>(data + size - sizeof(Trailer));
+        if (std::memcmp(trailer.Magic, IndexMagic, sizeof(IndexMagic)) == 0
+            && trailer.IndexOffset >= sizeof(Header) && trailer.IndexOffset <= size
+            && trailer.FrameCount <= (size - trailer.IndexOffset) / sizeof(IndexEntry)
+            && trailer.IndexOffset + trailer.FrameCount*sizeof(IndexEntry) + sizeof(Trailer) == size)
+        {
+            for (size_t i = 0; i < trailer.FrameCount; i++)
+            {
+                const IndexEntry entry = Load<IndexEntry>(data + trailer.IndexOffset + i*sizeof(IndexEntry));
+                if (entry.Offset + tableSize > trailer.IndexOffset)
+                    throw std::runtime_error(p_path + " has a corrupt frame index");
+                m_steps.push_back(entry.Step);
+                m_offsets.push_back(entry.Offset);
+            }
+            return;
+        }
+    }
+
+    //not closed: walk the frames up to the last complete one
+    m_recovered = true;
+    size_t offset = sizeof(Header);
+    while (offset + tableSize <= size)
+    {
+        const FrameHeader frame = Load<FrameHeader>(data + offset);
+        if (frame.Magic != FrameMagic || frame.TileCount != tileCount || frame.FrameSize < tableSize
+            || frame.FrameSize > size - offset)
+            break;
+        m_steps.push_back(frame.Step);
+        m_offsets.push_back(offset);
+        offset += frame.FrameSize;
+    }
+}
+
+int FieldHistoryReader::GetXDim() const
+{
+    return m_xDim;
+}
+
+int FieldHistoryReader::GetYDim() const
+{
+    return m_yDim;
+}
+
+int FieldHistoryReader::GetTileSize() const
+{
+    return m_tileSize;
+}
+
+int FieldHistoryReader::GetTilesX() const
+{
+    return m_tilesX;
+}
+
+int FieldHistoryReader::GetTilesY() const
+{
+    return m_tilesY;
+}
+
+int FieldHistoryReader::GetTileWidth(const int p_tileX) const
+{
+    return std::min(m_tileSize, m_xDim - p_tileX*m_tileSize);
+}
+
+int FieldHistoryReader::GetTileHeight(const int p_tileY) const
+{
+    return std::min(m_tileSize, m_yDim - p_tileY*m_tileSize);
+}
+
+int FieldHistoryReader::GetFrameCount() const
+{
+    return static_cast<int>(m_steps.size());
+}
+
+long long FieldHistoryReader::GetStep(const int p_frame) const
+{
+    return m_steps[p_frame];
+}
+
+int FieldHistoryReader::FindFrame(const long long p_step) const
+{
+    //frames are appended as the run goes, so steps increase
+    const auto it = std::upper_bound(m_steps.begin(), m_steps.end(), p_step);
+    return static_cast<int>(it - m_steps.begin()) - 1;
+}
+
+bool FieldHistoryReader::IsRecovered() const
+{
+    return m_recovered;
+}
+
+const unsigned char* FieldHistoryReader::TileBlock(const int p_frame, const int p_tileX, const int p_tileY,
+    std::uint32_t& p_size, std::uint32_t& p_encoding) const
+{
+    const unsigned char* frame = m_file.Data() + m_offsets[p_frame];
+    const FrameHeader header = Load<FrameHeader>(frame);
+    const TileEntry entry = Load<TileEntry>(frame + sizeof(FrameHeader)
+        + (static_cast<size_t>(p_tileY)*m_tilesX + p_tileX)*sizeof(TileEntry));
+    if (header.Magic != FrameMagic || entry.Offset > header.FrameSize || entry.Size > header.FrameSize - entry.Offset
+        || m_offsets[p_frame] + header.FrameSize > m_file.Size())
+        throw std::runtime_error("corrupt frame");
+    p_size = entry.Size;
+    p_encoding = entry.Encoding;
+    return frame + entry.Offset;
+}
+
+void FieldHistoryReader::DecodeTile(const int p_frame, const int p_tileX, const int p_tileY, float* p_rho,
+    float* p_u, float* p_v, const int p_stride) const
+{
+    std::uint32_t size;
+    std::uint32_t encoding;
+    const unsigned char* block = TileBlock(p_frame, p_tileX, p_tileY, size, encoding);
+    const int width = GetTileWidth(p_tileX);
+    const int height = GetTileHeight(p_tileY);
+    const size_t tileNodes = static_cast<size_t>(width)*height;
+    const size_t rawSize = tileNodes*ChannelCount*sizeof(float);
+    float* const fields[ChannelCount] = { p_rho, p_u, p_v };
+
+    if (encoding == Raw)
+    {
+        if (size != rawSize)
+            throw std::runtime_error("corrupt tile");
+        for (int c = 0; c < ChannelCount; c++)
+        {
+            if (fields[c] == nullptr)
+                continue;
+            for (int y = 0; y < height; y++)
+            {
+                std::memcpy(fields[c] + static_cast<size_t>(y)*p_stride,
+                    block + (c*tileNodes + static_cast<size_t>(y)*width)*sizeof(float), width*sizeof(float));
+            }
+        }
+        return;
+    }
+    if (encoding != XorRle)
+        throw std::runtime_error("unknown tile encoding");
+
+    std::vector<unsigned char> planes(rawSize);
+    RleDecode(block, size, planes.data(), rawSize);
+    for (int c = 0; c < ChannelCount; c++)
+    {
+        if (fields[c] != nullptr)
+            JoinResiduals(planes.data() + c*tileNodes*sizeof(float), width, height, fields[c], p_stride);
+    }
+}
+
+void FieldHistoryReader::ReadTile(const int p_frame, const int p_tileX, const int p_tileY, float* p_rho,
+    float* p_u, float* p_v) const
+{
+    if (p_frame < 0 || p_frame >= GetFrameCount() || p_tileX < 0 || p_tileX >= m_tilesX || p_tileY < 0
+        || p_tileY >= m_tilesY)
+        throw std::out_of_range("no such field history tile");
+    DecodeTile(p_frame, p_tileX, p_tileY, p_rho, p_u, p_v, GetTileWidth(p_tileX));
+}
+
+void FieldHistoryReader::ReadFrame(const int p_frame, float* p_rho, float* p_u, float* p_v) const
+{
+    if (p_frame < 0 || p_frame >= GetFrameCount())
+        throw std::out_of_range("no such field history frame");
+    for (int tileY = 0; tileY < m_tilesY; tileY++)
+    {
+        for (int tileX = 0; tileX < m_tilesX; tileX++)
+        {
+            const size_t origin = static_cast<size_t>(tileX)*m_tileSize
+                + static_cast<size_t>(tileY)*m_tileSize*m_xDim;
+            DecodeTile(p_frame, tileX, tileY, p_rho ? p_rho + origin : nullptr, p_u ? p_u + origin : nullptr,
+                p_v ? p_v + origin : nullptr, m_xDim);
+        }
+    }
+}
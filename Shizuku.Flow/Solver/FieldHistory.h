@@ -0,0 +1,115 @@
+#pragma once
+#include "Shizuku.Core/Utilities/MappedFile.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    //! Density and velocity of every node at one time step, row major (x + y*xDim) like Simulation::GetFields
+    struct FieldFrame
+    {
+        long long Step;
+        std::vector<float> Rho;
+        std::vector<float> U;
+        std::vector<float> V;
+
+        FieldFrame();
+    };
+
+    //! Field history files record FieldFrames of a run for analysis and replay. The file is a header followed by
+    //! frames that are only ever appended, then an index of the frames once the recording is closed. Each frame
+    //! is split into square tiles, and each tile is compressed on its own behind a table of tile offsets, so a
+    //! reader can decode any tile of any frame without touching the rest. Compression is lossless: each value is
+    //! XORed with its left (or upper) neighbour, which zeroes the high bytes of smooth fields, and the byte planes
+    //! of the result are run-length coded. Tiles that don't shrink are stored raw.
+    namespace FieldHistoryFile{
+        //! Bumped on any change to the layout; readers reject other versions
+        const unsigned int Version = 1;
+        const int DefaultTileSize = 64;
+    }
+
+    //! Writes a field history file on the calling thread. See FieldHistoryWriter to keep that off the solver's.
+    class FieldHistoryAppender
+    {
+    private:
+        std::ofstream m_file;
+        std::string m_path;
+        int m_xDim;
+        int m_yDim;
+        int m_tileSize;
+        unsigned long long m_offset;
+        std::vector<long long> m_steps;
+        std::vector<unsigned long long> m_offsets;
+        std::vector<unsigned char> m_frameBuffer;
+        std::vector<unsigned char> m_tileBuffer;
+    public:
+        //! Creates p_path, replacing any file there. Throws std::runtime_error if it can't be created.
+        FieldHistoryAppender(const std::string& p_path, const int p_xDim, const int p_yDim,
+            const int p_tileSize = FieldHistoryFile::DefaultTileSize);
+        ~FieldHistoryAppender();
+
+        FieldHistoryAppender(const FieldHistoryAppender&) = delete;
+        FieldHistoryAppender& operator=(const FieldHistoryAppender&) = delete;
+
+        //! Compresses and writes p_frame, whose fields have to be XDim*YDim long. Throws std::runtime_error.
+        void Append(const FieldFrame& p_frame);
+        //! Writes the frame index and closes the file. A file that isn't closed is still readable up to its last
+        //! complete frame. Throws std::runtime_error.
+        void Close();
+        bool IsOpen();
+
+        int GetFrameCount();
+        //! File size so far
+        unsigned long long GetBytesWritten();
+    };
+
+    //! Memory-mapped view of a field history file. Reading is const and thread safe, so several threads can
+    //! decode frames at once.
+    class FieldHistoryReader
+    {
+    private:
+        Core::MappedFile m_file;
+        int m_xDim;
+        int m_yDim;
+        int m_tileSize;
+        int m_tilesX;
+        int m_tilesY;
+        std::vector<long long> m_steps;
+        std::vector<unsigned long long> m_offsets;
+        //! Set when there was no valid index and the frames were found by walking the file
+        bool m_recovered;
+
+        const unsigned char* TileBlock(const int p_frame, const int p_tileX, const int p_tileY,
+            std::uint32_t& p_size, std::uint32_t& p_encoding) const;
+        void DecodeTile(const int p_frame, const int p_tileX, const int p_tileY, float* p_rho, float* p_u,
+            float* p_v, const int p_stride) const;
+    public:
+        FieldHistoryReader();
+
+        //! Maps p_path and reads its frame index. Throws std::runtime_error if the file can't be mapped or isn't a
+        //! field history of this version.
+        void Open(const std::string& p_path);
+
+        int GetXDim() const;
+        int GetYDim() const;
+        int GetTileSize() const;
+        int GetTilesX() const;
+        int GetTilesY() const;
+        int GetTileWidth(const int p_tileX) const;
+        int GetTileHeight(const int p_tileY) const;
+        int GetFrameCount() const;
+        long long GetStep(const int p_frame) const;
+        //! Last frame at or before p_step, or -1 if there is none
+        int FindFrame(const long long p_step) const;
+        //! Whether the file wasn't closed, so its frames were found without the index
+        bool IsRecovered() const;
+
+        //! Decodes one tile into arrays of GetTileWidth x GetTileHeight, row major. Any of the pointers can be null.
+        //! Throws std::out_of_range for a frame or tile that doesn't exist and std::runtime_error for a corrupt one.
+        void ReadTile(const int p_frame, const int p_tileX, const int p_tileY, float* p_rho, float* p_u,
+            float* p_v) const;
+        //! Decodes a whole frame into arrays of XDim*YDim, row major. Any of the pointers can be null.
+        void ReadFrame(const int p_frame, float* p_rho, float* p_u, float* p_v) const;
+    };
+} }
@@ -0,0 +1,124 @@
+#include "FieldHistoryPrefetcher.h"
+#include <stdexcept>
+
+using namespace Shizuku::Flow;
+
+FieldHistoryPrefetcher::FieldHistoryPrefetcher(std::shared_ptr<const FieldHistoryReader> p_reader,
+    const int p_ringSize, const bool p_loop)
+    : m_reader(p_reader), m_loop(p_loop), m_acquired(-1), m_nextFrame(0), m_decoding(false), m_generation(0),
+    m_stop(false)
+{
+    //one slot is held by the consumer, so at least two keep the thread busy
+    const int ringSize = p_ringSize > 2 ? p_ringSize : 2;
+    const size_t nodes = static_cast<size_t>(m_reader->GetXDim())*m_reader->GetYDim();
+    m_slots.resize(ringSize);
+    for (int i = 0; i < ringSize; i++)
+    {
+        m_slots[i].Rho.resize(nodes);
+        m_slots[i].U.resize(nodes);
+        m_slots[i].V.resize(nodes);
+        m_free.push_back(i);
+    }
+    m_thread = std::thread(&FieldHistoryPrefetcher::Run, this);
+}
+
+FieldHistoryPrefetcher::~FieldHistoryPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_changed.notify_all();
+    m_thread.join();
+}
+
+const FieldFrame* FieldHistoryPrefetcher::TryAcquire()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ready.empty())
+        return nullptr;
+    if (m_acquired >= 0)
+        m_free.push_back(m_acquired);
+    m_acquired = m_ready.front();
+    m_ready.pop_front();
+    m_changed.notify_all();
+    return &m_slots[m_acquired];
+}
+
+const FieldFrame* FieldHistoryPrefetcher::Acquire()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_acquired >= 0)
+    {
+        m_free.push_back(m_acquired);
+        m_acquired = -1;
+        m_changed.notify_all();
+    }
+    const int frameCount = m_reader->GetFrameCount();
+    m_changed.wait(lock, [&]{ return !m_ready.empty() || (m_nextFrame >= frameCount && !m_decoding); });
+    if (m_ready.empty())
+        return nullptr;
+    m_acquired = m_ready.front();
+    m_ready.pop_front();
+    m_changed.notify_all();
+    return &m_slots[m_acquired];
+}
+
+void FieldHistoryPrefetcher::Seek(const int p_frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.insert(m_free.end(), m_ready.begin(), m_ready.end());
+        m_ready.clear();
+        m_nextFrame = p_frame;
+        m_generation++;
+    }
+    m_changed.notify_all();
+}
+
+std::string FieldHistoryPrefetcher::GetLastError()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+void FieldHistoryPrefetcher::Run()
+{
+    const int frameCount = m_reader->GetFrameCount();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        if (m_loop && m_nextFrame >= frameCount)
+            m_nextFrame = 0;
+        m_changed.wait(lock, [&]{ return m_stop || (!m_free.empty() && m_nextFrame < frameCount); });
+        if (m_stop)
+            return;
+
+        const int slot = m_free.back();
+        m_free.pop_back();
+        const int frame = m_nextFrame++;
+        const int generation = m_generation;
+        m_decoding = true;
+        lock.unlock();
+        FieldFrame& buffer = m_slots[slot];
+        std::string error;
+        try
+        {
+            m_reader->ReadFrame(frame, buffer.Rho.data(), buffer.U.data(), buffer.V.data());
+            buffer.Step = m_reader->GetStep(frame);
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        lock.lock();
+        m_decoding = false;
+        if (generation != m_generation || !error.empty())
+            m_free.push_back(slot);
+        else
+            m_ready.push_back(slot);
+        if (!error.empty())
+            m_lastError = error;
+        m_changed.notify_all();
+    }
+}
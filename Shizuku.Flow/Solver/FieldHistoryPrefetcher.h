@@ -0,0 +1,56 @@
+#pragma once
+#include "FieldHistory.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    //! Decodes the frames of a field history ahead of playback on a thread of its own, into a small ring of frame
+    //! buffers. Frames come out in order; after the last one it starts over from the first if looping.
+    class FieldHistoryPrefetcher
+    {
+    private:
+        std::shared_ptr<const FieldHistoryReader> m_reader;
+        bool m_loop;
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::vector<FieldFrame> m_slots;
+        //! Slots holding decoded frames, in playback order
+        std::deque<int> m_ready;
+        std::vector<int> m_free;
+        //! Slot handed out by Acquire, -1 if none
+        int m_acquired;
+        //! Frame the thread decodes next, GetFrameCount() once it reached the end without looping
+        int m_nextFrame;
+        bool m_decoding;
+        //! Bumped by Seek, so a frame decoded for the old position is dropped
+        int m_generation;
+        bool m_stop;
+        std::string m_lastError;
+
+        void Run();
+    public:
+        //! p_ringSize frames are decoded ahead at most
+        FieldHistoryPrefetcher(std::shared_ptr<const FieldHistoryReader> p_reader, const int p_ringSize = 3,
+            const bool p_loop = true);
+        ~FieldHistoryPrefetcher();
+
+        FieldHistoryPrefetcher(const FieldHistoryPrefetcher&) = delete;
+        FieldHistoryPrefetcher& operator=(const FieldHistoryPrefetcher&) = delete;
+
+        //! Next frame if it is decoded already, else null. Releases the previously acquired frame, so that one must
+        //! not be used any more. Never blocks, so playback can carry on showing the last frame.
+        const FieldFrame* TryAcquire();
+        //! Like TryAcquire but waits for the frame. Null at the end when not looping, or if decoding failed.
+        const FieldFrame* Acquire();
+        //! Drops the frames decoded so far and carries on from p_frame
+        void Seek(const int p_frame);
+        //! Error of the last frame that couldn't be decoded, which is skipped
+        std::string GetLastError();
+    };
+} }
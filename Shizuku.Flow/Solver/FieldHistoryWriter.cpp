@@ -0,0 +1,126 @@
+#include "FieldHistoryWriter.h"
+#include <stdexcept>
+
+using namespace Shizuku::Flow;
+
+FieldHistoryWriter::FieldHistoryWriter(const std::string& p_path, const int p_xDim, const int p_yDim,
+    const int p_tileSize, const int p_maxPending)
+    : m_appender(new FieldHistoryAppender(p_path, p_xDim, p_yDim, p_tileSize)), m_xDim(p_xDim), m_yDim(p_yDim),
+    m_maxPending(p_maxPending > 0 ? p_maxPending : 1), m_stop(false), m_written(0), m_bytesWritten(0)
+{
+    m_thread = std::thread(&FieldHistoryWriter::Run, this);
+}
+
+FieldHistoryWriter::~FieldHistoryWriter()
+{
+    Close();
+}
+
+FieldFrame FieldHistoryWriter::AcquireFrame()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_freeFrames.empty())
+        {
+            FieldFrame frame = std::move(m_freeFrames.back());
+            m_freeFrames.pop_back();
+            return frame;
+        }
+    }
+    const size_t nodes = static_cast<size_t>(m_xDim)*m_yDim;
+    FieldFrame frame;
+    frame.Rho.resize(nodes);
+    frame.U.resize(nodes);
+    frame.V.resize(nodes);
+    return frame;
+}
+
+void FieldHistoryWriter::Append(FieldFrame&& p_frame)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queueChanged.wait(lock, [&]{ return static_cast<int>(m_queue.size()) < m_maxPending; });
+        m_queue.push_back(std::move(p_frame));
+    }
+    m_queueChanged.notify_all();
+}
+
+bool FieldHistoryWriter::Close()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_queueChanged.notify_all();
+        m_thread.join();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_appender->IsOpen())
+    {
+        try
+        {
+            m_appender->Close();
+        }
+        catch (const std::runtime_error& e)
+        {
+            m_lastError = e.what();
+        }
+        m_bytesWritten = m_appender->GetBytesWritten();
+    }
+    return m_lastError.empty();
+}
+
+std::string FieldHistoryWriter::GetLastError()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+int FieldHistoryWriter::GetWrittenCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+}
+
+unsigned long long FieldHistoryWriter::GetBytesWritten()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytesWritten;
+}
+
+void FieldHistoryWriter::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        //the queue is drained before stopping
+        m_queueChanged.wait(lock, [&]{ return m_stop || !m_queue.empty(); });
+        if (m_queue.empty())
+            return;
+
+        FieldFrame frame = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_queueChanged.notify_all();
+        lock.unlock();
+        std::string error;
+        try
+        {
+            m_appender->Append(frame);
+        }
+        catch (const std::runtime_error& e)
+        {
+            error = e.what();
+        }
+        const unsigned long long bytes = m_appender->GetBytesWritten();
+        lock.lock();
+        m_bytesWritten = bytes;
+        if (error.empty())
+            m_written++;
+        else
+            m_lastError = error;
+        m_freeFrames.push_back(std::move(frame));
+        m_queueChanged.notify_all();
+    }
+}
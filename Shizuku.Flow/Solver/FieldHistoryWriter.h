@@ -0,0 +1,52 @@
+#pragma once
+#include "FieldHistory.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    //! Compresses and appends FieldFrames on a thread of its own, so the solver only pays for copying the fields
+    //! into a frame. Frame buffers are recycled once written, so a steady recording doesn't allocate.
+    class FieldHistoryWriter
+    {
+    private:
+        std::unique_ptr<FieldHistoryAppender> m_appender;
+        int m_xDim;
+        int m_yDim;
+        int m_maxPending;
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_queueChanged;
+        std::deque<FieldFrame> m_queue;
+        std::vector<FieldFrame> m_freeFrames;
+        bool m_stop;
+        std::string m_lastError;
+        int m_written;
+        unsigned long long m_bytesWritten;
+
+        void Run();
+    public:
+        //! Creates p_path, see FieldHistoryAppender. At most p_maxPending frames wait to be written before Append
+        //! blocks, which bounds the memory if the disk can't keep up.
+        FieldHistoryWriter(const std::string& p_path, const int p_xDim, const int p_yDim,
+            const int p_tileSize = FieldHistoryFile::DefaultTileSize, const int p_maxPending = 4);
+        ~FieldHistoryWriter();
+
+        FieldHistoryWriter(const FieldHistoryWriter&) = delete;
+        FieldHistoryWriter& operator=(const FieldHistoryWriter&) = delete;
+
+        //! Frame with fields of XDim*YDim to fill and pass to Append
+        FieldFrame AcquireFrame();
+        void Append(FieldFrame&& p_frame);
+        //! Writes the queued frames and the index. Returns false if any write failed, see GetLastError.
+        bool Close();
+        std::string GetLastError();
+        //! Frames completed so far
+        int GetWrittenCount();
+        unsigned long long GetBytesWritten();
+    };
+} }
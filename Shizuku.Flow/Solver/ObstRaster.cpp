@@ -0,0 +1,31 @@
+#include "ObstRaster.h"
+#include <cmath>
+
+using namespace Shizuku::Core::Types;
+using namespace Shizuku::Flow;
+
+Point<float> Shizuku::Flow::ModelSpacePosFromSimPos(const Point<int>& p_simPos, const int p_xDimVisible)
+{
+    return Point<float>(static_cast<float>(p_simPos.X) / p_xDimVisible*2.f - 1.f, static_cast<float>(p_simPos.Y) / p_xDimVisible*2.f - 1.f);
+}
+
+CellRect Shizuku::Flow::CellRectFromFootprint(const ObstDefinition& p_obst, const int p_xDimVisible)
+{
+    const float scale = 0.5f*p_xDimVisible;
+    CellRect rect;
+    rect.XBegin = static_cast<int>(std::floor((p_obst.x - p_obst.r1 + 1.f)*scale)) - 1;
+    rect.XEnd = static_cast<int>(std::ceil((p_obst.x + p_obst.r1 + 1.f)*scale)) + 2;
+    rect.YBegin = static_cast<int>(std::floor((p_obst.y - p_obst.r1 + 1.f)*scale)) - 1;
+    rect.YEnd = static_cast<int>(std::ceil((p_obst.y + p_obst.r1 + 1.f)*scale)) + 2;
+    return rect;
+}
+
+bool Shizuku::Flow::IsInsideFootprint(const ObstDefinition& p_obst, const Point<float>& p_modelCoord)
+{
+    return std::abs(p_modelCoord.X - p_obst.x) < p_obst.r1 && std::abs(p_modelCoord.Y - p_obst.y) < p_obst.r1;
+}
+
+bool Shizuku::Flow::Overlap(const CellRect& p_a, const CellRect& p_b)
+{
+    return p_a.XBegin < p_b.XEnd && p_b.XBegin < p_a.XEnd && p_a.YBegin < p_b.YEnd && p_b.YBegin < p_a.YEnd;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "../Graphics/ObstDefinition.h"
+#include "Shizuku.Core/Types/Point.h"
+
+namespace Shizuku { namespace Flow{
+    //! Cells [XBegin, XEnd) x [YBegin, YEnd)
+    struct CellRect
+    {
+        int XBegin;
+        int XEnd;
+        int YBegin;
+        int YEnd;
+    };
+
+    //! Model space [-1, 1] across the p_xDimVisible cells of a row; y uses the same scale
+    Core::Types::Point<float> ModelSpacePosFromSimPos(const Core::Types::Point<int>& p_simPos, const int p_xDimVisible);
+
+    //! Cells whose model space position can fall inside the obstruction, with a cell of margin for rounding
+    CellRect CellRectFromFootprint(const ObstDefinition& p_obst, const int p_xDimVisible);
+
+    //! Same test as Obst::Hit(Point<float>)
+    bool IsInsideFootprint(const ObstDefinition& p_obst, const Core::Types::Point<float>& p_modelCoord);
+
+    bool Overlap(const CellRect& p_a, const CellRect& p_b);
+} }
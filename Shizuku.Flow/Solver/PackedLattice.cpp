@@ -0,0 +1,175 @@
+#include "PackedLattice.h"
+#include <cstring>
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define SHIZUKU_F16C
+#include <immintrin.h>
+#endif
+
+using namespace Shizuku::Flow;
+
+namespace
+{
+    const float weights[9] = { 4.f / 9.f, 1.f / 9.f, 1.f / 9.f, 1.f / 9.f, 1.f / 9.f,
+        1.f / 36.f, 1.f / 36.f, 1.f / 36.f, 1.f / 36.f };
+
+    std::uint32_t FloatBits(const float p_value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &p_value, sizeof(bits));
+        return bits;
+    }
+
+    float FloatFromBits(const std::uint32_t p_bits)
+    {
+        float value;
+        std::memcpy(&value, &p_bits, sizeof(value));
+        return value;
+    }
+
+    //! Round to nearest even, NaN kept quiet
+    std::uint16_t BFloat16FromFloat(const float p_value)
+    {
+        const std::uint32_t bits = FloatBits(p_value);
+        if ((bits & 0x7fffffffu) > 0x7f800000u)
+            return static_cast<std::uint16_t>((bits >> 16) | 0x40u);
+        return static_cast<std::uint16_t>((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+    }
+
+    float FloatFromBFloat16(const std::uint16_t p_value)
+    {
+        return FloatFromBits(static_cast<std::uint32_t>(p_value) << 16);
+    }
+
+#if defined(SHIZUKU_F16C)
+    std::uint16_t HalfFromFloat(const float p_value)
+    {
+        return static_cast<std::uint16_t>(_mm_extract_epi16(_mm_cvtps_ph(_mm_set_ss(p_value), 0), 0));
+    }
+
+    float FloatFromHalf(const std::uint16_t p_value)
+    {
+        return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(p_value)));
+    }
+#else
+    //! IEEE binary16, round to nearest even. Same results as F16C.
+    std::uint16_t HalfFromFloat(const float p_value)
+    {
+        const std::uint32_t bits = FloatBits(p_value);
+        const std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+        const std::uint32_t magnitude = bits & 0x7fffffffu;
+        if (magnitude > 0x7f800000u)//NaN, quieted, payload truncated
+            return sign | static_cast<std::uint16_t>(0x7e00u | ((magnitude & 0x7fffffu) >> 13));
+        if (magnitude == 0x7f800000u)
+            return sign | 0x7c00u;
+        if (magnitude >= 0x477ff000u)//rounds to beyond the largest half
+            return sign | 0x7c00u;
+        if (magnitude < 0x38800000u)//subnormal half or zero
+        {
+            if (magnitude < 0x33000000u)
+                return sign;
+            const std::uint32_t exponent = magnitude >> 23;
+            const std::uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+            const std::uint32_t shift = 126 - exponent;
+            std::uint32_t half = mantissa >> shift;
+            const std::uint32_t remainder = mantissa & ((1u << shift) - 1u);
+            const std::uint32_t halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (half & 1u)))
+                ++half;
+            return sign | static_cast<std::uint16_t>(half);
+        }
+        std::uint32_t half = (magnitude - 0x38000000u) >> 13;
+        const std::uint32_t remainder = magnitude & 0x1fffu;
+        if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+            ++half;
+        return sign | static_cast<std::uint16_t>(half);
+    }
+
+    float FloatFromHalf(const std::uint16_t p_value)
+    {
+        const std::uint32_t sign = static_cast<std::uint32_t>(p_value & 0x8000u) << 16;
+        const std::uint32_t exponent = (p_value >> 10) & 0x1fu;
+        std::uint32_t mantissa = p_value & 0x3ffu;
+        if (exponent == 0x1fu)
+            return FloatFromBits(sign | 0x7f800000u | (mantissa << 13));
+        if (exponent != 0)
+            return FloatFromBits(sign | ((exponent + 112) << 23) | (mantissa << 13));
+        if (mantissa == 0)
+            return FloatFromBits(sign);
+        int shift = 0;
+        while ((mantissa & 0x400u) == 0)
+        {
+            mantissa <<= 1;
+            ++shift;
+        }
+        return FloatFromBits(sign | static_cast<std::uint32_t>(113 - shift) << 23 | ((mantissa & 0x3ffu) << 13));
+    }
+#endif
+}
+
+const char* Packed::PrecisionName(const Precision p_precision)
+{
+    return p_precision == Precision::FP64 ? "fp64" : "fp32";
+}
+
+const char* Packed::StorageName(const DistributionStorage p_storage)
+{
+    switch (p_storage)
+    {
+    case DistributionStorage::FLOAT16: return "fp16";
+    case DistributionStorage::BFLOAT16: return "bf16";
+    default: return "full";
+    }
+}
+
+int Packed::ElementSize(const DistributionStorage p_storage, const Precision p_precision)
+{
+    if (p_storage != DistributionStorage::FULL)
+        return 2;
+    return p_precision == Precision::FP64 ? 8 : 4;
+}
+
+void Packed::Pack(const DistributionStorage p_storage, const int p_direction, const float* p_in,
+    std::uint16_t* p_out, const int p_count)
+{
+    const float weight = weights[p_direction];
+    int n = 0;
+    if (p_storage == DistributionStorage::BFLOAT16)
+    {
+        for (; n < p_count; ++n)
+            p_out[n] = BFloat16FromFloat(p_in[n] - weight);
+        return;
+    }
+#if defined(SHIZUKU_F16C)
+    const __m256 shift = _mm256_set1_ps(weight);
+    for (; n + 8 <= p_count; n += 8)
+    {
+        const __m128i half = _mm256_cvtps_ph(_mm256_sub_ps(_mm256_loadu_ps(p_in + n), shift), 0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p_out + n), half);
+    }
+#endif
+    for (; n < p_count; ++n)
+        p_out[n] = HalfFromFloat(p_in[n] - weight);
+}
+
+void Packed::Unpack(const DistributionStorage p_storage, const int p_direction, const std::uint16_t* p_in,
+    float* p_out, const int p_count)
+{
+    const float weight = weights[p_direction];
+    int n = 0;
+    if (p_storage == DistributionStorage::BFLOAT16)
+    {
+        for (; n < p_count; ++n)
+            p_out[n] = FloatFromBFloat16(p_in[n]) + weight;
+        return;
+    }
+#if defined(SHIZUKU_F16C)
+    const __m256 shift = _mm256_set1_ps(weight);
+    for (; n + 8 <= p_count; n += 8)
+    {
+        const __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_in + n));
+        _mm256_storeu_ps(p_out + n, _mm256_add_ps(_mm256_cvtph_ps(half), shift));
+    }
+#endif
+    for (; n < p_count; ++n)
+        p_out[n] = FloatFromHalf(p_in[n]) + weight;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+namespace Shizuku { namespace Flow{
+    //! Arithmetic type of the CpuLbm solver. FP64 is the double precision variant, the reference for validation runs.
+    enum Precision{FP32,FP64};
+
+    //! Element format of the CpuLbm lattice. FULL stores distributions in the arithmetic type. The 16-bit formats
+    //! store f_i - w_i, the deviation from the rest equilibrium: populations stay close to their weights, so the shift
+    //! leaves the mantissa to the part that actually changes. Only their loads and stores convert, through fp32.
+    enum DistributionStorage{FULL,FLOAT16,BFLOAT16};
+
+    namespace Packed{
+        const char* PrecisionName(const Precision p_precision);
+        const char* StorageName(const DistributionStorage p_storage);
+        //! Bytes per distribution in memory
+        int ElementSize(const DistributionStorage p_storage, const Precision p_precision);
+
+        //! Converts p_count values of direction p_direction between fp32 and a 16-bit format. p_storage must be
+        //! FLOAT16 or BFLOAT16.
+        void Pack(const DistributionStorage p_storage, const int p_direction, const float* p_in, std::uint16_t* p_out,
+            const int p_count);
+        void Unpack(const DistributionStorage p_storage, const int p_direction, const std::uint16_t* p_in,
+            float* p_out, const int p_count);
+    }
+} }
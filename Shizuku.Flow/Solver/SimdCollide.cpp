@@ -0,0 +1,304 @@
+#include "SimdCollide.h"
+#include "common.h"
+#include <math.h>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace Shizuku::Flow;
+
+namespace
+{
+    //! Lane types share one collision kernel. Every operation is a single IEEE op in the same order as
+    //! LbmNode, which is what keeps the vector paths bit-comparable with the scalar one.
+    struct ScalarLanes
+    {
+        typedef float V;
+        static const int Width = 1;
+        static V Load(const float* p) { return *p; }
+        static void Store(float* p, const V a) { *p = a; }
+        static V Set(const float a) { return a; }
+        static V Add(const V a, const V b) { return a + b; }
+        static V Sub(const V a, const V b) { return a - b; }
+        static V Mul(const V a, const V b) { return a * b; }
+        static V Div(const V a, const V b) { return a / b; }
+        static V Sqrt(const V a) { return sqrtf(a); }
+        static V Neg(const V a) { return -a; }
+        //! float*double product rounded back to float, as in the 1/36 weights of ComputeFeqs
+        static V MulDouble(const V a, const double b) { return static_cast<float>(b * a); }
+    };
+
+#if defined(__AVX2__)
+    struct Avx2Lanes
+    {
+        typedef __m256 V;
+        static const int Width = 8;
+        static V Load(const float* p) { return _mm256_loadu_ps(p); }
+        static void Store(float* p, const V a) { _mm256_storeu_ps(p, a); }
+        static V Set(const float a) { return _mm256_set1_ps(a); }
+        static V Add(const V a, const V b) { return _mm256_add_ps(a, b); }
+        static V Sub(const V a, const V b) { return _mm256_sub_ps(a, b); }
+        static V Mul(const V a, const V b) { return _mm256_mul_ps(a, b); }
+        static V Div(const V a, const V b) { return _mm256_div_ps(a, b); }
+        static V Sqrt(const V a) { return _mm256_sqrt_ps(a); }
+        static V Neg(const V a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.f)); }
+        static V MulDouble(const V a, const double b)
+        {
+            const __m256d factor = _mm256_set1_pd(b);
+            const __m256d lo = _mm256_mul_pd(factor, _mm256_cvtps_pd(_mm256_castps256_ps128(a)));
+            const __m256d hi = _mm256_mul_pd(factor, _mm256_cvtps_pd(_mm256_extractf128_ps(a, 1)));
+            return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1);
+        }
+    };
+#endif
+
+#if defined(__AVX512F__)
+    struct Avx512Lanes
+    {
+        typedef __m512 V;
+        static const int Width = 16;
+        static V Load(const float* p) { return _mm512_loadu_ps(p); }
+        static void Store(float* p, const V a) { _mm512_storeu_ps(p, a); }
+        static V Set(const float a) { return _mm512_set1_ps(a); }
+        static V Add(const V a, const V b) { return _mm512_add_ps(a, b); }
+        static V Sub(const V a, const V b) { return _mm512_sub_ps(a, b); }
+        static V Mul(const V a, const V b) { return _mm512_mul_ps(a, b); }
+        static V Div(const V a, const V b) { return _mm512_div_ps(a, b); }
+        static V Sqrt(const V a) { return _mm512_sqrt_ps(a); }
+        static V Neg(const V a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x80000000))); }
+        static V MulDouble(const V a, const double b)
+        {
+            const __m512d factor = _mm512_set1_pd(b);
+            const __m256 aLo = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), 0));
+            const __m256 aHi = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a), 1));
+            const __m256 lo = _mm512_cvtpd_ps(_mm512_mul_pd(factor, _mm512_cvtps_pd(aLo)));
+            const __m256 hi = _mm512_cvtpd_ps(_mm512_mul_pd(factor, _mm512_cvtps_pd(aHi)));
+            return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)),
+                _mm256_castps_pd(hi), 1));
+        }
+    };
+#endif
+
+    template <typename L>
+    struct Kernel
+    {
+        typedef typename L::V V;
+
+        static V ComputeRho(const V* f)
+        {
+            return L::Add(L::Add(L::Add(L::Add(L::Add(L::Add(L::Add(L::Add(f[0], f[1]), f[2]), f[3]), f[4]), f[5]), f[6]), f[7]), f[8]);
+        }
+
+        static V ComputeU(const V* f)
+        {
+            return L::Add(L::Sub(L::Sub(L::Add(L::Sub(f[1], f[3]), f[5]), f[6]), f[7]), f[8]);
+        }
+
+        static V ComputeV(const V* f)
+        {
+            return L::Sub(L::Sub(L::Add(L::Add(L::Sub(f[2], f[4]), f[5]), f[6]), f[7]), f[8]);
+        }
+
+        static V Feq(const V rho, const V c, const V usqr, const V weight)
+        {
+            return L::Mul(weight, L::Sub(L::Add(L::Add(rho, L::Mul(L::Set(3.0f), c)), L::Mul(L::Mul(L::Set(4.5f), c), c)),
+                L::Mul(L::Set(1.5f), usqr)));
+        }
+
+        static V FeqNegative(const V rho, const V c, const V usqr, const V weight)
+        {
+            return L::Mul(weight, L::Sub(L::Add(L::Sub(rho, L::Mul(L::Set(3.0f), c)), L::Mul(L::Mul(L::Set(4.5f), c), c)),
+                L::Mul(L::Set(1.5f), usqr)));
+        }
+
+        static V FeqDiagonal(const V rho, const V c, const V usqr)
+        {
+            return L::MulDouble(L::Sub(L::Add(L::Add(rho, L::Mul(L::Set(3.0f), c)), L::Mul(L::Mul(L::Set(4.5f), c), c)),
+                L::Mul(L::Set(1.5f), usqr)), 0.02777777778);
+        }
+
+        static void ComputeFeqs(V* fEq, const V rho, const V u, const V v)
+        {
+            const V usqr = L::Add(L::Mul(u, u), L::Mul(v, v));
+            const V w1 = L::Set(0.1111111111f);
+            fEq[0] = L::Mul(L::Set(0.4444444444f), L::Sub(rho, L::Mul(L::Set(1.5f), usqr)));
+            fEq[1] = Feq(rho, u, usqr, w1);
+            fEq[2] = Feq(rho, v, usqr, w1);
+            fEq[3] = FeqNegative(rho, u, usqr, w1);
+            fEq[4] = FeqNegative(rho, v, usqr, w1);
+            fEq[5] = FeqDiagonal(rho, L::Add(u, v), usqr);
+            fEq[6] = FeqDiagonal(rho, L::Sub(v, u), usqr);
+            fEq[7] = FeqDiagonal(rho, L::Sub(L::Neg(u), v), usqr);
+            fEq[8] = FeqDiagonal(rho, L::Sub(u, v), usqr);
+        }
+
+        static V ComputeStrainRateMagnitude(const V* f)
+        {
+            V fEq[9];
+            ComputeFeqs(fEq, ComputeRho(f), ComputeU(f), ComputeV(f));
+            V d[9];
+            for (int i = 0; i < 9; ++i)
+                d[i] = L::Sub(f[i], fEq[i]);
+            const V qxx = L::Add(L::Add(L::Add(L::Add(L::Add(d[1], d[3]), d[5]), d[6]), d[7]), d[8]);
+            const V qxy = L::Sub(L::Add(L::Sub(d[5], d[6]), d[7]), d[8]);
+            const V qyy = L::Add(L::Add(L::Add(L::Add(L::Add(d[5], d[2]), d[6]), d[7]), d[4]), d[8]);
+            return L::Sqrt(L::Add(L::Add(L::Mul(qxx, qxx), L::Mul(L::Mul(qxy, qxy), L::Set(2.f))), L::Mul(qyy, qyy)));
+        }
+
+        static void Collide(V* f, const float omega)
+        {
+            const V Q = ComputeStrainRateMagnitude(f);
+            const float tau0 = 1.f / omega;
+            const float smagorinsky = 18.f*SMAG_CONST*sqrtf(2.f);
+            const V tau = L::Add(L::Set(0.5f*tau0),
+                L::Mul(L::Set(0.5f), L::Sqrt(L::Add(L::Set(tau0*tau0), L::Mul(L::Set(smagorinsky), Q)))));
+            const V omegaTurb = L::Div(L::Set(1.f), tau);
+
+            const V u = ComputeU(f);
+            const V v = ComputeV(f);
+            const V usqr = L::Add(L::Mul(u, u), L::Mul(v, v));
+            const V two = L::Set(2.f);
+            const V three = L::Set(3.f);
+            const V four = L::Set(4.f);
+
+            const V m1 = L::Sub(L::Add(L::Add(L::Add(L::Add(L::Add(L::Add(L::Add(L::Add(
+                L::Mul(L::Set(-2.f), f[0]), f[1]), f[2]), f[3]), f[4]),
+                L::Mul(four, f[5])), L::Mul(four, f[6])), L::Mul(four, f[7])), L::Mul(four, f[8])),
+                L::Mul(L::Set(3.0f), usqr));
+            const V m2 = L::Add(L::Sub(L::Sub(L::Sub(L::Sub(
+                L::Mul(three, f[0]), L::Mul(three, f[1])), L::Mul(three, f[2])), L::Mul(three, f[3])), L::Mul(three, f[4])),
+                L::Mul(L::Set(3.0f), usqr));
+            const V m4 = L::Add(L::Sub(L::Sub(L::Add(L::Add(L::Neg(f[1]), f[3]),
+                L::Mul(two, f[5])), L::Mul(two, f[6])), L::Mul(two, f[7])), L::Mul(two, f[8]));
+            const V m6 = L::Sub(L::Sub(L::Add(L::Add(L::Add(L::Neg(f[2]), f[4]),
+                L::Mul(two, f[5])), L::Mul(two, f[6])), L::Mul(two, f[7])), L::Mul(two, f[8]));
+            const V m7 = L::Sub(L::Sub(L::Add(L::Sub(f[1], f[2]), f[3]), f[4]), L::Sub(L::Mul(u, u), L::Mul(v, v)));
+            const V m8 = L::Sub(L::Sub(L::Add(L::Sub(f[5], f[6]), f[7]), f[8]), L::Mul(u, v));
+
+            const V a = L::Mul(L::Neg(m1), L::Set(0.027777777f));
+            const V b = L::Mul(L::Set(0.05555555556f), m2);
+            const V c4 = L::Mul(L::Set(0.16666666667f), m4);
+            const V c6 = L::Mul(L::Set(0.16666666667f), m6);
+            const V d7 = L::Mul(L::Mul(m7, omegaTurb), L::Set(0.25f));
+            const V e = L::Mul(L::Set(0.05555555556f), m1);
+            const V g = L::Mul(m2, L::Set(0.027777777f));
+            const V h4 = L::Mul(L::Set(0.08333333333f), m4);
+            const V h6 = L::Mul(L::Set(0.08333333333f), m6);
+            const V k8 = L::Mul(L::Mul(m8, omegaTurb), L::Set(0.25f));
+
+            f[0] = L::Sub(f[0], L::Mul(L::Add(L::Neg(m1), m2), L::Set(0.11111111f)));
+            f[1] = L::Sub(f[1], L::Add(L::Sub(L::Sub(a, b), c4), d7));
+            f[2] = L::Sub(f[2], L::Sub(L::Sub(L::Sub(a, b), c6), d7));
+            f[3] = L::Sub(f[3], L::Add(L::Add(L::Sub(a, b), c4), d7));
+            f[4] = L::Sub(f[4], L::Sub(L::Add(L::Sub(a, b), c6), d7));
+            f[5] = L::Sub(f[5], L::Add(L::Add(L::Add(L::Add(e, g), h4), h6), k8));
+            f[6] = L::Sub(f[6], L::Sub(L::Add(L::Sub(L::Add(e, g), h4), h6), k8));
+            f[7] = L::Sub(f[7], L::Add(L::Sub(L::Sub(L::Add(e, g), h4), h6), k8));
+            f[8] = L::Sub(f[8], L::Sub(L::Sub(L::Add(L::Add(e, g), h4), h6), k8));
+        }
+
+        //! Returns the number of nodes handled; the remainder is left for a narrower lane type
+        static int CollideNodes(const float* const fIn[9], float* const fOut[9], const int count, const float omega)
+        {
+            int n = 0;
+            for (; n + L::Width <= count; n += L::Width)
+            {
+                V f[9];
+                for (int i = 0; i < 9; ++i)
+                    f[i] = L::Load(fIn[i] + n);
+                Collide(f, omega);
+                for (int i = 0; i < 9; ++i)
+                    L::Store(fOut[i] + n, f[i]);
+            }
+            return n;
+        }
+
+        static int StrainRateNodes(const float* const fIn[9], float* out, const int count)
+        {
+            int n = 0;
+            for (; n + L::Width <= count; n += L::Width)
+            {
+                V f[9];
+                for (int i = 0; i < 9; ++i)
+                    f[i] = L::Load(fIn[i] + n);
+                L::Store(out + n, ComputeStrainRateMagnitude(f));
+            }
+            return n;
+        }
+    };
+
+    void Offset(const float* const p_f[9], const int p_offset, const float* p_out[9])
+    {
+        for (int i = 0; i < 9; ++i)
+            p_out[i] = p_f[i] + p_offset;
+    }
+
+    void Offset(float* const p_f[9], const int p_offset, float* p_out[9])
+    {
+        for (int i = 0; i < 9; ++i)
+            p_out[i] = p_f[i] + p_offset;
+    }
+}
+
+Simd::InstructionSet Simd::CompiledInstructionSet()
+{
+#if defined(__AVX512F__)
+    return InstructionSet::Avx512;
+#elif defined(__AVX2__)
+    return InstructionSet::Avx2;
+#else
+    return InstructionSet::Scalar;
+#endif
+}
+
+const char* Simd::InstructionSetName(const InstructionSet p_set)
+{
+    switch (p_set)
+    {
+    case InstructionSet::Avx512:
+        return "AVX-512";
+    case InstructionSet::Avx2:
+        return "AVX2";
+    default:
+        return "Scalar";
+    }
+}
+
+int Simd::LaneCount()
+{
+#if defined(__AVX512F__)
+    return Avx512Lanes::Width;
+#elif defined(__AVX2__)
+    return Avx2Lanes::Width;
+#else
+    return ScalarLanes::Width;
+#endif
+}
+
+void Simd::Collide(const float* const p_fIn[9], float* const p_fOut[9], const int p_count, const float p_omega)
+{
+    int done = 0;
+#if defined(__AVX512F__)
+    done = Kernel<Avx512Lanes>::CollideNodes(p_fIn, p_fOut, p_count, p_omega);
+#elif defined(__AVX2__)
+    done = Kernel<Avx2Lanes>::CollideNodes(p_fIn, p_fOut, p_count, p_omega);
+#endif
+    const float* fIn[9];
+    float* fOut[9];
+    Offset(p_fIn, done, fIn);
+    Offset(p_fOut, done, fOut);
+    Kernel<ScalarLanes>::CollideNodes(fIn, fOut, p_count - done, p_omega);
+}
+
+void Simd::ComputeStrainRateMagnitude(const float* const p_f[9], float* p_out, const int p_count)
+{
+    int done = 0;
+#if defined(__AVX512F__)
+    done = Kernel<Avx512Lanes>::StrainRateNodes(p_f, p_out, p_count);
+#elif defined(__AVX2__)
+    done = Kernel<Avx2Lanes>::StrainRateNodes(p_f, p_out, p_count);
+#endif
+    const float* f[9];
+    Offset(p_f, done, f);
+    Kernel<ScalarLanes>::StrainRateNodes(f, p_out + done, p_count - done);
+}
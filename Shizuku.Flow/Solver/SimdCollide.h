@@ -0,0 +1,23 @@
+#pragma once
+
+namespace Shizuku { namespace Flow{ namespace Simd{
+    enum InstructionSet
+    {
+        Scalar,
+        Avx2,
+        Avx512
+    };
+
+    //! Widest instruction set this translation unit was compiled for (/arch:AVX2, -mavx2, -mavx512f)
+    InstructionSet CompiledInstructionSet();
+    const char* InstructionSetName(const InstructionSet p_set);
+    int LaneCount();
+
+    //! Smagorinsky MRT collision of p_count nodes stored as structure of arrays: p_fIn[i][n] is direction i of node n.
+    //! Reproduces LbmNode::Collide bit for bit as long as the compiler does not contract mul/add into FMA
+    //! (-ffp-contract=off, /fp:precise). p_fIn and p_fOut may alias.
+    void Collide(const float* const p_fIn[9], float* const p_fOut[9], const int p_count, const float p_omega);
+
+    //! Same as LbmNode::ComputeStrainRateMagnitude for p_count nodes
+    void ComputeStrainRateMagnitude(const float* const p_f[9], float* p_out, const int p_count);
+} } }
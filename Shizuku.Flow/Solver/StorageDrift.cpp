@@ -0,0 +1,65 @@
+#include "StorageDrift.h"
+#include "CpuLbm.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Shizuku::Flow;
+
+namespace
+{
+    StorageDrift Compare(CpuLbm& p_reference, CpuLbm& p_test)
+    {
+        StorageDrift drift = { p_test.GetTimeStep(), 0.f, 0.f, 0.f, 0.0, 0.0, 0.0 };
+        const NodeType* image = p_reference.GetImage();
+        const int pitch = p_reference.GetPitch();
+        long long count = 0;
+        for (int y = 0; y < p_reference.GetYDim(); ++y)
+        {
+            for (int x = 0; x < p_reference.GetXDim(); ++x)
+            {
+                const NodeType im = image[x + y*pitch];
+                if (im == NodeType::OBSTRUCTION || im == NodeType::WALL)
+                    continue;
+                const float dRho = std::abs(p_test.ComputeRho(x, y) - p_reference.ComputeRho(x, y));
+                const float dU = std::abs(p_test.ComputeU(x, y) - p_reference.ComputeU(x, y));
+                const float dV = std::abs(p_test.ComputeV(x, y) - p_reference.ComputeV(x, y));
+                drift.MaxRho = std::max(drift.MaxRho, dRho);
+                drift.MaxU = std::max(drift.MaxU, dU);
+                drift.MaxV = std::max(drift.MaxV, dV);
+                drift.RmsRho += static_cast<double>(dRho)*dRho;
+                drift.RmsU += static_cast<double>(dU)*dU;
+                drift.RmsV += static_cast<double>(dV)*dV;
+                ++count;
+            }
+        }
+        if (count > 0)
+        {
+            drift.RmsRho = std::sqrt(drift.RmsRho / count);
+            drift.RmsU = std::sqrt(drift.RmsU / count);
+            drift.RmsV = std::sqrt(drift.RmsV / count);
+        }
+        return drift;
+    }
+}
+
+std::vector<StorageDrift> Shizuku::Flow::MeasureStorageDrift(CpuLbm& p_reference, CpuLbm& p_test,
+    const DistributionStorage p_storage, const int p_steps, const int p_interval)
+{
+    p_reference.SetPrecision(Precision::FP64);
+    p_reference.SetDistributionStorage(DistributionStorage::FULL);
+    p_test.SetPrecision(Precision::FP32);
+    p_test.SetDistributionStorage(p_storage);
+    p_reference.Initialize();
+    p_test.Initialize();
+
+    std::vector<StorageDrift> drifts;
+    const int interval = std::max(p_interval, 1);
+    for (int done = 0; done < p_steps; done += interval)
+    {
+        const int steps = std::min(interval, p_steps - done);
+        p_reference.March(steps);
+        p_test.March(steps);
+        drifts.push_back(Compare(p_reference, p_test));
+    }
+    return drifts;
+}
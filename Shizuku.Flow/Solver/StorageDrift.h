@@ -0,0 +1,26 @@
+#pragma once
+#include "PackedLattice.h"
+#include <vector>
+
+namespace Shizuku { namespace Flow{
+    class CpuLbm;
+
+    //! Deviation of rho/u/v of a run from the fp64 reference run after Steps steps, over non-solid nodes
+    struct StorageDrift
+    {
+        long long Steps;
+        float MaxRho;
+        float MaxU;
+        float MaxV;
+        double RmsRho;
+        double RmsU;
+        double RmsV;
+    };
+
+    //! Accuracy check for DistributionStorage. p_reference and p_test must have the same size and image; both are
+    //! initialized, p_test is switched to FP32 with p_storage and p_reference to FP64 with FULL storage, and they are
+    //! marched side by side for p_steps steps, measuring the drift every p_interval steps. FULL gives the error of the
+    //! fp32 solver.
+    std::vector<StorageDrift> MeasureStorageDrift(CpuLbm& p_reference, CpuLbm& p_test,
+        const DistributionStorage p_storage, const int p_steps, const int p_interval);
+} }
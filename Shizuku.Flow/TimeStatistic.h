@@ -0,0 +1,14 @@
+#pragma once
+
+namespace Shizuku { namespace Flow{
+    //! What Query::GetTime reports of a profiler zone's durations. The percentiles and MAX cover every run since the
+    //! profiler was last reset, AVERAGE only the last few.
+    enum TimeStatistic
+    {
+        AVERAGE,
+        P50,
+        P90,
+        P99,
+        MAX
+    };
+} }
@@ -1,7 +1,12 @@
 #pragma once
 #include <stdio.h>
 
-#define MAXOBSTS 20
+//! Code shared by the CUDA kernels and the host solver, e.g. LbmNode
+#ifdef __CUDACC__
+#define SHIZUKU_HOST_DEVICE __host__ __device__
+#else
+#define SHIZUKU_HOST_DEVICE
+#endif
 
 #ifdef REDUCED_RESOLUTION
 #define MAX_XDIM 256
@@ -12,6 +17,8 @@
 #endif
 
 #define CAUSTICS_TEX_SIZE 1024
+//! Cells per side of the obstruction grid (ObstGrid), passed to SurfaceShader.frag.glsl as obstGridCells
+#define OBST_GRID_CELLS 64
 
 #define INITIAL_UMAX 0.125f
 #define BLOCKSIZEX 64
@@ -21,3 +28,14 @@
 #define SMAG_CONST 1.f
 
 enum ContourVariable{VEL_MAG,VEL_U,VEL_V,PRESSURE,STRAIN_RATE,WATER_RENDERING};
+
+//! PING_PONG streams between two lattices. IN_PLACE uses a single lattice (AA pattern): steps alternate between
+//! exchanging with neighbor slots and a purely local update, and after each pair of steps direction i of a node is
+//! stored in the slot of its opposite direction.
+enum StreamingMode{PING_PONG,IN_PLACE};
+
+//! Node codes of the lattice images, one byte per node on the host, on the device and in checkpoints. Images are
+//! zero-initialized, so FLUID has to stay 0. OBSTRUCTION and WALL are both bounce-back nodes; MOVING_WALL is only
+//! drawn, the solver treats it as fluid.
+enum class NodeType : unsigned char{FLUID=0,OBSTRUCTION=1,NEUMANN_EAST=2,DIRICHLET_WEST=3,WALL=10,SYMMETRY_TOP=11,
+    SYMMETRY_BOTTOM=12,MOVING_WALL=20};
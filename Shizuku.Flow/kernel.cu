@@ -32,90 +32,200 @@ __device__ bool IsInsideObst(const float2& p_coord, const ObstDefinition& p_obst
     return abs(p_coord.x - p_obst.x) < r1 + p_tol && abs(p_coord.y - p_obst.y) < r1 + p_tol;
 }
 
+//! Whether the segment rayOrigin-rayDest hits the pillar of p_obst, leaving the hit point in intersect
 __device__ bool GetCoordFromRayHitOnObst(float3 &intersect, const float3 rayOrigin, const float3 rayDest,
-    ObstDefinition* obstructions, float obstHeight, const float tolerance = 0.f)
+    const ObstDefinition& p_obst, float obstHeight)
 {
     float3 rayDir = rayDest - rayOrigin;
     bool hit = false;
-    for (int i = 0; i < MAXOBSTS; i++){
-        if (obstructions[i].state == State::NORMAL)
+    if (p_obst.state == State::NORMAL)
+    {
+        const float3 obstLineP1 = { p_obst.x, p_obst.y, -1.f };
+        const float3 obstLineP2 = { p_obst.x, p_obst.y, obstHeight };
+        const float dist = GetDistanceBetweenTwoLineSegments(rayOrigin, rayDest, obstLineP1, obstLineP2);
+        if (dist < p_obst.r1*2.5f)
         {
-            const float3 obstLineP1 = { obstructions[i].x, obstructions[i].y, -1.f };
-            const float3 obstLineP2 = { obstructions[i].x, obstructions[i].y, obstHeight };
-            const float dist = GetDistanceBetweenTwoLineSegments(rayOrigin, rayDest, obstLineP1, obstLineP2);
-            if (dist < obstructions[i].r1*2.5f)
+            const float x =  p_obst.x;
+            const float y =  p_obst.y;
+            if (p_obst.shape == Shape::SQUARE)
             {
-                const float x =  obstructions[i].x;
-                const float y =  obstructions[i].y;
-                if (obstructions[i].shape == Shape::SQUARE)
-                {
-                    const float r1 = obstructions[i].r1;
-                    const float3 swt = { x - r1, y - r1, obstHeight };//-0.3f*80.f
-                    const float3 set = { x + r1, y - r1, obstHeight };//-0.3f*80.f
-                    const float3 nwt = { x - r1, y + r1, obstHeight };//-0.3f*80.f
-                    const float3 net = { x + r1, y + r1, obstHeight };//-0.3f*80.f
-                    const float3 swb = { x - (r1), y - (r1), -1.f };//-1.f*80.f
-                    const float3 seb = { x + (r1), y - (r1), -1.f };//-1.f*80.f
-                    const float3 nwb = { x - (r1), y + (r1), -1.f };//-1.f*80.f
-                    const float3 neb = { x + (r1), y + (r1), -1.f };//-1.f*80.f
-
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, nwt, swt, swb, nwb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, swt, set, seb, swb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, set, net, neb, seb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, net, nwt, nwb, neb);
-                }
-                else if (obstructions[i].shape == Shape::CIRCLE)
-                {
-                    if (dist < obstructions[i].r1)
-                    {
-                        float3 v = CrossProduct(rayDir, obstLineP1 - obstLineP2);
-                        Normalize(v);
-                        intersect = float3{ x, y, obstHeight*0.5f }+dist*v;
-                        hit = true;
-                    }
-                }
-                else if (obstructions[i].shape == Shape::VERTICAL_LINE)
-                {
-                    const float r1 = LINE_OBST_WIDTH*0.501f;
-                    const float r2 = obstructions[i].r1*2.f;
-                    const float3 swt = { x - r1, y - r2, obstHeight };
-                    const float3 set = { x + r1, y - r2, obstHeight };
-                    const float3 nwt = { x - r1, y + r2, obstHeight };
-                    const float3 net = { x + r1, y + r2, obstHeight };
-                    const float3 swb = { x - (r1), y - (r2), 0.f };
-                    const float3 seb = { x + (r1), y - (r2), 0.f };
-                    const float3 nwb = { x - (r1), y + (r2), 0.f };
-                    const float3 neb = { x + (r1), y + (r2), 0.f };
-
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, nwt, swt, swb, nwb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, swt, set, seb, swb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, set, net, neb, seb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, net, nwt, nwb, neb);
-                }
-                else if (obstructions[i].shape == Shape::HORIZONTAL_LINE)
+                const float r1 = p_obst.r1;
+                const float3 swt = { x - r1, y - r1, obstHeight };//-0.3f*80.f
+                const float3 set = { x + r1, y - r1, obstHeight };//-0.3f*80.f
+                const float3 nwt = { x - r1, y + r1, obstHeight };//-0.3f*80.f
+                const float3 net = { x + r1, y + r1, obstHeight };//-0.3f*80.f
+                const float3 swb = { x - (r1), y - (r1), -1.f };//-1.f*80.f
+                const float3 seb = { x + (r1), y - (r1), -1.f };//-1.f*80.f
+                const float3 nwb = { x - (r1), y + (r1), -1.f };//-1.f*80.f
+                const float3 neb = { x + (r1), y + (r1), -1.f };//-1.f*80.f
+
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, nwt, swt, swb, nwb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, swt, set, seb, swb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, set, net, neb, seb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, net, nwt, nwb, neb);
+            }
+            else if (p_obst.shape == Shape::CIRCLE)
+            {
+                if (dist < p_obst.r1)
                 {
-                    const float r1 = obstructions[i].r1*2.f;
-                    const float r2 = LINE_OBST_WIDTH*0.501f;
-                    const float3 swt = { x - r1, y - r2, obstHeight };
-                    const float3 set = { x + r1, y - r2, obstHeight };
-                    const float3 nwt = { x - r1, y + r2, obstHeight };
-                    const float3 net = { x + r1, y + r2, obstHeight };
-                    const float3 swb = { x - (r1), y - (r2), 0.f };
-                    const float3 seb = { x + (r1), y - (r2), 0.f };
-                    const float3 nwb = { x - (r1), y + (r2), 0.f };
-                    const float3 neb = { x + (r1), y + (r2), 0.f };
-
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, nwt, swt, swb, nwb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, swt, set, seb, swb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, set, net, neb, seb);
-                    hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, net, nwt, nwb, neb);
+                    float3 v = CrossProduct(rayDir, obstLineP1 - obstLineP2);
+                    Normalize(v);
+                    intersect = float3{ x, y, obstHeight*0.5f }+dist*v;
+                    hit = true;
                 }
             }
+            else if (p_obst.shape == Shape::VERTICAL_LINE)
+            {
+                const float r1 = LINE_OBST_WIDTH*0.501f;
+                const float r2 = p_obst.r1*2.f;
+                const float3 swt = { x - r1, y - r2, obstHeight };
+                const float3 set = { x + r1, y - r2, obstHeight };
+                const float3 nwt = { x - r1, y + r2, obstHeight };
+                const float3 net = { x + r1, y + r2, obstHeight };
+                const float3 swb = { x - (r1), y - (r2), 0.f };
+                const float3 seb = { x + (r1), y - (r2), 0.f };
+                const float3 nwb = { x - (r1), y + (r2), 0.f };
+                const float3 neb = { x + (r1), y + (r2), 0.f };
+
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, nwt, swt, swb, nwb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, swt, set, seb, swb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, set, net, neb, seb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, net, nwt, nwb, neb);
+            }
+            else if (p_obst.shape == Shape::HORIZONTAL_LINE)
+            {
+                const float r1 = p_obst.r1*2.f;
+                const float r2 = LINE_OBST_WIDTH*0.501f;
+                const float3 swt = { x - r1, y - r2, obstHeight };
+                const float3 set = { x + r1, y - r2, obstHeight };
+                const float3 nwt = { x - r1, y + r2, obstHeight };
+                const float3 net = { x + r1, y + r2, obstHeight };
+                const float3 swb = { x - (r1), y - (r2), 0.f };
+                const float3 seb = { x + (r1), y - (r2), 0.f };
+                const float3 nwb = { x - (r1), y + (r2), 0.f };
+                const float3 neb = { x + (r1), y + (r2), 0.f };
+
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, nwt, swt, swb, nwb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, swt, set, seb, swb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, set, net, neb, seb);
+                hit = hit | IntersectLineSegmentWithRect(intersect, rayOrigin, rayDest, net, nwt, nwb, neb);
+            }
         }
     }
     return hit;
 }
 
+__device__ int ObstGridCell(const float p_coord, const int p_cellsPerSide)
+{
+    const int cell = floorf((p_coord + 1.f)*0.5f*p_cellsPerSide);
+    return min(max(cell, 0), p_cellsPerSide - 1);
+}
+
+//! Calls p_visit(obstruction) for the obstructions outside the domain and those in the grid cells under the xy
+//! projection of the segment p_from-p_to. Obstructions spanning several of these cells are visited once per cell.
+template <typename Visit>
+__device__ void VisitObstsAlongSegment(const ObstGridView& p_obsts, const float2 p_from, const float2 p_to,
+    Visit p_visit)
+{
+    const int n = p_obsts.CellsPerSide;
+    for (int k = p_obsts.Starts[n*n]; k < p_obsts.Starts[n*n + 1]; ++k)
+        p_visit(p_obsts.Obsts[p_obsts.Items[k]]);
+
+    //clip to the domain, then walk the cells (Amanatides-Woo) with t in [0, 1] along the segment
+    const float from[2] = { p_from.x, p_from.y };
+    const float delta[2] = { p_to.x - p_from.x, p_to.y - p_from.y };
+    float tMin = 0.f;
+    float tMax = 1.f;
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (delta[axis] == 0.f)
+        {
+            if (from[axis] < -1.f || from[axis] > 1.f)
+                return;
+            continue;
+        }
+        float t0 = (-1.f - from[axis]) / delta[axis];
+        float t1 = (1.f - from[axis]) / delta[axis];
+        if (t0 > t1)
+        {
+            const float t = t0;
+            t0 = t1;
+            t1 = t;
+        }
+        tMin = dmax(tMin, t0);
+        tMax = dmin(tMax, t1);
+    }
+    if (tMin > tMax)
+        return;
+
+    const float cellSize = 2.f / n;
+    int cell[2];
+    int step[2];
+    float tNext[2];
+    float tDelta[2];
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        cell[axis] = ObstGridCell(from[axis] + tMin*delta[axis], n);
+        if (delta[axis] > 0.f)
+        {
+            step[axis] = 1;
+            tNext[axis] = (-1.f + (cell[axis] + 1)*cellSize - from[axis]) / delta[axis];
+            tDelta[axis] = cellSize / delta[axis];
+        }
+        else if (delta[axis] < 0.f)
+        {
+            step[axis] = -1;
+            tNext[axis] = (-1.f + cell[axis] * cellSize - from[axis]) / delta[axis];
+            tDelta[axis] = -cellSize / delta[axis];
+        }
+        else
+        {
+            step[axis] = 0;
+            tNext[axis] = 1e30f;
+            tDelta[axis] = 0.f;
+        }
+    }
+
+    while (true)
+    {
+        const int c = cell[0] + cell[1] * n;
+        for (int k = p_obsts.Starts[c]; k < p_obsts.Starts[c + 1]; ++k)
+            p_visit(p_obsts.Obsts[p_obsts.Items[k]]);
+        const int axis = tNext[0] < tNext[1] ? 0 : 1;
+        if (tNext[axis] > tMax)
+            break;
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= n)
+            break;
+        tNext[axis] += tDelta[axis];
+    }
+}
+
+__device__ bool GetCoordFromRayHitOnObst(float3 &intersect, const float3 rayOrigin, const float3 rayDest,
+    const ObstGridView& obstructions, float obstHeight)
+{
+    bool hit = false;
+    VisitObstsAlongSegment(obstructions, make_float2(rayOrigin.x, rayOrigin.y), make_float2(rayDest.x, rayDest.y),
+        [&](const ObstDefinition& p_obst)
+    {
+        hit = hit | GetCoordFromRayHitOnObst(intersect, rayOrigin, rayDest, p_obst, obstHeight);
+    });
+    return hit;
+}
+
+//! Number of obstructions of p_obsts within p_tol of p_coord
+__device__ int CountObstsAt(const float2& p_coord, const ObstGridView& p_obsts, const float p_tol)
+{
+    const int n = p_obsts.CellsPerSide;
+    const int cell = ObstGridCell(p_coord.x, n) + ObstGridCell(p_coord.y, n)*n;
+    int count = 0;
+    for (int k = p_obsts.Starts[n*n]; k < p_obsts.Starts[n*n + 1]; ++k)
+        count += IsInsideObst(p_coord, p_obsts.Obsts[p_obsts.Items[k]], p_tol) ? 1 : 0;
+    for (int k = p_obsts.Starts[cell]; k < p_obsts.Starts[cell + 1]; ++k)
+        count += IsInsideObst(p_coord, p_obsts.Obsts[p_obsts.Items[k]], p_tol) ? 1 : 0;
+    return count;
+}
+
 __device__    float ScaledLength(const int p_l, const int p_maxDim)
 {
     return (float)p_l / (p_maxDim - 1) * 2.f;
@@ -144,37 +254,40 @@ __device__ float ObstructionPickingTol(const int p_xDimVisible)
 }
 
 // Initialize domain using constant velocity
-__global__ void InitializeLBM(float4* vbo, float *f, int *Im, float uMax,
-    Domain simDomain)
+__global__ void InitializeLBM(float *f, float uMax,
+    Domain simDomain, const StreamingMode streamingMode)
 {
     const int x = threadIdx.x + blockIdx.x*blockDim.x;
     const int y = threadIdx.y + blockIdx.y*blockDim.y;
+    if (x >= simDomain.GetPitch() || y >= simDomain.GetYDim())
+        return;
 
-    LbmNode lbm;
-    lbm.Initialize(f, 1.f, uMax, 0.f);
-    lbm.WriteDistributions(f, x, y);
+    LbmNode lbm(simDomain.GetXDim(), simDomain.GetYDim(), simDomain.GetPitch());
+    lbm.Initialize(1.f, uMax, 0.f);
+    if (streamingMode == StreamingMode::IN_PLACE)
+        lbm.WriteOppositeDistributions(f, x, y);
+    else
+        lbm.WriteDistributions(f, x, y);
 }
 
 // main LBM function including streaming and colliding
-__global__ void MarchLBM(float* fA, float* fB, const float omega, int *Im,
-    ObstDefinition *obstructions, const float uMax, Domain simDomain)
+// Launched over the active block list of CudaLbm: block b covers block (b % blocksPerRow, b / blocksPerRow) of the
+// full grid. The Boundary = false instantiation is only launched on all-fluid blocks and never reads the image.
+template <bool Boundary>
+__global__ void MarchLBM(float* fA, float* fB, const float omega, const NodeType* Im, const float uMax, Domain simDomain, const int* activeBlocks, const int blocksPerRow)
 {
-    const int x = threadIdx.x + blockIdx.x*blockDim.x;//coord in linear mem
-    const int y = threadIdx.y + blockIdx.y*blockDim.y;
-    const int j = x + y*MAX_XDIM;
-    const int im = Im[j];
+    const int block = activeBlocks[blockIdx.x];
+    const int x = threadIdx.x + (block % blocksPerRow)*blockDim.x;//coord in linear mem
+    const int y = threadIdx.y + (block / blocksPerRow)*blockDim.y;
     const int xDim = simDomain.GetXDim();
     const int yDim = simDomain.GetYDim();
+    if (x >= xDim || y >= yDim)
+        return;
 
-    LbmNode lbm;
-    lbm.SetXDim(xDim);
-    lbm.SetYDim(yDim);
+    LbmNode lbm(xDim, yDim, simDomain.GetPitch());
     lbm.ReadIncomingDistributions(fA, x, y);
 
-    if (im == 1 || im == 10){//bounce-back condition
-        lbm.BounceBackWall();
-    }
-//    else if (im == 20)
+//    else if (im == NodeType::MOVING_WALL)
 //    {
 //        float rho, u, v;
 //        rho = 1.0f;
@@ -182,30 +295,75 @@ __global__ void MarchLBM(float* fA, float* fB, const float omega, int *Im,
 //        v = obstructions[obstId].v;
 //        lbm.MovingWall(rho, u, v);
 //    }
+    if (Boundary)
+        lbm.Update(y, Im[x + y*simDomain.GetPitch()], uMax, omega);
     else
-    {
-        lbm.ApplyBCs(y, im, xDim, yDim, uMax);
-        lbm.Collide(omega);
-    }
+        lbm.Update<NodeType::FLUID>(y, uMax, omega);
     lbm.WriteDistributions(fB, x, y);
 }
 
-__global__ void UpdateSurfaceVbo(float4* vbo, float* fA, int *Im,
+// Single lattice version of MarchLBM (AA pattern). Launched in pairs: exchange reads from and writes back to the
+// neighbor slots, the following step only touches the node's own slots. The pair gives the same result as two
+// MarchLBM calls, with direction i left in its opposite slot.
+template <bool Boundary>
+__global__ void MarchLBMInPlace(float* f, const bool exchange, const float omega, const NodeType* Im, const float uMax, Domain simDomain, const int* activeBlocks, const int blocksPerRow)
+{
+    const int block = activeBlocks[blockIdx.x];
+    const int x = threadIdx.x + (block % blocksPerRow)*blockDim.x;//coord in linear mem
+    const int y = threadIdx.y + (block / blocksPerRow)*blockDim.y;
+    const int xDim = simDomain.GetXDim();
+    const int yDim = simDomain.GetYDim();
+    if (x >= xDim || y >= yDim)
+        return;
+
+    LbmNode lbm(xDim, yDim, simDomain.GetPitch());
+    if (exchange)
+        lbm.ReadInPlaceIncoming(f, x, y);
+    else
+        lbm.ReadDistributions(f, x, y);
+
+    if (Boundary)
+        lbm.Update(y, Im[x + y*simDomain.GetPitch()], uMax, omega);
+    else
+        lbm.Update<NodeType::FLUID>(y, uMax, omega);
+
+    if (exchange)
+        lbm.WriteInPlaceOutgoing(f, x, y);
+    else
+        lbm.WriteOppositeDistributions(f, x, y);
+}
+
+// rho, u, v and strain rate magnitude of each node, for FieldSnapshot
+__global__ void ComputeFields(float4* p_fields, float* f, const NodeType* Im, Domain simDomain,
+    const StreamingMode streamingMode)
+{
+    const int x = threadIdx.x + blockIdx.x*blockDim.x;//coord in linear mem
+    const int y = threadIdx.y + blockIdx.y*blockDim.y;
+    const int i = x + y*simDomain.GetPitch();
+
+    LbmNode lbm(simDomain.GetXDim(), simDomain.GetYDim(), simDomain.GetPitch());
+    if (streamingMode == StreamingMode::IN_PLACE)
+        lbm.ReadOppositeDistributions(f, x, y);
+    else
+        lbm.ReadDistributions(f, x, y);
+    const float rho = (Im[i] == NodeType::OBSTRUCTION) ? 1.0f : lbm.ComputeRho();
+    p_fields[i] = make_float4(rho, lbm.ComputeU(), lbm.ComputeV(), lbm.ComputeStrainRateMagnitude());
+}
+
+__global__ void UpdateSurfaceVbo(float4* vbo, const float4* p_fields, const NodeType* Im,
     const int contourVar, const float contMin, const float contMax,
-    const float uMax, Domain simDomain, const float waterDepth)
+    Domain simDomain, const float waterDepth)
 {
     const int x = threadIdx.x + blockIdx.x*blockDim.x;//coord in linear mem
     const int y = threadIdx.y + blockIdx.y*blockDim.y;
-    const int j = x + y*MAX_XDIM;
-    const int im = Im[j];
+    const int j = x + y*MAX_XDIM;//index on the surface mesh
+    const int i = x + y*simDomain.GetPitch();
+    const NodeType im = Im[i];
 
-    const int xDim = simDomain.GetXDim();
-    const int yDim = simDomain.GetYDim();
-    LbmNode lbm;
-    lbm.ReadDistributions(fA, x, y);
-    const float rho = (im == 1) ? 1.0 : lbm.ComputeRho();
-    const float u = lbm.ComputeU();
-    const float v = lbm.ComputeV();
+    const float4 fields = p_fields[i];
+    const float rho = fields.x;
+    const float u = fields.y;
+    const float v = fields.z;
 
     const int xDimVisible = simDomain.GetXDimVisible();
     const int yDimVisible = simDomain.GetYDimVisible();
@@ -238,7 +396,7 @@ __global__ void UpdateSurfaceVbo(float4* vbo, float* fA, int *Im,
         }
         else if (contourVar == ContourVariable::STRAIN_RATE)
         {
-            variableValue = lbm.ComputeStrainRateMagnitude();
+            variableValue = fields.w;
         }
 
         ////Blue to white color scheme
@@ -249,7 +407,7 @@ __global__ void UpdateSurfaceVbo(float4* vbo, float* fA, int *Im,
         unsigned char B = 255;
         unsigned char A = 255;
 
-        if (im == 1 || im == 20){
+        if (im == NodeType::OBSTRUCTION || im == NodeType::MOVING_WALL){
             R = 204; G = 204; B = 204;
         }
 
@@ -266,7 +424,7 @@ __global__ void UpdateSurfaceVbo(float4* vbo, float* fA, int *Im,
     vbo[j] = make_float4(coords.x, coords.y, zcoord, color);
 }
 
-__global__ void UpdateSurfaceNormals(float4* vbo, float4* p_normals, Domain simDomain, int* p_image)
+__global__ void UpdateSurfaceNormals(float4* vbo, float4* p_normals, Domain simDomain, const SolidMask p_solid)
 {
     const int x = threadIdx.x + blockIdx.x*blockDim.x;//coord in linear mem
     const int y = threadIdx.y + blockIdx.y*blockDim.y;
@@ -297,10 +455,9 @@ __global__ void UpdateSurfaceNormals(float4* vbo, float4* p_normals, Domain simD
     }
     else if (x > 0 && x < (xDimVisible - 1) && y > 0 && y < (yDimVisible - 1))
     {
-        const int im = p_image[(x + 1) + y * MAX_XDIM] + p_image[(x - 1) + y * MAX_XDIM] +
-            p_image[x + (y + 1)*MAX_XDIM] + p_image[x + (y - 1)*MAX_XDIM] + p_image[x + y * MAX_XDIM];
+        const bool solid = p_solid.Bits(x - 1, y, 3) != 0 || p_solid.IsSolid(x, y + 1) || p_solid.IsSolid(x, y - 1);
 
-        if (im == 0)
+        if (!solid)
         {
             slope_x = (vbo[(x + 1) + y*MAX_XDIM].z - vbo[(x - 1) + y*MAX_XDIM].z) /
                 (2.f*cellSize);
@@ -315,7 +472,7 @@ __global__ void UpdateSurfaceNormals(float4* vbo, float4* p_normals, Domain simD
     p_normals[j] = make_float4(n.x, n.y, n.z, 0.f);
 }
 
-__global__ void PhongLighting(float4* vbo, float4* p_normals, ObstDefinition *obstructions, 
+__global__ void PhongLighting(float4* vbo, float4* p_normals, const ObstDefinition *obstructions,
     float3 cameraPosition, Domain simDomain)
 {
     const int x = threadIdx.x + blockIdx.x*blockDim.x;//coord in linear mem
@@ -429,7 +586,7 @@ __device__ float ComputeAreaFrom4Points(const float2 &nw, const float2 &ne,
 }
 
 __global__ void DeformFloorMeshUsingCausticRay(float4* vbo, float4* p_normals, float3 incidentLight, 
-    ObstDefinition* obstructions, const int p_obstCount, Domain simDomain, const float waterDepth, int* p_image, int* p_floorHit)
+    const ObstGridView obstructions, Domain simDomain, const float waterDepth, const SolidMask p_solid, int* p_floorHit)
 {
     const int x = threadIdx.x + blockIdx.x*blockDim.x;//coord in linear mem
     const int y = threadIdx.y + blockIdx.y*blockDim.y;
@@ -437,29 +594,24 @@ __global__ void DeformFloorMeshUsingCausticRay(float4* vbo, float4* p_normals, f
     const int xDimVisible = simDomain.GetXDimVisible();
     const int yDimVisible = simDomain.GetYDimVisible();
 
-    ObstDefinition obst = obstructions[0];
-    
     const float2 coords = ScaledCoords(x, y, simDomain.GetXDim());
     const float tol = ScaledLength(1, simDomain.GetXDim());
 
     if (x < xDimVisible && y < yDimVisible)
     {
-        for (int i = 0; i < p_obstCount; ++i)
+        //same as once per obstruction not covering the node
+        if (CountObstsAt(coords, obstructions, tol) < obstructions.ObstCount)
         {
-            if (!IsInsideObst(coords, obstructions[i], tol))
-            {
-                const int im = p_image[x + y * MAX_XDIM];
-                const float2 lightPositionOnFloor = ComputePositionOfLightOnFloor(vbo, p_normals, incidentLight,
-                    x, y, simDomain, waterDepth, im != 0);
-                vbo[j + MAX_XDIM*MAX_YDIM].x = lightPositionOnFloor.x;
-                vbo[j + MAX_XDIM*MAX_YDIM].y = lightPositionOnFloor.y;
-            }
+            const float2 lightPositionOnFloor = ComputePositionOfLightOnFloor(vbo, p_normals, incidentLight,
+                x, y, simDomain, waterDepth, p_solid.IsSolid(x, y));
+            vbo[j + MAX_XDIM*MAX_YDIM].x = lightPositionOnFloor.x;
+            vbo[j + MAX_XDIM*MAX_YDIM].y = lightPositionOnFloor.y;
         }
     }
 }
 
 __global__ void ComputeFloorLightIntensitiesFromMeshDeformation(float4* vbo, float* floor_d, 
-    ObstDefinition* obstructions, Domain simDomain, int* p_image, int* p_floorHit)
+    const ObstDefinition* obstructions, Domain simDomain, const SolidMask p_solid, int* p_floorHit)
 {
     const int x = threadIdx.x + blockIdx.x*blockDim.x;//coord in linear mem
     const int y = threadIdx.y + blockIdx.y*blockDim.y;
@@ -469,12 +621,7 @@ __global__ void ComputeFloorLightIntensitiesFromMeshDeformation(float4* vbo, flo
     //const int j = x + y*MAX_XDIM;//index on padded mem (pitch in elements)
     if (x < xDimVisible-2 && y < yDimVisible-2)
     {
-        const int im = p_image[x + y * MAX_XDIM]
-            + p_image[(x + 1) + y * MAX_XDIM]
-            + p_image[(x + 1) + (y + 1)*MAX_XDIM]
-            + p_image[x + (y + 1)*MAX_XDIM];
-
-        if (im == 0)
+        if ((p_solid.Bits(x, y, 2) | p_solid.Bits(x, y + 1, 2)) == 0)
         {
             const int offset = MAX_XDIM*MAX_YDIM;
             const float2 nw = make_float2(vbo[(x)+(y + 1)*MAX_XDIM + offset].x, vbo[(x)+(y + 1)*MAX_XDIM + offset].y);
@@ -496,7 +643,7 @@ __global__ void ComputeFloorLightIntensitiesFromMeshDeformation(float4* vbo, flo
 
 
 __global__ void ApplyCausticLightingToFloor(float4* vbo, float* floor_d, 
-    ObstDefinition* obstructions, Domain simDomain, const float obstHeight)
+    const ObstDefinition* obstructions, Domain simDomain, const float obstHeight)
 {
     const int x = threadIdx.x + blockIdx.x*blockDim.x;
     const int y = threadIdx.y + blockIdx.y*blockDim.y;
@@ -669,7 +816,7 @@ __device__ float2 GetUVCoordsForSkyMap(const float3 &rayOrigin, const float3 &ra
 texture<float4, 2, cudaReadModeElementType> floorTex;
 texture<float4, 2, cudaReadModeElementType> envTex;
 
-__global__ void SurfaceRefraction(float4* vbo, float4* p_normals, ObstDefinition *obstructions,
+__global__ void SurfaceRefraction(float4* vbo, float4* p_normals, const ObstGridView obstructions,
     float3 cameraPosition, Domain simDomain, const bool simplified, const float waterDepth, const float obstHeight)
 {
     const int x = threadIdx.x + blockIdx.x*blockDim.x;//coord in linear mem
@@ -791,17 +938,18 @@ __global__ void SurfaceRefraction(float4* vbo, float4* p_normals, ObstDefinition
  * End of device functions
  */
 
-void InitializeDomain(float4* vis, float* f_d, int* im_d, const float uMax,
-    Domain &simDomain)
+void InitializeDomain(float* f_d, const float uMax,
+    Domain &simDomain, const StreamingMode streamingMode)
 {
     dim3 threads(BLOCKSIZEX, BLOCKSIZEY);
-    dim3 grid(ceil(static_cast<float>(MAX_XDIM) / BLOCKSIZEX), MAX_YDIM / BLOCKSIZEY);
-    InitializeLBM << <grid, threads >> >(vis, f_d, im_d, uMax, simDomain);
+    dim3 grid(ceil(static_cast<float>(simDomain.GetPitch()) / BLOCKSIZEX), simDomain.GetYDim() / BLOCKSIZEY);
+    InitializeLBM << <grid, threads >> >(f_d, uMax, simDomain, streamingMode);
 }
 
-void SetObstructionVelocitiesToZero(ObstDefinition* obst_h, ObstDefinition* obst_d, Domain& simDomain)
+void SetObstructionVelocitiesToZero(ObstDefinition* obst_h, ObstDefinition* obst_d, const int obstCount,
+    Domain& simDomain)
 {
-    for (int i = 0; i < MAXOBSTS; i++)
+    for (int i = 0; i < obstCount; i++)
     {
         if ((abs(obst_h[i].u) > 0.f || abs(obst_h[i].v) > 0.f) &&
             obst_h[i].state != State::SELECTED)
@@ -811,43 +959,80 @@ void SetObstructionVelocitiesToZero(ObstDefinition* obst_h, ObstDefinition* obst
     }
 }
 
-void MarchSolution(CudaLbm* cudaLbm)
+// One step over the active blocks of cudaLbm: the all-fluid blocks with the check-free kernel, then the rest
+void MarchStep(CudaLbm* cudaLbm, float* fIn, float* fOut, const bool exchange, cudaStream_t stream)
 {
     Domain* simDomain = cudaLbm->GetDomain();
-    const int xDim = simDomain->GetXDim();
-    const int yDim = simDomain->GetYDim();
-    const int tStep = cudaLbm->GetTimeStepsPerFrame();
-    float* fA_d = cudaLbm->GetFA();
-    float* fB_d = cudaLbm->GetFB();
-    int* im_d = cudaLbm->GetImage();
-    ObstDefinition* obst_d = cudaLbm->GetDeviceObst();
+    const NodeType* im_d = cudaLbm->GetBoundaryCodes();
     const float u = cudaLbm->GetInletVelocity();
     const float omega = cudaLbm->GetOmega();
+    const int* fluidBlocks = cudaLbm->GetActiveBlocks();
+    const int fluidCount = cudaLbm->GetFluidBlockCount();
+    const int* boundaryBlocks = fluidBlocks + fluidCount;
+    const int boundaryCount = cudaLbm->GetActiveBlockCount() - fluidCount;
+    const int blocksPerRow = cudaLbm->GetBlocksPerRow();
 
     const dim3 threads(BLOCKSIZEX, BLOCKSIZEY);
-    const dim3 grid(ceil(static_cast<float>(xDim) / BLOCKSIZEX), yDim / BLOCKSIZEY);
+    if (cudaLbm->GetStreamingMode() == StreamingMode::IN_PLACE)
+    {
+        if (fluidCount > 0)
+            MarchLBMInPlace<false> << <fluidCount, threads, 0, stream >> >(fIn, exchange, omega, im_d, u,
+                *simDomain, fluidBlocks, blocksPerRow);
+        if (boundaryCount > 0)
+            MarchLBMInPlace<true> << <boundaryCount, threads, 0, stream >> >(fIn, exchange, omega, im_d, u,
+                *simDomain, boundaryBlocks, blocksPerRow);
+        return;
+    }
+    if (fluidCount > 0)
+        MarchLBM<false> << <fluidCount, threads, 0, stream >> >(fIn, fOut, omega, im_d, u, *simDomain,
+            fluidBlocks, blocksPerRow);
+    if (boundaryCount > 0)
+        MarchLBM<true> << <boundaryCount, threads, 0, stream >> >(fIn, fOut, omega, im_d, u, *simDomain,
+            boundaryBlocks, blocksPerRow);
+}
+
+void MarchSolution(CudaLbm* cudaLbm, cudaStream_t stream)
+{
+    const int tStep = cudaLbm->GetTimeStepsPerFrame();
+    float* fA_d = cudaLbm->GetFA();
+    float* fB_d = cudaLbm->GetFB();
+    if (cudaLbm->GetStreamingMode() == StreamingMode::IN_PLACE)
+    {
+        for (int i = 0; i < tStep; i+=2)
+        {
+            MarchStep(cudaLbm, fA_d, fA_d, true, stream);
+            MarchStep(cudaLbm, fA_d, fA_d, false, stream);
+        }
+        return;
+    }
     for (int i = 0; i < tStep; i+=2)
     {
-        MarchLBM << <grid, threads >> >(fA_d, fB_d, omega, im_d, obst_d, u, *simDomain);
-        MarchLBM << <grid, threads >> >(fB_d, fA_d, omega, im_d, obst_d, u, *simDomain);
+        MarchStep(cudaLbm, fA_d, fB_d, false, stream);
+        MarchStep(cudaLbm, fB_d, fA_d, false, stream);
     }
 }
 
-void UpdateSolutionVbo(float4* vis, float4* p_normals, CudaLbm* cudaLbm, const ContourVariable contVar,
-    const float contMin, const float contMax, const float waterDepth)
+void ComputeFieldSnapshot(float4* fields_d, CudaLbm* cudaLbm, cudaStream_t stream)
 {
     Domain* simDomain = cudaLbm->GetDomain();
-    const int xDim = simDomain->GetXDim();
-    const int yDim = simDomain->GetYDim();
-    float* f_d = cudaLbm->GetFA();
-    int* im_d = cudaLbm->GetImage();
-    const float u = cudaLbm->GetInletVelocity();
+    const dim3 threads(BLOCKSIZEX, BLOCKSIZEY);
+    const dim3 grid(ceil(static_cast<float>(simDomain->GetXDim()) / BLOCKSIZEX), simDomain->GetYDim() / BLOCKSIZEY);
+    ComputeFields << <grid, threads, 0, stream >> >(fields_d, cudaLbm->GetFA(), cudaLbm->GetBoundaryCodes(),
+        *simDomain, cudaLbm->GetStreamingMode());
+}
+
+void UpdateSolutionVbo(float4* vis, float4* p_normals, const FieldSnapshot& p_snapshot, const ContourVariable contVar,
+    const float contMin, const float contMax, const float waterDepth)
+{
+    Domain simDomain = p_snapshot.SimDomain;
+    const int xDim = simDomain.GetXDim();
+    const int yDim = simDomain.GetYDim();
 
     const dim3 threads(BLOCKSIZEX, BLOCKSIZEY);
     const dim3 grid(ceil(static_cast<float>(xDim) / BLOCKSIZEX), yDim / BLOCKSIZEY);
-    UpdateSurfaceVbo << <grid, threads >> > (vis, f_d, im_d, contVar, contMin, contMax,
-        u, *simDomain, waterDepth);
-    UpdateSurfaceNormals << <grid, threads >> > (vis, p_normals, *simDomain, im_d);
+    UpdateSurfaceVbo << <grid, threads >> > (vis, p_snapshot.Fields, p_snapshot.BoundaryCodes, contVar, contMin,
+        contMax, simDomain, waterDepth);
+    UpdateSurfaceNormals << <grid, threads >> > (vis, p_normals, simDomain, p_snapshot.GetSolidMask());
 }
 
 void UpdateDeviceObstructions(ObstDefinition* obst_d, const int targetObstID,
@@ -856,14 +1041,14 @@ void UpdateDeviceObstructions(ObstDefinition* obst_d, const int targetObstID,
     UpdateObstructions << <1, 1 >> >(obst_d, targetObstID, newObst);
 }
 
-void SurfacePhongLighting(float4* vis, float4* p_normals, ObstDefinition* obst_d, const float3 cameraPosition,
+void SurfacePhongLighting(float4* vis, float4* p_normals, const ObstGridView& p_obsts, const float3 cameraPosition,
     Domain &simDomain)
 {
     const int xDim = simDomain.GetXDim();
     const int yDim = simDomain.GetYDim();
     const dim3 threads(BLOCKSIZEX, BLOCKSIZEY);
     const dim3 grid(ceil(static_cast<float>(xDim) / BLOCKSIZEX), yDim / BLOCKSIZEY);
-    PhongLighting << <grid, threads>> >(vis, p_normals, obst_d, cameraPosition, simDomain);
+    PhongLighting << <grid, threads>> >(vis, p_normals, p_obsts.Obsts, cameraPosition, simDomain);
 }
 
 void InitializeSurface(float4* vis, Domain &simDomain)
@@ -880,8 +1065,9 @@ void InitializeFloor(float4* vis, Domain &simDomain)
     InitializeMesh << <grid, threads >> >(&vis[MAX_XDIM*MAX_YDIM], simDomain);
 }
 
-void LightFloor(float4* vis, float4* p_normals, float* floor_d, ObstDefinition* obst_d, const int p_obstCount,
-    const float3 cameraPosition, Domain &simDomain, CudaLbm& p_lbm, const float waterDepth, const float obstHeight)
+void LightFloor(float4* vis, float4* p_normals, float* floor_d, const ObstGridView& p_obsts,
+    const float3 cameraPosition, Domain &simDomain, const SolidMask p_solid, int* p_floorHit, const float waterDepth,
+    const float obstHeight)
 {
     const int xDim = simDomain.GetXDim();
     const int yDim = simDomain.GetYDim();
@@ -889,14 +1075,15 @@ void LightFloor(float4* vis, float4* p_normals, float* floor_d, ObstDefinition*
     const dim3 grid(ceil(static_cast<float>(xDim) / BLOCKSIZEX), yDim / BLOCKSIZEY);
     const float3 incidentLight1 = { 0.f, 0.f, -1.f };
     DeformFloorMeshUsingCausticRay << <grid, threads >> >
-        (vis, p_normals, incidentLight1, obst_d, p_obstCount, simDomain, waterDepth, p_lbm.GetImage(), p_lbm.GetFloorHit());
+        (vis, p_normals, incidentLight1, p_obsts, simDomain, waterDepth, p_solid, p_floorHit);
     ComputeFloorLightIntensitiesFromMeshDeformation << <grid, threads >> >
-        (vis, floor_d, obst_d, simDomain, p_lbm.GetImage(), p_lbm.GetFloorHit());
+        (vis, floor_d, p_obsts.Obsts, simDomain, p_solid, p_floorHit);
 
-    ApplyCausticLightingToFloor << <grid, threads >> >(vis, floor_d, obst_d, simDomain, obstHeight);
+    ApplyCausticLightingToFloor << <grid, threads >> >(vis, floor_d, p_obsts.Obsts, simDomain, obstHeight);
 }
 
-void RefractSurface(float4* vis, float4* p_normals, cudaArray* floorLightTexture, cudaArray* envTexture, ObstDefinition* obst_d, const glm::vec4 cameraPos,
+void RefractSurface(float4* vis, float4* p_normals, cudaArray* floorLightTexture, cudaArray* envTexture,
+    const ObstGridView& p_obsts, const glm::vec4 cameraPos,
     Domain &simDomain, const float waterDepth, const float obstHeight, const bool simplified)
 {
     const int xDim = simDomain.GetXDim();
@@ -906,6 +1093,6 @@ void RefractSurface(float4* vis, float4* p_normals, cudaArray* floorLightTexture
     gpuErrchk(cudaBindTextureToArray(floorTex, floorLightTexture));
     gpuErrchk(cudaBindTextureToArray(envTex, envTexture));
     const float3 f3CameraPos = make_float3(cameraPos.x, cameraPos.y, cameraPos.z);
-    SurfaceRefraction << <grid, threads>> >(vis, p_normals, obst_d, f3CameraPos, simDomain, simplified, waterDepth, obstHeight);
+    SurfaceRefraction << <grid, threads>> >(vis, p_normals, p_obsts, f3CameraPos, simDomain, simplified, waterDepth, obstHeight);
 }
 
@@ -0,0 +1,181 @@
+#include "LbmNode.h"
+#include "Solver/ActiveTiles.h"
+#include "Solver/CpuLbm.h"
+#include "Test.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace Shizuku::Core;
+using namespace Shizuku::Flow;
+
+namespace
+{
+    void FillSolid(std::vector<NodeType>& p_image, const int p_pitch, const int p_x0, const int p_x1, const int p_y0,
+        const int p_y1)
+    {
+        for (int y = p_y0; y < p_y1; y++)
+            for (int x = p_x0; x < p_x1; x++)
+                p_image[x + y*p_pitch] = NodeType::OBSTRUCTION;
+    }
+
+    // Marches p_f node by node over the whole lattice, skipping nothing, as the reference for the tiled solver
+    void MarchEveryNode(CpuLbm& p_lbm, std::vector<float>& p_f, const int p_steps)
+    {
+        const int xDim = p_lbm.GetXDim();
+        const int yDim = p_lbm.GetYDim();
+        const int pitch = p_lbm.GetPitch();
+        std::vector<float> fOut(p_f.size());
+        LbmNode node(xDim, yDim, pitch);
+        for (int step = 0; step < p_steps; step++)
+        {
+            for (int y = 0; y < yDim; y++)
+            {
+                for (int x = 0; x < xDim; x++)
+                {
+                    node.ReadIncomingDistributions(p_f.data(), x, y);
+                    node.Update(y, p_lbm.GetImage()[x + y*pitch], p_lbm.GetInletVelocity(), p_lbm.GetOmega());
+                    node.WriteDistributions(fOut.data(), x, y);
+                }
+            }
+            p_f.swap(fOut);
+        }
+    }
+}
+
+// The 48x34 block covers tiles (1..3, 1..2) and their one-node ring, so those six are skipped
+TEST(ActiveTiles, SolidTilesWithTheirRingAreSkipped)
+{
+    const int xDim = 96;
+    const int yDim = 64;
+    std::vector<NodeType> image(xDim*yDim, NodeType::FLUID);
+    FillSolid(image, xDim, 15, 66, 15, 49);
+    ActiveTiles tiles;
+    tiles.Resize(xDim, yDim, 16);
+    tiles.Classify(image.data(), xDim);
+
+    EXPECT_EQ(24, tiles.GetTileCount());
+    EXPECT_EQ(18, tiles.GetActiveTileCount());
+    EXPECT_EQ(ActiveTiles::SOLID, tiles.GetTileType(2, 1));
+    EXPECT_EQ(ActiveTiles::BOUNDARY, tiles.GetTileType(0, 1));
+    EXPECT_EQ(ActiveTiles::BOUNDARY, tiles.GetTileType(4, 2));
+    EXPECT_EQ(ActiveTiles::FLUID, tiles.GetTileType(5, 0));
+
+    //tiles 1 to 3 are skipped; tile 4 holds the last two solid columns, tile 5 is all fluid
+    const std::vector<ActiveTiles::Span>& spans = tiles.RowSpans(20);
+    ASSERT_EQ(3u, spans.size());
+    EXPECT_EQ(0, spans[0].Begin);
+    EXPECT_EQ(16, spans[0].End);
+    EXPECT_TRUE(spans[0].Boundary);
+    EXPECT_EQ(64, spans[1].Begin);
+    EXPECT_EQ(80, spans[1].End);
+    EXPECT_TRUE(spans[1].Boundary);
+    EXPECT_EQ(80, spans[2].Begin);
+    EXPECT_EQ(96, spans[2].End);
+    EXPECT_FALSE(spans[2].Boundary);
+    //a row above the block is one all-fluid span
+    ASSERT_EQ(1u, tiles.RowSpans(5).size());
+    EXPECT_EQ(96, tiles.RowSpans(5)[0].End);
+    EXPECT_FALSE(tiles.RowSpans(5)[0].Boundary);
+}
+
+TEST(ActiveTiles, SleepingTileWakesWhenANeighborChanges)
+{
+    const int xDim = 80;
+    const int yDim = 16;
+    const size_t planeSize = static_cast<size_t>(xDim)*yDim;
+    std::vector<NodeType> image(planeSize, NodeType::FLUID);
+    ActiveTiles tiles;
+    tiles.Resize(xDim, yDim, 16);
+    tiles.Classify(image.data(), xDim);
+    EXPECT_EQ(5, tiles.GetActiveTileCount());
+
+    //only tile 2 changes: it and its neighbors keep running
+    tiles.RowChanges(5)[2] = 0.1f;
+    tiles.RowChanges(6)[1] = 1e-4f;
+    tiles.UpdateSleeping(1e-3f);
+    EXPECT_EQ(3, tiles.GetActiveTileCount());
+    EXPECT_TRUE(tiles.IsAsleep(0, 0));
+    EXPECT_FALSE(tiles.IsAsleep(1, 0));
+    EXPECT_FALSE(tiles.IsAsleep(3, 0));
+    EXPECT_TRUE(tiles.IsAsleep(4, 0));
+    EXPECT_TRUE(tiles.RowSpans(5).size() == 1 && tiles.RowSpans(5)[0].Begin == 16 && tiles.RowSpans(5)[0].End == 64);
+
+    //now only tile 3 changes: sleeping tile 4 next to it wakes, tile 1 falls asleep. The changes of the last step
+    //were reset.
+    tiles.RowChanges(9)[3] = 0.1f;
+    tiles.UpdateSleeping(1e-3f);
+    EXPECT_FALSE(tiles.IsAsleep(4, 0));
+    EXPECT_FALSE(tiles.IsAsleep(2, 0));
+    EXPECT_TRUE(tiles.IsAsleep(1, 0));
+    EXPECT_EQ(3, tiles.GetActiveTileCount());
+
+    //any classification wakes everything
+    tiles.Classify(image.data(), xDim);
+    EXPECT_EQ(5, tiles.GetActiveTileCount());
+}
+
+// Sleeping is decided from the changes the solver records while marching, so it works with temporal blocking (here
+// after every pass of 4 steps) and any storage
+TEST(ActiveTiles, TilesSleepWithTemporalBlockingAndPackedStorage)
+{
+    std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>(2);
+    for (const DistributionStorage storage : { DistributionStorage::FULL, DistributionStorage::FLOAT16 })
+    {
+        CpuLbm lbm(256, 128, pool);
+        lbm.SetDistributionStorage(storage);
+        lbm.SetTemporalBlocking(4, 32);
+        lbm.SetSleepThreshold(1e-3f);
+        lbm.InitializeImage();
+        lbm.Initialize();
+        lbm.March(20);
+        EXPECT_LT(lbm.GetActiveTileCount(), lbm.GetTileCount()) << Packed::StorageName(storage);
+        EXPECT_EQ(4, lbm.GetStepsPerTile());
+
+        lbm.SetSleepThreshold(0.f);
+        lbm.March(4);
+        EXPECT_EQ(lbm.GetTileCount(), lbm.GetActiveTileCount()) << Packed::StorageName(storage);
+    }
+}
+
+// The block covers tiles (1..2, 1) of 32 with their ring. Skipping them changes no fluid node, bit for bit.
+TEST(ActiveTiles, SkippedTilesMatchAFullMarch)
+{
+    std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>(2);
+    CpuLbm lbm(160, 96, pool);
+    lbm.InitializeImage();
+    for (int y = 28; y < 68; y++)
+        for (int x = 28; x < 100; x++)
+            lbm.SetNodeType(x, y, NodeType::OBSTRUCTION);
+    lbm.Initialize();
+    const size_t latticeSize = static_cast<size_t>(lbm.GetPitch())*lbm.GetYDim()*9;
+    std::vector<float> reference(lbm.GetF(), lbm.GetF() + latticeSize);
+
+    const int steps = 30;
+    lbm.March(steps);
+    MarchEveryNode(lbm, reference, steps);
+    EXPECT_EQ(15, lbm.GetTileCount());
+    EXPECT_EQ(13, lbm.GetActiveTileCount());
+
+    const float* f = lbm.GetF();
+    const size_t planeSize = static_cast<size_t>(lbm.GetPitch())*lbm.GetYDim();
+    int differing = 0;
+    for (int y = 0; y < lbm.GetYDim(); y++)
+    {
+        for (int x = 0; x < lbm.GetXDim(); x++)
+        {
+            const size_t j = x + static_cast<size_t>(y)*lbm.GetPitch();
+            if (lbm.GetImage()[j] == NodeType::OBSTRUCTION)
+                continue;
+            for (int i = 0; i < 9; i++)
+            {
+                if (std::memcmp(&f[j + i*planeSize], &reference[j + i*planeSize], sizeof(float)) != 0)
+                {
+                    differing++;
+                    break;
+                }
+            }
+        }
+    }
+    EXPECT_EQ(0, differing);
+}
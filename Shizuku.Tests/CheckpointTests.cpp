@@ -0,0 +1,197 @@
+#include "Simulation.h"
+#include "Solver/Checkpoint.h"
+#include "Solver/CheckpointWriter.h"
+#include "Test.h"
+#include "TestHelpers.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Shizuku::Flow;
+using namespace Shizuku::Test;
+
+namespace
+{
+    std::vector<float> Velocity(Simulation& p_simulation)
+    {
+        std::vector<float> u(static_cast<size_t>(p_simulation.GetXDim())*p_simulation.GetYDim());
+        std::vector<float> v(u.size());
+        p_simulation.GetFields(nullptr, u.data(), v.data());
+        u.insert(u.end(), v.begin(), v.end());
+        return u;
+    }
+}
+
+TEST(Checkpoint, FileRoundTrip)
+{
+    Simulation simulation(70, 30, 1);
+    simulation.AddObstruction(Square(-0.5f, -0.6f, 0.08f));
+    simulation.SetStreamingMode(StreamingMode::IN_PLACE);
+    simulation.SetOmega(1.8f);
+    simulation.Initialize();
+    simulation.Step(10);
+    const Checkpoint saved = simulation.CaptureCheckpoint();
+
+    const std::string path = TempPath("round_trip", ".ckpt");
+    CheckpointFile::Write(path, saved);
+    const Checkpoint loaded = CheckpointFile::Read(path);
+    std::remove(path.c_str());
+
+    EXPECT_EQ(saved.XDim, loaded.XDim);
+    EXPECT_EQ(saved.YDim, loaded.YDim);
+    EXPECT_EQ(StreamingMode::IN_PLACE, loaded.Streaming);
+    EXPECT_EQ(1.8f, loaded.Omega);
+    EXPECT_EQ(saved.InletVelocity, loaded.InletVelocity);
+    EXPECT_EQ(10, loaded.Step);
+    EXPECT_TRUE(saved.Distributions == loaded.Distributions);
+    EXPECT_TRUE(saved.Image == loaded.Image);
+    ASSERT_EQ(1u, loaded.Obsts.size());
+    EXPECT_EQ(-0.5f, loaded.Obsts[0].x);
+    EXPECT_EQ(0.08f, loaded.Obsts[0].r1);
+
+    int solid = 0;
+    for (const NodeType code : loaded.Image)
+        solid += code == NodeType::OBSTRUCTION;
+    EXPECT_GT(solid, 0);
+}
+
+TEST(Checkpoint, RestartContinuesTheSameFlow)
+{
+    for (const StreamingMode mode : { StreamingMode::PING_PONG, StreamingMode::IN_PLACE })
+    {
+        Simulation reference(96, 40, 2);
+        reference.AddObstruction(Square(-0.4f, -0.55f, 0.1f));
+        reference.SetStreamingMode(mode);
+        reference.Initialize();
+        reference.Step(40);
+        const Checkpoint checkpoint = reference.CaptureCheckpoint();
+        reference.Step(40);
+
+        Simulation restarted(96, 40, 2);
+        restarted.RestoreCheckpoint(checkpoint);
+        EXPECT_EQ(40, restarted.GetTimeStep());
+        EXPECT_EQ(1u, restarted.GetObstructions().size());
+        EXPECT_EQ(mode, restarted.GetStreamingMode());
+        restarted.Step(40);
+        EXPECT_EQ(80, restarted.GetTimeStep());
+        EXPECT_TRUE(Velocity(reference) == Velocity(restarted)) << "mode" << mode;
+    }
+}
+
+TEST(Checkpoint, RestoreRejectsOtherDomainSizes)
+{
+    Simulation small(32, 16, 1);
+    Simulation large(64, 16, 1);
+    try
+    {
+        large.RestoreCheckpoint(small.CaptureCheckpoint());
+        FAIL() << "restored a 32 x 16 checkpoint into a 64 x 16 simulation";
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+}
+
+TEST(Checkpoint, RestoreRejectsBuffersThatDontMatchTheDomain)
+{
+    Simulation simulation(32, 16, 1);
+    Checkpoint truncated = simulation.CaptureCheckpoint();
+    truncated.Image.pop_back();
+    Checkpoint empty = simulation.CaptureCheckpoint();
+    empty.Distributions.clear();
+    for (const Checkpoint* checkpoint : { &truncated, &empty })
+    {
+        try
+        {
+            simulation.RestoreCheckpoint(*checkpoint);
+            FAIL() << "restored a checkpoint with short buffers";
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    }
+}
+
+TEST(Checkpoint, ReadRejectsBadFiles)
+{
+    Simulation simulation(32, 16, 1);
+    const std::string path = TempPath("bad", ".ckpt");
+    CheckpointFile::Write(path, simulation.CaptureCheckpoint());
+    std::vector<char> data;
+    {
+        std::ifstream file(path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    const auto rejects = [&](const std::vector<char>& p_data){
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(p_data.data(), p_data.size());
+        }
+        try
+        {
+            CheckpointFile::Read(path);
+            return false;
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+    };
+    std::vector<char> truncated(data.begin(), data.end() - 1);
+    EXPECT_TRUE(rejects(truncated));
+    std::vector<char> otherVersion = data;
+    otherVersion[8]++;
+    EXPECT_TRUE(rejects(otherVersion));
+    std::vector<char> notACheckpoint = data;
+    notACheckpoint[0] = 'X';
+    EXPECT_TRUE(rejects(notACheckpoint));
+    EXPECT_FALSE(rejects(data));
+    std::remove(path.c_str());
+
+    try
+    {
+        CheckpointFile::Read(TempPath("missing", ".ckpt"));
+        FAIL() << "read a missing file";
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+}
+
+TEST(Checkpoint, WriterWritesInTheBackground)
+{
+    Simulation simulation(48, 24, 1);
+    CheckpointWriter writer;
+    const std::string first = TempPath("writer_1", ".ckpt");
+    const std::string second = TempPath("writer_2", ".ckpt");
+    writer.Write(first, simulation.CaptureCheckpoint());
+    simulation.Step(4);
+    writer.Write(second, simulation.CaptureCheckpoint());
+    EXPECT_TRUE(writer.Wait());
+    EXPECT_FALSE(writer.IsBusy());
+    EXPECT_EQ(2, writer.GetWrittenCount());
+    EXPECT_EQ(0, CheckpointFile::Read(first).Step);
+    EXPECT_EQ(4, CheckpointFile::Read(second).Step);
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+
+    writer.Write("no_such_directory/checkpoint.ckpt", simulation.CaptureCheckpoint());
+    EXPECT_FALSE(writer.Wait());
+    EXPECT_FALSE(writer.GetLastError().empty());
+
+    // The error is of the last write only
+    writer.Write(first, simulation.CaptureCheckpoint());
+    EXPECT_TRUE(writer.Wait());
+    EXPECT_TRUE(writer.GetLastError().empty());
+    EXPECT_EQ(3, writer.GetWrittenCount());
+
+    // Replaces the existing file
+    simulation.Step(2);
+    writer.Write(first, simulation.CaptureCheckpoint());
+    EXPECT_TRUE(writer.Wait());
+    EXPECT_EQ(6, CheckpointFile::Read(first).Step);
+    std::remove(first.c_str());
+}
@@ -0,0 +1,298 @@
+#include "Simulation.h"
+#include "Solver/FieldHistory.h"
+#include "Solver/FieldHistoryPrefetcher.h"
+#include "Solver/FieldHistoryWriter.h"
+#include "Test.h"
+#include "TestHelpers.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Shizuku::Flow;
+using namespace Shizuku::Test;
+
+namespace
+{
+    std::vector<FieldFrame> RunFrames(const int p_xDim, const int p_yDim, const int p_count, const int p_interval)
+    {
+        Simulation simulation(p_xDim, p_yDim, 1);
+        simulation.AddObstruction(Square(-0.5f, -0.5f, 0.1f));
+        simulation.Initialize();
+
+        std::vector<FieldFrame> frames;
+        for (int i = 0; i < p_count; i++)
+        {
+            simulation.Step(p_interval);
+            FieldFrame frame;
+            frame.Step = simulation.GetTimeStep();
+            const size_t nodes = static_cast<size_t>(p_xDim)*p_yDim;
+            frame.Rho.resize(nodes);
+            frame.U.resize(nodes);
+            frame.V.resize(nodes);
+            simulation.GetFields(frame.Rho.data(), frame.U.data(), frame.V.data());
+            frames.push_back(frame);
+        }
+        return frames;
+    }
+
+    bool SameBits(const std::vector<float>& p_a, const std::vector<float>& p_b)
+    {
+        return p_a.size() == p_b.size() && std::memcmp(p_a.data(), p_b.data(), p_a.size()*sizeof(float)) == 0;
+    }
+
+    std::vector<char> ReadBytes(const std::string& p_path)
+    {
+        std::ifstream file(p_path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void WriteBytes(const std::string& p_path, const std::vector<char>& p_bytes, const size_t p_size)
+    {
+        std::ofstream file(p_path, std::ios::binary | std::ios::trunc);
+        file.write(p_bytes.data(), p_size);
+    }
+}
+
+TEST(FieldHistory, RoundTripIsLossless)
+{
+    //tiles don't divide the domain, so the last row and column of tiles are partial
+    const int xDim = 150;
+    const int yDim = 70;
+    const std::vector<FieldFrame> frames = RunFrames(xDim, yDim, 3, 20);
+    const std::string path = TempPath("round_trip", ".hist");
+    unsigned long long bytes;
+    {
+        FieldHistoryAppender appender(path, xDim, yDim, 32);
+        for (const FieldFrame& frame : frames)
+            appender.Append(frame);
+        appender.Close();
+        bytes = appender.GetBytesWritten();
+    }
+
+    FieldHistoryReader reader;
+    reader.Open(path);
+    EXPECT_EQ(xDim, reader.GetXDim());
+    EXPECT_EQ(yDim, reader.GetYDim());
+    EXPECT_EQ(5, reader.GetTilesX());
+    EXPECT_EQ(3, reader.GetTilesY());
+    EXPECT_FALSE(reader.IsRecovered());
+    ASSERT_EQ(3, reader.GetFrameCount());
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(frames[i].Step, reader.GetStep(i));
+        std::vector<float> rho(xDim*yDim), u(xDim*yDim), v(xDim*yDim);
+        reader.ReadFrame(i, rho.data(), u.data(), v.data());
+        EXPECT_TRUE(SameBits(frames[i].Rho, rho)) << "frame " << i;
+        EXPECT_TRUE(SameBits(frames[i].U, u)) << "frame " << i;
+        EXPECT_TRUE(SameBits(frames[i].V, v)) << "frame " << i;
+    }
+
+    //a corner tile on its own
+    const int width = reader.GetTileWidth(4);
+    const int height = reader.GetTileHeight(2);
+    EXPECT_EQ(22, width);
+    EXPECT_EQ(6, height);
+    std::vector<float> u(width*height);
+    reader.ReadTile(1, 4, 2, nullptr, u.data(), nullptr);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+            ASSERT_EQ(frames[1].U[128 + x + (64 + y)*xDim], u[x + y*width]);
+    }
+
+    //smooth fields shrink
+    EXPECT_LT(bytes, 3ull*xDim*yDim*3*sizeof(float)*3/4);
+    std::remove(path.c_str());
+}
+
+TEST(FieldHistory, NoiseIsStoredExactly)
+{
+    FieldFrame frame;
+    frame.Step = 7;
+    std::srand(1);
+    for (int i = 0; i < 40*40; i++)
+    {
+        frame.Rho.push_back(static_cast<float>(std::rand()) / RAND_MAX);
+        frame.U.push_back(static_cast<float>(std::rand()) - RAND_MAX/2);
+        frame.V.push_back(0.f);
+    }
+    const std::string path = TempPath("noise", ".hist");
+    {
+        FieldHistoryAppender appender(path, 40, 40, 16);
+        appender.Append(frame);
+    }
+
+    FieldHistoryReader reader;
+    reader.Open(path);
+    ASSERT_EQ(1, reader.GetFrameCount());
+    std::vector<float> rho(40*40), u(40*40), v(40*40, 1.f);
+    reader.ReadFrame(0, rho.data(), u.data(), v.data());
+    EXPECT_TRUE(SameBits(frame.Rho, rho));
+    EXPECT_TRUE(SameBits(frame.U, u));
+    EXPECT_TRUE(SameBits(frame.V, v));
+    std::remove(path.c_str());
+}
+
+TEST(FieldHistory, FindsFramesByStep)
+{
+    const std::vector<FieldFrame> frames = RunFrames(40, 20, 4, 5);
+    const std::string path = TempPath("find", ".hist");
+    {
+        FieldHistoryAppender appender(path, 40, 20);
+        for (const FieldFrame& frame : frames)
+            appender.Append(frame);
+    }
+
+    FieldHistoryReader reader;
+    reader.Open(path);
+    EXPECT_EQ(-1, reader.FindFrame(4));
+    EXPECT_EQ(0, reader.FindFrame(5));
+    EXPECT_EQ(0, reader.FindFrame(9));
+    EXPECT_EQ(2, reader.FindFrame(15));
+    EXPECT_EQ(3, reader.FindFrame(1000));
+    std::remove(path.c_str());
+}
+
+TEST(FieldHistory, UnclosedFileIsReadUpToItsLastFrame)
+{
+    const std::vector<FieldFrame> frames = RunFrames(64, 32, 3, 10);
+    const std::string path = TempPath("unclosed", ".hist");
+    {
+        FieldHistoryAppender appender(path, 64, 32);
+        for (const FieldFrame& frame : frames)
+            appender.Append(frame);
+    }
+    const std::vector<char> bytes = ReadBytes(path);
+    //3 index entries and the trailer
+    const size_t framesEnd = bytes.size() - 3*16 - 24;
+
+    FieldHistoryReader reader;
+    WriteBytes(path, bytes, framesEnd);
+    reader.Open(path);
+    EXPECT_TRUE(reader.IsRecovered());
+    ASSERT_EQ(3, reader.GetFrameCount());
+    std::vector<float> v(64*32);
+    reader.ReadFrame(2, nullptr, nullptr, v.data());
+    EXPECT_TRUE(SameBits(frames[2].V, v));
+
+    //cut into the last frame, as if the run died while writing it
+    WriteBytes(path, bytes, framesEnd - 10);
+    reader.Open(path);
+    EXPECT_EQ(2, reader.GetFrameCount());
+    std::remove(path.c_str());
+}
+
+TEST(FieldHistory, RejectsOtherFiles)
+{
+    FieldHistoryReader reader;
+    const std::string path = TempPath("not_history", ".hist");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "certainly not a field history file, but long enough to hold a header";
+    }
+    bool threw = false;
+    try
+    {
+        reader.Open(path);
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    EXPECT_TRUE(threw);
+    std::remove(path.c_str());
+
+    threw = false;
+    try
+    {
+        reader.Open(TempPath("missing", ".hist"));
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    EXPECT_TRUE(threw);
+}
+
+TEST(FieldHistory, WriterRecordsInTheBackground)
+{
+    const std::vector<FieldFrame> frames = RunFrames(80, 40, 5, 4);
+    const std::string path = TempPath("writer", ".hist");
+    FieldHistoryWriter writer(path, 80, 40, 32, 1);
+    for (const FieldFrame& frame : frames)
+    {
+        FieldFrame staged = writer.AcquireFrame();
+        ASSERT_EQ(frame.Rho.size(), staged.Rho.size());
+        staged.Step = frame.Step;
+        staged.Rho = frame.Rho;
+        staged.U = frame.U;
+        staged.V = frame.V;
+        writer.Append(std::move(staged));
+    }
+    EXPECT_TRUE(writer.Close()) << writer.GetLastError();
+    EXPECT_EQ(5, writer.GetWrittenCount());
+    EXPECT_GT(writer.GetBytesWritten(), 0ull);
+
+    FieldHistoryReader reader;
+    reader.Open(path);
+    ASSERT_EQ(5, reader.GetFrameCount());
+    for (int i = 0; i < 5; i++)
+    {
+        std::vector<float> rho(80*40);
+        reader.ReadFrame(i, rho.data(), nullptr, nullptr);
+        EXPECT_EQ(frames[i].Step, reader.GetStep(i));
+        EXPECT_TRUE(SameBits(frames[i].Rho, rho)) << "frame " << i;
+    }
+    std::remove(path.c_str());
+}
+
+TEST(FieldHistory, PrefetcherPlaysFramesInOrder)
+{
+    const std::vector<FieldFrame> frames = RunFrames(64, 32, 4, 3);
+    const std::string path = TempPath("prefetch", ".hist");
+    {
+        FieldHistoryAppender appender(path, 64, 32);
+        for (const FieldFrame& frame : frames)
+            appender.Append(frame);
+    }
+    auto reader = std::make_shared<FieldHistoryReader>();
+    reader->Open(path);
+
+    {
+        FieldHistoryPrefetcher once(reader, 2, false);
+        for (int i = 0; i < 4; i++)
+        {
+            const FieldFrame* frame = once.Acquire();
+            ASSERT_TRUE(frame != nullptr) << "frame " << i;
+            EXPECT_EQ(frames[i].Step, frame->Step);
+            EXPECT_TRUE(SameBits(frames[i].U, frame->U)) << "frame " << i;
+        }
+        EXPECT_TRUE(once.Acquire() == nullptr);
+    }
+
+    FieldHistoryPrefetcher looping(reader, 3, true);
+    for (int i = 0; i < 10; i++)
+    {
+        const FieldFrame* frame = looping.Acquire();
+        ASSERT_TRUE(frame != nullptr);
+        EXPECT_EQ(frames[i % 4].Step, frame->Step);
+    }
+    looping.Seek(2);
+    const FieldFrame* frame = looping.Acquire();
+    ASSERT_TRUE(frame != nullptr);
+    EXPECT_EQ(frames[2].Step, frame->Step);
+    EXPECT_TRUE(SameBits(frames[2].Rho, frame->Rho));
+    //TryAcquire never blocks, but the frame after shows up eventually
+    const FieldFrame* next = nullptr;
+    while (next == nullptr)
+        next = looping.TryAcquire();
+    EXPECT_EQ(frames[3].Step, next->Step);
+    EXPECT_TRUE(looping.GetLastError().empty());
+    std::remove(path.c_str());
+}
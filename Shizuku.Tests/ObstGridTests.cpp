@@ -0,0 +1,214 @@
+#include "Graphics/ObstGrid.h"
+#include "Test.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Shizuku::Core::Types;
+using namespace Shizuku::Flow;
+
+namespace
+{
+    // Stands in for Obst, which needs a GL context
+    struct Item
+    {
+        ObstDefinition Definition;
+        bool Removed;
+
+        const ObstDefinition& Def()
+        {
+            return Definition;
+        }
+    };
+
+    typedef ObstGridT<Item> Grid;
+    typedef std::array<float, 3> Vec3;
+
+    float FootprintRadius(const ObstDefinition& p_def)
+    {
+        const bool line = p_def.shape == Shape::HORIZONTAL_LINE || p_def.shape == Shape::VERTICAL_LINE;
+        return (line ? 2.5f : 1.f)*std::abs(p_def.r1);
+    }
+
+    bool Contains(const ObstDefinition& p_def, const Point<float>& p_point)
+    {
+        const float r = FootprintRadius(p_def);
+        return std::abs(p_point.X - p_def.x) <= r && std::abs(p_point.Y - p_def.y) <= r;
+    }
+
+    // Whether the ray (t >= 0) spends more than a sliver inside the footprint box between p_zMin and p_zMax, so
+    // rays grazing an edge don't depend on rounding
+    bool Crosses(const ObstDefinition& p_def, const Vec3& p_origin, const Vec3& p_dir, const float p_zMin,
+        const float p_zMax)
+    {
+        const float r = FootprintRadius(p_def);
+        const float low[3] = { p_def.x - r, p_def.y - r, p_zMin };
+        const float high[3] = { p_def.x + r, p_def.y + r, p_zMax };
+        float tMin = 0.f;
+        float tMax = 1e30f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (p_dir[axis] == 0.f)
+            {
+                if (p_origin[axis] <= low[axis] + 1e-4f || p_origin[axis] >= high[axis] - 1e-4f)
+                    return false;
+                continue;
+            }
+            float t0 = (low[axis] - p_origin[axis]) / p_dir[axis];
+            float t1 = (high[axis] - p_origin[axis]) / p_dir[axis];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            tMin = std::max(tMin, t0);
+            tMax = std::min(tMax, t1);
+        }
+        return tMax - tMin > 1e-4f;
+    }
+
+    ObstDefinition RandomObst(std::mt19937& p_random)
+    {
+        //centers up to 0.2 outside the domain, so plenty of footprints cross its edge
+        std::uniform_real_distribution<float> center(-1.2f, 1.2f);
+        std::uniform_real_distribution<float> radius(0.01f, 0.15f);
+        ObstDefinition def = {};
+        def.shape = static_cast<int>(p_random() % 4);
+        def.x = center(p_random);
+        def.y = center(p_random);
+        def.r1 = radius(p_random);
+        def.r2 = def.r1;
+        return def;
+    }
+
+    class GridFixture
+    {
+    public:
+        Grid Cells;
+        std::vector<std::shared_ptr<Item>> Items;
+        std::mt19937 Random;
+
+        GridFixture(const int p_count) : Cells(16), Random(7)
+        {
+            for (int i = 0; i < p_count; i++)
+            {
+                Items.push_back(std::make_shared<Item>(Item{ RandomObst(Random), false }));
+                Cells.Insert(Items.back());
+            }
+        }
+
+        // Obstructions the ray crosses that AlongRay misses, plus removed or repeated ones it returns
+        int RayErrors(const Vec3& p_origin, const Vec3& p_dir, const float p_zMin, const float p_zMax)
+        {
+            std::vector<std::shared_ptr<Item>> found = Cells.AlongRay(p_origin, p_dir, p_zMin, p_zMax);
+            std::sort(found.begin(), found.end());
+            int errors = static_cast<int>(found.end() - std::unique(found.begin(), found.end()));
+            for (const auto& item : found)
+            {
+                if (item->Removed)
+                    errors++;
+            }
+            for (const auto& item : Items)
+            {
+                if (!item->Removed && Crosses(item->Definition, p_origin, p_dir, p_zMin, p_zMax)
+                    && !std::binary_search(found.begin(), found.end(), item))
+                    errors++;
+            }
+            return errors;
+        }
+
+        // Whether FindAt and a scan over every live obstruction disagree about p_point, or FindAt visits a removed one
+        bool PointError(const Point<float>& p_point)
+        {
+            bool visitedRemoved = false;
+            const bool found = Cells.FindAt(p_point, [&](Item& p_item){
+                visitedRemoved = visitedRemoved || p_item.Removed;
+                return Contains(p_item.Definition, p_point);
+            });
+            bool expected = false;
+            for (const auto& item : Items)
+                expected = expected || (!item->Removed && Contains(item->Definition, p_point));
+            return visitedRemoved || found != expected;
+        }
+
+        // Random points, and random rays from above the domain, skew and parallel to the axes
+        int QueryErrors(const int p_queries)
+        {
+            std::uniform_real_distribution<float> coord(-1.3f, 1.3f);
+            std::uniform_real_distribution<float> slope(-1.f, 1.f);
+            int errors = 0;
+            for (int query = 0; query < p_queries; query++)
+            {
+                if (PointError(Point<float>(coord(Random), coord(Random))))
+                    errors++;
+                const Vec3 origin = { coord(Random), coord(Random), 0.5f };
+                errors += RayErrors(origin, { slope(Random), slope(Random), -0.5f }, -1.f, -0.5f);
+                errors += RayErrors(origin, { slope(Random), 0.f, -0.3f }, -1.f, -0.5f);
+                errors += RayErrors(origin, { 0.f, slope(Random), -0.3f }, -1.f, -0.5f);
+                errors += RayErrors(origin, { 0.f, 0.f, -1.f }, -1.f, -0.5f);
+                //horizontal rays inside the slab
+                const Vec3 level = { origin[0], origin[1], -0.7f };
+                errors += RayErrors(level, { slope(Random), slope(Random), 0.f }, -1.f, -0.5f);
+                errors += RayErrors(level, { 1.f, 0.f, 0.f }, -1.f, -0.5f);
+                errors += RayErrors(level, { 0.f, -1.f, 0.f }, -1.f, -0.5f);
+            }
+            return errors;
+        }
+    };
+}
+
+TEST(ObstGrid, QueriesMatchAScanOverEveryObstruction)
+{
+    GridFixture fixture(200);
+    EXPECT_EQ(0, fixture.QueryErrors(2000));
+}
+
+TEST(ObstGrid, QueriesFollowUpdatesAndRemovals)
+{
+    GridFixture fixture(200);
+    //move some obstructions across cells and out of and back into the domain, then remove others
+    for (int i = 0; i < 80; i++)
+    {
+        fixture.Items[i]->Definition = RandomObst(fixture.Random);
+        fixture.Cells.Update(fixture.Items[i]);
+    }
+    for (int i = 60; i < 120; i++)
+    {
+        fixture.Items[i]->Removed = true;
+        fixture.Cells.Remove(fixture.Items[i]);
+    }
+    //removing twice is harmless
+    fixture.Cells.Remove(fixture.Items[60]);
+    EXPECT_EQ(0, fixture.QueryErrors(2000));
+
+    fixture.Cells.Clear();
+    for (const auto& item : fixture.Items)
+        item->Removed = true;
+    EXPECT_EQ(0, fixture.QueryErrors(100));
+}
+
+// Footprints reaching outside the domain are visited by every query; the rest only from their own cells
+TEST(ObstGrid, FlattenListsOutsideFootprintsLast)
+{
+    Grid grid(4);
+    std::vector<std::shared_ptr<Item>> items;
+    //inside cell (1, 1) only, and across the left edge
+    items.push_back(std::make_shared<Item>(Item{ ObstDefinition{ Shape::SQUARE, -0.25f, -0.25f, 0.1f }, false }));
+    items.push_back(std::make_shared<Item>(Item{ ObstDefinition{ Shape::SQUARE, -0.95f, 0.25f, 0.1f }, false }));
+    std::unordered_map<const Item*, int> indices;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        grid.Insert(items[i]);
+        indices[items[i].get()] = static_cast<int>(i);
+    }
+
+    std::vector<int> starts;
+    std::vector<int> cellItems;
+    grid.Flatten(indices, starts, cellItems);
+    ASSERT_EQ(18u, starts.size());
+    ASSERT_EQ(2u, cellItems.size());
+    EXPECT_EQ(1, starts[6] - starts[5]);
+    EXPECT_EQ(0, cellItems[starts[5]]);
+    EXPECT_EQ(1, starts[17] - starts[16]);
+    EXPECT_EQ(1, cellItems[starts[16]]);
+}
@@ -0,0 +1,290 @@
+#include "Shizuku.Core/Utilities/Profiler.h"
+#include "Test.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Shizuku::Core;
+
+namespace
+{
+    ZoneStats Stats(const char* p_name)
+    {
+        return Profiler::GetStats()[Profiler::ZoneId(p_name)];
+    }
+}
+
+TEST(Profiler, DisabledZonesRecordNothing)
+{
+    Profiler::Enable(false);
+    Profiler::Reset();
+    for (int i = 0; i < 10; i++)
+    {
+        SHIZUKU_ZONE("Disabled");
+    }
+    Profiler::Collect();
+    EXPECT_EQ(0, Stats("Disabled").Count);
+}
+
+//SHIZUKU_ZONE is compiled out without the profiler
+#ifndef SHIZUKU_NO_PROFILER
+namespace
+{
+    void Spin(const double p_seconds)
+    {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(p_seconds);
+        while (std::chrono::steady_clock::now() < end)
+        {
+        }
+    }
+}
+
+TEST(Profiler, ZonesNest)
+{
+    Profiler::Enable(true);
+    Profiler::Reset();
+    for (int i = 0; i < 3; i++)
+    {
+        SHIZUKU_ZONE("Outer");
+        Spin(1e-4);
+        {
+            const ScopedZone inner(Profiler::ZoneId("Inner"));
+            Spin(1e-3);
+        }
+    }
+    Profiler::Collect();
+    Profiler::Enable(false);
+
+    const ZoneStats outer = Stats("Outer");
+    const ZoneStats inner = Stats("Inner");
+    EXPECT_EQ(3, outer.Count);
+    EXPECT_EQ(3, inner.Count);
+    EXPECT_EQ(-1, outer.Parent);
+    EXPECT_EQ(0, outer.Depth);
+    EXPECT_EQ(Profiler::ZoneId("Outer"), inner.Parent);
+    EXPECT_EQ(1, inner.Depth);
+    EXPECT_LE(1e-3, inner.Average);
+    EXPECT_LT(inner.Total, outer.Total);
+    EXPECT_LE(inner.Last, inner.Max);
+    EXPECT_NEAR(outer.Total / 3, outer.Average, 1e-9);
+    EXPECT_EQ(outer.Average, Profiler::GetAverage("Outer"));
+    EXPECT_EQ(0.0, Profiler::GetAverage("Never registered"));
+}
+
+//counters may not be there at all, in a VM or under a strict perf_event_paranoid, so only what is there is checked
+TEST(Profiler, PerfCountersAdvance)
+{
+    CounterSample before;
+    if (!PerfCounters::Read(before))
+    {
+        EXPECT_EQ(0, before.TaskClock);
+        EXPECT_FALSE(PerfCounters::HasHardwareCounters());
+        return;
+    }
+    Spin(1e-3);
+    CounterSample after;
+    ASSERT_TRUE(PerfCounters::Read(after));
+    const CounterSample spent = after - before;
+    EXPECT_LT(0, spent.TaskClock);
+    if (PerfCounters::HasHardwareCounters())
+    {
+        EXPECT_LT(0, spent.Cycles);
+        EXPECT_LT(0, spent.Instructions);
+        EXPECT_LT(0.0, PerfCounters::Ipc(spent));
+    }
+}
+
+TEST(Profiler, CountedZonesAddUpCounters)
+{
+    Profiler::Enable(true);
+    Profiler::EnableCounters(false);
+    Profiler::Reset();
+    {
+        SHIZUKU_COUNTED_ZONE("Counted");
+    }
+    Profiler::Collect();
+    EXPECT_EQ(1, Stats("Counted").Count);
+    EXPECT_EQ(0, Stats("Counted").CountedRuns);
+
+    Profiler::EnableCounters(true);
+    Profiler::Reset();
+    for (int i = 0; i < 3; i++)
+    {
+        SHIZUKU_COUNTED_ZONE("Counted");
+        Spin(1e-3);
+        SHIZUKU_ZONE("Uncounted");
+    }
+    Profiler::Collect();
+    Profiler::EnableCounters(false);
+    Profiler::Enable(false);
+
+    CounterSample probe;
+    const bool available = PerfCounters::Read(probe);
+    const ZoneStats counted = Stats("Counted");
+    EXPECT_EQ(3, counted.Count);
+    EXPECT_EQ(available ? 3 : 0, counted.CountedRuns);
+    EXPECT_EQ(0, Stats("Uncounted").CountedRuns);
+    if (available)
+    {
+        EXPECT_LE(1000000*counted.CountedRuns/2, counted.Counters.TaskClock);
+    }
+    if (PerfCounters::HasHardwareCounters())
+    {
+        EXPECT_LT(0, counted.Counters.Instructions);
+    }
+}
+
+// Work goes to the innermost open zone of the reporting thread, and adds up over threads for the counted runs
+TEST(Profiler, CountedZonesAddUpWork)
+{
+    Profiler::Enable(true);
+    Profiler::EnableCounters(true);
+    Profiler::Reset();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 3; i++)
+    {
+        threads.push_back(std::thread([i](){
+            SHIZUKU_COUNTED_ZONE("Worked");
+            SHIZUKU_ZONE_WORK(100.0*(i + 1));
+            {
+                SHIZUKU_ZONE("Inner");
+                SHIZUKU_ZONE_WORK(1.0);
+            }
+        }));
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    Profiler::Collect();
+    Profiler::EnableCounters(false);
+    Profiler::Enable(false);
+
+    CounterSample probe;
+    const ZoneStats worked = Stats("Worked");
+    EXPECT_EQ(3, worked.Count);
+    EXPECT_EQ(PerfCounters::Read(probe) ? 600.0 : 0.0, worked.CountedWork);
+    //only counted runs keep their work
+    EXPECT_EQ(0.0, Stats("Inner").CountedWork);
+}
+#endif
+
+TEST(Profiler, ThreadsAndDynamicNamesAreCollected)
+{
+    Profiler::Enable(true);
+    Profiler::Reset();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([t]{
+            for (int i = 0; i < 100; i++)
+            {
+                const ScopedZone worker(Profiler::ZoneId("Worker"));
+                const ScopedZone zone("Worker " + std::to_string(t));
+            }
+        }));
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    //the threads are gone, but what they recorded isn't
+    Profiler::Collect();
+    Profiler::Enable(false);
+
+    EXPECT_EQ(400, Stats("Worker").Count);
+    for (int t = 0; t < 4; t++)
+    {
+        const std::string name = "Worker " + std::to_string(t);
+        EXPECT_EQ(100, Stats(name.c_str()).Count) << name;
+        EXPECT_EQ(Profiler::ZoneId("Worker"), Stats(name.c_str()).Parent);
+    }
+    EXPECT_EQ(0, Profiler::GetDroppedCount());
+}
+
+TEST(Profiler, FullRingDropsZones)
+{
+    Profiler::Enable(true);
+    Profiler::Reset();
+    const int count = Profiler::RingCapacity + 10;
+    for (int i = 0; i < count; i++)
+    {
+        const ScopedZone zone(Profiler::ZoneId("Flood"));
+    }
+    Profiler::Collect();
+    EXPECT_EQ(Profiler::RingCapacity, Stats("Flood").Count);
+    EXPECT_EQ(10, Profiler::GetDroppedCount());
+
+    //drained, so there is room again
+    {
+        const ScopedZone zone(Profiler::ZoneId("Flood"));
+    }
+    Profiler::Collect();
+    Profiler::Enable(false);
+    EXPECT_EQ(Profiler::RingCapacity + 1, Stats("Flood").Count);
+}
+
+TEST(Profiler, TraceHoldsEveryZone)
+{
+    Profiler::SetThreadName("Test \"main\"");
+    Profiler::StartTrace();
+    for (int i = 0; i < 2; i++)
+    {
+        const ScopedZone frame(Profiler::ZoneId("Frame"));
+        const ScopedZone stage(Profiler::ZoneId("Stage"));
+    }
+    std::thread([]{
+        Profiler::SetThreadName("Helper");
+        const ScopedZone zone(Profiler::ZoneId("Helping"));
+    }).join();
+    Profiler::Collect();
+    Profiler::StopTrace();
+    Profiler::Enable(false);
+    //after the trace stopped
+    {
+        const ScopedZone zone(Profiler::ZoneId("Late"));
+    }
+    Profiler::Collect();
+
+    const std::string path = "shizuku_test_trace.json";
+    ASSERT_TRUE(Profiler::WriteTrace(path));
+    std::ifstream file(path);
+    const std::string trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+
+    const auto count = [&](const std::string& p_text){
+        int found = 0;
+        for (size_t at = trace.find(p_text); at != std::string::npos; at = trace.find(p_text, at + 1))
+            found++;
+        return found;
+    };
+    EXPECT_EQ(2, count("{\"name\": \"Frame\", \"ph\": \"X\""));
+    EXPECT_EQ(2, count("{\"name\": \"Stage\", \"ph\": \"X\""));
+    EXPECT_EQ(1, count("{\"name\": \"Helping\", \"ph\": \"X\""));
+    EXPECT_EQ(0, count("\"Late\""));
+    EXPECT_EQ(1, count("\"args\": {\"name\": \"Test \\\"main\\\"\"}"));
+    EXPECT_EQ(1, count("\"args\": {\"name\": \"Helper\"}"));
+    EXPECT_EQ(0, trace.find("{\"displayTimeUnit\""));
+    EXPECT_EQ(trace.size() - 4, trace.rfind("\n]}\n"));
+}
+
+TEST(Profiler, ZoneStatsHavePercentiles)
+{
+    Profiler::Enable(true);
+    Profiler::Reset();
+    for (int i = 0; i < 50; i++)
+    {
+        const ScopedZone zone(Profiler::ZoneId("Percentiles"));
+    }
+    Profiler::Collect();
+    Profiler::Enable(false);
+
+    const ZoneStats stats = Profiler::GetStats("Percentiles");
+    EXPECT_EQ(50, stats.Count);
+    EXPECT_LE(stats.P50, stats.P90);
+    EXPECT_LE(stats.P90, stats.P99);
+    EXPECT_LE(stats.P99, stats.Max);
+    EXPECT_LT(0.0, stats.Max);
+    EXPECT_EQ(0, Profiler::GetStats("Never run").Count);
+}
@@ -0,0 +1,109 @@
+#include "Shizuku.Cli/Scenario.h"
+#include "Test.h"
+#include <stdexcept>
+
+using namespace Shizuku::Cli;
+using namespace Shizuku::Flow;
+
+TEST(Scenario, ParsesEverySetting)
+{
+    const Scenario scenario = Scenario::Parse(
+        "# comment line\n"
+        "domain 300 100\n"
+        "velocity 0.07   # trailing comment\n"
+        "omega 1.9\n"
+        "threads 3\n"
+        "\n"
+        "precision fp64\n"
+        "storage bf16\n"
+        "streaming inplace\n"
+        "sleep 1e-6\n"
+        "obst square -0.5 -0.6 0.05\n"
+        "obst square 0.1 -0.4 0.02\n"
+        "steps 1234\n"
+        "output 100 out/run\n"
+        "checkpoint 500 out/state\n"
+        "history 10 out/run.hist\n"
+        "restart out/state_500.ckpt\n");
+    EXPECT_EQ(300, scenario.XDim);
+    EXPECT_EQ(100, scenario.YDim);
+    EXPECT_FLOAT_EQ(0.07f, scenario.InletVelocity);
+    EXPECT_FLOAT_EQ(1.9f, scenario.Omega);
+    EXPECT_EQ(3, scenario.ThreadCount);
+    EXPECT_EQ(Precision::FP64, scenario.Precision);
+    EXPECT_EQ(DistributionStorage::BFLOAT16, scenario.Storage);
+    EXPECT_EQ(StreamingMode::IN_PLACE, scenario.Streaming);
+    EXPECT_FLOAT_EQ(1e-6f, scenario.SleepThreshold);
+    ASSERT_EQ(2u, scenario.Obsts.size());
+    EXPECT_FLOAT_EQ(-0.5f, scenario.Obsts[0].x);
+    EXPECT_FLOAT_EQ(0.02f, scenario.Obsts[1].r1);
+    EXPECT_EQ(1234, scenario.Steps);
+    EXPECT_EQ(100, scenario.OutputInterval);
+    EXPECT_EQ("out/run", scenario.OutputPrefix);
+    EXPECT_EQ(500, scenario.CheckpointInterval);
+    EXPECT_EQ("out/state", scenario.CheckpointPrefix);
+    EXPECT_EQ(10, scenario.HistoryInterval);
+    EXPECT_EQ("out/run.hist", scenario.HistoryPath);
+    EXPECT_EQ("out/state_500.ckpt", scenario.RestartPath);
+}
+
+TEST(Scenario, ErrorsNameTheLine)
+{
+    const char* bad[] = { "steps 10\ndomain 10\n", "steps 10\nfoo 1\n", "steps 10\nstorage fp8\n",
+        "steps 10\nprecision fp16\n", "steps 10\nobst circle 0 0 1\n", "steps 10\nsteps 5 6\n" };
+    for (const char* text : bad)
+    {
+        try
+        {
+            Scenario::Parse(text);
+            FAIL() << text;
+        }
+        catch (const std::runtime_error& e)
+        {
+            EXPECT_EQ(0, std::string(e.what()).find("line 2:")) << e.what();
+        }
+    }
+}
+
+namespace
+{
+    bool Rejects(const Scenario& p_scenario, const long long p_startStep)
+    {
+        try
+        {
+            p_scenario.Check(p_startStep);
+            return false;
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+    }
+}
+
+// In-place streaming marches in step pairs, so odd counts would overshoot and skip the outputs in between
+TEST(Scenario, InPlaceStreamingNeedsEvenSteps)
+{
+    const char* bad[] = { "streaming inplace\nsteps 9\n", "streaming inplace\noutput 3 out\n",
+        "streaming inplace\ncheckpoint 5 out\n", "streaming inplace\nhistory 7 out.hist\n" };
+    for (const char* text : bad)
+    {
+        try
+        {
+            Scenario::Parse(text);
+            FAIL() << text;
+        }
+        catch (const std::runtime_error& e)
+        {
+            EXPECT_TRUE(std::string(e.what()).find("even") != std::string::npos) << e.what();
+        }
+    }
+
+    Scenario scenario = Scenario::Parse("streaming inplace\nsteps 10\noutput 2 out\n");
+    EXPECT_FALSE(Rejects(scenario, 4));
+    EXPECT_TRUE(Rejects(scenario, 3));
+    scenario.Steps = 11;
+    EXPECT_TRUE(Rejects(scenario, 0));
+    scenario.Streaming = StreamingMode::PING_PONG;
+    EXPECT_FALSE(Rejects(scenario, 3));
+}
@@ -0,0 +1,106 @@
+#include "Simulation.h"
+#include "Solver/ObstRaster.h"
+#include "Test.h"
+#include "TestHelpers.h"
+#include <vector>
+
+using namespace Shizuku::Core::Types;
+using namespace Shizuku::Flow;
+using namespace Shizuku::Test;
+
+TEST(ObstRaster, FootprintRectCoversEveryInsideCell)
+{
+    const int xDim = 100;
+    for (const ObstDefinition& obst : { Square(0.f, 0.f, 0.1f), Square(-0.93f, -0.51f, 0.037f),
+        Square(0.5f, -0.8f, 0.25f) })
+    {
+        const CellRect rect = CellRectFromFootprint(obst, xDim);
+        for (int y = -10; y < xDim + 10; y++)
+        {
+            for (int x = -10; x < xDim + 10; x++)
+            {
+                if (!IsInsideFootprint(obst, ModelSpacePosFromSimPos(Point<int>(x, y), xDim)))
+                    continue;
+                ASSERT_TRUE(x >= rect.XBegin && x < rect.XEnd && y >= rect.YBegin && y < rect.YEnd)
+                    << x << ", " << y;
+            }
+        }
+    }
+}
+
+TEST(Simulation, StepAdvancesTime)
+{
+    Simulation simulation(64, 32, 2);
+    simulation.Step(10);
+    simulation.Step(5);
+    EXPECT_EQ(15, simulation.GetTimeStep());
+    simulation.Initialize();
+    EXPECT_EQ(0, simulation.GetTimeStep());
+}
+
+TEST(Simulation, ObstructionsAreRasterizedIntoTheSolver)
+{
+    const int xDim = 128;
+    const int yDim = 64;
+    Simulation open(xDim, yDim, 2);
+    Simulation blocked(xDim, yDim, 2);
+    //cells 38-50 of row 32
+    blocked.AddObstruction(Square(-0.3f, -0.5f, 0.1f));
+    ASSERT_EQ(1u, blocked.GetObstructions().size());
+    open.Initialize();
+    blocked.Initialize();
+    open.Step(100);
+    blocked.Step(100);
+
+    std::vector<float> openU(xDim*yDim);
+    std::vector<float> blockedU(xDim*yDim);
+    open.GetFields(nullptr, openU.data(), nullptr);
+    blocked.GetFields(nullptr, blockedU.data(), nullptr);
+    const int wake = 56 + 32*xDim;
+    EXPECT_NEAR(open.GetInletVelocity(), openU[wake], 1e-3f);
+    EXPECT_LT(blockedU[wake], 0.5f*blocked.GetInletVelocity());
+
+    blocked.ClearObstructions();
+    EXPECT_TRUE(blocked.GetObstructions().empty());
+}
+
+TEST(Simulation, ParametersReachTheSolver)
+{
+    Simulation simulation(32, 16, 1);
+    simulation.SetInletVelocity(0.08f);
+    simulation.SetOmega(1.5f);
+    simulation.SetPrecision(Precision::FP64);
+    simulation.SetStreamingMode(StreamingMode::IN_PLACE);
+    simulation.Initialize();
+    EXPECT_FLOAT_EQ(0.08f, simulation.GetInletVelocity());
+    EXPECT_FLOAT_EQ(1.5f, simulation.GetOmega());
+    EXPECT_EQ(Precision::FP64, simulation.GetPrecision());
+    EXPECT_EQ(DistributionStorage::FULL, simulation.GetDistributionStorage());
+    EXPECT_EQ(StreamingMode::IN_PLACE, simulation.GetStreamingMode());
+
+    std::vector<float> u(32*16);
+    simulation.GetFields(nullptr, u.data(), nullptr);
+    EXPECT_NEAR(0.08f, u[10 + 8*32], 1e-6f);
+}
+
+// Uniform flow between the symmetry edges stops changing almost at once, so with a threshold most tiles sleep. An
+// obstruction wakes them all for the step after it, and the ones it disturbs stay awake.
+TEST(Simulation, SteadyTilesSleepUntilTheFlowChanges)
+{
+    Simulation simulation(256, 128, 2);
+    simulation.SetSleepThreshold(1e-6f);
+    EXPECT_FLOAT_EQ(1e-6f, simulation.GetSleepThreshold());
+    simulation.Initialize();
+    simulation.Step(20);
+    EXPECT_EQ(32, simulation.GetTileCount());
+    const int steadyTiles = simulation.GetActiveTileCount();
+    EXPECT_LT(steadyTiles, simulation.GetTileCount());
+
+    simulation.AddObstruction(Square(-0.5f, -0.5f, 0.05f));
+    simulation.Step(1);
+    EXPECT_GT(simulation.GetActiveTileCount(), steadyTiles);
+
+    simulation.SetSleepThreshold(0.f);
+    simulation.Step(1);
+    EXPECT_EQ(simulation.GetTileCount(), simulation.GetActiveTileCount());
+}
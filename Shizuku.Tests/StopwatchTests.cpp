@@ -0,0 +1,75 @@
+#include "Shizuku.Core/Utilities/LatencyHistogram.h"
+#include "Shizuku.Core/Utilities/Stopwatch.h"
+#include "Test.h"
+
+using namespace Shizuku::Core;
+
+TEST(Stopwatch, HistogramPercentilesAreWithinABucket)
+{
+    LatencyHistogram histogram;
+    EXPECT_EQ(0.0, histogram.GetPercentile(50.0));
+
+    //1 to 1000 microseconds, evenly
+    for (int i = 1; i <= 1000; i++)
+        histogram.Record(i*1e-6);
+    EXPECT_EQ(1000, histogram.GetCount());
+    const double tolerance = 1.0 / LatencyHistogram::SubBuckets;
+    EXPECT_NEAR(500e-6, histogram.GetPercentile(50.0), 500e-6*tolerance);
+    EXPECT_NEAR(900e-6, histogram.GetPercentile(90.0), 900e-6*tolerance);
+    EXPECT_NEAR(990e-6, histogram.GetPercentile(99.0), 990e-6*tolerance);
+    EXPECT_NEAR(1e-6, histogram.GetPercentile(0.0), 1e-6*tolerance);
+    EXPECT_EQ(1000e-6, histogram.GetPercentile(100.0));
+    EXPECT_EQ(1000e-6, histogram.GetMax());
+
+    histogram.Reset();
+    EXPECT_EQ(0, histogram.GetCount());
+    EXPECT_EQ(0.0, histogram.GetMax());
+}
+
+TEST(Stopwatch, HistogramShowsRareSpikes)
+{
+    //a 50 ms hitch every hundred 2 ms frames moves the mean little but owns the tail
+    LatencyHistogram histogram;
+    double total = 0.0;
+    for (int i = 0; i < 1000; i++)
+    {
+        const double frame = i % 100 == 99 ? 50e-3 : 2e-3;
+        histogram.Record(frame);
+        total += frame;
+    }
+    EXPECT_LT(total / 1000, 2.5e-3);
+    EXPECT_NEAR(2e-3, histogram.GetPercentile(50.0), 2e-3 / LatencyHistogram::SubBuckets);
+    EXPECT_NEAR(2e-3, histogram.GetPercentile(98.0), 2e-3 / LatencyHistogram::SubBuckets);
+    EXPECT_NEAR(50e-3, histogram.GetPercentile(99.5), 50e-3 / LatencyHistogram::SubBuckets);
+    EXPECT_EQ(50e-3, histogram.GetMax());
+}
+
+TEST(Stopwatch, HistogramCoversNanosecondsToHours)
+{
+    LatencyHistogram histogram;
+    histogram.Record(0.0);
+    histogram.Record(3e-9);
+    histogram.Record(3600.0);
+    histogram.Record(1e9);
+    histogram.Record(-1.0);
+    EXPECT_EQ(5, histogram.GetCount());
+    EXPECT_EQ(0.0, histogram.GetPercentile(20.0));
+    EXPECT_NEAR(3e-9, histogram.GetPercentile(60.0), 1e-12);
+    EXPECT_NEAR(3600.0, histogram.GetPercentile(80.0), 3600.0 / LatencyHistogram::SubBuckets);
+    EXPECT_EQ(1e9, histogram.GetMax());
+}
+
+TEST(Stopwatch, KeepsPercentilesOfEveryTock)
+{
+    Stopwatch stopwatch(2);
+    for (int i = 0; i < 5; i++)
+    {
+        stopwatch.Tick();
+        stopwatch.Tock();
+    }
+    EXPECT_LE(stopwatch.GetPercentile(50.0), stopwatch.GetMax());
+    EXPECT_LT(0.0, stopwatch.GetMax());
+    stopwatch.Reset();
+    EXPECT_EQ(0.0, stopwatch.GetMax());
+    EXPECT_EQ(0.0, stopwatch.GetPercentile(99.0));
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//! Minimal test harness, so the tests build wherever the libraries do. Mirrors the GoogleTest macros: EXPECT_*
+//! records a failure and carries on, ASSERT_* and FAIL also leave the test, and all of them take a trailing
+//! << message.
+namespace Shizuku { namespace Test{
+    struct TestCase
+    {
+        std::string Suite;
+        std::string Name;
+        std::function<void()> Body;
+    };
+
+    std::vector<TestCase>& Registry();
+    //! Counts failures of the running test
+    void ReportFailure(const char* p_file, const int p_line, const std::string& p_message);
+
+    struct Registrar
+    {
+        Registrar(const char* p_suite, const char* p_name, const std::function<void()>& p_body)
+        {
+            Registry().push_back(TestCase{ p_suite, p_name, p_body });
+        }
+    };
+
+    //! Reports when destroyed, after the trailing << message has been streamed in
+    class Failure
+    {
+    private:
+        const char* m_file;
+        int m_line;
+        std::ostringstream m_message;
+    public:
+        Failure(const char* p_file, const int p_line, const std::string& p_check)
+            : m_file(p_file), m_line(p_line)
+        {
+            m_message << p_check;
+        }
+        ~Failure()
+        {
+            ReportFailure(m_file, m_line, m_message.str());
+        }
+
+        template <typename T>
+        Failure& operator<<(const T& p_value)
+        {
+            m_message << " " << p_value;
+            return *this;
+        }
+    };
+
+    //! Lets ASSERT_* return from a void test body
+    struct Fatal
+    {
+        void operator=(const Failure&)
+        {
+        }
+    };
+
+    template <typename A, typename B>
+    std::string Compared(const char* p_check, const A& p_a, const B& p_b)
+    {
+        std::ostringstream message;
+        message << p_check << " (" << p_a << " vs " << p_b << ")";
+        return message.str();
+    }
+} }
+
+#define SHIZUKU_TEST_NAME(suite, name) suite##_##name##_Test
+
+#define TEST(suite, name) \
+    static void SHIZUKU_TEST_NAME(suite, name)(); \
+    static Shizuku::Test::Registrar SHIZUKU_TEST_NAME(suite, name##_registrar)(#suite, #name, \
+        &SHIZUKU_TEST_NAME(suite, name)); \
+    static void SHIZUKU_TEST_NAME(suite, name)()
+
+// The else of the check is its own, so an else after it still belongs to an unbraced if around it. The switch, as
+// in GoogleTest, stops clang and MSVC warning about that if; GCC warns anyway, so brace it.
+#define SHIZUKU_EXPECT(condition, check) \
+    switch (0) case 0: default: \
+    if (condition) ; else Shizuku::Test::Failure(__FILE__, __LINE__, check)
+#define SHIZUKU_ASSERT(condition, check) \
+    switch (0) case 0: default: \
+    if (condition) ; else return Shizuku::Test::Fatal() = Shizuku::Test::Failure(__FILE__, __LINE__, check)
+#define SHIZUKU_COMPARED(a, op, b) Shizuku::Test::Compared(#a " " #op " " #b, (a), (b))
+
+#define EXPECT_TRUE(condition) SHIZUKU_EXPECT(condition, #condition)
+#define EXPECT_FALSE(condition) SHIZUKU_EXPECT(!(condition), "!(" #condition ")")
+#define EXPECT_EQ(a, b) SHIZUKU_EXPECT((a) == (b), SHIZUKU_COMPARED(a, ==, b))
+#define EXPECT_LT(a, b) SHIZUKU_EXPECT((a) < (b), SHIZUKU_COMPARED(a, <, b))
+#define EXPECT_LE(a, b) SHIZUKU_EXPECT((a) <= (b), SHIZUKU_COMPARED(a, <=, b))
+#define EXPECT_GT(a, b) SHIZUKU_EXPECT((a) > (b), SHIZUKU_COMPARED(a, >, b))
+#define EXPECT_NEAR(a, b, tolerance) \
+    SHIZUKU_EXPECT(std::abs((a) - (b)) <= (tolerance), SHIZUKU_COMPARED(a, ~=, b))
+#define EXPECT_FLOAT_EQ(a, b) EXPECT_NEAR(a, b, 1e-6f*std::abs(b))
+
+#define ASSERT_TRUE(condition) SHIZUKU_ASSERT(condition, #condition)
+#define ASSERT_FALSE(condition) SHIZUKU_ASSERT(!(condition), "!(" #condition ")")
+#define ASSERT_EQ(a, b) SHIZUKU_ASSERT((a) == (b), SHIZUKU_COMPARED(a, ==, b))
+#define ASSERT_GT(a, b) SHIZUKU_ASSERT((a) > (b), SHIZUKU_COMPARED(a, >, b))
+#define ASSERT_NEAR(a, b, tolerance) \
+    SHIZUKU_ASSERT(std::abs((a) - (b)) <= (tolerance), SHIZUKU_COMPARED(a, ~=, b))
+#define FAIL() return Shizuku::Test::Fatal() = Shizuku::Test::Failure(__FILE__, __LINE__, "failed")
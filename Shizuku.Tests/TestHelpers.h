@@ -0,0 +1,24 @@
+#pragma once
+#include "Graphics/ObstDefinition.h"
+#include <string>
+
+//! Fixtures shared by the suites that drive a Simulation or write files
+namespace Shizuku { namespace Test{
+    //! Square obstruction of half width p_r1 centred on (p_x, p_y) in model space
+    inline Shizuku::Flow::ObstDefinition Square(const float p_x, const float p_y, const float p_r1)
+    {
+        Shizuku::Flow::ObstDefinition obst = {};
+        obst.shape = Shizuku::Flow::Shape::SQUARE;
+        obst.x = p_x;
+        obst.y = p_y;
+        obst.r1 = p_r1;
+        obst.r2 = p_r1;
+        return obst;
+    }
+
+    //! File name in the working directory that a test owns and removes, e.g. TempPath("round_trip", ".ckpt")
+    inline std::string TempPath(const char* p_name, const char* p_extension)
+    {
+        return std::string("shizuku_test_") + p_name + p_extension;
+    }
+} }
@@ -0,0 +1,52 @@
+#include "Test.h"
+#include <cstdio>
+
+using namespace Shizuku::Test;
+
+namespace
+{
+    int s_failures = 0;
+}
+
+std::vector<TestCase>& Shizuku::Test::Registry()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+void Shizuku::Test::ReportFailure(const char* p_file, const int p_line, const std::string& p_message)
+{
+    printf("%s:%d: %s\n", p_file, p_line, p_message.c_str());
+    s_failures++;
+}
+
+//! shizuku_tests [<suite>...] runs the tests of the given suites, or all of them
+int main(int argc, char **argv)
+{
+    int run = 0;
+    std::vector<std::string> failed;
+    for (const TestCase& test : Registry())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            selected = selected || test.Suite == argv[i];
+        if (!selected)
+            continue;
+
+        const std::string name = test.Suite + "." + test.Name;
+        printf("[ RUN      ] %s\n", name.c_str());
+        fflush(stdout);
+        const int failuresBefore = s_failures;
+        test.Body();
+        const bool passed = s_failures == failuresBefore;
+        printf("%s %s\n", passed ? "[       OK ]" : "[  FAILED  ]", name.c_str());
+        if (!passed)
+            failed.push_back(name);
+        run++;
+    }
+
+    printf("%d tests, %d failed\n", run, static_cast<int>(failed.size()));
+    for (const std::string& name : failed)
+        printf("  %s\n", name.c_str());
+    return failed.empty() && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+#include "Shizuku.Core/Utilities/ThreadPool.h"
+#include "Test.h"
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Shizuku::Core;
+
+TEST(ThreadPool, ParallelForVisitsEachIndexOnce)
+{
+    for (const int threads : { 1, 2, 4 })
+    {
+        ThreadPool pool(threads);
+        for (const int count : { 0, 1, 7, 1000 })
+        {
+            for (const int grain : { 1, 3, 64 })
+            {
+                std::vector<std::atomic<int>> visits(count);
+                for (auto& visit : visits)
+                    visit = 0;
+                pool.ParallelFor(count, grain, [&](const int p_begin, const int p_end){
+                    //a single worker runs the whole range at once
+                    if (threads > 1)
+                    {
+                        EXPECT_LE(p_end - p_begin, grain);
+                    }
+                    for (int i = p_begin; i < p_end; i++)
+                        visits[i]++;
+                });
+                for (int i = 0; i < count; i++)
+                    ASSERT_EQ(1, visits[i].load()) << threads << " threads, count " << count << ", grain " << grain;
+            }
+        }
+    }
+}
+
+TEST(ThreadPool, WorkerStatsCountChunks)
+{
+    ThreadPool pool(2);
+    pool.ResetWorkerStats();
+    pool.ParallelFor(100, 10, [](const int, const int){});
+    long long chunks = 0;
+    for (int worker = 0; worker < pool.ThreadCount(); worker++)
+        chunks += pool.GetWorkerStats(worker).Chunks;
+    //steals split ranges off the grain boundaries, which can add a chunk or two
+    EXPECT_LE(10, chunks);
+    EXPECT_LT(chunks, 100);
+}
+
+TEST(ThreadPool, WorkerIdsMatchTheStats)
+{
+    ThreadPool pool(3);
+    pool.ResetWorkerStats();
+    std::vector<std::atomic<int>> chunks(pool.ThreadCount());
+    for (auto& count : chunks)
+        count = 0;
+    std::atomic<bool> inRange(true);
+    pool.ParallelForWorker(90, 3, [&](const int p_worker, const int, const int){
+        if (p_worker < 0 || p_worker >= pool.ThreadCount())
+        {
+            inRange = false;
+            return;
+        }
+        chunks[p_worker]++;
+    });
+    ASSERT_TRUE(inRange.load());
+    for (int worker = 0; worker < pool.ThreadCount(); worker++)
+        EXPECT_EQ(pool.GetWorkerStats(worker).Chunks, chunks[worker].load()) << "worker " << worker;
+}
+
+TEST(ThreadPool, BodyExceptionsReachTheCaller)
+{
+    for (const int threads : { 1, 3 })
+    {
+        ThreadPool pool(threads);
+        std::atomic<int> visited(0);
+        bool caught = false;
+        try
+        {
+            pool.ParallelFor(1000, 10, [&](const int p_begin, const int p_end){
+                visited += p_end - p_begin;
+                if (p_begin <= 500 && 500 < p_end)
+                    throw std::runtime_error("chunk 500");
+            });
+        }
+        catch (const std::runtime_error& e)
+        {
+            caught = std::string(e.what()) == "chunk 500";
+        }
+        EXPECT_TRUE(caught) << threads << " threads";
+        EXPECT_LE(visited.load(), 1000);
+
+        //the pool carries on as before
+        std::atomic<int> sum(0);
+        pool.ParallelFor(100, 7, [&](const int p_begin, const int p_end){ sum += p_end - p_begin; });
+        EXPECT_EQ(100, sum.load()) << threads << " threads";
+    }
+}
+
+TEST(ThreadPool, NestedCallsThrowInsteadOfDeadlocking)
+{
+    ThreadPool pool(2);
+    std::atomic<int> rejected(0);
+    pool.ParallelFor(4, 1, [&](const int, const int){
+        try
+        {
+            pool.ParallelFor(10, [](const int, const int){});
+        }
+        catch (const std::logic_error&)
+        {
+            rejected++;
+        }
+    });
+    EXPECT_EQ(4, rejected.load());
+
+    //a body may still use another pool
+    ThreadPool inner(2);
+    std::atomic<int> sum(0);
+    pool.ParallelFor(4, 1, [&](const int, const int){
+        inner.ParallelFor(10, 5, [&](const int p_begin, const int p_end){ sum += p_end - p_begin; });
+    });
+    EXPECT_EQ(40, sum.load());
+}
+
+TEST(ThreadPool, CallsFromSeveralThreadsTakeTurns)
+{
+    ThreadPool pool(3);
+    std::vector<std::atomic<int>> visits(4*5000);
+    for (auto& visit : visits)
+        visit = 0;
+    std::vector<std::thread> callers;
+    for (int caller = 0; caller < 4; caller++)
+    {
+        callers.push_back(std::thread([&, caller]{
+            for (int round = 0; round < 50; round++)
+            {
+                pool.ParallelFor(5000, 64, [&](const int p_begin, const int p_end){
+                    for (int i = p_begin; i < p_end; i++)
+                        visits[caller*5000 + i]++;
+                });
+            }
+        }));
+    }
+    for (auto& thread : callers)
+        thread.join();
+    int wrong = 0;
+    for (const auto& visit : visits)
+    {
+        if (visit.load() != 50)
+            wrong++;
+    }
+    EXPECT_EQ(0, wrong);
+}
@@ -0,0 +1,56 @@
+#include "Shizuku.Core/Utilities/TripleBuffer.h"
+#include "Test.h"
+#include <thread>
+
+using namespace Shizuku::Core;
+
+TEST(TripleBuffer, AcquireReturnsLatestPublished)
+{
+    TripleBuffer<int> buffer;
+    EXPECT_FALSE(buffer.Acquire());
+
+    buffer.Back() = 1;
+    buffer.Publish();
+    buffer.Back() = 2;
+    buffer.Publish();
+    EXPECT_TRUE(buffer.Acquire());
+    EXPECT_EQ(2, buffer.Front());
+    EXPECT_FALSE(buffer.Acquire());
+    EXPECT_EQ(2, buffer.Front());
+
+    buffer.Back() = 3;
+    buffer.Publish();
+    EXPECT_TRUE(buffer.Acquire());
+    EXPECT_EQ(3, buffer.Front());
+}
+
+TEST(TripleBuffer, ConsumerSeesIncreasingValues)
+{
+    struct Value
+    {
+        int A;
+        int B;
+    };
+    TripleBuffer<Value> buffer;
+    const int count = 100000;
+    std::thread producer([&]{
+        for (int i = 1; i <= count; i++)
+        {
+            buffer.Back().A = i;
+            buffer.Back().B = -i;
+            buffer.Publish();
+        }
+    });
+
+    int last = 0;
+    while (last < count)
+    {
+        if (!buffer.Acquire())
+            continue;
+        const Value& value = buffer.Front();
+        ASSERT_EQ(-value.A, value.B);
+        ASSERT_GT(value.A, last);
+        last = value.A;
+    }
+    producer.join();
+}
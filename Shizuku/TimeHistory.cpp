@@ -24,7 +24,7 @@ void TimeHistory::Append(const double p_value)
 
 float TimeHistory::DataProvider(void* p_data, int p_index)
 {
-    return static_cast<float>(m_queue[p_index]);
+    return static_cast<float>(static_cast<TimeHistory*>(p_data)->m_queue[p_index]);
 }
 
 void TimeHistory::Resize(const int p_size)
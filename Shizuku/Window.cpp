@@ -23,6 +23,10 @@
 #include "Shizuku.Flow/Command/SetSurfaceShadingMode.h"
 #include "Shizuku.Flow/Command/SetWaterDepth.h"
 #include "Shizuku.Flow/Command/RestartSimulation.h"
+#include "Shizuku.Flow/Command/SaveCheckpoint.h"
+#include "Shizuku.Flow/Command/LoadCheckpoint.h"
+#include "Shizuku.Flow/Command/RecordFields.h"
+#include "Shizuku.Flow/Command/ReplayFields.h"
 #include "Shizuku.Flow/Command/SetFloorWireframeVisibility.h"
 #include "Shizuku.Flow/Command/SetLightProbeVisibility.h"
 #include "Shizuku.Flow/Command/SetToTopView.h"
@@ -34,13 +38,14 @@
 #include "Shizuku.Flow/Command/Parameter/MinMaxParameter.h"
 #include "Shizuku.Flow/Command/Parameter/DepthParameter.h"
 #include "Shizuku.Flow/Command/Parameter/VisibilityParameter.h"
+#include "Shizuku.Flow/Command/Parameter/PathParameter.h"
 
 #include "Shizuku.Flow/Query.h"
 #include "Shizuku.Flow/Flow.h"
-#include "Shizuku.Flow/TimerKey.h"
 
 #include "Shizuku.Core/Ogl/Ogl.h"
 #include "Shizuku.Core/Ogl/Shader.h"
+#include "Shizuku.Core/Utilities/Profiler.h"
 
 #include <GLFW/glfw3.h>
 
@@ -56,6 +61,9 @@ using namespace Shizuku::Flow;
 
 namespace
 {
+    const char* const CheckpointPath = "shizuku.ckpt";
+    const char* const RecordingPath = "shizuku.hist";
+
     void ResizeWrapper(GLFWwindow* window, int width, int height)
     {
         Window::Instance().Resize(Rect<int>(width, height));
@@ -130,47 +138,38 @@ namespace
         }
     }
 
-    namespace TimeHistoryProviders{
-        static float SolveFluid(void* data, int i) { return TimeHistory::Instance(TimerKey::SolveFluid).DataProvider(data, i); }
-        static float PrepareFloor(void* data, int i) { return TimeHistory::Instance(TimerKey::PrepareFloor).DataProvider(data, i); }
-        static float PrepareSurf(void* data, int i) { return TimeHistory::Instance(TimerKey::PrepareSurface).DataProvider(data, i); }
-        static float ProcessFloor(void* data, int i) { return TimeHistory::Instance(TimerKey::ProcessFloor).DataProvider(data, i); }
-        static float ProcessSurf(void* data, int i) { return TimeHistory::Instance(TimerKey::ProcessSurface).DataProvider(data, i); }
-    }
-
-    void CreateHistoryPlotLines(Query& p_query, const TimerKey p_key, const char* p_label)
+    void CreateHistoryPlotLines(Query& p_query, const char* p_zone, const char* p_label)
     {
-        const double time = p_query.GetTime(p_key);
-        TimeHistory::Instance(p_key).Append(time);
-
-        float(*provider) (void*, int) = NULL;
-        switch (p_key)
-        {
-            case TimerKey::SolveFluid:
-                provider = TimeHistoryProviders::SolveFluid;
-                break;
-            case TimerKey::PrepareSurface:
-                provider = TimeHistoryProviders::PrepareSurf;
-                break;
-            case TimerKey::PrepareFloor:
-                provider = TimeHistoryProviders::PrepareFloor;
-                break;
-            case TimerKey::ProcessSurface:
-                provider = TimeHistoryProviders::ProcessSurf;
-                break;
-            case TimerKey::ProcessFloor:
-                provider = TimeHistoryProviders::ProcessFloor;
-                break;
-            default:
-                throw "Unexpected TimerKey";
-        }
+        const double time = p_query.GetTime(p_zone);
+        TimeHistory& history = TimeHistory::Instance(p_zone);
+        history.Append(time);
 
-        const MinMax<double> minMax = TimeHistory::Instance(p_key).MinMax();
+        const MinMax<double> minMax = history.MinMax();
         char timeStr[64];
         sprintf_s(timeStr, "%f", time);
         const int chartHeight = 64;
-        ImGui::PlotLines(p_label, provider, NULL, (TimeHistory::Instance(p_key).Size()), 0, timeStr,
+        ImGui::PlotLines(p_label, TimeHistory::DataProvider, &history, history.Size(), 0, timeStr,
             minMax.Min, minMax.Max, ImVec2(0, chartHeight));
+        //the mean hides hitches, the tail shows them
+        ImGui::Text("ms  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f", 1e3*p_query.GetTime(p_zone, TimeStatistic::P50),
+            1e3*p_query.GetTime(p_zone, TimeStatistic::P90), 1e3*p_query.GetTime(p_zone, TimeStatistic::P99),
+            1e3*p_query.GetTime(p_zone, TimeStatistic::MAX));
+    }
+
+    //! Per update of counted zone p_zone, summed over the workers that ran it. Nothing until the zone has run.
+    void CreateCounterText(Query& p_query, const char* p_zone, const char* p_label)
+    {
+        if (p_query.GetCounter(p_zone, CounterStatistic::UPDATES) == 0.0)
+            ImGui::Text("%-14s not run yet", p_label);
+        else if (p_query.HasHardwareCounters())
+            ImGui::Text("%-14s IPC %.2f  LLC misses/upd %.3f  B/upd %.1f  cpu ns/upd %.1f", p_label,
+                p_query.GetCounter(p_zone, CounterStatistic::IPC),
+                p_query.GetCounter(p_zone, CounterStatistic::LLC_MISSES),
+                p_query.GetCounter(p_zone, CounterStatistic::LLC_BYTES),
+                p_query.GetCounter(p_zone, CounterStatistic::CPU_NANOSECONDS));
+        else
+            ImGui::Text("%-14s IPC n/a  LLC n/a  cpu ns/upd %.1f", p_label,
+                p_query.GetCounter(p_zone, CounterStatistic::CPU_NANOSECONDS));
     }
 
     float ScaleFromResolution(const float p_res)
@@ -189,6 +188,7 @@ Window::Window() :
     m_depth(0.5f),
     m_paused(false),
     m_diagEnabled(false),
+    m_countersEnabled(false),
     //m_history(20),
     m_shadingMode(SurfaceShadingMode::RayTracing)
 {
@@ -215,6 +215,10 @@ void Window::RegisterCommands()
     m_pauseSimulation = std::make_shared<PauseSimulation>(*m_flow);
     m_pauseRayTracing = std::make_shared<PauseRayTracing>(*m_flow);
     m_restartSimulation = std::make_shared<RestartSimulation>(*m_flow);
+    m_saveCheckpoint = std::make_shared<SaveCheckpoint>(*m_flow);
+    m_loadCheckpoint = std::make_shared<LoadCheckpoint>(*m_flow);
+    m_recordFields = std::make_shared<RecordFields>(*m_flow);
+    m_replayFields = std::make_shared<ReplayFields>(*m_flow);
     m_setSimulationScale = std::make_shared<SetSimulationScale>(*m_flow);
     m_timestepsPerFrame = std::make_shared<SetTimestepsPerFrame>(*m_flow);
     m_setVelocity = std::make_shared<SetInletVelocity>(*m_flow);
@@ -280,6 +284,8 @@ void Window::EnableDebug()
 void Window::EnableDiagnostics()
 {
     m_diagEnabled = true;
+    //the zones cost next to nothing until the plots need them
+    Shizuku::Core::Profiler::Enable(true);
 }
 
 void Window::MouseButton(const int button, const int state, const int mod)
@@ -555,6 +561,21 @@ void Window::DrawUI()
 
         if (ImGui::Button("Restart simulation"))
             m_restartSimulation->Start();
+        if (ImGui::Button("Save checkpoint"))
+            m_saveCheckpoint->Start(boost::any(PathParameter(CheckpointPath)));
+        ImGui::SameLine();
+        if (ImGui::Button("Load checkpoint"))
+            m_loadCheckpoint->Start(boost::any(PathParameter(CheckpointPath)));
+
+        bool recording = m_query->IsRecording();
+        if (ImGui::Checkbox("Record fields", &recording))
+            m_recordFields->Start(boost::any(PathParameter(recording ? RecordingPath : "")));
+        bool replaying = m_query->IsReplaying();
+        if (ImGui::Checkbox("Replay recording", &replaying))
+            m_replayFields->Start(boost::any(PathParameter(replaying ? RecordingPath : "")));
+        const std::string status = m_query->StatusMessage();
+        if (!status.empty())
+            ImGui::TextWrapped("%s", status.c_str());
 
         const bool oldPaused = m_paused;
         if (ImGui::Checkbox("Pause simulation", &m_paused) && m_paused != oldPaused)
@@ -583,17 +604,28 @@ void Window::DrawUI()
     {
         if (m_firstUIDraw)
         {
-            ImGui::SetNextWindowSize(ImVec2(370,250));
+            ImGui::SetNextWindowSize(ImVec2(370,500));
             ImGui::SetNextWindowPos(ImVec2(m_size.Width-370-5,5));
         }
 
         ImGui::Begin("Diagnostics");
         {
-            CreateHistoryPlotLines(*m_query, TimerKey::SolveFluid, "Solve Fluid");
-            CreateHistoryPlotLines(*m_query, TimerKey::PrepareSurface, "Prepare Surface");
-            CreateHistoryPlotLines(*m_query, TimerKey::PrepareFloor, "Prepare Floor");
-            //CreateHistoryPlotLines(*m_query, TimerKey::ProcessSurface, "Process Surface");
-            //CreateHistoryPlotLines(*m_query, TimerKey::ProcessFloor, "Process Floor");
+            CreateHistoryPlotLines(*m_query, "SolveFluid", "Solve Fluid");
+            CreateHistoryPlotLines(*m_query, "PrepareSurface", "Prepare Surface");
+            CreateHistoryPlotLines(*m_query, "PrepareFloor", "Prepare Floor");
+            CreateHistoryPlotLines(*m_query, "Frame", "Frame");
+            if (ImGui::Button("Reset percentiles"))
+                m_query->ResetTimes();
+            const bool oldCountersEnabled = m_countersEnabled;
+            if (ImGui::Checkbox("Hardware counters", &m_countersEnabled) && m_countersEnabled != oldCountersEnabled)
+                m_query->EnableCounters(m_countersEnabled);
+            if (m_countersEnabled)
+            {
+                //the solve, normals and caustics run on the GPU, where the host counters see nothing
+                ImGui::TextDisabled("Host threads only; GPU passes aren't counted");
+                CreateCounterText(*m_query, "CpuLattice", "CPU solver");
+                CreateCounterText(*m_query, "ImageRows", "Image rebuild");
+            }
         }
         ImGui::End();
     }
@@ -615,13 +647,23 @@ void Window::Display()
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     while (!glfwWindowShouldClose(m_window))
     {
-        glfwPollEvents();
+        {
+            SHIZUKU_ZONE("Frame");
+            glfwPollEvents();
 
-        Draw3D();
+            Draw3D();
 
-        DrawUI();
+            {
+                SHIZUKU_ZONE("DrawUI");
+                DrawUI();
+            }
 
-        glfwSwapBuffers(m_window);
+            SHIZUKU_ZONE("SwapBuffers");
+            glfwSwapBuffers(m_window);
+        }
+        //once a frame, so the rings of the threads never fill up
+        if (Profiler::IsEnabled())
+            Profiler::Collect();
     }
     glfwTerminate();
 }
@@ -26,6 +26,10 @@ namespace Shizuku{
             class PauseSimulation; 
             class PauseRayTracing;
             class RestartSimulation;
+            class SaveCheckpoint;
+            class LoadCheckpoint;
+            class RecordFields;
+            class ReplayFields;
             class SetSimulationScale;
             class SetTimestepsPerFrame;
             class SetContourMode;
@@ -64,6 +68,10 @@ namespace Shizuku{ namespace Presentation{
         std::shared_ptr<PauseSimulation> m_pauseSimulation;
         std::shared_ptr<PauseRayTracing> m_pauseRayTracing;
         std::shared_ptr<RestartSimulation> m_restartSimulation;
+        std::shared_ptr<SaveCheckpoint> m_saveCheckpoint;
+        std::shared_ptr<LoadCheckpoint> m_loadCheckpoint;
+        std::shared_ptr<RecordFields> m_recordFields;
+        std::shared_ptr<ReplayFields> m_replayFields;
         std::shared_ptr<SetSimulationScale> m_setSimulationScale;
         std::shared_ptr<SetTimestepsPerFrame> m_timestepsPerFrame;
         std::shared_ptr<SetInletVelocity> m_setVelocity;
@@ -94,6 +102,7 @@ namespace Shizuku{ namespace Presentation{
         bool m_lightProbeEnabled;
         bool m_topViewMode;
         bool m_diagEnabled;
+        bool m_countersEnabled;
         bool m_debug;
 
         TimeHistory m_history;
@@ -1,23 +1,35 @@
 #include "Window.h"
 #include "Shizuku.Flow/Flow.h"
+#include "Shizuku.Core/Utilities/Profiler.h"
+#include <stdio.h>
 #include <string.h>
 #include <memory>
+#include <string>
 
 using namespace Shizuku::Presentation;
 using namespace Shizuku::Flow;
+using namespace Shizuku::Core;
 
 int main(int argc, char **argv)
 {
     bool debug(false);
     bool diag(false);
+    std::string tracePath;
     for (int i = 0; i < argc; ++i)
     {
         if (strcmp(argv[i], "-d") == 0)
             debug = true;
         else if (strcmp(argv[i], "-v") == 0)
             diag = true;
+        //-t <path> writes a Chrome trace of every frame's stages to path on exit
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
     }
 
+    Profiler::SetThreadName("Main");
+    if (!tracePath.empty())
+        Profiler::StartTrace();
+
     std::shared_ptr<Flow> flow = std::make_shared<Flow>();
 
     Rect<int> windowSize = Rect<int>(1200, 700);
@@ -40,5 +52,13 @@ int main(int argc, char **argv)
 
     Window::Instance().Display();
 
+    if (!tracePath.empty())
+    {
+        Profiler::Collect();
+        Profiler::StopTrace();
+        if (!Profiler::WriteTrace(tracePath))
+            printf("Can't write the trace to %s\n", tracePath.c_str());
+    }
+
     return 0;
 }
\ No newline at end of file